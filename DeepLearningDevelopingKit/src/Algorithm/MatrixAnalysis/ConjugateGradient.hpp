@@ -0,0 +1,475 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	      Conjugate Gradient Solver                                                */
+/*								        		 	                Matrix   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "..\..\MathLib\MathLib.h"
+
+
+namespace MathLib
+{
+	namespace IterativeSolver
+	{
+		// Linear operator
+		/// Computes _y = A * _x, both buffers hold n elements. Used for matrix-free systems and preconditioners.
+		template<class T>
+		using LinearOperator = std::function<void(const T * _x, T * _y)>;
+
+		// Preconditioner
+		/// None : plain conjugate gradient.
+		/// Jacobi : M = diag(A), cheap and fully parallel.
+		/// IncompleteCholesky : M = L * L^T with L restricted to the pattern of the lower triangle of A, IC(0).
+		enum class Preconditioner {
+			None,
+			Jacobi,
+			IncompleteCholesky
+		};
+
+		// Conjugate Gradient Initor
+		/// Iteration stops when ||r|| / ||b|| < Tolerance or after MaxIteration steps (0 means the size of the system).
+		/// Monitor, if set, is called after every step with the step number and the relative residual.
+		template<class T>
+		struct CGInitor
+		{
+			size_t MaxIteration = 0;
+			T Tolerance = T(1e-10);
+			Preconditioner Precondition = Preconditioner::Jacobi;
+			bool RecordHistory = true;
+			std::function<void(size_t, T)> Monitor;
+		};
+
+		// Conjugate Gradient Report
+		/// Residual is the relative residual of the recurrence, TrueResidual is ||b - A * x|| / ||b|| recomputed at exit.
+		/// History holds the relative residual of every step when RecordHistory is set.
+		/// Times are in milliseconds, SetupTime covers building the preconditioner.
+		template<class T>
+		struct CGReport
+		{
+			bool Converged = false;
+			size_t Iteration = 0;
+			size_t OperatorCall = 0;
+			T Residual = T(0);
+			T TrueResidual = T(0);
+			double SetupTime = 0;
+			double SolveTime = 0;
+			std::vector<T> History;
+		};
+
+		/***************************************************************************************************/
+		// Class : JacobiPreconditioner
+		/// z = D^-1 * r, zero diagonal elements are treated as ones.
+		template<class T>
+		class JacobiPreconditioner
+		{
+		public:
+
+			explicit JacobiPreconditioner(const std::vector<T> & _diagonal);
+
+			// Apply the preconditioner, _z = M^-1 * _r.
+			void operator()(const T * _r, T * _z) const;
+
+		private:
+
+			std::vector<T> _inverse;
+		};
+
+		/***************************************************************************************************/
+		// Class : IncompleteCholesky
+		/// Zero fill-in incomplete Cholesky factor of a symmetric positive definite SparseMatrix.
+		/// Only the lower triangle of A is read. When a pivot breaks down, A + shift * diag(A) is factored
+		/// instead, the shift starting at 1e-3 and doubling until the factorization succeeds.
+		/// The triangular solves are sequential by nature, the factor is built once per system.
+		template<class T>
+		class IncompleteCholesky
+		{
+		public:
+
+			explicit IncompleteCholesky(const SparseMatrix<T> & _mat);
+
+			// Apply the preconditioner, _z = (L * L^T)^-1 * _r.
+			void operator()(const T * _r, T * _z) const;
+
+			// Diagonal shift used by the factorization, zero when no breakdown occured.
+			inline T GetShift(void) const { return _shift; }
+
+		private:
+
+			bool Factorize(const T _shift);
+
+		private:
+
+			size_t n;
+			std::vector<size_t> _rowBegin;
+			std::vector<size_t> _columnIndex;
+			std::vector<T> _lower;
+			std::vector<T> _value;
+			T _shift;
+		};
+
+		// Preconditioned conjugate gradient
+		/// Solve A * x = b for a symmetric positive definite A given as an operator of size _n.
+		/// _precondition applies M^-1, pass an empty operator for no preconditioning.
+		/// _x holds the initial guess on entry and the solution on exit.
+		template<class T>
+		CGReport<T> ConjugateGradient(const LinearOperator<T> & _operator, const LinearOperator<T> & _precondition,
+			const size_t _n, const T * _b, T * _x, const CGInitor<T> & _initor);
+
+		// Conjugate gradient on a SparseMatrix.
+		/// The products with A are parallel sparse matrix vector products.
+		/// An empty _x is taken as a zero initial guess.
+		template<class T>
+		CGReport<T> ConjugateGradient(const SparseMatrix<T> & _mat, const Vector<T> & _b, Vector<T> & _x,
+			const CGInitor<T> & _initor = CGInitor<T>());
+
+		// Conjugate gradient on a dense Matrix.
+		/// The products with A go through GEMM. The incomplete Cholesky factor of a dense matrix is its
+		/// full Cholesky factor, which costs O(n^3), prefer Jacobi for large dense systems.
+		template<class T>
+		CGReport<T> ConjugateGradient(const Matrix<T> & _mat, const Vector<T> & _b, Vector<T> & _x,
+			const CGInitor<T> & _initor = CGInitor<T>());
+
+		// Matrix-free conjugate gradient.
+		/// _operator computes A * x. Jacobi preconditioning needs the _diagonal of A,
+		/// incomplete Cholesky needs the elements of A and is not available here.
+		template<class T>
+		CGReport<T> ConjugateGradient(const LinearOperator<T> & _operator, const Vector<T> & _b, Vector<T> & _x,
+			const CGInitor<T> & _initor = CGInitor<T>(), const std::vector<T> & _diagonal = std::vector<T>());
+
+		namespace Internal
+		{
+			// Inner product of two buffers through ParallelReduce.
+			template<class T>
+			T Dot(const T * _a, const T * _b, const size_t _n)
+			{
+				return ParallelReduce(0, _n, T(0), [_a, _b](size_t _begin, size_t _end) {
+					T sum = 0;
+					for (size_t i = _begin; i < _end; i++)
+						sum += _a[i] * _b[i];
+					return sum;
+				}, [](T _left, T _right) { return _left + _right; }, 4096);
+			}
+
+			// Prepare the initial guess of a Vector based solve, false if its size does not match.
+			template<class T>
+			bool PrepareGuess(const Vector<T> & _b, Vector<T> & _x, const size_t _n)
+			{
+				if (_b.Size() != _n || (_x.Size() != 0 && _x.Size() != _n))
+				{
+					std::cerr << "ERROR : Size of the conjugate gradient system does not match." << std::endl;
+					return false;
+				}
+				if (_x.Size() == 0)
+					_x = Vector<T>(_n);
+				return true;
+			}
+		}
+	}
+}
+
+
+namespace MathLib
+{
+	namespace IterativeSolver
+	{
+		template<class T>
+		JacobiPreconditioner<T>::JacobiPreconditioner(const std::vector<T> & _diagonal)
+			: _inverse(_diagonal.size())
+		{
+			for (size_t i = 0; i < _diagonal.size(); i++)
+				_inverse[i] = _diagonal[i] != T(0) ? T(1) / _diagonal[i] : T(1);
+		}
+
+		template<class T>
+		void JacobiPreconditioner<T>::operator()(const T * _r, T * _z) const
+		{
+			const T * inverse = _inverse.data();
+			ParallelFor(0, _inverse.size(), [=](size_t _begin, size_t _end) {
+				for (size_t i = _begin; i < _end; i++)
+					_z[i] = inverse[i] * _r[i];
+			}, 4096);
+		}
+
+		template<class T>
+		IncompleteCholesky<T>::IncompleteCholesky(const SparseMatrix<T> & _mat)
+			: n(_mat.ColumeSize()), _rowBegin(_mat.ColumeSize() + 1, 0), _shift(0)
+		{
+			// Lower triangle of A, every row ends with its diagonal element.
+			const std::vector<size_t> & rowBegin = _mat.RowBegin();
+			const std::vector<size_t> & columnIndex = _mat.ColumnIndex();
+			const std::vector<T> & value = _mat.Value();
+			for (size_t i = 0; i < n; i++)
+			{
+				T diagonal = 0;
+				for (size_t k = rowBegin[i]; k < rowBegin[i + 1] && columnIndex[k] <= i; k++)
+				{
+					if (columnIndex[k] == i)
+					{
+						diagonal = value[k];
+						break;
+					}
+					_columnIndex.push_back(columnIndex[k]);
+					_lower.push_back(value[k]);
+				}
+				_columnIndex.push_back(i);
+				_lower.push_back(diagonal);
+				_rowBegin[i + 1] = _lower.size();
+			}
+
+			T shift = 0;
+			while (!Factorize(shift))
+			{
+				shift = shift == T(0) ? T(1e-3) : shift * 2;
+				if (shift > T(1e3))
+				{
+					std::cerr << "ERROR : Incomplete Cholesky factorization failed, the matrix is not positive definite." << std::endl;
+					std::fill(_value.begin(), _value.end(), T(0));
+					for (size_t i = 0; i < n; i++)
+						_value[_rowBegin[i + 1] - 1] = T(1);
+					break;
+				}
+			}
+			_shift = shift;
+		}
+
+		template<class T>
+		bool IncompleteCholesky<T>::Factorize(const T _shift)
+		{
+			_value = _lower;
+			for (size_t i = 0; i < n; i++)
+			{
+				const size_t diagonal = _rowBegin[i + 1] - 1;
+				_value[diagonal] *= T(1) + _shift;
+				for (size_t p = _rowBegin[i]; p <= diagonal; p++)
+				{
+					// L(i, j) -= sum over k < j of L(i, k) * L(j, k), merging the sorted rows i and j.
+					const size_t j = _columnIndex[p];
+					T sum = _value[p];
+					size_t a = _rowBegin[i], b = _rowBegin[j];
+					const size_t bEnd = _rowBegin[j + 1] - 1;
+					while (a < p && b < bEnd)
+					{
+						if (_columnIndex[a] == _columnIndex[b])
+							sum -= _value[a++] * _value[b++];
+						else if (_columnIndex[a] < _columnIndex[b])
+							a++;
+						else
+							b++;
+					}
+					if (p < diagonal)
+						_value[p] = sum / _value[_rowBegin[j + 1] - 1];
+					else
+					{
+						if (!(sum > T(0)))
+							return false;
+						_value[p] = std::sqrt(sum);
+					}
+				}
+			}
+			return true;
+		}
+
+		template<class T>
+		void IncompleteCholesky<T>::operator()(const T * _r, T * _z) const
+		{
+			// L * y = r
+			for (size_t i = 0; i < n; i++)
+			{
+				const size_t diagonal = _rowBegin[i + 1] - 1;
+				T sum = _r[i];
+				for (size_t k = _rowBegin[i]; k < diagonal; k++)
+					sum -= _value[k] * _z[_columnIndex[k]];
+				_z[i] = sum / _value[diagonal];
+			}
+			// L^T * z = y, column oriented over the rows of L.
+			for (size_t i = n; i-- > 0;)
+			{
+				const size_t diagonal = _rowBegin[i + 1] - 1;
+				_z[i] /= _value[diagonal];
+				for (size_t k = _rowBegin[i]; k < diagonal; k++)
+					_z[_columnIndex[k]] -= _value[k] * _z[i];
+			}
+		}
+
+		template<class T>
+		CGReport<T> ConjugateGradient(const LinearOperator<T> & _operator, const LinearOperator<T> & _precondition,
+			const size_t _n, const T * _b, T * _x, const CGInitor<T> & _initor)
+		{
+			typedef std::chrono::steady_clock Clock;
+			const Clock::time_point start = Clock::now();
+			CGReport<T> report;
+			const size_t maxIteration = _initor.MaxIteration == 0 ? _n : _initor.MaxIteration;
+			std::vector<T> r(_n), z(_n), p(_n), Ap(_n);
+
+			const T bNorm = std::sqrt(Internal::Dot(_b, _b, _n));
+			if (bNorm == T(0))
+			{
+				std::fill(_x, _x + _n, T(0));
+				report.Converged = true;
+				report.SolveTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				return report;
+			}
+
+			// r = b - A * x
+			_operator(_x, Ap.data());
+			report.OperatorCall++;
+			for (size_t i = 0; i < _n; i++)
+				r[i] = _b[i] - Ap[i];
+			if (_precondition) _precondition(r.data(), z.data());
+			else z = r;
+			p = z;
+			T rz = Internal::Dot(r.data(), z.data(), _n);
+			report.Residual = std::sqrt(Internal::Dot(r.data(), r.data(), _n)) / bNorm;
+			report.Converged = report.Residual < _initor.Tolerance;
+
+			while (!report.Converged && report.Iteration < maxIteration)
+			{
+				_operator(p.data(), Ap.data());
+				report.OperatorCall++;
+				const T pAp = Internal::Dot(p.data(), Ap.data(), _n);
+				if (!(pAp > T(0)))
+				{
+					std::cerr << "ERROR : Conjugate gradient broke down, the operator is not positive definite." << std::endl;
+					break;
+				}
+				const T alpha = rz / pAp;
+				T * x = _x;
+				T * rData = r.data();
+				const T * pData = p.data();
+				const T * ApData = Ap.data();
+				ParallelFor(0, _n, [=](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++)
+					{
+						x[i] += alpha * pData[i];
+						rData[i] -= alpha * ApData[i];
+					}
+				}, 4096);
+				report.Iteration++;
+				report.Residual = std::sqrt(Internal::Dot(r.data(), r.data(), _n)) / bNorm;
+				if (_initor.RecordHistory)
+					report.History.push_back(report.Residual);
+				if (_initor.Monitor)
+					_initor.Monitor(report.Iteration, report.Residual);
+				if (report.Residual < _initor.Tolerance)
+				{
+					report.Converged = true;
+					break;
+				}
+
+				if (_precondition) _precondition(r.data(), z.data());
+				else z = r;
+				const T rzNext = Internal::Dot(r.data(), z.data(), _n);
+				const T beta = rzNext / rz;
+				rz = rzNext;
+				T * pNext = p.data();
+				const T * zData = z.data();
+				ParallelFor(0, _n, [=](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++)
+						pNext[i] = zData[i] + beta * pNext[i];
+				}, 4096);
+			}
+
+			// Recompute the residual, the recurrence drifts away from it in finite precision.
+			_operator(_x, Ap.data());
+			report.OperatorCall++;
+			for (size_t i = 0; i < _n; i++)
+				r[i] = _b[i] - Ap[i];
+			report.TrueResidual = std::sqrt(Internal::Dot(r.data(), r.data(), _n)) / bNorm;
+			report.SolveTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			return report;
+		}
+
+		template<class T>
+		CGReport<T> ConjugateGradient(const SparseMatrix<T> & _mat, const Vector<T> & _b, Vector<T> & _x, const CGInitor<T> & _initor)
+		{
+			const size_t n = _mat.ColumeSize();
+			if (_mat.RowSize() != n || !Internal::PrepareGuess(_b, _x, n))
+				return CGReport<T>();
+
+			typedef std::chrono::steady_clock Clock;
+			const Clock::time_point start = Clock::now();
+			LinearOperator<T> precondition;
+			switch (_initor.Precondition)
+			{
+			case Preconditioner::Jacobi:
+				precondition = JacobiPreconditioner<T>(_mat.Diagonal());
+				break;
+			case Preconditioner::IncompleteCholesky:
+				precondition = IncompleteCholesky<T>(_mat);
+				break;
+			case Preconditioner::None:
+			default:
+				break;
+			}
+			const double setupTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			CGReport<T> report = ConjugateGradient<T>([&_mat](const T * _in, T * _out) { _mat.Multiply(_in, _out); },
+				precondition, n, _b.data(), _x.data(), _initor);
+			report.SetupTime = setupTime;
+			return report;
+		}
+
+		template<class T>
+		CGReport<T> ConjugateGradient(const Matrix<T> & _mat, const Vector<T> & _b, Vector<T> & _x, const CGInitor<T> & _initor)
+		{
+			const size_t n = _mat.ColumeSize();
+			if (_mat.RowSize() != n || !Internal::PrepareGuess(_b, _x, n))
+				return CGReport<T>();
+
+			typedef std::chrono::steady_clock Clock;
+			const Clock::time_point start = Clock::now();
+			LinearOperator<T> precondition;
+			switch (_initor.Precondition)
+			{
+			case Preconditioner::Jacobi:
+			{
+				std::vector<T> diagonal(n);
+				for (size_t i = 0; i < n; i++)
+					diagonal[i] = _mat(i, i);
+				precondition = JacobiPreconditioner<T>(diagonal);
+				break;
+			}
+			case Preconditioner::IncompleteCholesky:
+				precondition = IncompleteCholesky<T>(SparseMatrix<T>(_mat));
+				break;
+			case Preconditioner::None:
+			default:
+				break;
+			}
+			const double setupTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			const T * A = _mat.Data();
+			CGReport<T> report = ConjugateGradient<T>([A, n](const T * _in, T * _out) {
+				GEMM(Transpose::NoTrans, Transpose::NoTrans, n, 1, n, T(1), A, n, _in, 1, T(0), _out, 1);
+			}, precondition, n, _b.data(), _x.data(), _initor);
+			report.SetupTime = setupTime;
+			return report;
+		}
+
+		template<class T>
+		CGReport<T> ConjugateGradient(const LinearOperator<T> & _operator, const Vector<T> & _b, Vector<T> & _x,
+			const CGInitor<T> & _initor, const std::vector<T> & _diagonal)
+		{
+			const size_t n = _b.Size();
+			if (!Internal::PrepareGuess(_b, _x, n))
+				return CGReport<T>();
+
+			LinearOperator<T> precondition;
+			if (_initor.Precondition == Preconditioner::Jacobi && _diagonal.size() == n)
+				precondition = JacobiPreconditioner<T>(_diagonal);
+			else if (_initor.Precondition != Preconditioner::None)
+				std::cerr << "ERROR : Matrix-free conjugate gradient only supports Jacobi preconditioning with a given diagonal, "
+				"running without preconditioner." << std::endl;
+			return ConjugateGradient<T>(_operator, precondition, n, _b.data(), _x.data(), _initor);
+		}
+	}
+}
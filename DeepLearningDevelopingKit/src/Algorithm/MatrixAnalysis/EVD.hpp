@@ -0,0 +1,511 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	  Eigenvalue Decomposotion 	                                                 */
+/*								        		 	                Matrix   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "..\..\MathLib\MathLib.h"
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		// Eigenvalue decomposition of a real symmetric matrix
+		/// A = V * diag(lambda) * V^T
+		/// Returns the eigenvalues in ascending order and the eigenvectors as the columns of V.
+		/// The matrix is first reduced to tridiagonal form by Householder reflections, the
+		/// tridiagonal problem is then solved by Cuppen's divide and conquer method, whose two
+		/// halves are solved in parallel and whose merges are done with GEMM.
+		template<class T>
+		std::pair<MathLib::Vector<T>, MathLib::Matrix<T>> EVD(const MathLib::Matrix<T> & _mat);
+
+		// Tridiagonal reduction
+		/// A = Q * T * Q^T, T has _diag on its diagonal and _offDiag on both off-diagonals.
+		template<class T>
+		MathLib::Matrix<T> Tridiagonalize(const MathLib::Matrix<T> & _mat, std::vector<T> & _diag, std::vector<T> & _offDiag);
+
+		// Divide and conquer eigensolver of a symmetric tridiagonal matrix
+		/// _diag has n elements, _offDiag has n - 1 elements.
+		/// _values receives the eigenvalues in ascending order, _vectors the n x n row-major eigenvector matrix.
+		template<class T>
+		void TridiagonalEVD(const std::vector<T> & _diag, const std::vector<T> & _offDiag, std::vector<T> & _values, std::vector<T> & _vectors);
+	}
+}
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		namespace Internal
+		{
+			// Below this size a tridiagonal problem is solved directly by implicit QL.
+			const size_t EVDDirectSize = 32;
+			// Above this size the two halves of a tridiagonal problem are solved in parallel.
+			const size_t EVDParallelSize = 128;
+
+			// Sort eigenvalues ascending and permute the eigenvector columns accordingly.
+			template<class T>
+			void SortEigen(const size_t _n, std::vector<T> & _values, std::vector<T> & _vectors)
+			{
+				std::vector<size_t> order(_n);
+				std::iota(order.begin(), order.end(), size_t(0));
+				std::stable_sort(order.begin(), order.end(), [&_values](size_t _a, size_t _b) { return _values[_a] < _values[_b]; });
+				std::vector<T> values(_n), vectors(_n * _n);
+				for (size_t j = 0; j < _n; j++)
+				{
+					values[j] = _values[order[j]];
+					for (size_t i = 0; i < _n; i++)
+						vectors[i * _n + j] = _vectors[i * _n + order[j]];
+				}
+				_values.swap(values);
+				_vectors.swap(vectors);
+			}
+
+			// Implicit QL iteration with Wilkinson shifts.
+			/// _e[i] couples rows i and i + 1, _e has _n elements with _e[_n - 1] = 0.
+			/// _V must hold the identity on entry and holds the eigenvectors as columns on exit.
+			template<class T>
+			void TridiagonalQL(const size_t _n, std::vector<T> & _d, std::vector<T> & _e, std::vector<T> & _V)
+			{
+				const T eps = std::numeric_limits<T>::epsilon();
+				T f = 0, tst1 = 0;
+				for (size_t l = 0; l < _n; l++)
+				{
+					tst1 = std::max(tst1, std::abs(_d[l]) + std::abs(_e[l]));
+					size_t m = l;
+					while (m < _n - 1 && std::abs(_e[m]) > eps * tst1)
+						m++;
+					if (m > l)
+					{
+						size_t iteration = 0;
+						do
+						{
+							T g = _d[l];
+							T p = (_d[l + 1] - g) / (2 * _e[l]);
+							T r = std::hypot(p, T(1));
+							if (p < 0) r = -r;
+							_d[l] = _e[l] / (p + r);
+							_d[l + 1] = _e[l] * (p + r);
+							const T dl1 = _d[l + 1];
+							T h = g - _d[l];
+							for (size_t i = l + 2; i < _n; i++)
+								_d[i] -= h;
+							f += h;
+
+							p = _d[m];
+							T c = 1, c2 = 1, c3 = 1;
+							const T el1 = _e[l + 1];
+							T s = 0, s2 = 0;
+							for (size_t i = m; i-- > l;)
+							{
+								c3 = c2;
+								c2 = c;
+								s2 = s;
+								g = c * _e[i];
+								h = c * p;
+								r = std::hypot(p, _e[i]);
+								_e[i + 1] = s * r;
+								s = _e[i] / r;
+								c = p / r;
+								p = c * _d[i] - s * g;
+								_d[i + 1] = h + s * (c * g + s * _d[i]);
+								for (size_t k = 0; k < _n; k++)
+								{
+									h = _V[k * _n + i + 1];
+									_V[k * _n + i + 1] = s * _V[k * _n + i] + c * h;
+									_V[k * _n + i] = c * _V[k * _n + i] - s * h;
+								}
+							}
+							p = -s * s2 * c3 * el1 * _e[l] / dl1;
+							_e[l] = s * p;
+							_d[l] = c * p;
+						} while (std::abs(_e[l]) > eps * tst1 && ++iteration < 30 * _n);
+					}
+					_d[l] += f;
+					_e[l] = 0;
+				}
+				SortEigen(_n, _d, _V);
+			}
+
+			// Eigen decomposition of diag(_D) + _rho * _z * _z^T, rotated back by the columns of _Q.
+			/// _Q is n x n, on exit _values and _vectors hold the merged eigen pairs in ascending order.
+			template<class T>
+			void SecularMerge(const size_t _n, std::vector<T> & _D, std::vector<T> & _z, T _rho, std::vector<T> & _Q, std::vector<T> & _values, std::vector<T> & _vectors)
+			{
+				const T eps = std::numeric_limits<T>::epsilon();
+
+				// Normalize z so that the secular equation has all its roots below d_max + rho.
+				T zNorm2 = 0;
+				for (size_t i = 0; i < _n; i++)
+					zNorm2 += _z[i] * _z[i];
+				if (_rho == T(0) || zNorm2 == T(0))
+				{
+					_values = _D;
+					_vectors = _Q;
+					SortEigen(_n, _values, _vectors);
+					return;
+				}
+				_rho *= zNorm2;
+				const T zNorm = std::sqrt(zNorm2);
+
+				// Sort the poles ascending.
+				std::vector<size_t> perm(_n);
+				std::iota(perm.begin(), perm.end(), size_t(0));
+				std::stable_sort(perm.begin(), perm.end(), [&_D](size_t _a, size_t _b) { return _D[_a] < _D[_b]; });
+				std::vector<T> d(_n), z(_n), Q(_n * _n);
+				T dMax = 0;
+				for (size_t j = 0; j < _n; j++)
+				{
+					d[j] = _D[perm[j]];
+					z[j] = _z[perm[j]] / zNorm;
+					dMax = std::max(dMax, std::abs(d[j]));
+					for (size_t i = 0; i < _n; i++)
+						Q[i * _n + j] = _Q[i * _n + perm[j]];
+				}
+
+				// Deflation : drop tiny components of z and rotate away one of two close poles.
+				const T tol = 8 * eps * std::max(dMax, _rho);
+				std::vector<size_t> kept, deflated;
+				for (size_t i = 0; i < _n; i++)
+				{
+					if (_rho * std::abs(z[i]) <= tol)
+					{
+						deflated.push_back(i);
+						continue;
+					}
+					if (!kept.empty())
+					{
+						const size_t j = kept.back();
+						const T tau = std::hypot(z[i], z[j]);
+						const T c = z[i] / tau;
+						const T s = z[j] / tau;
+						if (std::abs((d[i] - d[j]) * c * s) <= tol)
+						{
+							for (size_t r = 0; r < _n; r++)
+							{
+								const T qj = Q[r * _n + j];
+								const T qi = Q[r * _n + i];
+								Q[r * _n + j] = c * qj - s * qi;
+								Q[r * _n + i] = s * qj + c * qi;
+							}
+							const T dj = d[j];
+							d[j] = c * c * dj + s * s * d[i];
+							d[i] = s * s * dj + c * c * d[i];
+							z[i] = tau;
+							z[j] = 0;
+							kept.pop_back();
+							deflated.push_back(j);
+						}
+					}
+					kept.push_back(i);
+				}
+				std::stable_sort(kept.begin(), kept.end(), [&d](size_t _a, size_t _b) { return d[_a] < d[_b]; });
+
+				// Solve the secular equation 1 + rho * sum(z_j^2 / (d_j - lambda)) = 0 for the kept poles.
+				/// Every root is stored as an offset mu from its closest pole, so d_j - lambda is
+				/// computed as (d_j - d_origin) - mu without cancellation.
+				const size_t K = kept.size();
+				std::vector<T> dK(K), zK(K), mu(K);
+				std::vector<size_t> origin(K);
+				for (size_t i = 0; i < K; i++)
+				{
+					dK[i] = d[kept[i]];
+					zK[i] = z[kept[i]];
+				}
+				for (size_t i = 0; i < K; i++)
+				{
+					T lo, hi;
+					if (i + 1 < K)
+					{
+						const T gap = dK[i + 1] - dK[i];
+						T fMid = 1;
+						for (size_t j = 0; j < K; j++)
+							fMid += _rho * zK[j] * zK[j] / ((dK[j] - dK[i]) - gap / 2);
+						if (fMid >= 0) { origin[i] = i; lo = 0; hi = gap / 2; }
+						else { origin[i] = i + 1; lo = -gap / 2; hi = 0; }
+					}
+					else
+					{
+						origin[i] = i;
+						lo = 0;
+						hi = _rho;
+					}
+					const T base = dK[origin[i]];
+					T x = (lo + hi) / 2;
+					for (size_t iteration = 0; iteration < 100; iteration++)
+					{
+						T f = 1, df = 0;
+						for (size_t j = 0; j < K; j++)
+						{
+							const T t = zK[j] / ((dK[j] - base) - x);
+							f += _rho * zK[j] * t;
+							df += _rho * t * t;
+						}
+						if (f == 0)
+							break;
+						if (f > 0) hi = x; else lo = x;
+						T next = x - f / df;
+						if (!(next > lo && next < hi))
+							next = (lo + hi) / 2;
+						const bool converged = std::abs(next - x) <= 2 * eps * std::abs(next) || next == lo || next == hi;
+						x = next;
+						if (converged)
+							break;
+					}
+					mu[i] = x;
+				}
+
+				// Recompute z from the computed roots (Gu-Eisenstat), which keeps the eigenvectors orthogonal.
+				auto difference = [&](size_t _j, size_t _i) { return (dK[_j] - dK[origin[_i]]) - mu[_i]; };
+				std::vector<T> zHat(K);
+				for (size_t j = 0; j < K; j++)
+				{
+					T product = -difference(j, K - 1) / _rho;
+					for (size_t i = 0; i < j; i++)
+						product *= -difference(j, i) / (dK[i] - dK[j]);
+					for (size_t i = j; i + 1 < K; i++)
+						product *= -difference(j, i) / (dK[i + 1] - dK[j]);
+					zHat[j] = std::sqrt(std::abs(product));
+					if (zK[j] < 0)
+						zHat[j] = -zHat[j];
+				}
+
+				// Eigenvectors of the rank-one modified diagonal matrix.
+				std::vector<T> U(K * K);
+				for (size_t i = 0; i < K; i++)
+				{
+					T norm = 0;
+					for (size_t j = 0; j < K; j++)
+					{
+						U[j * K + i] = zHat[j] / difference(j, i);
+						norm += U[j * K + i] * U[j * K + i];
+					}
+					norm = std::sqrt(norm);
+					for (size_t j = 0; j < K; j++)
+						U[j * K + i] /= norm;
+				}
+
+				// Rotate back : Q[:, kept] * U.
+				std::vector<T> QK(_n * K), QU(_n * K);
+				for (size_t r = 0; r < _n; r++)
+					for (size_t i = 0; i < K; i++)
+						QK[r * K + i] = Q[r * _n + kept[i]];
+				GEMM(Transpose::NoTrans, Transpose::NoTrans, _n, K, K, T(1), QK.data(), K, U.data(), K, T(0), QU.data(), K);
+
+				_values.assign(_n, T(0));
+				_vectors.assign(_n * _n, T(0));
+				size_t column = 0;
+				for (size_t i : deflated)
+				{
+					_values[column] = d[i];
+					for (size_t r = 0; r < _n; r++)
+						_vectors[r * _n + column] = Q[r * _n + i];
+					column++;
+				}
+				for (size_t i = 0; i < K; i++)
+				{
+					_values[column] = dK[origin[i]] + mu[i];
+					for (size_t r = 0; r < _n; r++)
+						_vectors[r * _n + column] = QU[r * K + i];
+					column++;
+				}
+				SortEigen(_n, _values, _vectors);
+			}
+
+			// Cuppen's divide and conquer on the tridiagonal matrix given by _d[0, _n) and _e[0, _n - 1).
+			template<class T>
+			void DivideConquer(const size_t _n, const T * _d, const T * _e, std::vector<T> & _values, std::vector<T> & _vectors)
+			{
+				if (_n <= EVDDirectSize)
+				{
+					std::vector<T> d(_d, _d + _n), e(_n, T(0));
+					std::copy(_e, _e + _n - 1, e.begin());
+					_vectors.assign(_n * _n, T(0));
+					for (size_t i = 0; i < _n; i++)
+						_vectors[i * _n + i] = T(1);
+					TridiagonalQL(_n, d, e, _vectors);
+					_values.swap(d);
+					return;
+				}
+
+				// T = diag(T1, T2) + rho * u * u^T, u = [e_k ; sign(beta) * e_1]
+				const size_t k = _n / 2;
+				const T beta = _e[k - 1];
+				const T rho = std::abs(beta);
+				const T sign = beta < 0 ? T(-1) : T(1);
+				std::vector<T> d1(_d, _d + k), d2(_d + k, _d + _n);
+				d1[k - 1] -= rho;
+				d2[0] -= rho;
+
+				std::vector<T> values1, vectors1, values2, vectors2;
+				auto solve = [&](size_t _begin, size_t _end) {
+					for (size_t half = _begin; half < _end; half++)
+						if (half == 0)
+							DivideConquer(k, d1.data(), _e, values1, vectors1);
+						else
+							DivideConquer(_n - k, d2.data(), _e + k, values2, vectors2);
+				};
+				if (_n >= EVDParallelSize)
+					ParallelFor(0, 2, solve);
+				else
+					solve(0, 2);
+
+				// Merge the two halves.
+				const size_t n2 = _n - k;
+				std::vector<T> D(_n), z(_n), Q(_n * _n, T(0));
+				for (size_t i = 0; i < k; i++)
+				{
+					D[i] = values1[i];
+					z[i] = vectors1[(k - 1) * k + i];
+					std::copy(&vectors1[i * k], &vectors1[i * k] + k, &Q[i * _n]);
+				}
+				for (size_t i = 0; i < n2; i++)
+				{
+					D[k + i] = values2[i];
+					z[k + i] = sign * vectors2[i];
+					std::copy(&vectors2[i * n2], &vectors2[i * n2] + n2, &Q[(k + i) * _n + k]);
+				}
+				SecularMerge(_n, D, z, rho, Q, _values, _vectors);
+			}
+		}
+
+		template<class T>
+		MathLib::Matrix<T> Tridiagonalize(const MathLib::Matrix<T>& _mat, std::vector<T>& _diag, std::vector<T>& _offDiag)
+		{
+			const size_t n = _mat.ColumeSize();
+			std::vector<T> A(_mat.Data(), _mat.Data() + n * n);
+			std::vector<std::vector<T>> reflectors(n > 2 ? n - 2 : 0);
+			_diag.assign(n, T(0));
+			_offDiag.assign(n > 0 ? n - 1 : 0, T(0));
+			const size_t grain = std::max<size_t>(1, 16384 / std::max<size_t>(1, n));
+
+			for (size_t k = 0; k + 2 < n; k++)
+			{
+				// Householder vector zeroing A[k + 2 :, k].
+				const size_t len = n - k - 1;
+				std::vector<T> & v = reflectors[k];
+				v.assign(len, T(0));
+				T norm = 0;
+				for (size_t i = 0; i < len; i++)
+				{
+					v[i] = A[(k + 1 + i) * n + k];
+					norm += v[i] * v[i];
+				}
+				norm = std::sqrt(norm);
+				_diag[k] = A[k * n + k];
+				if (norm == T(0))
+				{
+					_offDiag[k] = 0;
+					v.assign(len, T(0));
+					continue;
+				}
+				const T alpha = v[0] > 0 ? -norm : norm;
+				_offDiag[k] = alpha;
+				v[0] -= alpha;
+				T vNorm = 0;
+				for (size_t i = 0; i < len; i++)
+					vNorm += v[i] * v[i];
+				vNorm = std::sqrt(vNorm);
+				for (size_t i = 0; i < len; i++)
+					v[i] /= vNorm;
+
+				// A' = H A H = A - 2 v q^T - 2 q v^T, with p = A v and q = p - (v^T p) v.
+				std::vector<T> p(len, T(0));
+				ParallelFor(0, len, [&](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++)
+					{
+						const T * row = &A[(k + 1 + i) * n + k + 1];
+						T sum = 0;
+						for (size_t j = 0; j < len; j++)
+							sum += row[j] * v[j];
+						p[i] = sum;
+					}
+				}, grain);
+				T vp = 0;
+				for (size_t i = 0; i < len; i++)
+					vp += v[i] * p[i];
+				for (size_t i = 0; i < len; i++)
+					p[i] -= vp * v[i];
+				ParallelFor(0, len, [&](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++)
+					{
+						T * row = &A[(k + 1 + i) * n + k + 1];
+						for (size_t j = 0; j < len; j++)
+							row[j] -= 2 * (v[i] * p[j] + p[i] * v[j]);
+					}
+				}, grain);
+			}
+			if (n >= 2)
+			{
+				_diag[n - 2] = A[(n - 2) * n + n - 2];
+				_offDiag[n - 2] = A[(n - 1) * n + n - 2];
+			}
+			if (n >= 1)
+				_diag[n - 1] = A[(n - 1) * n + n - 1];
+
+			// Q = H(0) H(1) ... H(n-3), accumulated backwards on the identity.
+			std::vector<T> Q(n * n, T(0));
+			for (size_t i = 0; i < n; i++)
+				Q[i * n + i] = T(1);
+			for (size_t k = reflectors.size(); k-- > 0;)
+			{
+				const std::vector<T> & v = reflectors[k];
+				const size_t len = v.size();
+				std::vector<T> w(len, T(0));
+				for (size_t i = 0; i < len; i++)
+					for (size_t j = 0; j < len; j++)
+						w[j] += v[i] * Q[(k + 1 + i) * n + k + 1 + j];
+				ParallelFor(0, len, [&](size_t _begin, size_t _end) {
+					for (size_t i = _begin; i < _end; i++)
+					{
+						T * row = &Q[(k + 1 + i) * n + k + 1];
+						for (size_t j = 0; j < len; j++)
+							row[j] -= 2 * v[i] * w[j];
+					}
+				}, grain);
+			}
+			MathLib::Matrix<T> QMat(n, n);
+			std::copy(Q.begin(), Q.end(), QMat.Data());
+			return QMat;
+		}
+
+		template<class T>
+		void TridiagonalEVD(const std::vector<T>& _diag, const std::vector<T>& _offDiag, std::vector<T>& _values, std::vector<T>& _vectors)
+		{
+			if (_diag.empty())
+			{
+				_values.clear();
+				_vectors.clear();
+				return;
+			}
+			Internal::DivideConquer(_diag.size(), _diag.data(), _offDiag.data(), _values, _vectors);
+		}
+
+		template<class T>
+		std::pair<MathLib::Vector<T>, MathLib::Matrix<T>> EVD(const MathLib::Matrix<T>& _mat)
+		{
+			const size_t n = _mat.ColumeSize();
+			std::vector<T> diag, offDiag, values, vectors;
+			MathLib::Matrix<T> Q = Tridiagonalize(_mat, diag, offDiag);
+			TridiagonalEVD(diag, offDiag, values, vectors);
+
+			MathLib::Vector<T> eigenValues(n);
+			for (size_t i = 0; i < n; i++)
+				eigenValues(i) = values[i];
+			MathLib::Matrix<T> eigenVectors(n, n);
+			GEMM(Transpose::NoTrans, Transpose::NoTrans, n, n, n, T(1), Q.Data(), n, vectors.data(), n, T(0), eigenVectors.Data(), n);
+			return std::pair<MathLib::Vector<T>, MathLib::Matrix<T>>(eigenValues, eigenVectors);
+		}
+	}
+}
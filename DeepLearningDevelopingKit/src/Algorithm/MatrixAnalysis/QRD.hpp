@@ -0,0 +1,176 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	       QR Decomposotion 	                                                    */
+/*								        		 	                Matrix   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+#include "..\..\MathLib\MathLib.h"
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		// QR decomposition
+		/// Factors a m x n matrix as the product of a m x r matrix Q with orthonormal columns
+		/// and a r x n upper triangular matrix R, where r = min(m, n).
+		enum class QRDMethod {
+			GramSchmidt,
+			Householder
+		};
+
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> QRD(
+			const MathLib::Matrix<T> & _mat, const QRDMethod & _method = QRDMethod::Householder);
+
+		// Modified Gram-Schmidt Method
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> GramSchmidt(const MathLib::Matrix<T> & _mat);
+
+		// Householder Method
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> Householder(const MathLib::Matrix<T> & _mat);
+	}
+}
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> QRD(const MathLib::Matrix<T>& _mat, const QRDMethod & _method)
+		{
+			switch (_method)
+			{
+			case MathLib::MatrixDecomposition::QRDMethod::GramSchmidt:
+				return GramSchmidt(_mat);
+				break;
+			case MathLib::MatrixDecomposition::QRDMethod::Householder:
+				return Householder(_mat);
+				break;
+			default:
+				return Householder(_mat);
+				break;
+			}
+		}
+
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> GramSchmidt(const MathLib::Matrix<T>& _mat)
+		{
+			const size_t m = _mat.ColumeSize();
+			const size_t n = _mat.RowSize();
+			const size_t r = std::min(m, n);
+			MathLib::Matrix<T> Q(m, r);
+			MathLib::Matrix<T> R(r, n);
+
+			// Work on columns stored contiguously.
+			std::vector<T> columns(n * m);
+			for (size_t i = 0; i < m; i++)
+				for (size_t j = 0; j < n; j++)
+					columns[j * m + i] = _mat(i, j);
+
+			for (size_t k = 0; k < r; k++)
+			{
+				T * q = &columns[k * m];
+				T norm = 0;
+				for (size_t i = 0; i < m; i++)
+					norm += q[i] * q[i];
+				norm = std::sqrt(norm);
+				R(k, k) = norm;
+				if (norm > 0)
+					for (size_t i = 0; i < m; i++)
+						q[i] /= norm;
+				for (size_t j = k + 1; j < n; j++)
+				{
+					T * a = &columns[j * m];
+					T dot = 0;
+					for (size_t i = 0; i < m; i++)
+						dot += q[i] * a[i];
+					R(k, j) = dot;
+					for (size_t i = 0; i < m; i++)
+						a[i] -= dot * q[i];
+				}
+				for (size_t i = 0; i < m; i++)
+					Q(i, k) = q[i];
+			}
+			return std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>>(Q, R);
+		}
+
+		template<class T>
+		std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>> Householder(const MathLib::Matrix<T>& _mat)
+		{
+			const size_t m = _mat.ColumeSize();
+			const size_t n = _mat.RowSize();
+			const size_t r = std::min(m, n);
+
+			// Reduce a copy of the matrix to upper triangular form, keeping the reflectors.
+			std::vector<T> A(_mat.Data(), _mat.Data() + m * n);
+			std::vector<std::vector<T>> reflectors(r);
+			for (size_t k = 0; k < r; k++)
+			{
+				std::vector<T> & v = reflectors[k];
+				v.assign(m - k, T(0));
+				T norm = 0;
+				for (size_t i = k; i < m; i++)
+				{
+					v[i - k] = A[i * n + k];
+					norm += v[i - k] * v[i - k];
+				}
+				norm = std::sqrt(norm);
+				if (norm == T(0))
+				{
+					v.assign(m - k, T(0));
+					continue;
+				}
+				const T alpha = v[0] > 0 ? -norm : norm;
+				v[0] -= alpha;
+				T vNorm = 0;
+				for (size_t i = 0; i < v.size(); i++)
+					vNorm += v[i] * v[i];
+				vNorm = std::sqrt(vNorm);
+				for (size_t i = 0; i < v.size(); i++)
+					v[i] /= vNorm;
+
+				// A[k:, k:] -= 2 v (v^T A[k:, k:])
+				std::vector<T> w(n - k, T(0));
+				for (size_t i = k; i < m; i++)
+					for (size_t j = k; j < n; j++)
+						w[j - k] += v[i - k] * A[i * n + j];
+				for (size_t i = k; i < m; i++)
+					for (size_t j = k; j < n; j++)
+						A[i * n + j] -= 2 * v[i - k] * w[j - k];
+			}
+
+			MathLib::Matrix<T> R(r, n);
+			for (size_t i = 0; i < r; i++)
+				for (size_t j = i; j < n; j++)
+					R(i, j) = A[i * n + j];
+
+			// Q = H(0) H(1) ... H(r-1) applied to the first r columns of the identity.
+			std::vector<T> Q(m * r, T(0));
+			for (size_t i = 0; i < r; i++)
+				Q[i * r + i] = T(1);
+			for (size_t k = r; k-- > 0;)
+			{
+				const std::vector<T> & v = reflectors[k];
+				std::vector<T> w(r, T(0));
+				for (size_t i = k; i < m; i++)
+					for (size_t j = 0; j < r; j++)
+						w[j] += v[i - k] * Q[i * r + j];
+				for (size_t i = k; i < m; i++)
+					for (size_t j = 0; j < r; j++)
+						Q[i * r + j] -= 2 * v[i - k] * w[j];
+			}
+			MathLib::Matrix<T> QMat(m, r);
+			std::copy(Q.begin(), Q.end(), QMat.Data());
+			return std::pair<MathLib::Matrix<T>, MathLib::Matrix<T>>(QMat, R);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	   Singular Value Decomposotion 	                                           */
+/*								        		 	                Matrix   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+
+#include "..\..\MathLib\MathLib.h"
+#include "QRD.hpp"
+#include "EVD.hpp"
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		// Randomized truncated singular value decomposition
+		/// A ~ U * diag(S) * V^T, U is m x _rank, S holds _rank singular values in descending order, V is n x _rank.
+		/// The range of A is sampled with a Gaussian test matrix of _rank + _oversampling columns and refined by
+		/// _powerIteration power iterations, every product with A goes through GEMM.
+		/// _seed makes the test matrix, and therefore the result, reproducible.
+		template<class T>
+		std::tuple<MathLib::Matrix<T>, MathLib::Vector<T>, MathLib::Matrix<T>> RandomizedSVD(
+			const MathLib::Matrix<T> & _mat, const size_t _rank,
+			const size_t _oversampling = 10, const size_t _powerIteration = 2, const unsigned int _seed = 1);
+	}
+}
+
+
+namespace MathLib
+{
+	namespace MatrixDecomposition
+	{
+		template<class T>
+		std::tuple<MathLib::Matrix<T>, MathLib::Vector<T>, MathLib::Matrix<T>> RandomizedSVD(
+			const MathLib::Matrix<T>& _mat, const size_t _rank,
+			const size_t _oversampling, const size_t _powerIteration, const unsigned int _seed)
+		{
+			const size_t m = _mat.ColumeSize();
+			const size_t n = _mat.RowSize();
+			const size_t rank = std::min(_rank, std::min(m, n));
+			const size_t l = std::min(rank + _oversampling, std::min(m, n));
+
+			// Gaussian test matrix.
+			/// Every row draws from its own stream, so omega does not depend on the number of threads.
+			MathLib::Matrix<T> omega(n, l);
+			T * omegaData = omega.Data();
+			ParallelFor(0, n, [omegaData, l, _seed](size_t _rowBegin, size_t _rowEnd) {
+				for (size_t i = _rowBegin; i < _rowEnd; i++)
+				{
+					RandomStream stream(_seed, i);
+					for (size_t j = 0; j < l; j++)
+						omegaData[i * l + j] = static_cast<T>(stream.Normal());
+				}
+			}, 16);
+
+			// Range finder with power iterations, re-orthonormalized every half step.
+			MathLib::Matrix<T> Q = QRD(MatMul(_mat, omega)).first;
+			for (size_t q = 0; q < _powerIteration; q++)
+			{
+				MathLib::Matrix<T> Z = QRD(MatMul(_mat, Q, Transpose::Trans)).first;
+				Q = QRD(MatMul(_mat, Z)).first;
+			}
+
+			// Small problem : B = Q^T A is l x n, the eigen decomposition of B B^T gives its left singular vectors.
+			MathLib::Matrix<T> B = MatMul(Q, _mat, Transpose::Trans);
+			std::pair<MathLib::Vector<T>, MathLib::Matrix<T>> eigen = EVD(MatMul(B, B, Transpose::NoTrans, Transpose::Trans));
+
+			MathLib::Matrix<T> Ub(l, rank);
+			MathLib::Vector<T> S(rank);
+			for (size_t i = 0; i < rank; i++)
+			{
+				const size_t column = l - 1 - i;
+				S(i) = std::sqrt(std::max(eigen.first(column), T(0)));
+				for (size_t r = 0; r < l; r++)
+					Ub(r, i) = eigen.second(r, column);
+			}
+
+			MathLib::Matrix<T> U = MatMul(Q, Ub);
+			MathLib::Matrix<T> V = MatMul(B, Ub, Transpose::Trans);
+			for (size_t i = 0; i < rank; i++)
+			{
+				const T inverse = S(i) > T(0) ? T(1) / S(i) : T(0);
+				for (size_t r = 0; r < n; r++)
+					V(r, i) *= inverse;
+			}
+			return std::make_tuple(U, S, V);
+		}
+	}
+}
@@ -10,6 +10,8 @@
 #include <vector>
 #include <cmath>
 
+#include "..\..\MathLib\FastMath.hpp"
+
 /************************************************************************************************************/
 // Activation functions 
 /// Activation Function Enums
@@ -55,7 +57,7 @@ inline double LinearDerivative(double x) {
 const double A = 1;
 const double B = 1;
 inline double Sigmoid(double x) {
-	return A / (1 + exp(-x / B));
+	return A * MathLib::FastMath::Sigmoid(x / B);
 }
 
 // Sigmoid Derivative Function
@@ -83,11 +85,22 @@ inline double LeakyReLU(double x) {
 	return x > 0 ? x : C * x;
 }
 
+// Leaky-ReLU Derivative
+inline double LeakyReLUDerivative(double x) {
+	return x > 0 ? 1 : C;
+}
+
 // ELU
 /// A combination of Sigmoid and ReLU
 const double D = 0.25;
 inline double ELU(double x) {
-	return x > 0 ? x : D * (exp(x) - 1);
+	return x > 0 ? x : D * MathLib::FastMath::ExpM1(x);
+}
+
+// ELU Derivative
+/// Takes the output of ELU, like SigmoidDerivative.
+inline double ELUDerivative(double x) {
+	return x > 0 ? 1 : x + D;
 }
 
 // Hyperbolic sinh Function
@@ -101,14 +114,195 @@ inline double ELU(double x) {
 //}
 
 // Hyperbolic tanh Function
-//inline double tanh(double x) {
-//	return (exp(x) - exp(-x)) / (exp(x) + exp(-x));
-//}
+inline double Tanh(double x) {
+	return MathLib::FastMath::Tanh(x);
+}
+
+// Hyperbolic tanh Derivative Function
+/// Takes the output of tanh, like SigmoidDerivative.
+inline double TanhDerivative(double x) {
+	return 1 - x * x;
+}
 
 // Softplus Function
 /// A smoother version of ReLU
 inline double Softplus(double x) {
-	return logf(1 + exp(x));
+	return MathLib::FastMath::Softplus(x);
 }
 
+// Softplus Derivative Function
+/// Takes the output of Softplus, like SigmoidDerivative.
+inline double SoftplusDerivative(double x) {
+	return -MathLib::FastMath::ExpM1(-x);
+}
+
+/************************************************************************************************************/
+// Activation policies
+/// Compile-time description of an activation for the array kernels below : Function and Derivative on
+/// one double and on the two doubles of an SSE2 register, running the same operations so both give the
+/// same result as the scalar functions above. Derivative takes the output of the function.
+struct LinearPolicy {
+	static inline double Function(const double x) { return Linear(x); }
+	static inline double Derivative(const double y) { return LinearDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) { return _mm_mul_pd(x, _mm_set1_pd(K)); }
+	static inline __m128d Derivative(const __m128d /*y*/) { return _mm_set1_pd(K); }
+#endif // USING_SSE2_FASTMATH
+};
+
+struct SigmoidPolicy {
+	static inline double Function(const double x) { return Sigmoid(x); }
+	static inline double Derivative(const double y) { return SigmoidDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) {
+		return _mm_mul_pd(_mm_set1_pd(A), MathLib::FastMath::Internal::Sigmoid(_mm_div_pd(x, _mm_set1_pd(B))));
+	}
+	static inline __m128d Derivative(const __m128d y) { return _mm_mul_pd(y, _mm_sub_pd(_mm_set1_pd(1.0), y)); }
+#endif // USING_SSE2_FASTMATH
+};
+
+struct ReLUPolicy {
+	static inline double Function(const double x) { return ReLU(x); }
+	static inline double Derivative(const double y) { return ReLUDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	// maxpd returns its second operand unless the first is greater, as x > 0 ? x : 0 does.
+	static inline __m128d Function(const __m128d x) { return _mm_max_pd(x, _mm_setzero_pd()); }
+	static inline __m128d Derivative(const __m128d y) { return _mm_and_pd(_mm_cmpgt_pd(y, _mm_setzero_pd()), _mm_set1_pd(1.0)); }
+#endif // USING_SSE2_FASTMATH
+};
+
+struct LeakyReLUPolicy {
+	static inline double Function(const double x) { return LeakyReLU(x); }
+	static inline double Derivative(const double y) { return LeakyReLUDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) {
+		return MathLib::FastMath::Internal::Select(_mm_cmpgt_pd(x, _mm_setzero_pd()), x, _mm_mul_pd(_mm_set1_pd(C), x));
+	}
+	static inline __m128d Derivative(const __m128d y) {
+		return MathLib::FastMath::Internal::Select(_mm_cmpgt_pd(y, _mm_setzero_pd()), _mm_set1_pd(1.0), _mm_set1_pd(C));
+	}
+#endif // USING_SSE2_FASTMATH
+};
 
+struct ELUPolicy {
+	static inline double Function(const double x) { return ELU(x); }
+	static inline double Derivative(const double y) { return ELUDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) {
+		return MathLib::FastMath::Internal::Select(_mm_cmpgt_pd(x, _mm_setzero_pd()), x, _mm_mul_pd(_mm_set1_pd(D), MathLib::FastMath::Internal::ExpM1(x)));
+	}
+	static inline __m128d Derivative(const __m128d y) {
+		return MathLib::FastMath::Internal::Select(_mm_cmpgt_pd(y, _mm_setzero_pd()), _mm_set1_pd(1.0), _mm_add_pd(y, _mm_set1_pd(D)));
+	}
+#endif // USING_SSE2_FASTMATH
+};
+
+struct TanhPolicy {
+	static inline double Function(const double x) { return Tanh(x); }
+	static inline double Derivative(const double y) { return TanhDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) { return MathLib::FastMath::Internal::Tanh(x); }
+	static inline __m128d Derivative(const __m128d y) { return _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(y, y)); }
+#endif // USING_SSE2_FASTMATH
+};
+
+struct SoftplusPolicy {
+	static inline double Function(const double x) { return Softplus(x); }
+	static inline double Derivative(const double y) { return SoftplusDerivative(y); }
+#ifdef USING_SSE2_FASTMATH
+	static inline __m128d Function(const __m128d x) { return MathLib::FastMath::Internal::Softplus(x); }
+	static inline __m128d Derivative(const __m128d y) {
+		const __m128d sign = MathLib::FastMath::Internal::SignMask();
+		return _mm_xor_pd(MathLib::FastMath::Internal::ExpM1(_mm_xor_pd(y, sign)), sign);
+	}
+#endif // USING_SSE2_FASTMATH
+};
+
+// Apply the activation of a policy in place to _size contiguous elements.
+template<class Policy>
+inline void ApplyActivation(double * _data, const size_t _size) {
+	size_t i = 0;
+#ifdef USING_SSE2_FASTMATH
+	for (; i + 4 <= _size; i += 4)
+	{
+		_mm_storeu_pd(_data + i, Policy::Function(_mm_loadu_pd(_data + i)));
+		_mm_storeu_pd(_data + i + 2, Policy::Function(_mm_loadu_pd(_data + i + 2)));
+	}
+#endif // USING_SSE2_FASTMATH
+	for (; i < _size; i++)
+		_data[i] = Policy::Function(_data[i]);
+}
+
+// Multiply _size contiguous deltas by the derivative of the activation of a policy at its outputs.
+template<class Policy>
+inline void ApplyActivationDerivative(const double * _output, double * _delta, const size_t _size) {
+	size_t i = 0;
+#ifdef USING_SSE2_FASTMATH
+	for (; i + 4 <= _size; i += 4)
+	{
+		_mm_storeu_pd(_delta + i, _mm_mul_pd(_mm_loadu_pd(_delta + i), Policy::Derivative(_mm_loadu_pd(_output + i))));
+		_mm_storeu_pd(_delta + i + 2, _mm_mul_pd(_mm_loadu_pd(_delta + i + 2), Policy::Derivative(_mm_loadu_pd(_output + i + 2))));
+	}
+#endif // USING_SSE2_FASTMATH
+	for (; i < _size; i++)
+		_delta[i] = _delta[i] * Policy::Derivative(_output[i]);
+}
+
+/************************************************************************************************************/
+// Activation kernels
+/// Apply an activation function in place to _size contiguous elements, with the same result as
+/// calling the scalar function on every element, instantiated from the policies above.
+typedef void(*ActivationKernel)(double * _data, const size_t _size);
+/// Multiply _size contiguous deltas by the derivative of an activation function at its outputs.
+typedef void(*ActivationDerivativeKernel)(const double * _output, double * _delta, const size_t _size);
+
+inline void ApplyLinear(double * _data, const size_t _size) { ApplyActivation<LinearPolicy>(_data, _size); }
+inline void ApplySigmoid(double * _data, const size_t _size) { ApplyActivation<SigmoidPolicy>(_data, _size); }
+inline void ApplyReLU(double * _data, const size_t _size) { ApplyActivation<ReLUPolicy>(_data, _size); }
+inline void ApplyLeakyReLU(double * _data, const size_t _size) { ApplyActivation<LeakyReLUPolicy>(_data, _size); }
+inline void ApplyELU(double * _data, const size_t _size) { ApplyActivation<ELUPolicy>(_data, _size); }
+inline void ApplyTanh(double * _data, const size_t _size) { ApplyActivation<TanhPolicy>(_data, _size); }
+// Softplus takes the blocked kernel of FastMath, which gives the same result.
+inline void ApplySoftplus(double * _data, const size_t _size) { MathLib::FastMath::ApplySoftplus(_data, _size); }
+
+// Get the activation kernel of an activation function.
+/// Returns nullptr for functions without a kernel, such as Custom.
+inline ActivationKernel GetActivationKernel(const ActivationFunction _function) {
+	switch (_function)
+	{
+	case ActivationFunction::Linear: return ApplyLinear;
+	case ActivationFunction::Sigmoid: return ApplySigmoid;
+	case ActivationFunction::ReLU: return ApplyReLU;
+	case ActivationFunction::LeakyReLU: return ApplyLeakyReLU;
+	case ActivationFunction::ELU: return ApplyELU;
+	case ActivationFunction::Tanh: return ApplyTanh;
+	case ActivationFunction::Softplus: return ApplySoftplus;
+	default: return nullptr;
+	}
+}
+
+// Get the activation kernel matching a scalar activation function.
+/// Returns nullptr if the function has no kernel.
+inline ActivationKernel GetActivationKernel(double(*_function)(double)) {
+	if (_function == Linear) return ApplyLinear;
+	if (_function == Sigmoid) return ApplySigmoid;
+	if (_function == ReLU) return ApplyReLU;
+	if (_function == LeakyReLU) return ApplyLeakyReLU;
+	if (_function == ELU) return ApplyELU;
+	if (_function == Tanh) return ApplyTanh;
+	if (_function == Softplus) return ApplySoftplus;
+	return nullptr;
+}
+
+// Get the derivative kernel matching a scalar derivative function.
+/// Returns nullptr if the function has no kernel.
+inline ActivationDerivativeKernel GetActivationDerivativeKernel(double(*_derivative)(double)) {
+	if (_derivative == LinearDerivative) return ApplyActivationDerivative<LinearPolicy>;
+	if (_derivative == SigmoidDerivative) return ApplyActivationDerivative<SigmoidPolicy>;
+	if (_derivative == ReLUDerivative) return ApplyActivationDerivative<ReLUPolicy>;
+	if (_derivative == LeakyReLUDerivative) return ApplyActivationDerivative<LeakyReLUPolicy>;
+	if (_derivative == ELUDerivative) return ApplyActivationDerivative<ELUPolicy>;
+	if (_derivative == TanhDerivative) return ApplyActivationDerivative<TanhPolicy>;
+	if (_derivative == SoftplusDerivative) return ApplyActivationDerivative<SoftplusPolicy>;
+	return nullptr;
+}
@@ -24,6 +24,40 @@ size_t Neural::Layer::GetNodeNum(void)
 	return m;
 }
 
+// Apply the activation function to a contiguous array of node values.
+/// Uses the array kernel of the activation function when it has one.
+void Neural::Layer::ApplyActivation(ElemType * _values, const size_t _size)
+{
+	if (activationKernel != nullptr)
+		activationKernel(_values, _size);
+	else
+		for (size_t i = 0; i < _size; i++)
+			_values[i] = activationFunction(_values[i]);
+}
+
+// Forward propagation of a frozen layer, the activated values are written to _values.
+/// θ(W * X + B) with W the packed m x n weights.
+void Neural::Layer::FrozenForward(ElemType * _values)
+{
+	std::copy(frozenBias.begin(), frozenBias.end(), _values);
+	MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::NoTrans, m, 1, n,
+		ElemType(1), frozenWeight.data(), n, frozenInput.data(), 1, ElemType(1), _values, 1);
+	ApplyActivation(_values, m);
+}
+
+// Copy the input of a frozen layer.
+void Neural::Layer::FrozenSetInput(const Vector<ElemType> & _vec)
+{
+	for (size_t j = 0; j < n; j++)
+		frozenInput[j] = _vec(j);
+}
+
+// Bytes of the packed weights, biases and input.
+size_t Neural::Layer::FrozenBytes(void) const
+{
+	return (frozenWeight.capacity() + frozenBias.capacity() + frozenInput.capacity()) * sizeof(ElemType);
+}
+
 
 /***************************************************************************************************/
 // Class : InputLayer
@@ -74,11 +108,32 @@ void Neural::InputLayer::SetActivationFunction(const ActivationFunction _functio
 		this->activationFunction = ReLU;
 		this->activationFunctionDerivative = ReLUDerivative;
 		break;
+	case ActivationFunction::Linear:
+		this->activationFunction = Linear;
+		this->activationFunctionDerivative = LinearDerivative;
+		break;
+	case ActivationFunction::LeakyReLU:
+		this->activationFunction = LeakyReLU;
+		this->activationFunctionDerivative = LeakyReLUDerivative;
+		break;
+	case ActivationFunction::ELU:
+		this->activationFunction = ELU;
+		this->activationFunctionDerivative = ELUDerivative;
+		break;
+	case ActivationFunction::Tanh:
+		this->activationFunction = Tanh;
+		this->activationFunctionDerivative = TanhDerivative;
+		break;
+	case ActivationFunction::Softplus:
+		this->activationFunction = Softplus;
+		this->activationFunctionDerivative = SoftplusDerivative;
+		break;
 	default:
 		this->activationFunction = Sigmoid;
 		this->activationFunctionDerivative = SigmoidDerivative;
 		break;
 	}
+	this->activationKernel = GetActivationKernel(this->activationFunction);
 }
 
 // Set the loss function of the layer.
@@ -144,6 +199,19 @@ void Neural::InputLayer::BatchDeltaSumClear(void)
 {
 }
 
+// Freeze the layer for inference.
+/// The input layer holds no gradient.
+void Neural::InputLayer::Freeze(void)
+{
+	this->frozen = true;
+}
+
+// Bytes held by the nodes of the layer.
+size_t Neural::InputLayer::GetMemoryBytes(void) const
+{
+	return _nodes.capacity() * sizeof(InputNode);
+}
+
 
 /***************************************************************************************************/
 // Class : HiddenLayer
@@ -167,6 +235,11 @@ Neural::HiddenLayer::HiddenLayer(const size_t _n, const size_t _m)
 /// Which means set the nodes` tempInput.
 void Neural::HiddenLayer::SetInput(const Vector<ElemType>& _vec)
 {
+	if (frozen)
+	{
+		FrozenSetInput(_vec);
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		for (size_t j = 0; j < n; j++)
@@ -198,11 +271,32 @@ void Neural::HiddenLayer::SetActivationFunction(const ActivationFunction _functi
 		this->activationFunction = ReLU;
 		this->activationFunctionDerivative = ReLUDerivative;
 		break;
+	case ActivationFunction::Linear:
+		this->activationFunction = Linear;
+		this->activationFunctionDerivative = LinearDerivative;
+		break;
+	case ActivationFunction::LeakyReLU:
+		this->activationFunction = LeakyReLU;
+		this->activationFunctionDerivative = LeakyReLUDerivative;
+		break;
+	case ActivationFunction::ELU:
+		this->activationFunction = ELU;
+		this->activationFunctionDerivative = ELUDerivative;
+		break;
+	case ActivationFunction::Tanh:
+		this->activationFunction = Tanh;
+		this->activationFunctionDerivative = TanhDerivative;
+		break;
+	case ActivationFunction::Softplus:
+		this->activationFunction = Softplus;
+		this->activationFunctionDerivative = SoftplusDerivative;
+		break;
 	default:
 		this->activationFunction = Sigmoid;
 		this->activationFunctionDerivative = SigmoidDerivative;
 		break;
 	}
+	this->activationKernel = GetActivationKernel(this->activationFunction);
 }
 
 // Set the loss function of the layer.
@@ -237,16 +331,28 @@ Vector<Neural::ElemType> Neural::HiddenLayer::GetOutput(void)
 /// Calculate the value of each node.
 void Neural::HiddenLayer::ForwardPropagation(void)
 {
-	for (size_t i = 0; i < m; i++)
+	std::vector<ElemType> values(m);
+	if (frozen)
+		FrozenForward(values.data());
+	else
 	{
-		_nodes.at(i).value = activationFunction(Vector<double>::DotProduct(_nodes.at(i).tempInput, _nodes.at(i).weight) + _nodes.at(i).bias);
+		for (size_t i = 0; i < m; i++)
+			values[i] = Vector<double>::DotProduct(_nodes.at(i).tempInput, _nodes.at(i).weight) + _nodes.at(i).bias;
+		ApplyActivation(values.data(), m);
 	}
+	for (size_t i = 0; i < m; i++)
+		_nodes.at(i).value = values[i];
 }
 
 // BackwardPropagation Function
 /// Calculate the gradient(delta) of each node.
 Vector<Neural::ElemType> Neural::HiddenLayer::BackwardPropagation(const Vector<ElemType>& _vec)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : HiddenLayer is frozen, no backward propagation." << std::endl;
+		return Vector<ElemType>();
+	}
 	SetExpectation(_vec);
 	for (size_t i = 0; i < m; i++)
 	{
@@ -268,6 +374,11 @@ Vector<Neural::ElemType> Neural::HiddenLayer::BackwardPropagation(const Vector<E
 /// Update the weight and bias of each node.
 void Neural::HiddenLayer::Update(void)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : HiddenLayer is frozen, no update." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		_nodes.at(i).weight += _nodes.at(i).weightDeltaSum * learnRate;
@@ -278,6 +389,11 @@ void Neural::HiddenLayer::Update(void)
 // Sum up the delta of a batch.
 void Neural::HiddenLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : HiddenLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		_nodes.at(i).weightDeltaSum += (_nodes.at(i).weightDelta * (1 / (double)_batchSize));
@@ -288,6 +404,11 @@ void Neural::HiddenLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 // Clear the sum of sum of delta.
 void Neural::HiddenLayer::BatchDeltaSumClear(void)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : HiddenLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 		for (size_t j = 0; j < n; j++)
 			_nodes.at(i).weightDeltaSum(j) = 0;
@@ -296,6 +417,39 @@ void Neural::HiddenLayer::BatchDeltaSumClear(void)
 		_nodes.at(i).biasDeltaSum = 0;
 }
 
+// Freeze the layer for inference.
+/// The weights and biases are packed into frozenWeight and frozenBias, the node weights, gradients
+/// and input copies are released.
+void Neural::HiddenLayer::Freeze(void)
+{
+	if (frozen)
+		return;
+	frozenWeight.resize(m * n);
+	frozenBias.resize(m);
+	frozenInput.assign(n, ElemType(0));
+	for (size_t i = 0; i < m; i++)
+	{
+		HiddenNode & node = _nodes.at(i);
+		for (size_t j = 0; j < n; j++)
+			frozenWeight[i * n + j] = node.weight(j);
+		frozenBias[i] = node.bias;
+		node.weight.Release();
+		node.tempInput.Release();
+		node.weightDelta.Release();
+		node.weightDeltaSum.Release();
+	}
+	this->frozen = true;
+}
+
+// Bytes held by the nodes and the buffers of the layer.
+size_t Neural::HiddenLayer::GetMemoryBytes(void) const
+{
+	size_t bytes = _nodes.capacity() * sizeof(HiddenNode) + FrozenBytes();
+	for (const HiddenNode & node : _nodes)
+		bytes += (node.weight.Size() + node.tempInput.Size() + node.weightDelta.Size() + node.weightDeltaSum.Size()) * sizeof(ElemType);
+	return bytes;
+}
+
 
 /***************************************************************************************************/
 // Class : OutputLayer
@@ -319,6 +473,11 @@ Neural::OutputLayer::OutputLayer(const size_t _n, const size_t _m)
 /// Which means set the nodes` tempInput.
 void Neural::OutputLayer::SetInput(const Vector<ElemType>& _vec)
 {
+	if (frozen)
+	{
+		FrozenSetInput(_vec);
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		_nodes.at(i).tempInput = _vec;
@@ -347,11 +506,32 @@ void Neural::OutputLayer::SetActivationFunction(const ActivationFunction _functi
 		this->activationFunction = ReLU;
 		this->activationFunctionDerivative = ReLUDerivative;
 		break;
+	case ActivationFunction::Linear:
+		this->activationFunction = Linear;
+		this->activationFunctionDerivative = LinearDerivative;
+		break;
+	case ActivationFunction::LeakyReLU:
+		this->activationFunction = LeakyReLU;
+		this->activationFunctionDerivative = LeakyReLUDerivative;
+		break;
+	case ActivationFunction::ELU:
+		this->activationFunction = ELU;
+		this->activationFunctionDerivative = ELUDerivative;
+		break;
+	case ActivationFunction::Tanh:
+		this->activationFunction = Tanh;
+		this->activationFunctionDerivative = TanhDerivative;
+		break;
+	case ActivationFunction::Softplus:
+		this->activationFunction = Softplus;
+		this->activationFunctionDerivative = SoftplusDerivative;
+		break;
 	default:
 		this->activationFunction = Sigmoid;
 		this->activationFunctionDerivative = SigmoidDerivative;
 		break;
 	}
+	this->activationKernel = GetActivationKernel(this->activationFunction);
 }
 
 // Set the loss function of the layer.
@@ -409,17 +589,29 @@ Vector<Neural::ElemType> Neural::OutputLayer::GetDelta(void)
 /// Calculate the value of each node.
 void Neural::OutputLayer::ForwardPropagation(void)
 {
-	for (size_t i = 0; i < m; i++)
+	/// θ(∑ X * W - B)
+	std::vector<ElemType> values(m);
+	if (frozen)
+		FrozenForward(values.data());
+	else
 	{
-		/// θ(∑ X * W - B)
-		_nodes.at(i).value = activationFunction(Vector<double>::DotProduct(_nodes.at(i).tempInput, _nodes.at(i).weight) + _nodes.at(i).bias);
+		for (size_t i = 0; i < m; i++)
+			values[i] = Vector<double>::DotProduct(_nodes.at(i).tempInput, _nodes.at(i).weight) + _nodes.at(i).bias;
+		ApplyActivation(values.data(), m);
 	}
+	for (size_t i = 0; i < m; i++)
+		_nodes.at(i).value = values[i];
 }
 
 // BackwardPropagation Function
 /// Calculate the gradient(delta) of each node.
 Vector<Neural::ElemType> Neural::OutputLayer::BackwardPropagation(const Vector<ElemType> & _vec)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : OutputLayer is frozen, no backward propagation." << std::endl;
+		return Vector<ElemType>();
+	}
 	SetExpectation(_vec);
 	for (size_t i = 0; i < m; i++)
 	{
@@ -441,6 +633,11 @@ Vector<Neural::ElemType> Neural::OutputLayer::BackwardPropagation(const Vector<E
 /// Update the weight and bias of each node.
 void Neural::OutputLayer::Update(void)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : OutputLayer is frozen, no update." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		_nodes.at(i).weight += _nodes.at(i).weightDeltaSum * learnRate;
@@ -451,6 +648,11 @@ void Neural::OutputLayer::Update(void)
 // Sum up the delta of a batch.
 void Neural::OutputLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : OutputLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 	{
 		_nodes.at(i).weightDeltaSum += (_nodes.at(i).weightDelta * (1 / (double)_batchSize));
@@ -461,6 +663,11 @@ void Neural::OutputLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 // Clear the sum of sum of delta.
 void Neural::OutputLayer::BatchDeltaSumClear(void)
 {
+	if (frozen)
+	{
+		std::cerr << "ERROR : OutputLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
 	for (size_t i = 0; i < m; i++)
 		for (size_t j = 0; j < n; j++)
 			_nodes.at(i).weightDeltaSum(j) = 0;
@@ -469,6 +676,39 @@ void Neural::OutputLayer::BatchDeltaSumClear(void)
 		_nodes.at(i).biasDeltaSum = 0;
 }
 
+// Freeze the layer for inference.
+/// The weights and biases are packed into frozenWeight and frozenBias, the node weights, gradients
+/// and input copies are released.
+void Neural::OutputLayer::Freeze(void)
+{
+	if (frozen)
+		return;
+	frozenWeight.resize(m * n);
+	frozenBias.resize(m);
+	frozenInput.assign(n, ElemType(0));
+	for (size_t i = 0; i < m; i++)
+	{
+		OutputNode & node = _nodes.at(i);
+		for (size_t j = 0; j < n; j++)
+			frozenWeight[i * n + j] = node.weight(j);
+		frozenBias[i] = node.bias;
+		node.weight.Release();
+		node.tempInput.Release();
+		node.weightDelta.Release();
+		node.weightDeltaSum.Release();
+	}
+	this->frozen = true;
+}
+
+// Bytes held by the nodes and the buffers of the layer.
+size_t Neural::OutputLayer::GetMemoryBytes(void) const
+{
+	size_t bytes = _nodes.capacity() * sizeof(OutputNode) + FrozenBytes();
+	for (const OutputNode & node : _nodes)
+		bytes += (node.weight.Size() + node.tempInput.Size() + node.weightDelta.Size() + node.weightDeltaSum.Size()) * sizeof(ElemType);
+	return bytes;
+}
+
 // Sum up the loss of a batch.
 void Neural::OutputLayer::LossSumUpdate(void)
 {
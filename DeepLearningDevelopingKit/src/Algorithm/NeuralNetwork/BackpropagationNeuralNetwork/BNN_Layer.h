@@ -59,14 +59,44 @@ namespace Neural
 		// Clear the deltaSum of a batch.
 		virtual void BatchDeltaSumClear(void) = 0;
 
+	public: // Inference
+
+		// Freeze the layer for inference.
+		/// The gradients and the per node copies of the input are released, the weights and biases are
+		/// packed into one m x n row-major matrix and ForwardPropagation becomes a single GEMV on it.
+		/// BackwardPropagation, Update and the batch delta sums are refused afterwards.
+		virtual void Freeze(void) = 0;
+		inline bool IsFrozen(void) const { return frozen; }
+		// Bytes held by the nodes and the buffers of the layer.
+		virtual size_t GetMemoryBytes(void) const = 0;
+
+	protected:
+
+		// Apply the activation function to a contiguous array of node values.
+		void ApplyActivation(ElemType * _values, const size_t _size);
+		// Forward propagation of a frozen layer, the activated values are written to _values.
+		void FrozenForward(ElemType * _values);
+		// Copy the input of a frozen layer.
+		void FrozenSetInput(const Vector<ElemType> & _vec);
+		// Bytes of the packed weights, biases and input.
+		size_t FrozenBytes(void) const;
+
 	protected:
 
 		ElemType(*activationFunction)(ElemType x);
 		ElemType(*activationFunctionDerivative)(ElemType x);
+		ActivationKernel activationKernel = nullptr;
 		ElemType(*lossFunction)(ElemType x, ElemType y);
 		ElemType(*lossFunctionDerivative)(ElemType x, ElemType y);
 		size_t n, m;
 		double learnRate = 1;
+
+		// Frozen layer
+		/// frozenWeight is m x n row-major, row i the weights of node i.
+		bool frozen = false;
+		std::vector<ElemType> frozenWeight;
+		std::vector<ElemType> frozenBias;
+		std::vector<ElemType> frozenInput;
 	};
 
 	/***************************************************************************************************/
@@ -119,6 +149,13 @@ namespace Neural
 		// Clear the sumdelta of a batch.
 		void BatchDeltaSumClear(void) override;
 
+	public: // Inference
+
+		// Freeze the layer for inference.
+		void Freeze(void) override;
+		// Bytes held by the nodes and the buffers of the layer.
+		size_t GetMemoryBytes(void) const override;
+
 	private:
 
 		std::vector<InputNode> _nodes;
@@ -170,6 +207,13 @@ namespace Neural
 		// Clear the sum of sum of delta.
 		void BatchDeltaSumClear(void) override;
 
+	public: // Inference
+
+		// Freeze the layer for inference.
+		void Freeze(void) override;
+		// Bytes held by the nodes and the buffers of the layer.
+		size_t GetMemoryBytes(void) const override;
+
 	private:
 		std::vector<HiddenNode> _nodes;
 	};
@@ -228,6 +272,13 @@ namespace Neural
 		// Clear the sum of loss od a batch.
 		void LossSumClear(void);
 
+	public: // Inference
+
+		// Freeze the layer for inference.
+		void Freeze(void) override;
+		// Bytes held by the nodes and the buffers of the layer.
+		size_t GetMemoryBytes(void) const override;
+
 	private:
 
 		std::vector<OutputNode> _nodes;
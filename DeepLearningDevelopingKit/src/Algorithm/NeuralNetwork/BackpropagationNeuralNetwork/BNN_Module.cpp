@@ -132,6 +132,25 @@ Vector<Neural::ElemType> Neural::BNN::GetOutput(void)
 	return _outputlayer->GetOutput();
 }
 
+void Neural::BNN::Freeze(std::ostream * _report)
+{
+	const size_t before = GetMemoryBytes();
+	_inputlayer->Freeze();
+	for (size_t i = 0; i < _hiddenlayers.size(); i++)
+		_hiddenlayers.at(i)->Freeze();
+	_outputlayer->Freeze();
+	if (_report != nullptr)
+		*_report << "BNN frozen : " << before << " bytes -> " << GetMemoryBytes() << " bytes" << std::endl;
+}
+
+size_t Neural::BNN::GetMemoryBytes(void) const
+{
+	size_t bytes = _inputlayer->GetMemoryBytes() + _outputlayer->GetMemoryBytes();
+	for (size_t i = 0; i < _hiddenlayers.size(); i++)
+		bytes += _hiddenlayers.at(i)->GetMemoryBytes();
+	return bytes;
+}
+
 void Neural::BNN::SetTrainSet(NumericSet * _trainset)
 {
 	this->_trainSet = _trainset;
@@ -146,6 +165,11 @@ void Neural::BNN::SetTestSet(NumericSet * _testset)
 
 void Neural::BNN::Train()
 {
+	if (_outputlayer->IsFrozen())
+	{
+		std::cerr << "ERROR : BNN is frozen, no training." << std::endl;
+		return;
+	}
 	int iterCount = 0;
 	double loss = 0;
 	NumericSet::Sample sample;
@@ -73,6 +73,14 @@ namespace Neural
 		// Testing Funtion
 		void Test();
 
+	public: // Inference
+
+		// Freeze every layer for inference, Train() is refused afterwards.
+		/// Prints the bytes held by the layers before and after to _report, if one is given.
+		void Freeze(std::ostream * _report = nullptr);
+		// Bytes held by the layers.
+		size_t GetMemoryBytes(void) const;
+
 	private:
 
 		// ForwardPropagation Function
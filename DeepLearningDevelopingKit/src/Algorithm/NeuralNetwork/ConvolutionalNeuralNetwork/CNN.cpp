@@ -0,0 +1,757 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		   Convolutinal Neural Network     	                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN.h"
+
+Neural::Sequential::Sequential(const SequentialInitor & _initor)
+{
+	this->_training = _initor.Training;
+	this->_batchSize = _initor.BatchSize;
+	if (_batchSize == 0)
+	{
+		std::cerr << "ERROR : Sequential batch size is zero, using one." << std::endl;
+		this->_batchSize = 1;
+	}
+	this->_shapes.push_back(FeatureShape(_initor.InputChannels, _initor.InputSize));
+	this->_activations.resize(1);
+	this->_deltas.resize(1);
+}
+
+Neural::ConvolutionalLayer & Neural::Sequential::Add(ConvLayerInitor _initor)
+{
+	_initor.InputSize = _shapes.back().Size;
+	_convLayers.push_back(std::unique_ptr<ConvolutionalLayer>(new ConvolutionalLayer(_initor)));
+	ConvolutionalLayer & layer = *_convLayers.back();
+	Push(SequentialLayerType::Convolutional, _convLayers.size() - 1, FeatureShape(_initor.KernelNum, layer.GetOutputSize()));
+	return layer;
+}
+
+Neural::PoolingLayer & Neural::Sequential::Add(PoolLayerInitor _initor)
+{
+	_initor.InputSize = _shapes.back().Size;
+	_poolLayers.push_back(std::unique_ptr<PoolingLayer>(new PoolingLayer(_initor)));
+	PoolingLayer & layer = *_poolLayers.back();
+	Push(SequentialLayerType::Pooling, _poolLayers.size() - 1, FeatureShape(_shapes.back().Channels, layer.GetOutputSize()));
+	return layer;
+}
+
+Neural::ProcessLayer & Neural::Sequential::Add(ProcessLayerInitor _initor)
+{
+	_initor.InputSize = _shapes.back().Size;
+	_processLayers.push_back(std::unique_ptr<ProcessLayer>(new ProcessLayer(_initor)));
+	const FeatureShape shape = _shapes.back();
+	Push(SequentialLayerType::Process, _processLayers.size() - 1, shape);
+	return *_processLayers.back();
+}
+
+Neural::FusedConvPoolLayer & Neural::Sequential::Add(FusedLayerInitor _initor)
+{
+	_initor.Conv.InputSize = _shapes.back().Size;
+	_initor.Training = _training;
+	_fusedLayers.push_back(std::unique_ptr<FusedConvPoolLayer>(new FusedConvPoolLayer(_initor)));
+	FusedConvPoolLayer & layer = *_fusedLayers.back();
+	Push(SequentialLayerType::FusedConvPool, _fusedLayers.size() - 1, FeatureShape(_initor.Conv.KernelNum, layer.GetOutputSize()));
+	return layer;
+}
+
+Neural::BatchNormLayer & Neural::Sequential::Add(BatchNormLayerInitor _initor)
+{
+	_initor.InputSize = _shapes.back().Size;
+	_initor.Channels = _shapes.back().Channels;
+	_batchNormLayers.push_back(std::unique_ptr<BatchNormLayer>(new BatchNormLayer(_initor)));
+	BatchNormLayer & layer = *_batchNormLayers.back();
+	layer.SetTraining(_training);
+	const FeatureShape shape = _shapes.back();
+	Push(SequentialLayerType::BatchNorm, _batchNormLayers.size() - 1, shape);
+	return layer;
+}
+
+void Neural::Sequential::Push(const SequentialLayerType _type, const size_t _index, const FeatureShape & _output)
+{
+	if (_output.Elements() == 0)
+		std::cerr << "ERROR : Sequential layer " << _layers.size() << " has an empty output." << std::endl;
+	Layer layer;
+	layer.Type = _type;
+	layer.Index = _index;
+	_layers.push_back(layer);
+	_shapes.push_back(_output);
+	_activations.resize(_layers.size() + 1);
+	_deltas.resize(_layers.size() + 1);
+	_planned = false;
+}
+
+void Neural::Sequential::SetTraining(const bool _training)
+{
+	if (_training && _frozen)
+	{
+		std::cerr << "ERROR : Sequential is frozen, no training." << std::endl;
+		return;
+	}
+	this->_training = _training;
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		layer->SetTraining(_training);
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		layer->SetTraining(_training);
+	_planned = false;
+}
+
+void Neural::Sequential::SetLearnRate(const double _learnRate)
+{
+	for (std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+		layer->SetLearnRate(_learnRate);
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		layer->GetConvLayer().SetLearnRate(_learnRate);
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		layer->SetLearnRate(_learnRate);
+}
+
+void Neural::Sequential::Plan(void)
+{
+	// Layer i runs forward at step i and backward at step 2L - 1 - i.
+	const size_t layerNum = _layers.size();
+	_planner.Clear();
+	for (size_t i = 0; i < layerNum; i++)
+	{
+		Layer & layer = _layers[i];
+		// The output is read by the next layer, in training also by the backward of both layers.
+		/// The output of the model stays valid until the end of the iteration.
+		const size_t end = i + 1 == layerNum ? (_training ? 2 * layerNum : layerNum) : (_training ? 2 * layerNum - 1 - i : i + 1);
+		layer.Output = _planner.AddTensor(_batchSize * _shapes[i + 1].Elements(), i, end);
+		layer.InputDelta = SIZE_MAX;
+		layer.InPlaceDelta = false;
+		// A process layer writes over the output of the layer before it, unless that one is a process
+		// layer whose backward still needs its output. So does a batch normalization in inference, its
+		// backward needs its input.
+		layer.InPlace = i > 0 && ((layer.Type == SequentialLayerType::Process && !(_training && _layers[i - 1].Type == SequentialLayerType::Process))
+			|| (layer.Type == SequentialLayerType::BatchNorm && !_training));
+		if (layer.InPlace)
+			_planner.Share(layer.Output, _layers[i - 1].Output);
+	}
+	for (size_t i = 0; _training && i < layerNum; i++)
+	{
+		Layer & layer = _layers[i];
+		// The delta of the input is read by the backward of the layer before, the first one by the caller.
+		const size_t begin = 2 * layerNum - 1 - i;
+		const bool convolution = layer.Type == SequentialLayerType::Convolutional || layer.Type == SequentialLayerType::FusedConvPool;
+		// A convolution gives every input channel the same delta, it is stored once.
+		const size_t elements = convolution ? _shapes[i].Size.m * _shapes[i].Size.n : _shapes[i].Elements();
+		layer.InputDelta = _planner.AddTensor(_batchSize * elements, begin, begin + 1);
+	}
+	for (size_t i = layerNum; _training && i-- > 0;)
+	{
+		Layer & layer = _layers[i];
+		// A process layer scales the delta of its output in place, unless it is the shared delta of a convolution.
+		layer.InPlaceDelta = layer.Type == SequentialLayerType::Process && i + 1 < layerNum
+			&& (_layers[i + 1].Type == SequentialLayerType::Pooling || _layers[i + 1].Type == SequentialLayerType::Process);
+		if (layer.InPlaceDelta)
+			_planner.Share(layer.InputDelta, _layers[i + 1].InputDelta);
+	}
+	_planner.Plan();
+
+	_arenas.assign(_planner.GetArenaNum(), MathLib::Matrix<ElemType>());
+	for (size_t a = 0; a < _arenas.size(); a++)
+		_arenas[a].Init(_planner.GetArenaElements(a), 1);
+	_plannedOutputs.assign(layerNum, FeatureBatch());
+	_plannedDeltas.assign(layerNum, FeatureBatch());
+	for (size_t i = 0; i < layerNum; i++)
+	{
+		const Layer & layer = _layers[i];
+		_plannedOutputs[i] = Bind(layer.Output, _shapes[i + 1].Channels, _shapes[i + 1].Size);
+		if (layer.InputDelta == SIZE_MAX)
+			continue;
+		const bool convolution = layer.Type == SequentialLayerType::Convolutional || layer.Type == SequentialLayerType::FusedConvPool;
+		_plannedDeltas[i] = Bind(layer.InputDelta, convolution ? 1 : _shapes[i].Channels, _shapes[i].Size);
+	}
+	_planned = true;
+}
+
+Neural::FeatureBatch Neural::Sequential::Bind(const size_t _tensor, const size_t _channels, const MathLib::Size _size)
+{
+	MathLib::Matrix<ElemType> & arena = _arenas.at(_planner.GetArena(_tensor));
+	const size_t elements = _size.m * _size.n;
+	FeatureBatch maps(_batchSize);
+	for (size_t n = 0; n < _batchSize; n++)
+		for (size_t c = 0; c < _channels; c++)
+			maps[n].push_back(arena.Alias((n * _channels + c) * elements, _size.m, _size.n));
+	return maps;
+}
+
+void Neural::Sequential::CopyMaps(const FeatureBatch & _source, FeatureBatch & _target)
+{
+	for (size_t n = 0; n < _target.size() && n < _source.size(); n++)
+		for (size_t c = 0; c < _target[n].size() && c < _source[n].size(); c++)
+		{
+			const MathLib::Matrix<ElemType> & source = _source[n][c];
+			std::copy(source.Data(), source.Data() + source.ColumeSize() * source.RowSize(), _target[n][c].Data());
+		}
+}
+
+Neural::FeatureBatch Neural::Sequential::Handles(const FeatureBatch & _batch)
+{
+	FeatureBatch handles;
+	handles.reserve(_batch.size());
+	for (const std::vector<MathLib::Matrix<ElemType>> & maps : _batch)
+		handles.push_back(MathLib::Matrix<ElemType>::Handles(maps));
+	return handles;
+}
+
+void Neural::Sequential::PrintSummary(std::ostream & _stream) const
+{
+	static const char * typeNames[] = { "Convolutional", "Pooling", "Process", "FusedConvPool", "BatchNorm" };
+	const size_t bytes = sizeof(ElemType);
+	for (size_t i = 0; i < _layers.size(); i++)
+	{
+		const Layer & layer = _layers[i];
+		const FeatureShape & input = _shapes[i], & output = _shapes[i + 1];
+		_stream << "Layer " << i << " " << typeNames[(int)layer.Type] << " : " << input.Channels << "x" << input.Size.m << "x" << input.Size.n
+			<< " -> " << output.Channels << "x" << output.Size.m << "x" << output.Size.n;
+		if (_planned)
+		{
+			_stream << "  output arena " << _planner.GetArena(layer.Output) << (layer.InPlace ? " (in place)" : "");
+			if (layer.InputDelta != SIZE_MAX)
+				_stream << "  delta arena " << _planner.GetArena(layer.InputDelta) << (layer.InPlaceDelta ? " (in place)" : "");
+		}
+		_stream << std::endl;
+	}
+	if (_planned)
+		_stream << "Arenas : " << _planner.GetArenaNum() << "  " << _planner.GetPlannedElements() * bytes << " bytes  Without reuse : "
+			<< _planner.GetTotalElements() * bytes << " bytes  Peak live : " << _planner.GetPeakElements() * bytes << " bytes" << std::endl;
+	PrintMemoryReport(GetMemoryReport(), _stream);
+}
+
+Neural::MemoryReport Neural::Sequential::GetMemoryReport(void) const
+{
+	MemoryReport memory;
+	for (const std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+		Account(*layer, memory);
+	for (const std::unique_ptr<PoolingLayer> & layer : _poolLayers)
+		Account(*layer, memory);
+	for (const std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		Account(*layer, memory);
+	for (const std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		Account(*layer, memory);
+	memory.Activations += MapBytes(_arenas);
+	return memory;
+}
+
+void Neural::Sequential::PrintMemoryReport(const MemoryReport & _memory, std::ostream & _stream)
+{
+	_stream << "Memory : parameters " << _memory.Parameters << "  gradients " << _memory.Gradients << "  activations " << _memory.Activations
+		<< "  saved " << _memory.Saved << "  workspace " << _memory.Workspace << "  total " << _memory.Total() << " bytes" << std::endl;
+}
+
+size_t Neural::Sequential::MapBytes(const std::vector<MathLib::Matrix<ElemType>> & _maps)
+{
+	size_t bytes = 0;
+	std::vector<const ElemType *> counted;
+	for (const MathLib::Matrix<ElemType> & map : _maps)
+	{
+		const ElemType * data = map.Data();
+		if (map.IsAlias() || data == nullptr || std::find(counted.begin(), counted.end(), data) != counted.end())
+			continue;
+		counted.push_back(data);
+		bytes += map.ColumeSize() * map.RowSize() * sizeof(ElemType);
+	}
+	return bytes;
+}
+
+size_t Neural::Sequential::MapBytes(const FeatureBatch & _batch)
+{
+	size_t bytes = 0;
+	for (const std::vector<MathLib::Matrix<ElemType>> & maps : _batch)
+		bytes += MapBytes(maps);
+	return bytes;
+}
+
+void Neural::Sequential::Account(const ConvolutionalLayer & _conv, MemoryReport & _memory)
+{
+	std::vector<MathLib::Matrix<ElemType>> kernels, gradients, features;
+	for (const ConvNode & node : _conv._convNodes)
+	{
+		kernels.push_back(node.kernel);
+		gradients.push_back(node.kernelDelta);
+		gradients.push_back(node.kernelDeltaSum);
+		features.push_back(node.feature);
+	}
+	_memory.Parameters += MapBytes(kernels) + _conv._convNodes.size() * sizeof(ElemType) + MapBytes(_conv._flippedKernels.Data)
+		+ BufferBytes(_conv._packedKernels.Data) + BufferBytes(_conv._winogradKernels.Data) + BufferBytes(_conv._kernelSpectra.Data);
+	_memory.Gradients += MapBytes(gradients) + MapBytes(_conv._derivative) + MapBytes(_conv._derivativeLastLayer)
+		+ MapBytes(_conv._derivativeBatch) + MapBytes(_conv._derivativeLastLayerBatch);
+	_memory.Activations += MapBytes(features) + MapBytes(_conv._featureBatch);
+	_memory.Saved += MapBytes(_conv._input) + MapBytes(_conv._paddedInput) + MapBytes(_conv._inputBatch);
+	_memory.Workspace += BufferBytes(_conv._averageInput) + BufferBytes(_conv._padded) + BufferBytes(_conv._column) + BufferBytes(_conv._output)
+		+ BufferBytes(_conv._fftBuffer) + BufferBytes(_conv._inputSpectrum) + BufferBytes(_conv._productSpectrum)
+		+ BufferBytes(_conv._outputDelta) + BufferBytes(_conv._kernelGradient) + BufferBytes(_conv._columnDelta);
+}
+
+void Neural::Sequential::Account(const PoolingLayer & _pool, MemoryReport & _memory)
+{
+	_memory.Gradients += MapBytes(_pool._delta) + MapBytes(_pool._deltaDepooled) + MapBytes(_pool._deltaBatch) + MapBytes(_pool._deltaDepooledBatch);
+	_memory.Activations += MapBytes(_pool._output) + MapBytes(_pool._outputBatch);
+	_memory.Saved += MapBytes(_pool._input) + MapBytes(_pool._paddedInput) + BufferBytes(_pool._argmax)
+		+ MapBytes(_pool._inputBatch) + BufferBytes(_pool._argmaxBatch);
+	_memory.Workspace += BufferBytes(_pool._rowExtreme) + BufferBytes(_pool._rowArgmax) + BufferBytes(_pool._integral);
+}
+
+void Neural::Sequential::Account(const FusedConvPoolLayer & _fused, MemoryReport & _memory)
+{
+	Account(_fused._conv, _memory);
+	_memory.Gradients += MapBytes(_fused._delta) + MapBytes(_fused._convDelta) + MapBytes(_fused._deltaBatch) + MapBytes(_fused._convDeltaBatch);
+	_memory.Activations += MapBytes(_fused._output) + MapBytes(_fused._outputBatch);
+	_memory.Saved += BufferBytes(_fused._argmax) + BufferBytes(_fused._derivative) + BufferBytes(_fused._argmaxBatch) + BufferBytes(_fused._derivativeBatch);
+	_memory.Workspace += BufferBytes(_fused._averageInput) + BufferBytes(_fused._padded);
+}
+
+void Neural::Sequential::Account(const BatchNormLayer & _batchNorm, MemoryReport & _memory)
+{
+	_memory.Parameters += BufferBytes(_batchNorm._gamma) + BufferBytes(_batchNorm._beta)
+		+ BufferBytes(_batchNorm._runningMean) + BufferBytes(_batchNorm._runningVariance);
+	_memory.Gradients += BufferBytes(_batchNorm._gammaDelta) + BufferBytes(_batchNorm._betaDelta) + BufferBytes(_batchNorm._gammaDeltaSum)
+		+ BufferBytes(_batchNorm._betaDeltaSum) + MapBytes(_batchNorm._derivative) + MapBytes(_batchNorm._derivativeLastLayer)
+		+ MapBytes(_batchNorm._derivativeBatch) + MapBytes(_batchNorm._derivativeLastLayerBatch);
+	_memory.Activations += MapBytes(_batchNorm._output) + MapBytes(_batchNorm._outputBatch);
+	_memory.Saved += MapBytes(_batchNorm._input) + MapBytes(_batchNorm._inputBatch)
+		+ BufferBytes(_batchNorm._mean) + BufferBytes(_batchNorm._inverseDeviation);
+}
+
+void Neural::Sequential::SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input)
+{
+	if (_batchSize != 1)
+	{
+		std::cerr << "ERROR : Sequential batch size is " << _batchSize << ", use SetInputBatch." << std::endl;
+		return;
+	}
+	SetInputBatch(FeatureBatch(1, _input));
+}
+
+void Neural::Sequential::SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta)
+{
+	if (_batchSize != 1)
+	{
+		std::cerr << "ERROR : Sequential batch size is " << _batchSize << ", use SetDeltaBatch." << std::endl;
+		return;
+	}
+	SetDeltaBatch(FeatureBatch(1, _delta));
+}
+
+void Neural::Sequential::SetInputBatch(const FeatureBatch & _input)
+{
+	const FeatureShape & shape = _shapes.front();
+	bool match = _input.size() == _batchSize;
+	for (size_t n = 0; match && n < _input.size(); n++)
+		match = _input[n].size() == shape.Channels && !_input[n].empty()
+			&& _input[n].front().ColumeSize() == shape.Size.m && _input[n].front().RowSize() == shape.Size.n;
+	if (!match)
+	{
+		std::cerr << "ERROR : Sequential input does not match the input shape." << std::endl;
+		return;
+	}
+	_activations.front() = _input;
+}
+
+void Neural::Sequential::SetDeltaBatch(const FeatureBatch & _delta)
+{
+	bool match = _delta.size() == _batchSize;
+	for (size_t n = 0; match && n < _delta.size(); n++)
+		match = _delta[n].size() == _shapes.back().Channels;
+	if (!match)
+	{
+		std::cerr << "ERROR : Sequential delta does not match the output shape." << std::endl;
+		return;
+	}
+	_deltas.back() = _delta;
+}
+
+const std::vector<MathLib::Matrix<Neural::ElemType>> & Neural::Sequential::GetOutput(void) const
+{
+	static const std::vector<MathLib::Matrix<ElemType>> none;
+	return _activations.back().empty() ? none : _activations.back().front();
+}
+
+const std::vector<MathLib::Matrix<Neural::ElemType>> & Neural::Sequential::GetDelta(void) const
+{
+	static const std::vector<MathLib::Matrix<ElemType>> none;
+	return _deltas.front().empty() ? none : _deltas.front().front();
+}
+
+void Neural::Sequential::ForwardPropagation(void)
+{
+	if (_activations.front().empty())
+	{
+		std::cerr << "ERROR : Sequential forward propagation without input." << std::endl;
+		return;
+	}
+	if (!_planned)
+		Plan();
+	for (size_t i = 0; i < _layers.size(); i++)
+	{
+		const Layer & layer = _layers[i];
+		const FeatureBatch & input = _activations[i];
+		FeatureBatch & output = _activations[i + 1];
+		// Every layer writes to the aliases planned for its output, layers get handles of them, not copies.
+		switch (layer.Type)
+		{
+		case SequentialLayerType::Convolutional:
+		{
+			ConvolutionalLayer & conv = *_convLayers[layer.Index];
+			conv._inputBatch = Handles(input);
+			conv._featureBatch = Handles(_plannedOutputs[i]);
+			conv.ForwardPropagationBatch();
+			output = Handles(conv.GetFeatureBatch());
+			if (_frozen)
+			{
+				conv._inputBatch.clear();
+				conv._input.clear();
+			}
+			break;
+		}
+		case SequentialLayerType::Pooling:
+		{
+			PoolingLayer & pool = *_poolLayers[layer.Index];
+			pool._inputBatch = Handles(input);
+			pool._outputBatch = Handles(_plannedOutputs[i]);
+			pool.ForwardPropagationBatch();
+			output = Handles(pool.GetFeatureBatch());
+			if (_frozen)
+			{
+				pool._inputBatch.clear();
+				pool._input.clear();
+			}
+			break;
+		}
+		case SequentialLayerType::Process:
+		{
+			if (layer.InPlace)
+				output = Handles(input);
+			else
+			{
+				output = Handles(_plannedOutputs[i]);
+				CopyMaps(input, output);
+			}
+			_processLayers[layer.Index]->Process(output);
+			break;
+		}
+		case SequentialLayerType::FusedConvPool:
+		{
+			FusedConvPoolLayer & fused = *_fusedLayers[layer.Index];
+			fused._conv._inputBatch = Handles(input);
+			fused._outputBatch = Handles(_plannedOutputs[i]);
+			fused.ForwardPropagationBatch();
+			output = Handles(fused.GetFeatureBatch());
+			if (_frozen)
+			{
+				fused._conv._inputBatch.clear();
+				fused._conv._input.clear();
+			}
+			break;
+		}
+		case SequentialLayerType::BatchNorm:
+		{
+			BatchNormLayer & batchNorm = *_batchNormLayers[layer.Index];
+			batchNorm._inputBatch = Handles(input);
+			batchNorm._outputBatch = Handles(layer.InPlace ? input : _plannedOutputs[i]);
+			batchNorm.ForwardPropagationBatch();
+			output = Handles(batchNorm.GetFeatureBatch());
+			if (_frozen)
+				batchNorm._inputBatch.clear();
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+void Neural::Sequential::BackwardPropagation(void)
+{
+	if (!_training || !_planned || _deltas.back().empty())
+	{
+		std::cerr << "ERROR : Sequential backward propagation without training forward propagation or delta." << std::endl;
+		return;
+	}
+	for (size_t i = _layers.size(); i-- > 0;)
+	{
+		const Layer & layer = _layers[i];
+		const FeatureBatch & delta = _deltas[i + 1];
+		FeatureBatch & inputDelta = _deltas[i];
+		switch (layer.Type)
+		{
+		case SequentialLayerType::Convolutional:
+		{
+			ConvolutionalLayer & conv = *_convLayers[layer.Index];
+			conv._derivativeLastLayerBatch = Handles(delta);
+			conv._derivativeBatch.resize(_batchSize);
+			for (size_t n = 0; n < _batchSize; n++)
+				conv._derivativeBatch[n].assign(1, _plannedDeltas[i][n].front().Handle());
+			conv.BackwardPropagationBatch();
+			inputDelta = Handles(conv.GetDeltaBatch());
+			break;
+		}
+		case SequentialLayerType::Pooling:
+		{
+			PoolingLayer & pool = *_poolLayers[layer.Index];
+			pool._deltaBatch = Handles(delta);
+			pool._deltaDepooledBatch = Handles(_plannedDeltas[i]);
+			pool.BackwardPropagationBatch();
+			inputDelta = Handles(pool.GetDeltaBatch());
+			break;
+		}
+		case SequentialLayerType::Process:
+		{
+			if (layer.InPlaceDelta)
+				inputDelta = Handles(delta);
+			else
+			{
+				inputDelta = Handles(_plannedDeltas[i]);
+				CopyMaps(delta, inputDelta);
+			}
+			_processLayers[layer.Index]->Deprocess(inputDelta);
+			break;
+		}
+		case SequentialLayerType::FusedConvPool:
+		{
+			FusedConvPoolLayer & fused = *_fusedLayers[layer.Index];
+			fused._deltaBatch = Handles(delta);
+			fused._conv._derivativeBatch.resize(_batchSize);
+			for (size_t n = 0; n < _batchSize; n++)
+				fused._conv._derivativeBatch[n].assign(1, _plannedDeltas[i][n].front().Handle());
+			fused.BackwardPropagationBatch();
+			inputDelta = Handles(fused.GetDeltaBatch());
+			break;
+		}
+		case SequentialLayerType::BatchNorm:
+		{
+			BatchNormLayer & batchNorm = *_batchNormLayers[layer.Index];
+			batchNorm._derivativeLastLayerBatch = Handles(delta);
+			batchNorm._derivativeBatch = Handles(_plannedDeltas[i]);
+			batchNorm.BackwardPropagationBatch();
+			inputDelta = Handles(batchNorm.GetDeltaBatch());
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+void Neural::Sequential::Update(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : Sequential is frozen, no update." << std::endl;
+		return;
+	}
+	for (std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+		layer->Update();
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		layer->Update();
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		layer->Update();
+}
+
+void Neural::Sequential::BatchDeltaSumUpdate(const size_t _batchSize)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : Sequential is frozen, no delta sum." << std::endl;
+		return;
+	}
+	for (std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+		layer->BatchDeltaSumUpdate(_batchSize);
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		layer->GetConvLayer().BatchDeltaSumUpdate(_batchSize);
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		layer->BatchDeltaSumUpdate(_batchSize);
+}
+
+void Neural::Sequential::BatchDeltaSumClear(void)
+{
+	if (_frozen)
+		return;
+	for (std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+		layer->BatchDeltaSumClear();
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+		layer->GetConvLayer().BatchDeltaSumClear();
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+		layer->BatchDeltaSumClear();
+}
+
+void Neural::Sequential::Freeze(std::ostream * _report)
+{
+	if (_frozen)
+		return;
+	const MemoryReport before = GetMemoryReport();
+	const size_t layerNum = _layers.size();
+	Fold();
+	SetTraining(false);
+	_frozen = true;
+	// The layers drop their gradients and saved state, and their handles on the arenas planned for training.
+	for (std::unique_ptr<ConvolutionalLayer> & layer : _convLayers)
+	{
+		layer->Freeze();
+		for (ConvNode & node : layer->_convNodes)
+			node.feature = ConvFeature();
+		FeatureBatch().swap(layer->_featureBatch);
+	}
+	for (std::unique_ptr<PoolingLayer> & layer : _poolLayers)
+	{
+		layer->Freeze();
+		std::vector<Feature>().swap(layer->_output);
+		FeatureBatch().swap(layer->_outputBatch);
+	}
+	for (std::unique_ptr<ProcessLayer> & layer : _processLayers)
+		layer->Freeze();
+	for (std::unique_ptr<FusedConvPoolLayer> & layer : _fusedLayers)
+	{
+		layer->Freeze();
+		std::vector<Feature>().swap(layer->_output);
+		FeatureBatch().swap(layer->_outputBatch);
+	}
+	for (std::unique_ptr<BatchNormLayer> & layer : _batchNormLayers)
+	{
+		layer->Freeze();
+		std::vector<MathLib::Matrix<ElemType>>().swap(layer->_output);
+		FeatureBatch().swap(layer->_outputBatch);
+	}
+	for (size_t i = 1; i < _activations.size(); i++)
+		FeatureBatch().swap(_activations[i]);
+	for (FeatureBatch & delta : _deltas)
+		FeatureBatch().swap(delta);
+	Plan();
+
+	if (_report == nullptr)
+		return;
+	*_report << "Sequential frozen : " << layerNum << " layers -> " << _layers.size() << " layers" << std::endl << "Before ";
+	PrintMemoryReport(before, *_report);
+	*_report << "After  ";
+	PrintMemoryReport(GetMemoryReport(), *_report);
+}
+
+void Neural::Sequential::Fold(void)
+{
+	// Linear process layers are identities, a batch normalization right after a convolution is affine
+	// per kernel and moves into it.
+	std::vector<size_t> order;
+	for (size_t i = 0; i < _layers.size(); i++)
+	{
+		const Layer & layer = _layers[i];
+		if (layer.Type == SequentialLayerType::Process && _processLayers[layer.Index]->GetProcessFunction() == Linear)
+			continue;
+		if (layer.Type == SequentialLayerType::BatchNorm && !order.empty() && _layers[order.back()].Type == SequentialLayerType::Convolutional)
+		{
+			_batchNormLayers[layer.Index]->Fold(*_convLayers[_layers[order.back()].Index]);
+			continue;
+		}
+		order.push_back(i);
+	}
+
+	std::vector<Layer> layers;
+	std::vector<FeatureShape> shapes(1, _shapes.front());
+	std::vector<std::unique_ptr<ConvolutionalLayer>> convLayers;
+	std::vector<std::unique_ptr<PoolingLayer>> poolLayers;
+	std::vector<std::unique_ptr<ProcessLayer>> processLayers;
+	std::vector<std::unique_ptr<FusedConvPoolLayer>> fusedLayers;
+	std::vector<std::unique_ptr<BatchNormLayer>> batchNormLayers;
+	for (size_t o = 0; o < order.size(); o++)
+	{
+		const Layer & layer = _layers[order[o]];
+		Layer folded;
+		folded.Type = layer.Type;
+		switch (layer.Type)
+		{
+		case SequentialLayerType::Convolutional:
+		{
+			// Convolution, activation and pooling.
+			size_t next = o + 1;
+			const ProcessLayer * process = nullptr;
+			if (next < order.size() && _layers[order[next]].Type == SequentialLayerType::Process)
+				process = _processLayers[_layers[order[next++]].Index].get();
+			if (next < order.size() && _layers[order[next]].Type == SequentialLayerType::Pooling && Fusable(*_poolLayers[_layers[order[next]].Index]))
+			{
+				fusedLayers.push_back(Fuse(*_convLayers[layer.Index], process, *_poolLayers[_layers[order[next]].Index]));
+				folded.Type = SequentialLayerType::FusedConvPool;
+				folded.Index = fusedLayers.size() - 1;
+				o = next;
+			}
+			else
+			{
+				convLayers.push_back(std::move(_convLayers[layer.Index]));
+				folded.Index = convLayers.size() - 1;
+			}
+			break;
+		}
+		case SequentialLayerType::Pooling:
+			poolLayers.push_back(std::move(_poolLayers[layer.Index]));
+			folded.Index = poolLayers.size() - 1;
+			break;
+		case SequentialLayerType::Process:
+			processLayers.push_back(std::move(_processLayers[layer.Index]));
+			folded.Index = processLayers.size() - 1;
+			break;
+		case SequentialLayerType::FusedConvPool:
+			fusedLayers.push_back(std::move(_fusedLayers[layer.Index]));
+			folded.Index = fusedLayers.size() - 1;
+			break;
+		case SequentialLayerType::BatchNorm:
+			batchNormLayers.push_back(std::move(_batchNormLayers[layer.Index]));
+			folded.Index = batchNormLayers.size() - 1;
+			break;
+		default:
+			break;
+		}
+		layers.push_back(folded);
+		shapes.push_back(_shapes[order[o] + 1]);
+	}
+	_layers.swap(layers);
+	_shapes.swap(shapes);
+	_convLayers.swap(convLayers);
+	_poolLayers.swap(poolLayers);
+	_processLayers.swap(processLayers);
+	_fusedLayers.swap(fusedLayers);
+	_batchNormLayers.swap(batchNormLayers);
+	_activations.resize(_layers.size() + 1);
+	_deltas.resize(_layers.size() + 1);
+	_planned = false;
+}
+
+bool Neural::Sequential::Fusable(const PoolingLayer & _pool)
+{
+	return _pool._poolingMethod != PoolingMethod::RandomPooling && Pad::IsConstant(_pool._paddingNum);
+}
+
+std::unique_ptr<Neural::FusedConvPoolLayer> Neural::Sequential::Fuse(const ConvolutionalLayer & _conv, const ProcessLayer * _process, const PoolingLayer & _pool)
+{
+	FusedLayerInitor initor;
+	initor.Conv.Stride = _conv._stride;
+	initor.Conv.Dilation = _conv._dilation;
+	initor.Conv.KernelNum = _conv._convNodeNum;
+	initor.Conv.InputSize = _conv._inputSize;
+	initor.Conv.KernelSize = _conv._kernelSize;
+	initor.Conv.PaddingMethod = _conv._paddingMethod;
+	initor.Conv.PaddingNum = _conv._paddingNum;
+	initor.Conv.ActivationFunction = ActivationFunction::Linear;
+	initor.Pool.Stride = _pool._stride;
+	initor.Pool.InputSize = _pool._inputSize;
+	initor.Pool.PoolSize = _pool._poolSize;
+	initor.Pool.PaddingMethod = _pool._paddingMethod;
+	initor.Pool.PaddingNum = _pool._paddingNum;
+	initor.Pool.PoolingMethod = _pool._poolingMethod;
+	initor.Training = false;
+	std::unique_ptr<FusedConvPoolLayer> fused(new FusedConvPoolLayer(initor));
+	// The kernels and biases are shared (copy-on-write), the feature maps are not needed.
+	fused->_conv._convNodes = _conv._convNodes;
+	for (ConvNode & node : fused->_conv._convNodes)
+		node.feature = ConvFeature();
+	fused->_conv.InvalidateKernelCache();
+	if (_process != nullptr)
+	{
+		fused->_conv.activationFunction = _process->GetProcessFunction();
+		fused->_activationKernel = GetActivationKernel(fused->_conv.activationFunction);
+	}
+	return fused;
+}
@@ -7,13 +7,257 @@
 #pragma once
 
 // Header files
+#include <vector>
+#include <memory>
+#include <iostream>
+
 #include "CNN_ConvolutionalLayer.h"
 #include "CNN_PoolingLayer.h"
+#include "CNN_ProcessLayer.h"
+#include "CNN_FusedLayer.h"
+#include "CNN_BatchNormLayer.h"
+#include "CNN_MemoryPlanner.h"
 
 /***************************************************************************************************/
 // Namespace : Neural
 /// Provide Neural Network algorithm library.
 namespace Neural
 {
+	// Shape of the feature maps between two layers.
+	struct FeatureShape
+	{
+		FeatureShape() = default;
+		FeatureShape(const size_t _channels, const MathLib::Size _size) : Channels(_channels), Size(_size) {}
+
+		inline size_t Elements(void) const { return Channels * Size.m * Size.n; }
+
+		size_t Channels = 0;
+		MathLib::Size Size = MathLib::Size(0, 0);
+	};
+
+	// Type of a layer of a Sequential model.
+	enum class SequentialLayerType {
+		Convolutional,
+		Pooling,
+		Process,
+		FusedConvPool,
+		BatchNorm
+	};
+
+	// Memory Report
+	/// Bytes held by a Sequential model, by kind. Aliases of the arenas are only counted through the arenas,
+	/// matrices sharing a buffer once.
+	struct MemoryReport
+	{
+		// Kernels, biases and their cached layouts.
+		size_t Parameters = 0;
+		// Kernel gradients, their batch sums and the deltas owned by layers.
+		size_t Gradients = 0;
+		// The arenas (activations, and deltas in training) and the feature maps owned by layers.
+		size_t Activations = 0;
+		// Inputs and state kept by the forward propagation for the backward propagation.
+		size_t Saved = 0;
+		// Work buffers of the algorithms.
+		size_t Workspace = 0;
+
+		inline size_t Total(void) const { return Parameters + Gradients + Activations + Saved + Workspace; }
+	};
+
+	// Sequential Initor
+	/// Used for initialization of a Sequential model.
+	struct SequentialInitor
+	{
+		// Number of input channels.
+		size_t InputChannels = 1;
+		// Size of every input channel.
+		MathLib::Size InputSize;
+		// Whether the model is trained, activations then live until the backward propagation.
+		bool Training = true;
+		// Samples of every propagation, the arenas hold the whole batch.
+		size_t BatchSize = 1;
+	};
+
+	/***************************************************************************************************/
+	// Class : Sequential
+	/// A chain of layers, the output of every layer is the input of the next one.
+	/// Add() infers the input size of every layer from the one before, so only the model input is given.
+	/// The activations and deltas passed between layers are planned by a MemoryPlanner : they are aliases
+	/// (see Matrix::Alias) of a few arenas allocated once, reused as soon as their tensor is dead, and
+	/// process layers run in place. Matrices returned by the getters are only valid until the next
+	/// propagation.
+	/// Every propagation runs BatchSize samples, stored sample after sample in the arenas (N x C x H x W),
+	/// and every layer propagates the whole batch in one call (see ConvolutionalLayer::ForwardPropagationBatch).
+	class Sequential
+	{
+	public: // Constructors
+
+		// Invoke constructor
+		Sequential(const SequentialInitor & _initor);
+
+		Sequential(const Sequential &) = delete;
+		Sequential & operator = (const Sequential &) = delete;
+
+	public: // Building
+
+		// Append a layer, the input size of its initor is replaced by the output size of the model.
+		ConvolutionalLayer & Add(ConvLayerInitor _initor);
+		PoolingLayer & Add(PoolLayerInitor _initor);
+		ProcessLayer & Add(ProcessLayerInitor _initor);
+		FusedConvPoolLayer & Add(FusedLayerInitor _initor);
+		// The channels of the initor are replaced as well.
+		BatchNormLayer & Add(BatchNormLayerInitor _initor);
+		// Switch between training and inference, the activations are planned again.
+		void SetTraining(const bool _training);
+		// Set the learn rate of every layer with parameters.
+		void SetLearnRate(const double _learnRate);
+		// Plan the activations and deltas and allocate the arenas.
+		/// Called by the first propagation after a layer was added.
+		void Plan(void);
+
+	public: // Getter
+
+		inline size_t GetLayerNum(void) const { return _layers.size(); }
+		inline SequentialLayerType GetLayerType(const size_t _index) const { return _layers.at(_index).Type; }
+		// Shape of the input of layer _index, GetShape(GetLayerNum()) is the shape of the output.
+		inline const FeatureShape & GetShape(const size_t _index) const { return _shapes.at(_index); }
+		inline const FeatureShape & GetOutputShape(void) const { return _shapes.back(); }
+		inline size_t GetBatchSize(void) const { return _batchSize; }
+		// Output of the last forward propagation, of the first sample.
+		const std::vector<MathLib::Matrix<ElemType>> & GetOutput(void) const;
+		// Delta of the input computed by the last backward propagation, of the first sample.
+		const std::vector<MathLib::Matrix<ElemType>> & GetDelta(void) const;
+		// Output and input delta of every sample of the batch.
+		inline const FeatureBatch & GetOutputBatch(void) const { return _activations.back(); }
+		inline const FeatureBatch & GetDeltaBatch(void) const { return _deltas.front(); }
+		// The planner holding the lifetimes and arenas of the activations and deltas.
+		inline const MemoryPlanner & GetPlanner(void) const { return _planner; }
+		// Bytes of the arenas.
+		inline size_t GetArenaBytes(void) const { return _planner.GetPlannedElements() * sizeof(ElemType); }
+		// Bytes the activations and deltas take without reuse.
+		inline size_t GetUnplannedBytes(void) const { return _planner.GetTotalElements() * sizeof(ElemType); }
+		// Print the shape of every layer, the plan and the memory report.
+		void PrintSummary(std::ostream & _stream = std::cout) const;
+		// Bytes held by the layers and the arenas.
+		MemoryReport GetMemoryReport(void) const;
+		// Print a memory report on one line.
+		static void PrintMemoryReport(const MemoryReport & _memory, std::ostream & _stream = std::cout);
+
+	public: // Setter
+
+		// Set the input, _input.size() channels of the input size.
+		/// Only for a batch size of one.
+		void SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input);
+		// Set the delta of the output.
+		/// Only for a batch size of one.
+		void SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta);
+		// Set the input of the batch, BatchSize samples of the input shape.
+		void SetInputBatch(const FeatureBatch & _input);
+		// Set the delta of the output of the batch.
+		void SetDeltaBatch(const FeatureBatch & _delta);
+
+	public: // BackPropagation Algorithm
+
+		// ForwardPropagation function
+		void ForwardPropagation(void);
+		// BackwardPropagation function
+		/// Only in training mode.
+		void BackwardPropagation(void);
+		// Update function
+		void Update(void);
+		// Sum up the delta of a batch.
+		void BatchDeltaSumUpdate(const size_t _batchSize);
+		// Clear the deltaSum of a batch.
+		void BatchDeltaSumClear(void);
+
+	public: // Inference
+
+		// Freeze the model for inference.
+		/// Folds constants first : linear process layers are dropped, a batch normalization right after a
+		/// convolution moves into its kernels and biases (see BatchNormLayer::Fold), then a convolution
+		/// followed by a pooling layer (max, min or mean with constant padding), with at most a process layer
+		/// in between, becomes one FusedConvPoolLayer taking over its kernels and the process function as
+		/// activation. Batch normalizations anywhere else stay, as the affine map of their running statistics.
+		/// Then leaves training mode for good, freezes every layer (see ConvolutionalLayer::Freeze), plans
+		/// the activations again, so that they take turns on two arenas, and stops keeping the input of the
+		/// layers after their forward propagation. Prints the memory report before and after to _report,
+		/// if one is given. References returned by Add() to folded layers are invalid afterwards.
+		void Freeze(std::ostream * _report = nullptr);
+		inline bool IsFrozen(void) const { return _frozen; }
+
+	private: // Inner working function
+
+		// A layer of the model and the tensors it reads and writes.
+		struct Layer
+		{
+			SequentialLayerType Type;
+			// Index into the list of layers of its type.
+			size_t Index;
+			// Planner tensors of the output and of the delta of the input, SIZE_MAX if none.
+			size_t Output = SIZE_MAX;
+			size_t InputDelta = SIZE_MAX;
+			// Whether a process layer writes over its input and over the delta of its output.
+			bool InPlace = false;
+			bool InPlaceDelta = false;
+		};
+
+		// Record a new layer and the shape of its output.
+		void Push(const SequentialLayerType _type, const size_t _index, const FeatureShape & _output);
+		// Aliases of the arena of a tensor, BatchSize samples of _channels maps of _size.
+		FeatureBatch Bind(const size_t _tensor, const size_t _channels, const MathLib::Size _size);
+		// Copy _source into _target map by map.
+		static void CopyMaps(const FeatureBatch & _source, FeatureBatch & _target);
+		// Handles of the maps of _batch : aliases of the arenas are passed on as aliases, not copied.
+		static FeatureBatch Handles(const FeatureBatch & _batch);
+		// Fold the layers of a model about to be frozen, see Freeze().
+		void Fold(void);
+		// A FusedConvPoolLayer equal to _conv -> _process -> _pool, _process may be nullptr.
+		static std::unique_ptr<FusedConvPoolLayer> Fuse(const ConvolutionalLayer & _conv, const ProcessLayer * _process, const PoolingLayer & _pool);
+		// Whether Fuse supports the pooling layer.
+		static bool Fusable(const PoolingLayer & _pool);
+
+		// Bytes of the matrices that are not aliases, matrices sharing a buffer once.
+		static size_t MapBytes(const std::vector<MathLib::Matrix<ElemType>> & _maps);
+		static size_t MapBytes(const FeatureBatch & _batch);
+		// Bytes allocated by a buffer.
+		template<class T>
+		static inline size_t BufferBytes(const std::vector<T> & _buffer) { return _buffer.capacity() * sizeof(T); }
+		template<class T>
+		static inline size_t BufferBytes(const std::vector<std::vector<T>> & _buffers)
+		{
+			size_t bytes = 0;
+			for (const std::vector<T> & buffer : _buffers)
+				bytes += BufferBytes(buffer);
+			return bytes;
+		}
+		// Add the bytes held by a layer to _memory.
+		static void Account(const ConvolutionalLayer & _conv, MemoryReport & _memory);
+		static void Account(const PoolingLayer & _pool, MemoryReport & _memory);
+		static void Account(const FusedConvPoolLayer & _fused, MemoryReport & _memory);
+		static void Account(const BatchNormLayer & _batchNorm, MemoryReport & _memory);
+
+	private:
+
+		std::vector<Layer> _layers;
+		std::vector<FeatureShape> _shapes;
+		std::vector<std::unique_ptr<ConvolutionalLayer>> _convLayers;
+		std::vector<std::unique_ptr<PoolingLayer>> _poolLayers;
+		std::vector<std::unique_ptr<ProcessLayer>> _processLayers;
+		std::vector<std::unique_ptr<FusedConvPoolLayer>> _fusedLayers;
+		std::vector<std::unique_ptr<BatchNormLayer>> _batchNormLayers;
+
+		bool _training;
+		size_t _batchSize;
+		bool _planned = false;
+		bool _frozen = false;
+		MemoryPlanner _planner;
+		std::vector<MathLib::Matrix<ElemType>> _arenas;
+		// Planned aliases of the output and of the input delta of every layer.
+		std::vector<FeatureBatch> _plannedOutputs;
+		std::vector<FeatureBatch> _plannedDeltas;
 
+		// _activations[i] is the input of layer i, the last one the output of the model.
+		std::vector<FeatureBatch> _activations;
+		// _deltas[i] is the delta of _activations[i].
+		std::vector<FeatureBatch> _deltas;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	  Batch Normalization Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN_BatchNormLayer.h"
+
+Neural::BatchNormLayer::BatchNormLayer(const BatchNormLayerInitor & _initor)
+{
+	this->_channelNum = _initor.Channels;
+	this->_inputSize = _initor.InputSize;
+	this->_epsilon = _initor.Epsilon;
+	this->_momentum = _initor.Momentum;
+
+	this->_gamma.assign(_channelNum, ElemType(1));
+	this->_beta.assign(_channelNum, ElemType(0));
+	this->_gammaDelta.assign(_channelNum, ElemType(0));
+	this->_betaDelta.assign(_channelNum, ElemType(0));
+	this->_gammaDeltaSum.assign(_channelNum, ElemType(0));
+	this->_betaDeltaSum.assign(_channelNum, ElemType(0));
+	this->_runningMean.assign(_channelNum, ElemType(0));
+	this->_runningVariance.assign(_channelNum, ElemType(1));
+}
+
+Neural::ElemType Neural::BatchNormLayer::GetScale(const size_t _channel) const
+{
+	return _gamma.at(_channel) / std::sqrt(_runningVariance.at(_channel) + _epsilon);
+}
+
+Neural::ElemType Neural::BatchNormLayer::GetShift(const size_t _channel) const
+{
+	return _beta.at(_channel) - _runningMean.at(_channel) * GetScale(_channel);
+}
+
+void Neural::BatchNormLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input)
+{
+	this->_input = _input;
+}
+
+void Neural::BatchNormLayer::SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta)
+{
+	this->_derivativeLastLayer = _delta;
+}
+
+void Neural::BatchNormLayer::SetLearnRate(const double _learnRate)
+{
+	this->learnRate = _learnRate;
+}
+
+void Neural::BatchNormLayer::SetTraining(const bool _training)
+{
+	if (_training && _frozen)
+	{
+		std::cerr << "ERROR : BatchNormLayer is frozen, no training." << std::endl;
+		return;
+	}
+	this->_training = _training;
+}
+
+void Neural::BatchNormLayer::ForwardPropagation(void)
+{
+	if (_input.empty())
+	{
+		std::cerr << "ERROR : BatchNormLayer forward propagation without input." << std::endl;
+		return;
+	}
+	// The output of the last call is lent to the batch, so that it is written over.
+	_inputBatch.assign(1, _input);
+	_outputBatch.resize(1);
+	std::swap(_outputBatch[0], _output);
+	ForwardPropagationBatch();
+	std::swap(_outputBatch[0], _output);
+}
+
+void Neural::BatchNormLayer::BackwardPropagation(void)
+{
+	_derivativeLastLayerBatch.assign(1, _derivativeLastLayer);
+	_derivativeBatch.resize(1);
+	std::swap(_derivativeBatch[0], _derivative);
+	BackwardPropagationBatch();
+	std::swap(_derivativeBatch[0], _derivative);
+}
+
+void Neural::BatchNormLayer::Update(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : BatchNormLayer is frozen, no update." << std::endl;
+		return;
+	}
+	for (size_t c = 0; c < _channelNum; c++)
+	{
+		_gamma[c] -= _gammaDeltaSum[c] * learnRate;
+		_beta[c] -= _betaDeltaSum[c] * learnRate;
+	}
+}
+
+void Neural::BatchNormLayer::BatchDeltaSumUpdate(const size_t _batchSize)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : BatchNormLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
+	for (size_t c = 0; c < _channelNum; c++)
+	{
+		_gammaDeltaSum[c] += _gammaDelta[c] * (1 / (double)_batchSize);
+		_betaDeltaSum[c] += _betaDelta[c] * (1 / (double)_batchSize);
+	}
+}
+
+void Neural::BatchNormLayer::BatchDeltaSumClear(void)
+{
+	if (_frozen)
+		return;
+	std::fill(_gammaDeltaSum.begin(), _gammaDeltaSum.end(), ElemType(0));
+	std::fill(_betaDeltaSum.begin(), _betaDeltaSum.end(), ElemType(0));
+}
+
+void Neural::BatchNormLayer::SetInputBatch(const FeatureBatch & _input)
+{
+	this->_inputBatch = _input;
+}
+
+void Neural::BatchNormLayer::SetDeltaBatch(const FeatureBatch & _delta)
+{
+	this->_derivativeLastLayerBatch = _delta;
+}
+
+void Neural::BatchNormLayer::Shape(FeatureBatch & _batch, const size_t _batchSize) const
+{
+	_batch.resize(_batchSize);
+	for (std::vector<MathLib::Matrix<ElemType>> & maps : _batch)
+	{
+		maps.resize(_channelNum);
+		for (MathLib::Matrix<ElemType> & map : maps)
+			if (map.ColumeSize() != _inputSize.m || map.RowSize() != _inputSize.n)
+				map.Init(_inputSize.m, _inputSize.n);
+	}
+}
+
+void Neural::BatchNormLayer::ForwardPropagationBatch(void)
+{
+	const size_t batchSize = _inputBatch.size();
+	bool match = batchSize > 0;
+	for (size_t n = 0; match && n < batchSize; n++)
+	{
+		match = _inputBatch[n].size() == _channelNum;
+		for (size_t c = 0; match && c < _channelNum; c++)
+			match = _inputBatch[n][c].ColumeSize() == _inputSize.m && _inputBatch[n][c].RowSize() == _inputSize.n;
+	}
+	if (!match)
+	{
+		std::cerr << "ERROR : BatchNormLayer input does not match the channels and the input size." << std::endl;
+		return;
+	}
+	const bool training = _training && !_frozen;
+	const size_t pixels = _inputSize.m * _inputSize.n;
+	const ElemType count = ElemType(batchSize * pixels);
+	Shape(_outputBatch, batchSize);
+	if (training)
+	{
+		_mean.resize(_channelNum);
+		_inverseDeviation.resize(_channelNum);
+	}
+	// Channels are independent, every one is summed sample after sample whatever the thread count.
+	MathLib::ParallelFor(0, _channelNum, [&](size_t _channelBegin, size_t _channelEnd) {
+		for (size_t c = _channelBegin; c < _channelEnd; c++)
+		{
+			ElemType scale = GetScale(c), shift = GetShift(c);
+			if (training)
+			{
+				const MathLib::Matrix<ElemType> & first = _inputBatch[0][c];
+				const ElemType pivot = first.Data()[0];
+				ElemType sum = 0, squareSum = 0;
+				for (size_t n = 0; n < batchSize; n++)
+				{
+					const MathLib::Matrix<ElemType> & x = _inputBatch[n][c];
+					ChannelSums(x.Data(), pixels, pivot, sum, squareSum);
+				}
+				const ElemType shiftedMean = sum / count;
+				const ElemType variance = std::max<ElemType>(squareSum / count - shiftedMean * shiftedMean, 0);
+				const ElemType mean = pivot + shiftedMean;
+				_mean[c] = mean;
+				_inverseDeviation[c] = 1 / std::sqrt(variance + _epsilon);
+				_runningMean[c] += _momentum * (mean - _runningMean[c]);
+				_runningVariance[c] += _momentum * ((count > 1 ? variance * count / (count - 1) : variance) - _runningVariance[c]);
+				scale = _gamma[c] * _inverseDeviation[c];
+				shift = _beta[c] - mean * scale;
+			}
+			for (size_t n = 0; n < batchSize; n++)
+			{
+				const MathLib::Matrix<ElemType> & x = _inputBatch[n][c];
+				Affine(x.Data(), pixels, scale, shift, _outputBatch[n][c].Data());
+			}
+		}
+	}, MathLib::ThreadPool::Grain(2 * batchSize * pixels));
+	if (!training)
+		_mean.clear();
+}
+
+void Neural::BatchNormLayer::BackwardPropagationBatch(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : BatchNormLayer is frozen, no backward propagation." << std::endl;
+		return;
+	}
+	const size_t batchSize = _inputBatch.size();
+	bool match = batchSize > 0 && _mean.size() == _channelNum && _derivativeLastLayerBatch.size() == batchSize;
+	for (size_t n = 0; match && n < batchSize; n++)
+	{
+		match = _derivativeLastLayerBatch[n].size() == _channelNum;
+		for (size_t c = 0; match && c < _channelNum; c++)
+			match = _derivativeLastLayerBatch[n][c].ColumeSize() * _derivativeLastLayerBatch[n][c].RowSize() == _inputSize.m * _inputSize.n;
+	}
+	if (!match)
+	{
+		std::cerr << "ERROR : BatchNormLayer backward propagation without training forward propagation or delta." << std::endl;
+		return;
+	}
+	const size_t pixels = _inputSize.m * _inputSize.n;
+	const ElemType count = ElemType(batchSize * pixels);
+	Shape(_derivativeBatch, batchSize);
+	// dx = gamma / sigma * (dy - mean(dy) - x̂ * mean(dy * x̂)), as a * dy + b * x + c.
+	MathLib::ParallelFor(0, _channelNum, [&](size_t _channelBegin, size_t _channelEnd) {
+		for (size_t c = _channelBegin; c < _channelEnd; c++)
+		{
+			const ElemType mean = _mean[c], inverseDeviation = _inverseDeviation[c];
+			ElemType sum = 0, productSum = 0;
+			for (size_t n = 0; n < batchSize; n++)
+			{
+				const MathLib::Matrix<ElemType> & delta = _derivativeLastLayerBatch[n][c], & x = _inputBatch[n][c];
+				DeltaSums(delta.Data(), x.Data(), pixels, mean, sum, productSum);
+			}
+			_gammaDelta[c] = productSum * inverseDeviation;
+			_betaDelta[c] = sum;
+			const ElemType a = _gamma[c] * inverseDeviation;
+			const ElemType b = -a * inverseDeviation * inverseDeviation * productSum / count;
+			const ElemType shift = -a * sum / count - b * mean;
+			for (size_t n = 0; n < batchSize; n++)
+			{
+				const MathLib::Matrix<ElemType> & delta = _derivativeLastLayerBatch[n][c], & x = _inputBatch[n][c];
+				DeltaAffine(delta.Data(), x.Data(), pixels, a, b, shift, _derivativeBatch[n][c].Data());
+			}
+		}
+	}, MathLib::ThreadPool::Grain(2 * batchSize * pixels));
+}
+
+void Neural::BatchNormLayer::Fold(ConvolutionalLayer & _conv) const
+{
+	if (_conv._convNodeNum != _channelNum)
+	{
+		std::cerr << "ERROR : BatchNormLayer has " << _channelNum << " channels, the ConvLayer " << _conv._convNodeNum << " kernels." << std::endl;
+		return;
+	}
+	for (size_t k = 0; k < _channelNum; k++)
+	{
+		ConvNode & node = _conv._convNodes.at(k);
+		const ElemType scale = GetScale(k);
+		node.kernel = node.kernel * scale;
+		node.bias = node.bias * scale + GetShift(k);
+	}
+	_conv.InvalidateKernelCache();
+}
+
+void Neural::BatchNormLayer::Freeze(void)
+{
+	this->_frozen = true;
+	this->_training = false;
+	std::vector<ElemType>().swap(_gammaDelta);
+	std::vector<ElemType>().swap(_betaDelta);
+	std::vector<ElemType>().swap(_gammaDeltaSum);
+	std::vector<ElemType>().swap(_betaDeltaSum);
+	std::vector<ElemType>().swap(_mean);
+	std::vector<ElemType>().swap(_inverseDeviation);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_input);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_derivative);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_derivativeLastLayer);
+	FeatureBatch().swap(_inputBatch);
+	FeatureBatch().swap(_derivativeBatch);
+	FeatureBatch().swap(_derivativeLastLayerBatch);
+}
+
+void Neural::BatchNormLayer::ChannelSums(const ElemType * _x, const size_t _count, const ElemType _pivot, ElemType & _sum, ElemType & _squareSum)
+{
+	size_t e = 0;
+	ElemType sum = 0, squareSum = 0;
+#ifdef USING_SSE2_BATCHNORM
+	const __m128d pivot = _mm_set1_pd(_pivot);
+	__m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd(), square0 = _mm_setzero_pd(), square1 = _mm_setzero_pd();
+	for (; e + 4 <= _count; e += 4)
+	{
+		const __m128d x0 = _mm_sub_pd(_mm_loadu_pd(_x + e), pivot);
+		const __m128d x1 = _mm_sub_pd(_mm_loadu_pd(_x + e + 2), pivot);
+		sum0 = _mm_add_pd(sum0, x0);
+		sum1 = _mm_add_pd(sum1, x1);
+		square0 = _mm_add_pd(square0, _mm_mul_pd(x0, x0));
+		square1 = _mm_add_pd(square1, _mm_mul_pd(x1, x1));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+	sum = lanes[0] + lanes[1];
+	_mm_storeu_pd(lanes, _mm_add_pd(square0, square1));
+	squareSum = lanes[0] + lanes[1];
+#endif // USING_SSE2_BATCHNORM
+	for (; e < _count; e++)
+	{
+		const ElemType x = _x[e] - _pivot;
+		sum += x;
+		squareSum += x * x;
+	}
+	_sum += sum;
+	_squareSum += squareSum;
+}
+
+void Neural::BatchNormLayer::Affine(const ElemType * _x, const size_t _count, const ElemType _scale, const ElemType _shift, ElemType * _y)
+{
+	size_t e = 0;
+#ifdef USING_SSE2_BATCHNORM
+	const __m128d scale = _mm_set1_pd(_scale), shift = _mm_set1_pd(_shift);
+	for (; e + 4 <= _count; e += 4)
+	{
+		const __m128d x0 = _mm_loadu_pd(_x + e), x1 = _mm_loadu_pd(_x + e + 2);
+		_mm_storeu_pd(_y + e, _mm_add_pd(_mm_mul_pd(x0, scale), shift));
+		_mm_storeu_pd(_y + e + 2, _mm_add_pd(_mm_mul_pd(x1, scale), shift));
+	}
+#endif // USING_SSE2_BATCHNORM
+	for (; e < _count; e++)
+		_y[e] = _x[e] * _scale + _shift;
+}
+
+void Neural::BatchNormLayer::DeltaSums(const ElemType * _delta, const ElemType * _x, const size_t _count, const ElemType _mean,
+	ElemType & _sum, ElemType & _productSum)
+{
+	size_t e = 0;
+	ElemType sum = 0, productSum = 0;
+#ifdef USING_SSE2_BATCHNORM
+	const __m128d mean = _mm_set1_pd(_mean);
+	__m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd(), product0 = _mm_setzero_pd(), product1 = _mm_setzero_pd();
+	for (; e + 4 <= _count; e += 4)
+	{
+		const __m128d delta0 = _mm_loadu_pd(_delta + e), delta1 = _mm_loadu_pd(_delta + e + 2);
+		sum0 = _mm_add_pd(sum0, delta0);
+		sum1 = _mm_add_pd(sum1, delta1);
+		product0 = _mm_add_pd(product0, _mm_mul_pd(delta0, _mm_sub_pd(_mm_loadu_pd(_x + e), mean)));
+		product1 = _mm_add_pd(product1, _mm_mul_pd(delta1, _mm_sub_pd(_mm_loadu_pd(_x + e + 2), mean)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+	sum = lanes[0] + lanes[1];
+	_mm_storeu_pd(lanes, _mm_add_pd(product0, product1));
+	productSum = lanes[0] + lanes[1];
+#endif // USING_SSE2_BATCHNORM
+	for (; e < _count; e++)
+	{
+		sum += _delta[e];
+		productSum += _delta[e] * (_x[e] - _mean);
+	}
+	_sum += sum;
+	_productSum += productSum;
+}
+
+void Neural::BatchNormLayer::DeltaAffine(const ElemType * _delta, const ElemType * _x, const size_t _count, const ElemType _a, const ElemType _b,
+	const ElemType _c, ElemType * _output)
+{
+	size_t e = 0;
+#ifdef USING_SSE2_BATCHNORM
+	const __m128d a = _mm_set1_pd(_a), b = _mm_set1_pd(_b), c = _mm_set1_pd(_c);
+	for (; e + 4 <= _count; e += 4)
+	{
+		const __m128d y0 = _mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(_delta + e)), _mm_mul_pd(b, _mm_loadu_pd(_x + e)));
+		const __m128d y1 = _mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(_delta + e + 2)), _mm_mul_pd(b, _mm_loadu_pd(_x + e + 2)));
+		_mm_storeu_pd(_output + e, _mm_add_pd(y0, c));
+		_mm_storeu_pd(_output + e + 2, _mm_add_pd(y1, c));
+	}
+#endif // USING_SSE2_BATCHNORM
+	for (; e < _count; e++)
+		_output[e] = _a * _delta[e] + _b * _x[e] + _c;
+}
@@ -0,0 +1,172 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	  Batch Normalization Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include "CNN_ConvolutionalLayer.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USING_SSE2_BATCHNORM
+#include <emmintrin.h>
+#endif
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	// Batch Norm Layer Initor
+	/// Used for initialization of a BatchNormLayer.
+	struct BatchNormLayerInitor
+	{
+		// Number of channels, every one is normalized on its own.
+		size_t Channels;
+		// Size of every channel.
+		MathLib::Size InputSize;
+		// Added to the variance before the square root.
+		ElemType Epsilon = 1e-5;
+		// Weight of the statistics of a batch in the running statistics.
+		ElemType Momentum = 0.1;
+	};
+
+	/***************************************************************************************************/
+	// Class : Batch Normalization Layer
+	/// y = gamma * (x - mean) / sqrt(variance + epsilon) + beta for every channel, the mean and the variance
+	/// taken over the pixels of all the samples of the batch.
+	/// In training the layer normalizes with the statistics of the batch and the running statistics follow
+	/// them. In inference it normalizes with the running statistics and is the affine map
+	/// y = GetScale(c) * x + GetShift(c), which Fold() moves into the convolution before it.
+	/// A training forward propagation reads every channel twice : one SIMD pass sums x and x² together
+	/// (shifted by the first element, so that the variance does not cancel out), one writes scale * x + shift.
+	/// A single pass cannot be exact, the first output needs the statistics of the last input : both passes
+	/// run back to back on one channel, so that the second reads it from the cache.
+	/// The backward propagation reads the delta and the input once for both of its sums and once to write
+	/// the input delta, the normalized input is never stored.
+	class BatchNormLayer
+	{
+	public: // Constructors
+
+		// Invoke constructor
+		BatchNormLayer(const BatchNormLayerInitor & _initor);
+
+	public: // Getter
+
+		inline const MathLib::Matrix<ElemType> GetFeature(const size_t _index) const { return _output.at(_index); }
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetFeatureAll(void) const { return _output; }
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetDelta(void) const { return _derivative; }
+		inline MathLib::Size GetOutputSize(void) const { return _inputSize; }
+		inline size_t GetChannelNum(void) const { return _channelNum; }
+		// Scale and shift of channel _channel in inference, from the running statistics.
+		ElemType GetScale(const size_t _channel) const;
+		ElemType GetShift(const size_t _channel) const;
+
+	public: // Setter
+
+		// Set the input, Channels matrices of the input size.
+		void SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input);
+		// Set the delta propagate back from next layer, one matrix per channel.
+		void SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta);
+		void SetLearnRate(const double _learnRate);
+		// Switch between the statistics of the batch and the running statistics.
+		void SetTraining(const bool _training);
+
+	public: // BackPropagation Algorithm
+
+		// ForwardPropagation function
+		/// A single sample is a batch of one, normalized over its own pixels in training.
+		void ForwardPropagation(void);
+		// BackwardPropagation function
+		/// Only after a training forward propagation.
+		void BackwardPropagation(void);
+		// Update function
+		void Update(void);
+		// Sum up the delta of a batch.
+		void BatchDeltaSumUpdate(const size_t _batchSize);
+		// Clear the deltaSum of a batch.
+		void BatchDeltaSumClear(void);
+
+	public: // Minibatch
+
+		void SetInputBatch(const FeatureBatch & _input);
+		void SetDeltaBatch(const FeatureBatch & _delta);
+		// ForwardPropagation of the batch, the statistics are those of the whole batch.
+		/// The output is written into the matrices of _outputBatch when they have the right size, which may
+		/// be the input itself.
+		void ForwardPropagationBatch(void);
+		// BackwardPropagation of the batch.
+		/// The gamma and beta deltas are the sums over the batch, BatchDeltaSumUpdate(N) then averages them.
+		void BackwardPropagationBatch(void);
+		inline const FeatureBatch & GetFeatureBatch(void) const { return _outputBatch; }
+		inline const FeatureBatch & GetDeltaBatch(void) const { return _derivativeBatch; }
+
+	public: // Inference
+
+		// Fold the inference map into _conv, whose features are the input of the layer.
+		/// Every kernel is multiplied by the scale of its channel and every bias becomes
+		/// bias * scale + shift, the convolution alone then outputs what both did.
+		void Fold(ConvolutionalLayer & _conv) const;
+		// Freeze the layer for inference.
+		/// Leaves training mode for good and releases the deltas and the saved state.
+		void Freeze(void);
+		inline bool IsFrozen(void) const { return _frozen; }
+
+	private: // Inner working function
+
+		// Add the sum of _x[e] - _pivot and of its square to _sum and _squareSum.
+		static void ChannelSums(const ElemType * _x, const size_t _count, const ElemType _pivot, ElemType & _sum, ElemType & _squareSum);
+		// _y[e] = _scale * _x[e] + _shift, _y may be _x.
+		static void Affine(const ElemType * _x, const size_t _count, const ElemType _scale, const ElemType _shift, ElemType * _y);
+		// Add the sum of _delta[e] and of _delta[e] * (_x[e] - _mean) to _sum and _productSum.
+		static void DeltaSums(const ElemType * _delta, const ElemType * _x, const size_t _count, const ElemType _mean,
+			ElemType & _sum, ElemType & _productSum);
+		// _output[e] = _a * _delta[e] + _b * _x[e] + _c.
+		static void DeltaAffine(const ElemType * _delta, const ElemType * _x, const size_t _count, const ElemType _a, const ElemType _b,
+			const ElemType _c, ElemType * _output);
+		// Give every sample of _batch _channelNum maps of the input size, keeping the matrices that fit.
+		void Shape(FeatureBatch & _batch, const size_t _batchSize) const;
+
+	public:
+
+		size_t _channelNum;
+		MathLib::Size _inputSize;
+		ElemType _epsilon;
+		ElemType _momentum;
+
+		// Parameters and their deltas, one per channel.
+		std::vector<ElemType> _gamma;
+		std::vector<ElemType> _beta;
+		std::vector<ElemType> _gammaDelta;
+		std::vector<ElemType> _betaDelta;
+		std::vector<ElemType> _gammaDeltaSum;
+		std::vector<ElemType> _betaDeltaSum;
+		// Running statistics, the variance unbiased.
+		std::vector<ElemType> _runningMean;
+		std::vector<ElemType> _runningVariance;
+		// Statistics of the last training batch, saved for the backward propagation.
+		std::vector<ElemType> _mean;
+		std::vector<ElemType> _inverseDeviation;
+
+		// Learning rate
+		/// Default value is 1
+		double learnRate = 1;
+
+		bool _training = true;
+		bool _frozen = false;
+
+		std::vector<MathLib::Matrix<ElemType>> _input;
+		std::vector<MathLib::Matrix<ElemType>> _output;
+		std::vector<MathLib::Matrix<ElemType>> _derivativeLastLayer;
+		std::vector<MathLib::Matrix<ElemType>> _derivative;
+
+		// Minibatch
+		FeatureBatch _inputBatch;
+		FeatureBatch _outputBatch;
+		FeatureBatch _derivativeLastLayerBatch;
+		FeatureBatch _derivativeBatch;
+	};
+}
@@ -0,0 +1,218 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	    Convolution Kernels     	                                                      */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN_Convolution.h"
+
+void Neural::Convolution::Im2col(const ElemType * _input, const ConvGeometry & _geometry, ElemType * _column, const size_t _columnStride)
+{
+	const size_t inputM = _geometry.Input.m, inputN = _geometry.Input.n;
+	const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+	const size_t stride = _geometry.Stride;
+	const size_t dilation = _geometry.Dilation;
+	const size_t columnStride = _columnStride == 0 ? _geometry.OutputPixels() : _columnStride;
+	// Every kernel element fills its own row of the column matrix.
+	MathLib::ParallelFor(0, _geometry.KernelElements(), [&](size_t _elementBegin, size_t _elementEnd) {
+		for (size_t element = _elementBegin; element < _elementEnd; element++)
+		{
+			const size_t u = element / _geometry.Kernel.n, v = element % _geometry.Kernel.n;
+			ElemType * row = _column + element * columnStride;
+			// Output columns j whose input column j * stride + v * dilation - padding lies within [0, inputN).
+			const long long offsetN = (long long)(v * dilation) - (long long)_geometry.Padding.n;
+			size_t jBegin = 0, jEnd = outputN;
+			while (jBegin < outputN && (long long)(jBegin * stride) + offsetN < 0)
+				jBegin++;
+			while (jEnd > jBegin && (long long)((jEnd - 1) * stride) + offsetN >= (long long)inputN)
+				jEnd--;
+			for (size_t i = 0; i < outputM; i++)
+			{
+				ElemType * out = row + i * outputN;
+				const long long inputRow = (long long)(i * stride + u * dilation) - (long long)_geometry.Padding.m;
+				if (inputRow < 0 || inputRow >= (long long)inputM)
+				{
+					std::fill(out, out + outputN, ElemType(0));
+					continue;
+				}
+				const ElemType * in = _input + inputRow * inputN;
+				std::fill(out, out + jBegin, ElemType(0));
+				if (stride == 1)
+				{
+					if (jEnd > jBegin)
+						std::memcpy(out + jBegin, in + jBegin + offsetN, (jEnd - jBegin) * sizeof(ElemType));
+				}
+				else
+				{
+					for (size_t j = jBegin; j < jEnd; j++)
+						out[j] = in[j * stride + offsetN];
+				}
+				std::fill(out + jEnd, out + outputN, ElemType(0));
+			}
+		}
+	}, MathLib::ThreadPool::Grain(_geometry.OutputPixels()));
+}
+
+void Neural::Convolution::Col2im(const ElemType * _column, const ConvGeometry & _geometry, ElemType * _input, const size_t _columnStride)
+{
+	const size_t inputM = _geometry.Input.m, inputN = _geometry.Input.n;
+	const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+	const size_t stride = _geometry.Stride;
+	const size_t dilation = _geometry.Dilation;
+	const size_t columnStride = _columnStride == 0 ? _geometry.OutputPixels() : _columnStride;
+	std::fill(_input, _input + inputM * inputN, ElemType(0));
+	// Kernel elements overlap on the input, they are scattered one after the other.
+	for (size_t element = 0; element < _geometry.KernelElements(); element++)
+	{
+		const size_t u = element / _geometry.Kernel.n, v = element % _geometry.Kernel.n;
+		const ElemType * row = _column + element * columnStride;
+		const long long offsetN = (long long)(v * dilation) - (long long)_geometry.Padding.n;
+		size_t jBegin = 0, jEnd = outputN;
+		while (jBegin < outputN && (long long)(jBegin * stride) + offsetN < 0)
+			jBegin++;
+		while (jEnd > jBegin && (long long)((jEnd - 1) * stride) + offsetN >= (long long)inputN)
+			jEnd--;
+		for (size_t i = 0; i < outputM; i++)
+		{
+			const long long inputRow = (long long)(i * stride + u * dilation) - (long long)_geometry.Padding.m;
+			if (inputRow < 0 || inputRow >= (long long)inputM)
+				continue;
+			const ElemType * out = row + i * outputN;
+			ElemType * in = _input + inputRow * inputN;
+			for (size_t j = jBegin; j < jEnd; j++)
+				in[j * stride + offsetN] += out[j];
+		}
+	}
+}
+
+void Neural::Convolution::PackFlipped(const std::vector<MathLib::Matrix<ElemType>> & _kernels, ElemType * _packed)
+{
+	for (size_t k = 0; k < _kernels.size(); k++)
+	{
+		const size_t elements = _kernels[k].ColumeSize() * _kernels[k].RowSize();
+		const ElemType * kernel = _kernels[k].Data();
+		ElemType * packed = _packed + k * elements;
+		for (size_t e = 0; e < elements; e++)
+			packed[e] = kernel[elements - 1 - e];
+	}
+}
+
+void Neural::Convolution::Correlate(const ElemType * _input, const ConvGeometry & _geometry, const ElemType * _kernel,
+	const ElemType _padding, ElemType * _output)
+{
+	CorrelateRows(_input, _geometry, _kernel, _padding, 0, _geometry.Output.m, _output);
+}
+
+void Neural::Convolution::CorrelateRows(const ElemType * _input, const ConvGeometry & _geometry, const ElemType * _kernel,
+	const ElemType _padding, const size_t _rowBegin, const size_t _rowEnd, ElemType * _output)
+{
+	const long long inputM = _geometry.Input.m, inputN = _geometry.Input.n;
+	const size_t kernelM = _geometry.Kernel.m, kernelN = _geometry.Kernel.n;
+	const size_t outputN = _geometry.Output.n;
+	const size_t stride = _geometry.Stride;
+	const size_t dilation = _geometry.Dilation;
+	const MathLib::Size extent = _geometry.DilatedKernel();
+	// Output columns [jBegin, jEnd) read whole kernel rows inside the input.
+	size_t jBegin = 0, jEnd = outputN;
+	while (jBegin < outputN && (long long)(jBegin * stride) < (long long)_geometry.Padding.n)
+		jBegin++;
+	while (jEnd > jBegin && (long long)((jEnd - 1) * stride + extent.n) - (long long)_geometry.Padding.n > inputN)
+		jEnd--;
+
+	for (size_t i = _rowBegin; i < _rowEnd; i++)
+	{
+		const long long top = (long long)(i * stride) - (long long)_geometry.Padding.m;
+		const bool rowInside = top >= 0 && top + (long long)extent.m <= inputM;
+		ElemType * out = _output + (i - _rowBegin) * outputN;
+		for (size_t j = 0; j < outputN; j++)
+		{
+			const long long left = (long long)(j * stride) - (long long)_geometry.Padding.n;
+			ElemType sum = 0;
+			if (rowInside && j >= jBegin && j < jEnd)
+			{
+				const ElemType * in = _input + top * inputN + left;
+				for (size_t u = 0; u < kernelM; u++)
+					for (size_t v = 0; v < kernelN; v++)
+						sum += in[u * dilation * inputN + v * dilation] * _kernel[u * kernelN + v];
+			}
+			else
+			{
+				for (size_t u = 0; u < kernelM; u++)
+				{
+					const long long row = top + (long long)(u * dilation);
+					for (size_t v = 0; v < kernelN; v++)
+					{
+						const long long column = left + (long long)(v * dilation);
+						const ElemType x = row >= 0 && row < inputM && column >= 0 && column < inputN ? _input[row * inputN + column] : _padding;
+						sum += x * _kernel[u * kernelN + v];
+					}
+				}
+			}
+			out[j] = sum;
+		}
+	}
+}
+
+void Neural::Convolution::PadRows(const ElemType * _input, const ConvGeometry & _geometry, ElemType * _padded)
+{
+	const size_t paddedM = _geometry.Output.m + _geometry.Kernel.m - 1;
+	const size_t paddedN = _geometry.Output.n + _geometry.Kernel.n - 1;
+	const size_t rows = std::min(_geometry.Input.m, paddedM - std::min(paddedM, _geometry.Padding.m));
+	const size_t columns = std::min(_geometry.Input.n, paddedN - std::min(paddedN, _geometry.Padding.n));
+	std::fill(_padded, _padded + paddedM * paddedN, ElemType(0));
+	for (size_t i = 0; i < rows; i++)
+		std::memcpy(_padded + (i + _geometry.Padding.m) * paddedN + _geometry.Padding.n, _input + i * _geometry.Input.n, columns * sizeof(ElemType));
+}
+
+void Neural::Convolution::Pointwise(const ElemType * _weights, const ElemType * _input, const size_t _kernelNum,
+	const size_t _channelNum, const size_t _pixels, ElemType * _output)
+{
+	const size_t groupNum = (_kernelNum + 3) / 4;
+	const size_t tileNum = (_pixels + PointwisePixelTile - 1) / PointwisePixelTile;
+	MathLib::ParallelFor(0, groupNum * tileNum, [&](size_t _itemBegin, size_t _itemEnd) {
+		for (size_t item = _itemBegin; item < _itemEnd; item++)
+		{
+			const size_t kernelBegin = (item / tileNum) * 4;
+			const size_t kernelNum = std::min<size_t>(4, _kernelNum - kernelBegin);
+			const size_t pixelBegin = (item % tileNum) * PointwisePixelTile;
+			const size_t pixelEnd = std::min(_pixels, pixelBegin + PointwisePixelTile);
+			const ElemType * weights = _weights + kernelBegin * _channelNum;
+			size_t p = pixelBegin;
+#ifdef USING_SSE2_CONVOLUTION
+			for (; kernelNum == 4 && p + 4 <= pixelEnd; p += 4)
+			{
+				__m128d accumulator[4][2];
+				for (size_t g = 0; g < 4; g++)
+					accumulator[g][0] = accumulator[g][1] = _mm_setzero_pd();
+				for (size_t c = 0; c < _channelNum; c++)
+				{
+					const __m128d x0 = _mm_loadu_pd(_input + c * _pixels + p);
+					const __m128d x1 = _mm_loadu_pd(_input + c * _pixels + p + 2);
+					for (size_t g = 0; g < 4; g++)
+					{
+						const __m128d w = _mm_set1_pd(weights[g * _channelNum + c]);
+						accumulator[g][0] = _mm_add_pd(accumulator[g][0], _mm_mul_pd(w, x0));
+						accumulator[g][1] = _mm_add_pd(accumulator[g][1], _mm_mul_pd(w, x1));
+					}
+				}
+				for (size_t g = 0; g < 4; g++)
+				{
+					_mm_storeu_pd(_output + (kernelBegin + g) * _pixels + p, accumulator[g][0]);
+					_mm_storeu_pd(_output + (kernelBegin + g) * _pixels + p + 2, accumulator[g][1]);
+				}
+			}
+#endif // USING_SSE2_CONVOLUTION
+			for (; p < pixelEnd; p++)
+				for (size_t g = 0; g < kernelNum; g++)
+				{
+					ElemType sum = 0;
+					for (size_t c = 0; c < _channelNum; c++)
+						sum += weights[g * _channelNum + c] * _input[c * _pixels + p];
+					_output[(kernelBegin + g) * _pixels + p] = sum;
+				}
+		}
+	}, MathLib::ThreadPool::Grain(4 * _channelNum * PointwisePixelTile));
+}
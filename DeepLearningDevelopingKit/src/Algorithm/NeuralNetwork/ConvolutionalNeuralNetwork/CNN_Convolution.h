@@ -0,0 +1,393 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	    Convolution Kernels     	                                                   */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+
+#include "..\..\..\MathLib\MathLib.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USING_SSE2_CONVOLUTION
+#include <emmintrin.h>
+#endif
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	// Define the Element datatype.
+	/// Mainly using float and double.
+	typedef double ElemType;
+
+	// Convolution Geometry
+	/// Shapes of one 2D convolution. Output(i, j) reads the input window starting at
+	/// (i * Stride - Padding.m, j * Stride - Padding.n) with its taps Dilation apart,
+	/// positions outside the input read as zero.
+	struct ConvGeometry
+	{
+		ConvGeometry() = default;
+		ConvGeometry(const MathLib::Size _input, const MathLib::Size _kernel, const MathLib::Size _padding, const size_t _stride, const MathLib::Size _output, const size_t _dilation = 1)
+			: Input(_input), Kernel(_kernel), Padding(_padding), Stride(_stride), Output(_output), Dilation(_dilation) {}
+
+		// Number of elements of the kernel.
+		inline size_t KernelElements(void) const { return Kernel.m * Kernel.n; }
+		// Number of output pixels.
+		inline size_t OutputPixels(void) const { return Output.m * Output.n; }
+		// Extent of the kernel on the input once dilated.
+		inline MathLib::Size DilatedKernel(void) const { return MathLib::Size(Dilation * (Kernel.m - 1) + 1, Dilation * (Kernel.n - 1) + 1); }
+
+		// Number of output positions along one axis.
+		/// floor((input + 2 * padding - dilation * (kernel - 1) - 1) / stride) + 1, zero if the kernel does not fit.
+		static inline size_t OutputLength(const size_t _input, const size_t _kernel, const size_t _padding, const size_t _stride, const size_t _dilation = 1)
+		{
+			const size_t extent = _dilation * (_kernel - 1) + 1;
+			return _input + 2 * _padding < extent ? 0 : (_input + 2 * _padding - extent) / _stride + 1;
+		}
+
+		MathLib::Size Input;
+		MathLib::Size Kernel;
+		MathLib::Size Padding;
+		size_t Stride;
+		MathLib::Size Output;
+		size_t Dilation = 1;
+	};
+
+	// Kernel Cache Entry
+	/// A derived form of the kernels of a layer (flipped, packed, transformed) and the kernel version
+	/// it was built from. The entry is stale once the version of the layer moves past it.
+	template<class T>
+	struct KernelCacheEntry
+	{
+		// Whether the entry was built from the kernels of the given version.
+		inline bool Valid(const size_t _version) const { return Version == _version; }
+		// Mark the entry as built from the given version.
+		inline void Validate(const size_t _version) { Version = _version; }
+		// Force a rebuild, when the layout of the entry changes (Winograd tile, FFT size).
+		inline void Invalidate(void) { Version = SIZE_MAX; }
+
+		std::vector<T> Data;
+		size_t Version = SIZE_MAX;
+	};
+
+	/***************************************************************************************************/
+	// Class : Convolution
+	/// Lowering and transform kernels shared by the convolution algorithms of ConvolutionalLayer.
+	/// All buffers are contiguous row-major, kernels are cross-correlation kernels : a convolution
+	/// kernel has to be flipped (Rot180) before it is packed.
+	class Convolution
+	{
+	public: // im2col
+
+		// Image to column
+		/// Unfold the input into a KernelElements() x OutputPixels() matrix, row (u * Kernel.n + v) holds
+		/// the input pixel read by kernel element (u, v) for every output pixel, in output row-major order.
+		/// _columnStride is the distance between two rows of the column matrix, OutputPixels() if 0 : a batch
+		/// lowers sample n at _column + n * OutputPixels() with a stride of N * OutputPixels().
+		static void Im2col(const ElemType * _input, const ConvGeometry & _geometry, ElemType * _column, const size_t _columnStride = 0);
+
+		// Column to image
+		/// Adjoint of Im2col : every entry of the column matrix is added back to the input pixel it was
+		/// read from, entries read from the padding are dropped. _input is overwritten.
+		static void Col2im(const ElemType * _column, const ConvGeometry & _geometry, ElemType * _input, const size_t _columnStride = 0);
+
+		// Flip and pack kernels
+		/// Write kernel k rotated by 180° to row k of a _kernels.size() x KernelElements() matrix.
+		static void PackFlipped(const std::vector<MathLib::Matrix<ElemType>> & _kernels, ElemType * _packed);
+
+	public: // Direct
+
+		// Sliding window with virtual padding
+		/// Cross-correlate the unpadded input with one kernel, positions outside the input read as _padding.
+		/// Windows that lie inside the input take a path without bounds checks, only the border pays for them.
+		static void Correlate(const ElemType * _input, const ConvGeometry & _geometry, const ElemType * _kernel,
+			const ElemType _padding, ElemType * _output);
+		// Output rows [_rowBegin, _rowEnd) of Correlate, row _rowBegin is written at _output.
+		/// Lets fused operators compute a band of the output that stays in cache.
+		static void CorrelateRows(const ElemType * _input, const ConvGeometry & _geometry, const ElemType * _kernel,
+			const ElemType _padding, const size_t _rowBegin, const size_t _rowEnd, ElemType * _output);
+
+		// Padded copy for the stride 1 direct kernels
+		/// _padded receives (Output.m + Kernel.m - 1) x (Output.n + Kernel.n - 1) elements, the input is
+		/// copied row by row at offset Padding, everything else is zero.
+		static void PadRows(const ElemType * _input, const ConvGeometry & _geometry, ElemType * _padded);
+
+		// Tiled direct convolution
+		/// Cross-correlate a padded input (see PadRows) with _kernelNum packed K x K kernels at stride 1,
+		/// _output receives _kernelNum x OutputPixels() elements.
+		/// Output rows are walked in tiles of DirectRowTile so the input window stays in L1, every pass over
+		/// the window computes four kernels, and four output columns of each stay in SSE2 registers.
+		template<size_t K>
+		static void DirectTiled(const ElemType * _padded, const ConvGeometry & _geometry,
+			const ElemType * _packed, const size_t _kernelNum, ElemType * _output);
+
+		// Tiled direct convolution of a batch
+		/// DirectTiled on _sampleNum padded inputs stored back to back, kernel k of sample n writes its
+		/// response plus _bias[k] to _outputs[n * _kernelNum + k]. Work items are (sample, row tile) pairs
+		/// and run every kernel, the packed kernels stay in L1 for the whole batch and every row tile of the
+		/// input is read from L1 by all of them.
+		template<size_t K>
+		static void DirectTiledBatch(const ElemType * _padded, const size_t _sampleNum, const ConvGeometry & _geometry,
+			const ElemType * _packed, const ElemType * _bias, const size_t _kernelNum, ElemType * const * _outputs);
+
+		// Output rows [_rowBegin, _rowEnd) of DirectTiled for at most four kernels.
+		/// Kernel g writes its rows to _output + g * _outputStride, row _rowBegin first.
+		template<size_t K>
+		static void DirectRows(const ElemType * _padded, const ConvGeometry & _geometry, const ElemType * _packed, const size_t _kernelNum,
+			const size_t _rowBegin, const size_t _rowEnd, ElemType * _output, const size_t _outputStride);
+
+	public: // Depthwise separable
+
+		// Tiled depthwise convolution
+		/// Cross-correlate _channelNum padded inputs (see PadRows, stored back to back) with one packed K x K
+		/// kernel each at stride 1, _output receives _channelNum x OutputPixels() elements.
+		/// Work items are (channel, row tile) pairs, eight output columns stay in SSE2 registers.
+		template<size_t K>
+		static void DepthwiseTiled(const ElemType * _padded, const ConvGeometry & _geometry,
+			const ElemType * _packed, const size_t _channelNum, ElemType * _output);
+
+		// Pointwise convolution
+		/// _output (_kernelNum x _pixels) = _weights (_kernelNum x _channelNum) * _input (_channelNum x _pixels),
+		/// the 1x1 convolution of a depthwise separable layer. Four kernels times four pixels stay in SSE2
+		/// registers while the channels are summed in order, the result does not depend on the thread count.
+		static void Pointwise(const ElemType * _weights, const ElemType * _input, const size_t _kernelNum,
+			const size_t _channelNum, const size_t _pixels, ElemType * _output);
+
+	private:
+
+		// One output row of G kernels.
+		template<size_t K, size_t G>
+		static void DirectRow(const ElemType * _padded, const size_t _paddedN, const ElemType * _packed,
+			ElemType * const * _output, const size_t _outputN);
+		// One output row of a single kernel, eight columns per pass.
+		template<size_t K>
+		static void DepthwiseRow(const ElemType * _padded, const size_t _paddedN, const ElemType * _kernel,
+			ElemType * _output, const size_t _outputN);
+
+	public:
+
+		// Number of output rows per tile of DirectTiled.
+		static const size_t DirectRowTile = 8;
+		// Number of pixels per work item of Pointwise.
+		static const size_t PointwisePixelTile = 256;
+	};
+}
+
+
+namespace Neural
+{
+	template<size_t K, size_t G>
+	void Convolution::DirectRow(const ElemType * _padded, const size_t _paddedN, const ElemType * _packed,
+		ElemType * const * _output, const size_t _outputN)
+	{
+		size_t j = 0;
+#ifdef USING_SSE2_CONVOLUTION
+		for (; j + 4 <= _outputN; j += 4)
+		{
+			__m128d accumulator[G][2];
+			for (size_t g = 0; g < G; g++)
+				accumulator[g][0] = accumulator[g][1] = _mm_setzero_pd();
+			for (size_t u = 0; u < K; u++)
+			{
+				const ElemType * in = _padded + u * _paddedN + j;
+				for (size_t v = 0; v < K; v++)
+				{
+					const __m128d x0 = _mm_loadu_pd(in + v);
+					const __m128d x1 = _mm_loadu_pd(in + v + 2);
+					for (size_t g = 0; g < G; g++)
+					{
+						const __m128d w = _mm_set1_pd(_packed[g * K * K + u * K + v]);
+						accumulator[g][0] = _mm_add_pd(accumulator[g][0], _mm_mul_pd(w, x0));
+						accumulator[g][1] = _mm_add_pd(accumulator[g][1], _mm_mul_pd(w, x1));
+					}
+				}
+			}
+			for (size_t g = 0; g < G; g++)
+			{
+				_mm_storeu_pd(_output[g] + j, accumulator[g][0]);
+				_mm_storeu_pd(_output[g] + j + 2, accumulator[g][1]);
+			}
+		}
+#endif // USING_SSE2_CONVOLUTION
+		for (; j < _outputN; j++)
+		{
+			for (size_t g = 0; g < G; g++)
+			{
+				ElemType sum = 0;
+				for (size_t u = 0; u < K; u++)
+					for (size_t v = 0; v < K; v++)
+						sum += _packed[g * K * K + u * K + v] * _padded[u * _paddedN + j + v];
+				_output[g][j] = sum;
+			}
+		}
+	}
+
+	template<size_t K>
+	void Convolution::DirectTiled(const ElemType * _padded, const ConvGeometry & _geometry,
+		const ElemType * _packed, const size_t _kernelNum, ElemType * _output)
+	{
+		const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+		const size_t paddedN = outputN + K - 1;
+		const size_t pixels = outputM * outputN;
+		// Work items are (kernel group, row tile) pairs : groups of four kernels, then single kernels.
+		const size_t fullGroups = _kernelNum / 4;
+		const size_t groupNum = fullGroups + _kernelNum % 4;
+		const size_t tileNum = (outputM + DirectRowTile - 1) / DirectRowTile;
+		MathLib::ParallelFor(0, groupNum * tileNum, [&](size_t _itemBegin, size_t _itemEnd) {
+			for (size_t item = _itemBegin; item < _itemEnd; item++)
+			{
+				const size_t group = item / tileNum;
+				const size_t rowBegin = (item % tileNum) * DirectRowTile;
+				const size_t rowEnd = std::min(outputM, rowBegin + DirectRowTile);
+				if (group < fullGroups)
+				{
+					const size_t k = group * 4;
+					for (size_t i = rowBegin; i < rowEnd; i++)
+					{
+						ElemType * output[4];
+						for (size_t g = 0; g < 4; g++)
+							output[g] = _output + (k + g) * pixels + i * outputN;
+						DirectRow<K, 4>(_padded + i * paddedN, paddedN, _packed + k * K * K, output, outputN);
+					}
+				}
+				else
+				{
+					const size_t k = fullGroups * 4 + (group - fullGroups);
+					for (size_t i = rowBegin; i < rowEnd; i++)
+					{
+						ElemType * output = _output + k * pixels + i * outputN;
+						DirectRow<K, 1>(_padded + i * paddedN, paddedN, _packed + k * K * K, &output, outputN);
+					}
+				}
+			}
+		}, MathLib::ThreadPool::Grain(4 * K * K * DirectRowTile * outputN));
+	}
+
+	template<size_t K>
+	void Convolution::DirectTiledBatch(const ElemType * _padded, const size_t _sampleNum, const ConvGeometry & _geometry,
+		const ElemType * _packed, const ElemType * _bias, const size_t _kernelNum, ElemType * const * _outputs)
+	{
+		const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+		const size_t paddedN = outputN + K - 1;
+		const size_t paddedPixels = (outputM + K - 1) * paddedN;
+		const size_t tileNum = (outputM + DirectRowTile - 1) / DirectRowTile;
+		MathLib::ParallelFor(0, _sampleNum * tileNum, [&](size_t _itemBegin, size_t _itemEnd) {
+			for (size_t item = _itemBegin; item < _itemEnd; item++)
+			{
+				const size_t n = item / tileNum;
+				const size_t rowBegin = (item % tileNum) * DirectRowTile;
+				const size_t rowEnd = std::min(outputM, rowBegin + DirectRowTile);
+				const ElemType * padded = _padded + n * paddedPixels;
+				ElemType * const * outputs = _outputs + n * _kernelNum;
+				for (size_t i = rowBegin; i < rowEnd; i++)
+				{
+					size_t k = 0;
+					for (; k + 4 <= _kernelNum; k += 4)
+					{
+						ElemType * output[4];
+						for (size_t g = 0; g < 4; g++)
+							output[g] = outputs[k + g] + i * outputN;
+						DirectRow<K, 4>(padded + i * paddedN, paddedN, _packed + k * K * K, output, outputN);
+					}
+					for (; k < _kernelNum; k++)
+					{
+						ElemType * output = outputs[k] + i * outputN;
+						DirectRow<K, 1>(padded + i * paddedN, paddedN, _packed + k * K * K, &output, outputN);
+					}
+					// The rows are still in L1, the bias is added on the way.
+					for (k = 0; k < _kernelNum; k++)
+					{
+						ElemType * output = outputs[k] + i * outputN;
+						for (size_t j = 0; j < outputN; j++)
+							output[j] += _bias[k];
+					}
+				}
+			}
+		}, MathLib::ThreadPool::Grain(_kernelNum * K * K * DirectRowTile * outputN));
+	}
+
+	template<size_t K>
+	void Convolution::DirectRows(const ElemType * _padded, const ConvGeometry & _geometry, const ElemType * _packed, const size_t _kernelNum,
+		const size_t _rowBegin, const size_t _rowEnd, ElemType * _output, const size_t _outputStride)
+	{
+		const size_t outputN = _geometry.Output.n;
+		const size_t paddedN = outputN + K - 1;
+		for (size_t i = _rowBegin; i < _rowEnd; i++)
+		{
+			ElemType * output[4];
+			for (size_t g = 0; g < _kernelNum; g++)
+				output[g] = _output + g * _outputStride + (i - _rowBegin) * outputN;
+			if (_kernelNum == 4)
+				DirectRow<K, 4>(_padded + i * paddedN, paddedN, _packed, output, outputN);
+			else
+				for (size_t g = 0; g < _kernelNum; g++)
+					DirectRow<K, 1>(_padded + i * paddedN, paddedN, _packed + g * K * K, output + g, outputN);
+		}
+	}
+
+	template<size_t K>
+	void Convolution::DepthwiseRow(const ElemType * _padded, const size_t _paddedN, const ElemType * _kernel,
+		ElemType * _output, const size_t _outputN)
+	{
+		size_t j = 0;
+#ifdef USING_SSE2_CONVOLUTION
+		for (; j + 8 <= _outputN; j += 8)
+		{
+			__m128d accumulator[4];
+			for (size_t a = 0; a < 4; a++)
+				accumulator[a] = _mm_setzero_pd();
+			for (size_t u = 0; u < K; u++)
+			{
+				const ElemType * in = _padded + u * _paddedN + j;
+				for (size_t v = 0; v < K; v++)
+				{
+					const __m128d w = _mm_set1_pd(_kernel[u * K + v]);
+					for (size_t a = 0; a < 4; a++)
+						accumulator[a] = _mm_add_pd(accumulator[a], _mm_mul_pd(w, _mm_loadu_pd(in + v + 2 * a)));
+				}
+			}
+			for (size_t a = 0; a < 4; a++)
+				_mm_storeu_pd(_output + j + 2 * a, accumulator[a]);
+		}
+#endif // USING_SSE2_CONVOLUTION
+		for (; j < _outputN; j++)
+		{
+			ElemType sum = 0;
+			for (size_t u = 0; u < K; u++)
+				for (size_t v = 0; v < K; v++)
+					sum += _kernel[u * K + v] * _padded[u * _paddedN + j + v];
+			_output[j] = sum;
+		}
+	}
+
+	template<size_t K>
+	void Convolution::DepthwiseTiled(const ElemType * _padded, const ConvGeometry & _geometry,
+		const ElemType * _packed, const size_t _channelNum, ElemType * _output)
+	{
+		const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+		const size_t paddedN = outputN + K - 1;
+		const size_t paddedPixels = (outputM + K - 1) * paddedN;
+		const size_t pixels = outputM * outputN;
+		const size_t tileNum = (outputM + DirectRowTile - 1) / DirectRowTile;
+		MathLib::ParallelFor(0, _channelNum * tileNum, [&](size_t _itemBegin, size_t _itemEnd) {
+			for (size_t item = _itemBegin; item < _itemEnd; item++)
+			{
+				const size_t c = item / tileNum;
+				const size_t rowBegin = (item % tileNum) * DirectRowTile;
+				const size_t rowEnd = std::min(outputM, rowBegin + DirectRowTile);
+				const ElemType * padded = _padded + c * paddedPixels;
+				for (size_t i = rowBegin; i < rowEnd; i++)
+					DepthwiseRow<K>(padded + i * paddedN, paddedN, _packed + c * K * K, _output + c * pixels + i * outputN, outputN);
+			}
+		}, MathLib::ThreadPool::Grain(K * K * DirectRowTile * outputN));
+	}
+}
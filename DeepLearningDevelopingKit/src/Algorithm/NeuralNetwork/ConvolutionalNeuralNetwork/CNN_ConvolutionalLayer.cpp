@@ -14,20 +14,22 @@ Neural::ConvolutionalLayer::ConvolutionalLayer(const ConvLayerInitor & _initor)
 {
 	this->_convNodeNum = _initor.KernelNum;
 	this->_kernelSize = _initor.KernelSize;
-	this->_stride = _initor.Stride;
+	this->_stride = std::max<size_t>(_initor.Stride, 1);
+	this->_dilation = std::max<size_t>(_initor.Dilation, 1);
 	this->_inputSize = _initor.InputSize;
 	this->_paddingMethod = _initor.PaddingMethod;
 	this->_paddingNum = _initor.PaddingNum;
+	this->_algorithm = _initor.Algorithm;
 
-	this->_outputSize.m = _inputSize.m;
-	this->_outputSize.n = _inputSize.n;
-	this->_paddingM = floor(_kernelSize.m / 2);
-	this->_paddingN = floor(_kernelSize.n / 2);
+	this->_paddingM = _dilation * (_kernelSize.m / 2);
+	this->_paddingN = _dilation * (_kernelSize.n / 2);
+	this->_outputSize.m = ConvGeometry::OutputLength(_inputSize.m, _kernelSize.m, _paddingM, _stride, _dilation);
+	this->_outputSize.n = ConvGeometry::OutputLength(_inputSize.n, _kernelSize.n, _paddingN, _stride, _dilation);
 
 	SetActivationFunction(_initor.ActivationFunction);
 
 	for (size_t i = 0; i < _convNodeNum; i++)
-		this->_convNodes.push_back(ConvNode(_kernelSize, _inputSize));
+		this->_convNodes.push_back(ConvNode(_kernelSize, _outputSize));
 }
 
 void Neural::ConvolutionalLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>>& _input)
@@ -45,76 +47,482 @@ void Neural::ConvolutionalLayer::SetLearnRate(const double _learnRate)
 	this->learnRate = _learnRate;
 }
 
-void Neural::ConvolutionalLayer::ForwardPropagation(void)
+void Neural::ConvolutionalLayer::SetAlgorithm(const ConvolutionAlgorithm _algorithm)
+{
+	this->_algorithm = _algorithm;
+}
+
+void Neural::ConvolutionalLayer::InvalidateKernelCache(void)
 {
-	for (size_t k = 0; k < _convNodeNum; k++) // Travesing kernel
+	this->_kernelVersion++;
+}
+
+const std::vector<Neural::ConvKernel> & Neural::ConvolutionalLayer::GetFlippedKernels(void)
+{
+	if (!_flippedKernels.Valid(_kernelVersion))
 	{
-		_convNodes.at(k).feature.Clear();
-		for (size_t i = 0; i < _input.size(); i++) // Travesing input
+		_flippedKernels.Data.clear();
+		for (const ConvNode & node : _convNodes)
+			_flippedKernels.Data.push_back(Rot180(node.kernel));
+		_flippedKernels.Validate(_kernelVersion);
+	}
+	return _flippedKernels.Data;
+}
+
+const Neural::ElemType * Neural::ConvolutionalLayer::GetPackedKernels(void)
+{
+	if (!_packedKernels.Valid(_kernelVersion))
+	{
+		std::vector<ConvKernel> kernels;
+		for (const ConvNode & node : _convNodes)
+			kernels.push_back(node.kernel);
+		_packedKernels.Data.resize(_convNodeNum * _kernelSize.m * _kernelSize.n);
+		Convolution::PackFlipped(kernels, _packedKernels.Data.data());
+		_packedKernels.Validate(_kernelVersion);
+	}
+	return _packedKernels.Data.data();
+}
+
+const Neural::ElemType * Neural::ConvolutionalLayer::GetWinogradKernels(const WinogradTile _tile)
+{
+	if (_winograd.GetTile() != _tile)
+	{
+		_winograd = Winograd<ElemType>(_tile);
+		_winogradKernels.Invalidate();
+	}
+	if (!_winogradKernels.Valid(_kernelVersion))
+	{
+		_winograd.TransformKernels(GetPackedKernels(), _convNodeNum, _winogradKernels.Data);
+		_winogradKernels.Validate(_kernelVersion);
+	}
+	return _winogradKernels.Data.data();
+}
+
+const std::complex<Neural::ElemType> * Neural::ConvolutionalLayer::GetKernelSpectra(void)
+{
+	if (!_kernelSpectra.Valid(_kernelVersion))
+	{
+		const size_t fftN = _fftPlan.RowSize();
+		const size_t spectrumSize = _fftPlan.SpectrumSize();
+		_fftBuffer.assign(_fftPlan.ColumeSize() * fftN, ElemType(0));
+		_kernelSpectra.Data.resize(_convNodeNum * spectrumSize);
+		for (size_t k = 0; k < _convNodeNum; k++)
 		{
-			_convNodes.at(k).feature += (ConvolutionCal(_input.at(i), _convNodes.at(k).kernel) + _convNodes.at(k).bias);
+			// Dilated kernels are spread over the buffer with their taps _dilation apart.
+			const ElemType * kernel = _convNodes.at(k).kernel.Data();
+			for (size_t i = 0; i < _kernelSize.m; i++)
+				for (size_t j = 0; j < _kernelSize.n; j++)
+					_fftBuffer[i * _dilation * fftN + j * _dilation] = kernel[i * _kernelSize.n + j];
+			_fftPlan.Forward(_fftBuffer.data(), _kernelSpectra.Data.data() + k * spectrumSize);
 		}
-		_convNodes.at(k).feature = _convNodes.at(k).feature * ((double)1 / (double)_input.size());
+		_kernelSpectra.Validate(_kernelVersion);
 	}
+	return _kernelSpectra.Data.data();
 }
 
-void Neural::ConvolutionalLayer::BackwardPropagation(void)
+void Neural::ConvolutionalLayer::ForwardPropagation(void)
 {
-	_derivative.clear();
-	for (size_t k = 0; k < _convNodeNum; k++)
+	if (_input.empty())
+	{
+		std::cerr << "ERROR : ConvLayer forward propagation without input." << std::endl;
+		return;
+	}
+	const ConvolutionAlgorithm algorithm = ResolvedAlgorithm();
+	switch (algorithm)
 	{
-		MathLib::Matrix<ElemType> tempMat(_inputSize.m, _inputSize.n);
-		for (size_t i = 0; i < _input.size(); i++)
+	case ConvolutionAlgorithm::Direct:
+		ForwardDirect();
+		break;
+	case ConvolutionAlgorithm::Winograd2x2:
+	case ConvolutionAlgorithm::Winograd4x4:
+		if (_kernelSize.m == 3 && _kernelSize.n == 3 && _stride == 1 && _dilation == 1)
+		{
+			ForwardWinograd(algorithm == ConvolutionAlgorithm::Winograd2x2 ? WinogradTile::F2x2 : WinogradTile::F4x4);
+			break;
+		}
+		ForwardIm2col();
+		break;
+	case ConvolutionAlgorithm::FFT:
+		ForwardFFT();
+		break;
+	case ConvolutionAlgorithm::DirectTiled:
+		if (!ForwardDirectTiled())
+			ForwardIm2col();
+		break;
+	case ConvolutionAlgorithm::Im2col:
+	default:
+		ForwardIm2col();
+		break;
+	}
+}
+
+void Neural::ConvolutionalLayer::ForwardDirect(void)
+{
+	const std::vector<ConvKernel> & flippedKernels = GetFlippedKernels();
+	const size_t kernelWork = _input.size() * _outputSize.m * _outputSize.n * _kernelSize.m * _kernelSize.n;
+	MathLib::ParallelFor(0, _convNodeNum, [&](size_t _kernelBegin, size_t _kernelEnd) {
+		for (size_t k = _kernelBegin; k < _kernelEnd; k++) // Travesing kernel
 		{
-			for (size_t j = 0; j < _convNodeNum; j++)
+			_convNodes.at(k).feature.Clear();
+			for (size_t i = 0; i < _input.size(); i++) // Travesing input
 			{
-				auto a = ConvolutionCal(_derivativeLastLayer.at(j), _convNodes.at(k).kernel);
-				tempMat += Hadamard(a, _convNodes.at(j).feature);
+				_convNodes.at(k).feature += (CorrelationCal(_input.at(i), flippedKernels.at(k)) + _convNodes.at(k).bias);
 			}
+			// Scaled in place, the feature may be a view planned by the owner of the layer.
+			ConvFeature & feature = _convNodes.at(k).feature;
+			const ElemType scale = ElemType(1) / _input.size();
+			const size_t elements = feature.ColumeSize() * feature.RowSize();
+			ElemType * data = feature.Data();
+			for (size_t e = 0; e < elements; e++)
+				data[e] *= scale;
 		}
-		_derivative.push_back(tempMat);
-	}
+	}, MathLib::ThreadPool::Grain(kernelWork));
+}
 
-	for (size_t k = 0; k < _convNodeNum; k++)
+void Neural::ConvolutionalLayer::ForwardIm2col(void)
+{
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t kernelElements = geometry.KernelElements();
+	const size_t pixels = geometry.OutputPixels();
+
+	_column.resize(kernelElements * pixels);
+	_output.resize(_convNodeNum * pixels);
+
+	LowerInput(_input, geometry, _column.data());
+
+	// Features = packed kernels (K x k^2) * column (k^2 x pixels)
+	MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::NoTrans, _convNodeNum, pixels, kernelElements,
+		ElemType(1), GetPackedKernels(), kernelElements, _column.data(), pixels, ElemType(0), _output.data(), pixels);
+
+	StoreFeatures(_output.data(), geometry);
+}
+
+void Neural::ConvolutionalLayer::ForwardWinograd(const WinogradTile _tile)
+{
+	const ConvGeometry geometry = ForwardGeometry();
+	_averageInput.resize(_inputSize.m * _inputSize.n);
+	_output.resize(_convNodeNum * geometry.OutputPixels());
+
+	const ElemType * winogradKernels = GetWinogradKernels(_tile);
+	AverageInput(_averageInput.data());
+	_winograd.Forward(_averageInput.data(), geometry, winogradKernels, _convNodeNum, _output.data());
+	StoreFeatures(_output.data(), geometry);
+}
+
+void Neural::ConvolutionalLayer::ForwardFFT(void)
+{
+	// The layer convolves (Rot180 then correlate) : output(i, j) is the full linear convolution with the
+	// unflipped (dilated) kernel at (i * stride - padding + extent - 1). The FFT size covers the full
+	// convolution so the circular wrap never reaches the output.
+	const ConvGeometry geometry = ForwardGeometry();
+	const MathLib::Size extent = geometry.DilatedKernel();
+	const size_t fftM = MathLib::FFT<ElemType>::GoodSize(_inputSize.m + extent.m - 1);
+	const size_t fftN = MathLib::FFT<ElemType>::GoodEvenSize(_inputSize.n + extent.n - 1);
+	if (_fftPlan.ColumeSize() != fftM || _fftPlan.RowSize() != fftN)
 	{
-		_convNodes.at(k).kernelDelta.Clear();
-		_convNodes.at(k).biasDelta = 0;
-		auto temp = _derivative.at(k);
-		for (size_t a = 0; a < _input.size(); a++)
+		_fftPlan = MathLib::RealFFT2D<ElemType>(fftM, fftN);
+		_kernelSpectra.Invalidate();
+	}
+	const size_t spectrumSize = _fftPlan.SpectrumSize();
+	const std::complex<ElemType> * kernelSpectra = GetKernelSpectra();
+	_fftBuffer.assign(fftM * fftN, ElemType(0));
+
+	_averageInput.resize(_inputSize.m * _inputSize.n);
+	AverageInput(_averageInput.data());
+	for (size_t i = 0; i < _inputSize.m; i++)
+		std::copy(_averageInput.data() + i * _inputSize.n, _averageInput.data() + (i + 1) * _inputSize.n, _fftBuffer.data() + i * fftN);
+	_inputSpectrum.resize(spectrumSize);
+	_productSpectrum.resize(spectrumSize);
+	_fftPlan.Forward(_fftBuffer.data(), _inputSpectrum.data());
+
+	const size_t pixels = geometry.OutputPixels();
+	_output.resize(_convNodeNum * pixels);
+	const long long offsetM = (long long)extent.m - 1 - (long long)_paddingM;
+	const long long offsetN = (long long)extent.n - 1 - (long long)_paddingN;
+	// Kernels are inverted in parallel. The plan keeps scratch buffers, so the first range uses the
+	// plan and buffers of the layer and every other range works on its own copies.
+	/// An inverse transform costs about log2(points) operations per point.
+	const size_t kernelWork = fftM * fftN * std::max<size_t>(1, (size_t)std::log2(fftM * fftN));
+	MathLib::ParallelFor(0, _convNodeNum, [&](size_t _kernelBegin, size_t _kernelEnd) {
+		MathLib::RealFFT2D<ElemType> planCopy;
+		std::vector<std::complex<ElemType>> productBuffer;
+		std::vector<ElemType> realBuffer;
+		MathLib::RealFFT2D<ElemType> * plan = &_fftPlan;
+		std::complex<ElemType> * product = _productSpectrum.data();
+		ElemType * real = _fftBuffer.data();
+		if (_kernelBegin != 0)
 		{
-			auto temp2 = Rot180(_input.at(a));
-			for (size_t m = 0; m < _kernelSize.m; m++)
-			{
-				for (size_t n = 0; n < _kernelSize.n; n++)
+			planCopy = _fftPlan;
+			productBuffer.resize(spectrumSize);
+			realBuffer.resize(fftM * fftN);
+			plan = &planCopy;
+			product = productBuffer.data();
+			real = realBuffer.data();
+		}
+		for (size_t k = _kernelBegin; k < _kernelEnd; k++)
+		{
+			const std::complex<ElemType> * kernelSpectrum = kernelSpectra + k * spectrumSize;
+			for (size_t f = 0; f < spectrumSize; f++)
+				product[f] = MathLib::FFT<ElemType>::Multiply(_inputSpectrum[f], kernelSpectrum[f]);
+			plan->Inverse(product, real);
+			ElemType * out = _output.data() + k * pixels;
+			for (size_t i = 0; i < geometry.Output.m; i++)
+				for (size_t j = 0; j < geometry.Output.n; j++)
 				{
-					ElemType sum = 0;
-					for (size_t i = 0; i < _inputSize.m - _kernelSize.m; i++)
-					{
-						for (size_t j = 0; j < _inputSize.n - _kernelSize.n; j++)
-						{
-							sum += temp(i, j) * temp2(i + m, j + n);
-						}
-					}
-					_convNodes.at(k).kernelDelta(m, n) = sum / _derivative.at(k).ColumeSize() * _derivative.at(k).RowSize();
+					const long long row = (long long)(i * _stride) + offsetM, column = (long long)(j * _stride) + offsetN;
+					out[i * geometry.Output.n + j] = row >= 0 && row < (long long)fftM && column >= 0 && column < (long long)fftN
+						? real[row * fftN + column] : ElemType(0);
 				}
-			}
 		}
-		
-		_convNodes.at(k).biasDelta = _derivative.at(k).Sum() / _derivative.at(k).ColumeSize() * _derivative.at(k).RowSize();
+	}, MathLib::ThreadPool::Grain(kernelWork));
+	StoreFeatures(_output.data(), geometry);
+}
+
+bool Neural::ConvolutionalLayer::ForwardDirectTiled(void)
+{
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t kernelSize = _kernelSize.m;
+	if (_kernelSize.n != kernelSize || _stride != 1 || _dilation != 1 || (kernelSize != 3 && kernelSize != 5 && kernelSize != 7))
+		return false;
+
+	_averageInput.resize(_inputSize.m * _inputSize.n);
+	_padded.resize((geometry.Output.m + kernelSize - 1) * (geometry.Output.n + kernelSize - 1));
+	_output.resize(_convNodeNum * geometry.OutputPixels());
+
+	const ElemType * packedKernels = GetPackedKernels();
+	AverageInput(_averageInput.data());
+	Convolution::PadRows(_averageInput.data(), geometry, _padded.data());
+	switch (kernelSize)
+	{
+	case 3:
+		Convolution::DirectTiled<3>(_padded.data(), geometry, packedKernels, _convNodeNum, _output.data());
+		break;
+	case 5:
+		Convolution::DirectTiled<5>(_padded.data(), geometry, packedKernels, _convNodeNum, _output.data());
+		break;
+	default:
+		Convolution::DirectTiled<7>(_padded.data(), geometry, packedKernels, _convNodeNum, _output.data());
+		break;
+	}
+	StoreFeatures(_output.data(), geometry);
+	return true;
+}
+
+Neural::ConvolutionAlgorithm Neural::ConvolutionalLayer::AutoAlgorithm(void) const
+{
+	const size_t kernelSize = _kernelSize.m;
+	const bool tiled = _kernelSize.n == kernelSize && _stride == 1 && _dilation == 1 && (kernelSize == 3 || kernelSize == 5 || kernelSize == 7);
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	if (tiled && pixels <= AutoDirectTiledPixels)
+		return ConvolutionAlgorithm::DirectTiled;
+	// FFT computes every position whatever the stride, strided layers stay on Im2col.
+	if (_stride == 1 && _kernelSize.m * _kernelSize.n >= AutoFFTKernelElements && pixels >= AutoFFTPixels)
+		return ConvolutionAlgorithm::FFT;
+	return ConvolutionAlgorithm::Im2col;
+}
+
+Neural::ConvolutionAlgorithm Neural::ConvolutionalLayer::ResolvedAlgorithm(void) const
+{
+	const ConvolutionAlgorithm algorithm = _algorithm == ConvolutionAlgorithm::Auto ? AutoAlgorithm() : _algorithm;
+	if (algorithm != ConvolutionAlgorithm::Direct && IsPointwise())
+		return ConvolutionAlgorithm::Im2col;
+	const size_t kernelSize = _kernelSize.m;
+	const bool square = _kernelSize.n == kernelSize && _stride == 1 && _dilation == 1;
+	switch (algorithm)
+	{
+	case ConvolutionAlgorithm::Winograd2x2:
+	case ConvolutionAlgorithm::Winograd4x4:
+		return square && kernelSize == 3 ? algorithm : ConvolutionAlgorithm::Im2col;
+	case ConvolutionAlgorithm::DirectTiled:
+		return square && (kernelSize == 3 || kernelSize == 5 || kernelSize == 7) ? algorithm : ConvolutionAlgorithm::Im2col;
+	default:
+		return algorithm;
+	}
+}
+
+bool Neural::ConvolutionalLayer::IsPointwise(void) const
+{
+	return _kernelSize.m == 1 && _kernelSize.n == 1 && _stride == 1;
+}
+
+void Neural::ConvolutionalLayer::LowerInput(const std::vector<MathLib::Matrix<ElemType>> & _channels, const ConvGeometry & _geometry,
+	ElemType * _column, const size_t _columnStride)
+{
+	// The column matrix of a pointwise layer is a single row, the pixels of a sample are contiguous.
+	if (IsPointwise())
+	{
+		AverageInput(_channels, _column);
+		return;
 	}
+	_averageInput.resize(_inputSize.m * _inputSize.n);
+	AverageInput(_channels, _averageInput.data());
+	Convolution::Im2col(_averageInput.data(), _geometry, _column, _columnStride);
+}
+
+void Neural::ConvolutionalLayer::StoreFeatures(const ElemType * _responses, const ConvGeometry & _geometry)
+{
+	const size_t pixels = _geometry.OutputPixels();
+	MathLib::ParallelFor(0, _convNodeNum, [&](size_t _kernelBegin, size_t _kernelEnd) {
+		for (size_t k = _kernelBegin; k < _kernelEnd; k++)
+		{
+			ConvFeature & feature = _convNodes.at(k).feature;
+			if (feature.ColumeSize() != _geometry.Output.m || feature.RowSize() != _geometry.Output.n)
+				feature.Init(_geometry.Output.m, _geometry.Output.n);
+			const ElemType * response = _responses + k * pixels;
+			const ElemType bias = _convNodes.at(k).bias;
+			ElemType * data = feature.Data();
+			for (size_t p = 0; p < pixels; p++)
+				data[p] = response[p] + bias;
+		}
+	}, MathLib::ThreadPool::Grain(pixels));
+}
+
+Neural::ConvGeometry Neural::ConvolutionalLayer::ForwardGeometry(void) const
+{
+	return ConvGeometry(_inputSize, _kernelSize, MathLib::Size(_paddingM, _paddingN), _stride, _outputSize, _dilation);
+}
+
+void Neural::ConvolutionalLayer::AverageInput(ElemType * _average) const
+{
+	AverageInput(_input, _average);
+}
+
+void Neural::ConvolutionalLayer::AverageInput(const std::vector<MathLib::Matrix<ElemType>> & _channels, ElemType * _average) const
+{
+	const size_t elements = _inputSize.m * _inputSize.n;
+	const size_t channelNum = _channels.size();
+	const ElemType scale = ElemType(1) / channelNum;
+	// Every element is summed over the channels in order, the result does not depend on the thread count.
+	MathLib::ParallelFor(0, elements, [&](size_t _elementBegin, size_t _elementEnd) {
+		std::copy(_channels.at(0).Data() + _elementBegin, _channels.at(0).Data() + _elementEnd, _average + _elementBegin);
+		for (size_t c = 1; c < channelNum; c++)
+		{
+			const ElemType * channel = _channels.at(c).Data();
+			for (size_t e = _elementBegin; e < _elementEnd; e++)
+				_average[e] += channel[e];
+		}
+		if (channelNum > 1)
+			for (size_t e = _elementBegin; e < _elementEnd; e++)
+				_average[e] *= scale;
+	}, 4096);
+}
+
+void Neural::ConvolutionalLayer::BackwardPropagation(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : ConvLayer is frozen, no backward propagation." << std::endl;
+		return;
+	}
+	if (_input.empty() || _derivativeLastLayer.size() < _convNodeNum)
+	{
+		std::cerr << "ERROR : ConvLayer backward propagation without input or delta." << std::endl;
+		return;
+	}
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t kernelElements = geometry.KernelElements();
+	const size_t pixels = geometry.OutputPixels();
+	const size_t channelNum = _input.size();
+
+	// Features = W (K x k^2) * column (k^2 x pixels) + bias, W holding the flipped kernels.
+	_column.resize(kernelElements * pixels);
+	_outputDelta.resize(_convNodeNum * pixels);
+	_kernelGradient.resize(_convNodeNum * kernelElements);
+	_columnDelta.resize(kernelElements * pixels);
+	LowerInput(_input, geometry, _column.data());
+	for (size_t k = 0; k < _convNodeNum; k++)
+	{
+		const ConvFeature & delta = _derivativeLastLayer.at(k);
+		if (delta.ColumeSize() * delta.RowSize() != pixels)
+		{
+			std::cerr << "ERROR : ConvLayer delta does not match the output size." << std::endl;
+			return;
+		}
+		std::copy(delta.Data(), delta.Data() + pixels, _outputDelta.data() + k * pixels);
+	}
+
+	LowerDelta(pixels);
+	StoreDelta(_columnDelta.data(), geometry, pixels, channelNum, _derivative);
+}
+
+void Neural::ConvolutionalLayer::LowerDelta(const size_t _columns, const bool _accumulate)
+{
+	const size_t kernelElements = _kernelSize.m * _kernelSize.n;
+	// Weight gradient dW = dY (K x columns) * column^T (columns x k^2).
+	MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::Trans, _convNodeNum, kernelElements, _columns,
+		ElemType(1), _outputDelta.data(), _columns, _column.data(), _columns, ElemType(_accumulate ? 1 : 0), _kernelGradient.data(), kernelElements);
+	for (size_t k = 0; k < _convNodeNum; k++)
+	{
+		// W holds the flipped kernels, flip the gradient back.
+		const ElemType * gradient = _kernelGradient.data() + k * kernelElements;
+		ElemType * kernelDelta = _convNodes.at(k).kernelDelta.Data();
+		for (size_t e = 0; e < kernelElements; e++)
+			kernelDelta[e] = gradient[kernelElements - 1 - e];
+		const ElemType * delta = _outputDelta.data() + k * _columns;
+		ElemType biasDelta = 0;
+		for (size_t p = 0; p < _columns; p++)
+			biasDelta += delta[p];
+		_convNodes.at(k).biasDelta = _accumulate ? _convNodes.at(k).biasDelta + biasDelta : biasDelta;
+	}
+
+	// Input gradient, the transposed convolution col2im(W^T (k^2 x K) * dY (K x columns)).
+	MathLib::GEMM(MathLib::Transpose::Trans, MathLib::Transpose::NoTrans, kernelElements, _columns, _convNodeNum,
+		ElemType(1), GetPackedKernels(), kernelElements, _outputDelta.data(), _columns, ElemType(0), _columnDelta.data(), _columns);
+}
+
+void Neural::ConvolutionalLayer::StoreDelta(const ElemType * _columnDelta, const ConvGeometry & _geometry, const size_t _columnStride,
+	const size_t _channelNum, std::vector<MathLib::Matrix<ElemType>> & _delta)
+{
+	// The delta of the last call is written over, unless someone still holds it.
+	_delta.resize(std::min<size_t>(_delta.size(), 1));
+	if (_delta.empty() || _delta.front().ColumeSize() != _inputSize.m || _delta.front().RowSize() != _inputSize.n)
+		_delta.assign(1, MathLib::Matrix<ElemType>(_inputSize.m, _inputSize.n));
+	ElemType * inputDelta = _delta.front().Data();
+	const size_t elements = _inputSize.m * _inputSize.n;
+	// Every channel enters the features through their average, they share 1 / channels of it.
+	const ElemType scale = ElemType(1) / _channelNum;
+	if (IsPointwise())
+	{
+		// The column delta of a pointwise layer is the input delta, no overlapping windows to add up.
+		for (size_t e = 0; e < elements; e++)
+			inputDelta[e] = _columnDelta[e] * scale;
+	}
+	else
+	{
+		Convolution::Col2im(_columnDelta, _geometry, inputDelta, _columnStride);
+		if (_channelNum > 1)
+			for (size_t e = 0; e < elements; e++)
+				inputDelta[e] *= scale;
+	}
+	// Every channel gets a handle of the same delta, an alias stays an alias.
+	const MathLib::Matrix<ElemType> shared = _delta.front().Handle();
+	_delta.resize(1);
+	for (size_t c = 1; c < _channelNum; c++)
+		_delta.push_back(shared.Handle());
 }
 
 void Neural::ConvolutionalLayer::Update(void)
 {
+	if (_frozen)
+	{
+		std::cerr << "ERROR : ConvLayer is frozen, no update." << std::endl;
+		return;
+	}
 	for (size_t k = 0; k < _convNodeNum; k++)
 	{
 		_convNodes.at(k).kernel -= _convNodes.at(k).kernelDeltaSum * learnRate;
 		_convNodes.at(k).bias -= _convNodes.at(k).biasDeltaSum * learnRate;
 	}
+	InvalidateKernelCache();
 }
 
 void Neural::ConvolutionalLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 {
+	if (_frozen)
+	{
+		std::cerr << "ERROR : ConvLayer is frozen, no delta sum." << std::endl;
+		return;
+	}
 	for (size_t k = 0; k < _convNodeNum; k++)
 	{
 		_convNodes.at(k).kernelDeltaSum += _convNodes.at(k).kernelDelta * (1 / (double)_batchSize);
@@ -124,6 +532,8 @@ void Neural::ConvolutionalLayer::BatchDeltaSumUpdate(const size_t _batchSize)
 
 void Neural::ConvolutionalLayer::BatchDeltaSumClear(void)
 {
+	if (_frozen)
+		return;
 	for (size_t k = 0; k < _convNodeNum; k++)
 	{
 		_convNodes.at(k).kernelDeltaSum.Clear();
@@ -131,6 +541,249 @@ void Neural::ConvolutionalLayer::BatchDeltaSumClear(void)
 	}
 }
 
+void Neural::ConvolutionalLayer::SetInputBatch(const FeatureBatch & _input)
+{
+	this->_inputBatch = _input;
+}
+
+void Neural::ConvolutionalLayer::SetDeltaBatch(const FeatureBatch & _delta)
+{
+	this->_derivativeLastLayerBatch = _delta;
+}
+
+void Neural::ConvolutionalLayer::ForwardPropagationBatch(void)
+{
+	const size_t batchSize = _inputBatch.size();
+	for (size_t n = 0; n < batchSize; n++)
+		if (_inputBatch[n].empty())
+		{
+			std::cerr << "ERROR : ConvLayer batch forward propagation without input." << std::endl;
+			return;
+		}
+	const ConvGeometry geometry = ForwardGeometry();
+	_featureBatch.resize(batchSize);
+	for (std::vector<ConvFeature> & features : _featureBatch)
+	{
+		features.resize(_convNodeNum);
+		for (ConvFeature & feature : features)
+			if (feature.ColumeSize() != geometry.Output.m || feature.RowSize() != geometry.Output.n)
+				feature.Init(geometry.Output.m, geometry.Output.n);
+	}
+	const ConvolutionAlgorithm algorithm = ResolvedAlgorithm();
+	if (algorithm == ConvolutionAlgorithm::DirectTiled)
+	{
+		ForwardDirectTiledBatch(geometry);
+		return;
+	}
+	if (algorithm != ConvolutionAlgorithm::Im2col)
+	{
+		// Sample by sample, the features of the batch are lent to the nodes.
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			_input = MathLib::Matrix<ElemType>::Handles(_inputBatch[n]);
+			for (size_t k = 0; k < _convNodeNum; k++)
+				std::swap(_convNodes[k].feature, _featureBatch[n][k]);
+			ForwardPropagation();
+			for (size_t k = 0; k < _convNodeNum; k++)
+				std::swap(_convNodes[k].feature, _featureBatch[n][k]);
+		}
+		return;
+	}
+
+	const size_t kernelElements = geometry.KernelElements();
+	const size_t pixels = geometry.OutputPixels();
+	const size_t chunk = BatchChunk(geometry);
+	const ElemType * packed = GetPackedKernels();
+	for (size_t first = 0; first < batchSize; first += chunk)
+	{
+		const size_t count = std::min(chunk, batchSize - first);
+		const size_t columns = count * pixels;
+		_output.resize(_convNodeNum * columns);
+		LowerBatch(geometry, first, count);
+		// Features of the chunk = packed kernels (K x k^2) * column (k^2 x samples * pixels)
+		MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::NoTrans, _convNodeNum, columns, kernelElements,
+			ElemType(1), packed, kernelElements, _column.data(), columns, ElemType(0), _output.data(), columns);
+		MathLib::ParallelFor(0, count * _convNodeNum, [&](size_t _itemBegin, size_t _itemEnd) {
+			for (size_t item = _itemBegin; item < _itemEnd; item++)
+			{
+				const size_t n = item / _convNodeNum, k = item % _convNodeNum;
+				const ElemType * response = _output.data() + k * columns + n * pixels;
+				const ElemType bias = _convNodes.at(k).bias;
+				ElemType * data = _featureBatch[first + n][k].Data();
+				for (size_t p = 0; p < pixels; p++)
+					data[p] = response[p] + bias;
+			}
+		}, MathLib::ThreadPool::Grain(pixels));
+	}
+}
+
+void Neural::ConvolutionalLayer::ForwardDirectTiledBatch(const ConvGeometry & _geometry)
+{
+	const size_t batchSize = _inputBatch.size();
+	const size_t kernelSize = _kernelSize.m;
+	const size_t paddedPixels = (_geometry.Output.m + kernelSize - 1) * (_geometry.Output.n + kernelSize - 1);
+	const size_t chunk = std::max<size_t>(1, BatchColumnElements / paddedPixels);
+	const ElemType * packed = GetPackedKernels();
+	std::vector<ElemType> bias(_convNodeNum);
+	for (size_t k = 0; k < _convNodeNum; k++)
+		bias[k] = _convNodes.at(k).bias;
+	std::vector<ElemType *> outputs(std::min(chunk, batchSize) * _convNodeNum);
+	_averageInput.resize(_inputSize.m * _inputSize.n);
+	for (size_t first = 0; first < batchSize; first += chunk)
+	{
+		const size_t count = std::min(chunk, batchSize - first);
+		_padded.resize(count * paddedPixels);
+		for (size_t n = 0; n < count; n++)
+		{
+			AverageInput(_inputBatch[first + n], _averageInput.data());
+			Convolution::PadRows(_averageInput.data(), _geometry, _padded.data() + n * paddedPixels);
+			for (size_t k = 0; k < _convNodeNum; k++)
+				outputs[n * _convNodeNum + k] = _featureBatch[first + n][k].Data();
+		}
+		switch (kernelSize)
+		{
+		case 3:
+			Convolution::DirectTiledBatch<3>(_padded.data(), count, _geometry, packed, bias.data(), _convNodeNum, outputs.data());
+			break;
+		case 5:
+			Convolution::DirectTiledBatch<5>(_padded.data(), count, _geometry, packed, bias.data(), _convNodeNum, outputs.data());
+			break;
+		default:
+			Convolution::DirectTiledBatch<7>(_padded.data(), count, _geometry, packed, bias.data(), _convNodeNum, outputs.data());
+			break;
+		}
+	}
+}
+
+void Neural::ConvolutionalLayer::BackwardPropagationBatch(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : ConvLayer is frozen, no backward propagation." << std::endl;
+		return;
+	}
+	const size_t batchSize = _inputBatch.size();
+	if (batchSize == 0 || _derivativeLastLayerBatch.size() != batchSize)
+	{
+		std::cerr << "ERROR : ConvLayer batch backward propagation without input or delta." << std::endl;
+		return;
+	}
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t kernelElements = geometry.KernelElements();
+	const size_t pixels = geometry.OutputPixels();
+	for (size_t n = 0; n < batchSize; n++)
+		for (size_t k = 0; k < _convNodeNum; k++)
+		{
+			const std::vector<MathLib::Matrix<ElemType>> & deltas = _derivativeLastLayerBatch[n];
+			if (k >= deltas.size() || deltas[k].ColumeSize() * deltas[k].RowSize() != pixels)
+			{
+				std::cerr << "ERROR : ConvLayer delta does not match the output size." << std::endl;
+				return;
+			}
+		}
+
+	const size_t chunk = BatchChunk(geometry);
+	_kernelGradient.resize(_convNodeNum * kernelElements);
+	_derivativeBatch.resize(batchSize);
+	for (size_t first = 0; first < batchSize; first += chunk)
+	{
+		const size_t count = std::min(chunk, batchSize - first);
+		const size_t columns = count * pixels;
+		LowerBatch(geometry, first, count);
+		_outputDelta.resize(_convNodeNum * columns);
+		_columnDelta.resize(kernelElements * columns);
+		for (size_t n = 0; n < count; n++)
+			for (size_t k = 0; k < _convNodeNum; k++)
+			{
+				const ConvFeature & delta = _derivativeLastLayerBatch[first + n][k];
+				std::copy(delta.Data(), delta.Data() + pixels, _outputDelta.data() + k * columns + n * pixels);
+			}
+		// One GEMM adds the kernel gradient of the chunk to the batch sum, one lowers the delta of every sample.
+		LowerDelta(columns, first != 0);
+		for (size_t n = 0; n < count; n++)
+			StoreDelta(_columnDelta.data() + n * pixels, geometry, columns, _inputBatch[first + n].size(), _derivativeBatch[first + n]);
+	}
+}
+
+size_t Neural::ConvolutionalLayer::BatchChunk(const ConvGeometry & _geometry) const
+{
+	return std::max<size_t>(1, BatchColumnElements / std::max<size_t>(1, _geometry.KernelElements() * _geometry.OutputPixels()));
+}
+
+void Neural::ConvolutionalLayer::LowerBatch(const ConvGeometry & _geometry, const size_t _first, const size_t _count)
+{
+	const size_t pixels = _geometry.OutputPixels();
+	_column.resize(_geometry.KernelElements() * _count * pixels);
+	for (size_t n = 0; n < _count; n++)
+		LowerInput(_inputBatch[_first + n], _geometry, _column.data() + n * pixels, _count * pixels);
+}
+
+void Neural::ConvolutionalLayer::Freeze(void)
+{
+	this->_frozen = true;
+	if (_algorithm == ConvolutionAlgorithm::Auto)
+		_algorithm = AutoAlgorithm();
+
+	for (ConvNode & node : _convNodes)
+	{
+		node.kernelDelta = ConvKernel();
+		node.kernelDeltaSum = ConvKernel();
+		node.biasDelta = node.biasDeltaSum = 0;
+	}
+	std::vector<MathLib::Matrix<ElemType>>().swap(_input);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_paddedInput);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_derivative);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_derivativeLastLayer);
+	FeatureBatch().swap(_inputBatch);
+	FeatureBatch().swap(_derivativeBatch);
+	FeatureBatch().swap(_derivativeLastLayerBatch);
+	std::vector<ElemType>().swap(_outputDelta);
+	std::vector<ElemType>().swap(_kernelGradient);
+	std::vector<ElemType>().swap(_columnDelta);
+
+	// Build the layout the forward propagation reads, drop the others.
+	bool flipped = false, packed = false, transformed = false, spectra = false;
+	switch (ResolvedAlgorithm())
+	{
+	case ConvolutionAlgorithm::Direct:
+		GetFlippedKernels();
+		flipped = true;
+		break;
+	case ConvolutionAlgorithm::Winograd2x2:
+	case ConvolutionAlgorithm::Winograd4x4:
+		GetWinogradKernels(_algorithm == ConvolutionAlgorithm::Winograd2x2 ? WinogradTile::F2x2 : WinogradTile::F4x4);
+		transformed = true;
+		break;
+	case ConvolutionAlgorithm::FFT:
+		spectra = true;
+		break;
+	default:
+		GetPackedKernels();
+		packed = true;
+		break;
+	}
+	if (!flipped)
+	{
+		std::vector<ConvKernel>().swap(_flippedKernels.Data);
+		_flippedKernels.Invalidate();
+	}
+	if (!packed)
+	{
+		std::vector<ElemType>().swap(_packedKernels.Data);
+		_packedKernels.Invalidate();
+	}
+	if (!transformed)
+	{
+		std::vector<ElemType>().swap(_winogradKernels.Data);
+		_winogradKernels.Invalidate();
+	}
+	if (!spectra)
+	{
+		std::vector<std::complex<ElemType>>().swap(_kernelSpectra.Data);
+		_kernelSpectra.Invalidate();
+	}
+}
+
 void Neural::ConvolutionalLayer::SetActivationFunction(const ActivationFunction _function)
 {
 	switch (_function)
@@ -156,20 +809,17 @@ void Neural::ConvolutionalLayer::SetActivationFunction(const ActivationFunction
 
 MathLib::Matrix<Neural::ElemType> Neural::ConvolutionalLayer::ConvolutionCal(const MathLib::Matrix<ElemType> &  _mat1, const MathLib::Matrix<ElemType> &  _mat2)
 {
-	MathLib::Matrix<Neural::ElemType> temp(_inputSize.m, _inputSize.n);
+	return CorrelationCal(_mat1, Rot180(_mat2));
+}
 
-	MathLib::Matrix<Neural::ElemType> mat1Padded = Pad::Padding(_mat1, PaddingMethod::Surround, PaddingNum::ZeroPadding, _paddingM, _paddingN);
-	size_t offsetM{ 0 }, offsetN{ 0 };
-	for (size_t i = 0; i < _inputSize.m; i++)
-	{
-		for (size_t j = 0; j < _inputSize.n; j++)
-		{
-			temp(i, j) = ConvolutionSum(mat1Padded, _mat2, offsetM, offsetN);
-			offsetN += _stride;
-		}
-		offsetM += _stride;
-		offsetN = 0;
-	}
+MathLib::Matrix<Neural::ElemType> Neural::ConvolutionalLayer::CorrelationCal(const MathLib::Matrix<ElemType> &  _mat1, const MathLib::Matrix<ElemType> &  _flipped)
+{
+	const MathLib::Size padding(_paddingM, _paddingN);
+	const MathLib::Size output(ConvGeometry::OutputLength(_mat1.ColumeSize(), _flipped.ColumeSize(), _paddingM, _stride, _dilation),
+		ConvGeometry::OutputLength(_mat1.RowSize(), _flipped.RowSize(), _paddingN, _stride, _dilation));
+	MathLib::Matrix<Neural::ElemType> temp(output.m, output.n);
+	const ConvGeometry geometry(_mat1.GetSize(), _flipped.GetSize(), padding, _stride, output, _dilation);
+	Convolution::Correlate(_mat1.Data(), geometry, _flipped.Data(), ElemType(0), temp.Data());
 	return temp;
 }
 
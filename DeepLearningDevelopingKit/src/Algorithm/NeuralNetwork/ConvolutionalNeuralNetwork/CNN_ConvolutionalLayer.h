@@ -12,6 +12,8 @@
 #include "..\ActivationFunction.h"
 #include "..\LossFunction.h"
 #include "CNN_PaddingLayer.h"
+#include "CNN_Convolution.h"
+#include "CNN_Winograd.hpp"
 
 /***************************************************************************************************/
 // Namespace : Neural 
@@ -22,12 +24,43 @@ namespace Neural
 	/// Mainly using float and double.
 	typedef double ElemType;
 
+	// Algorithm used by the forward propagation of a ConvLayer.
+	/// Direct : per pixel sliding window on a padded copy of every input, the reference implementation.
+	/// Im2col : the inputs are lowered into a column matrix, all kernels are applied by one GEMM.
+	/// Winograd2x2, Winograd4x4 : Winograd F(2x2, 3x3) and F(4x4, 3x3), only for undilated 3x3 kernels
+	/// at stride 1, other layers fall back to Im2col. Not faster than Im2col for this layer : the input is
+	/// averaged into one channel, so the output transform of every kernel, which Winograd otherwise shares
+	/// over the input channels, costs what the elementwise stage saves (Winograd_test : 64x64, 10 kernels,
+	/// Im2col 0.40 ms, F2x2 0.40 ms, F4x4 0.43 ms, and both slower at 8x8). Auto never selects them.
+	/// FFT : the input is transformed once and multiplied with the cached spectrum of every kernel,
+	/// for large feature maps and kernels of 7x7 and above.
+	/// DirectTiled : register tiled SIMD sliding window specialized for undilated square 3x3, 5x5 and 7x7
+	/// kernels at stride 1, other layers fall back to Im2col.
+	/// Auto : DirectTiled where it beats Im2col (small feature maps), FFT for large maps with large kernels,
+	/// Im2col otherwise.
+	/// Every algorithm but Direct runs 1x1 kernels at stride 1 as Im2col without the lowering : the averaged
+	/// input is already the column matrix, the forward and backward propagation are kernels x 1 GEMMs on it.
+	/// The channels are averaged rather than weighted, so the kernels x channels weight matrix of a 1x1 layer
+	/// is rank one (kernel / channels in every column) and a GEMM over the raw channels costs channels times
+	/// as much for the same result ; averaging first is the cheaper order.
+	enum class ConvolutionAlgorithm {
+		Direct,
+		Im2col,
+		Winograd2x2,
+		Winograd4x4,
+		FFT,
+		DirectTiled,
+		Auto
+	};
+
 	// Convolutional Layer Initor
 	/// Used for initialization of a ConvLayer.
 	struct ConvLayerInitor
 	{
 		// Stride
 		size_t Stride;
+		// Dilation, the distance between two taps of the kernel on the input.
+		size_t Dilation = 1;
 		// The numner of kernels.
 		size_t KernelNum;
 		// Size of input matrix. 
@@ -40,11 +73,16 @@ namespace Neural
 		PaddingNum PaddingNum;
 		// Activation Function
 		ActivationFunction ActivationFunction;
+		// Convolution algorithm
+		/// Auto by default, so layers take DirectTiled or FFT wherever they beat Im2col.
+		ConvolutionAlgorithm Algorithm = ConvolutionAlgorithm::Auto;
 	};
 
 	// Define Kernel and Feature.
 	typedef MathLib::Matrix<ElemType> ConvKernel;
 	typedef MathLib::Matrix<ElemType> ConvFeature;
+	// A batch of samples, every sample a list of channels.
+	typedef std::vector<std::vector<MathLib::Matrix<ElemType>>> FeatureBatch;
 
 	/***************************************************************************************************/
 	// Struct : ConvNode
@@ -89,6 +127,9 @@ namespace Neural
 	/// Used for extracting features out of input.
 	class ConvolutionalLayer
 	{
+		// The fused layer drives the forward propagation of its ConvolutionalLayer itself.
+		friend class FusedConvPoolLayer;
+
 	public: // Constructors
 
 		// Invoke constructor
@@ -96,7 +137,9 @@ namespace Neural
 
 	public: // Getter
 
-		inline const ConvFeature GetFeature(const size_t _index) const { return _convNodes.at(_index).kernel; }
+		/// Matrix copies share their buffer (copy-on-write), so getters returning
+		/// features and kernels only copy handles, never elements.
+		inline const ConvFeature GetFeature(const size_t _index) const { return _convNodes.at(_index).feature; }
 		inline const std::vector<ConvFeature> GetFeatureAll(void) const {
 			std::vector<ConvFeature> features;
 			for (const ConvNode & node : _convNodes)
@@ -112,23 +155,46 @@ namespace Neural
 			return kernels;
 		}
 
-		inline const std::vector<MathLib::Matrix<ElemType>> GetDelta(void) const { return _derivative; }
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetDelta(void) const { return _derivative; }
+
+		// Size of the features.
+		/// Every output position is a window at a multiple of the stride, see ConvGeometry::OutputLength.
+		inline MathLib::Size GetOutputSize(void) const { return _outputSize; }
+
+	public: // Kernel cache
+
+		// Version of the kernels, bumped by every InvalidateKernelCache().
+		inline size_t GetKernelVersion(void) const { return _kernelVersion; }
+		// Kernels rotated by 180°, the direct sliding window correlates with them.
+		const std::vector<ConvKernel> & GetFlippedKernels(void);
+		// Flipped kernels packed into a KernelNum x KernelElements row-major matrix.
+		const ElemType * GetPackedKernels(void);
+		// Winograd transform of the packed kernels, KernelNum x Alpha² (3x3 kernels only).
+		const ElemType * GetWinogradKernels(const WinogradTile _tile);
+		// Spectra of the kernels zero padded to the size of _fftPlan, KernelNum x SpectrumSize().
+		const std::complex<ElemType> * GetKernelSpectra(void);
 
 
 	public: // Setter
 
 		// Set the input of the ConvLayer.
 		void SetInput(const std::vector<MathLib::Matrix<ElemType>> &  _input);
-		// Set the delta propagate back from next layer.
+		// Set the delta propagate back from next layer, one matrix of the output size per kernel.
 		void SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta);
 		// Set the learn rate of the ConvLayer.
 		void SetLearnRate(const double _learnRate);
+		// Set the algorithm used by ForwardPropagation.
+		void SetAlgorithm(const ConvolutionAlgorithm _algorithm);
+		// Bump the kernel version, every cached form of the kernels is rebuilt on its next use.
+		/// Update() does it, call it after writing the kernels of _convNodes directly.
+		void InvalidateKernelCache(void);
 
 	public: // BackPropagation Algorithm
 
 		// ForwardPropagation function
 		void ForwardPropagation(void);
 		// BackwardPropagation function
+		/// Kernel gradient dY * im2col(X)^T and input gradient col2im(W^T * dY), both by GEMM.
 		void BackwardPropagation(void);
 		// Update function
 		void Update(void);
@@ -137,12 +203,85 @@ namespace Neural
 		// Clear the deltaSum of a batch.
 		void BatchDeltaSumClear(void);
 
+	public: // Minibatch
+
+		// Set the input of a batch, every sample a list of channels of the input size.
+		void SetInputBatch(const FeatureBatch & _input);
+		// Set the delta of a batch, every sample one matrix of the output size per kernel.
+		void SetDeltaBatch(const FeatureBatch & _delta);
+		// ForwardPropagation of every sample of the batch.
+		/// Im2col lowers the batch, BatchColumnElements at a time, into a k² x (samples * pixels) column
+		/// matrix, so that a single GEMM applies every kernel to every sample of the chunk and the kernels
+		/// are read once per chunk. DirectTiled pads the chunk and runs every kernel on it from L1 in one
+		/// parallel loop (see ForwardDirectTiledBatch). Direct, Winograd and FFT run sample by sample on the
+		/// kernel layout they cache.
+		void ForwardPropagationBatch(void);
+		// BackwardPropagation of every sample of the batch, by the same GEMMs on the batched column matrix.
+		/// The kernel and bias deltas are the sums over the batch, BatchDeltaSumUpdate(N) then averages
+		/// them as it does for N single calls.
+		void BackwardPropagationBatch(void);
+		inline const FeatureBatch & GetFeatureBatch(void) const { return _featureBatch; }
+		inline const FeatureBatch & GetDeltaBatch(void) const { return _derivativeBatch; }
+
+	public: // Inference
+
+		// Freeze the layer for inference.
+		/// Releases the kernel gradients, the deltas, the stored input and the work buffers of the backward
+		/// propagation, resolves ConvolutionAlgorithm::Auto and keeps only the kernel layout the resolved
+		/// algorithm reads, built now (FFT spectra depend on the transform size and are built by the first
+		/// forward propagation). BackwardPropagation, Update and the batch delta sums are refused afterwards.
+		void Freeze(void);
+		inline bool IsFrozen(void) const { return _frozen; }
+
 	private: //  Inner working function
 
 		// Set the activation function of the layer.
 		void SetActivationFunction(const ActivationFunction _function);
 		// ConvolutionCal
 		MathLib::Matrix<ElemType> ConvolutionCal(const MathLib::Matrix<ElemType> & _mat1, const MathLib::Matrix<ElemType> &  _mat2);
+		// Same padded sliding window as ConvolutionCal, with a kernel that is already flipped.
+		MathLib::Matrix<ElemType> CorrelationCal(const MathLib::Matrix<ElemType> & _mat1, const MathLib::Matrix<ElemType> & _flipped);
+		// Forward propagation of every algorithm.
+		void ForwardDirect(void);
+		void ForwardIm2col(void);
+		void ForwardWinograd(const WinogradTile _tile);
+		void ForwardFFT(void);
+		// Returns false if the layer has no specialized direct kernel.
+		bool ForwardDirectTiled(void);
+		// DirectTiled on the whole batch, the layer must resolve to ConvolutionAlgorithm::DirectTiled.
+		/// The averaged inputs are padded BatchColumnElements at a time and every chunk is one
+		/// Convolution::DirectTiledBatch, which writes the features of the batch with their bias.
+		void ForwardDirectTiledBatch(const ConvGeometry & _geometry);
+		// Algorithm picked by ConvolutionAlgorithm::Auto for the shape of the layer.
+		ConvolutionAlgorithm AutoAlgorithm(void) const;
+		// Add the bias to the responses of every kernel and store them as features.
+		void StoreFeatures(const ElemType * _responses, const ConvGeometry & _geometry);
+		// Geometry of the forward convolution.
+		ConvGeometry ForwardGeometry(void) const;
+		// Average of the input channels.
+		/// Every kernel is shared by all input channels and the responses are averaged, so by linearity
+		/// the lowered algorithms convolve the averaged input once instead of every channel.
+		void AverageInput(ElemType * _average) const;
+		void AverageInput(const std::vector<MathLib::Matrix<ElemType>> & _channels, ElemType * _average) const;
+		// Algorithm ForwardPropagation runs, Auto and the fallbacks resolved.
+		ConvolutionAlgorithm ResolvedAlgorithm(void) const;
+		// Whether the kernels are 1x1 at stride 1.
+		/// Such a layer has no padding and reads every input pixel once, im2col and col2im are the identity.
+		bool IsPointwise(void) const;
+		// Average _channels and lower them into _column, whose rows are _columnStride apart (0 for the pixels).
+		/// Pointwise layers average straight into the column matrix, which is a single row.
+		void LowerInput(const std::vector<MathLib::Matrix<ElemType>> & _channels, const ConvGeometry & _geometry, ElemType * _column,
+			const size_t _columnStride = 0);
+		// Samples of the batch lowered at once, see BatchColumnElements.
+		size_t BatchChunk(const ConvGeometry & _geometry) const;
+		// Lower the averaged inputs of samples [_first, _first + _count) into _column, k² x (_count * pixels).
+		void LowerBatch(const ConvGeometry & _geometry, const size_t _first, const size_t _count);
+		// Kernel and bias deltas, and the column delta, from the _columns wide _outputDelta and _column.
+		/// _accumulate adds the kernel and bias deltas to those of the last call.
+		void LowerDelta(const size_t _columns, const bool _accumulate = false);
+		// Fold the column delta of one sample back into _delta, one shared matrix per input channel.
+		void StoreDelta(const ElemType * _columnDelta, const ConvGeometry & _geometry, const size_t _columnStride,
+			const size_t _channelNum, std::vector<MathLib::Matrix<ElemType>> & _delta);
 
 	private: //  Math stuff you know
 
@@ -181,23 +320,77 @@ namespace Neural
 		MathLib::Size _kernelSize;
 		// The size of stride.
 		size_t _stride;
+		// The dilation of the kernels.
+		size_t _dilation;
 
 		// Padding method
 		PaddingMethod _paddingMethod;
 		PaddingNum _paddingNum;
 		// Padding size
+		/// Dilation * floor(kernel / 2) on every side, odd kernels keep the input size at stride 1.
 		size_t _paddingM;
 		size_t _paddingN;
 
+		// Delta of every input channel, the gradient of the loss with respect to the input.
+		/// The channels share one buffer (copy-on-write), they all receive the same share of the average.
 		std::vector<MathLib::Matrix<ElemType>> _derivative;
+		// Delta of every feature, set by the next layer.
 		std::vector<MathLib::Matrix<ElemType>> _derivativeLastLayer;
 
 		// Learning rate
 		/// Default value is 1
 		double learnRate = 1;
 
+		// Convolution algorithm
+		ConvolutionAlgorithm _algorithm;
+		// Thresholds of ConvolutionAlgorithm::Auto, measured on the ConvAlgorithm test :
+		/// DirectTiled beats Im2col 1.2 to 1.6 times for 3x3 to 7x7 kernels on maps from 32x32 to 448x448
+		/// (8x8 maps are a tie),
+		/// larger maps were not measured and stay on Im2col. FFT wins from 9x9 kernels on 64x64 maps.
+		static const size_t AutoDirectTiledPixels = 448 * 448;
+		static const size_t AutoFFTKernelElements = 9 * 9;
+		static const size_t AutoFFTPixels = 64 * 64;
+		// Elements of the column matrix of a batch chunk, 256 kB of doubles : the backward propagation also
+		/// holds the column delta and the output delta of the chunk, 1 MB chunks pushed the three out of L2
+		/// and ran slower than single samples. Also bounds the padded inputs of a DirectTiled chunk.
+		static const size_t BatchColumnElements = 32 * 1024;
+		// Work buffers of the lowered algorithms, kept between calls to avoid allocations.
+		std::vector<ElemType> _averageInput;
+		std::vector<ElemType> _padded;
+		std::vector<ElemType> _column;
+		std::vector<ElemType> _output;
+		Winograd<ElemType> _winograd;
+		MathLib::RealFFT2D<ElemType> _fftPlan;
+		std::vector<ElemType> _fftBuffer;
+		std::vector<std::complex<ElemType>> _inputSpectrum;
+		std::vector<std::complex<ElemType>> _productSpectrum;
+		// Work buffers of the backward propagation.
+		std::vector<ElemType> _outputDelta;
+		std::vector<ElemType> _kernelGradient;
+		std::vector<ElemType> _columnDelta;
+
+		// Minibatch
+		/// Sample n of _featureBatch holds one feature per kernel, of _derivativeBatch one delta per input
+		/// channel (the channels share one buffer like _derivative).
+		FeatureBatch _inputBatch;
+		FeatureBatch _featureBatch;
+		FeatureBatch _derivativeLastLayerBatch;
+		FeatureBatch _derivativeBatch;
+
+		// Kernel cache
+		/// Every derived form of the kernels is built lazily by its getter and reused until
+		/// the kernel version moves on, which only InvalidateKernelCache() (and so Update()) does.
+		size_t _kernelVersion = 0;
+		KernelCacheEntry<ConvKernel> _flippedKernels;
+		KernelCacheEntry<ElemType> _packedKernels;
+		KernelCacheEntry<ElemType> _winogradKernels;
+		KernelCacheEntry<std::complex<ElemType>> _kernelSpectra;
+
 		// Activation Function
 		ElemType(*activationFunction)(ElemType x);
 		ElemType(*activationFunctionDerivative)(ElemType x);
+
+		// Whether the layer was frozen for inference.
+		bool _frozen = false;
 	};
 }
\ No newline at end of file
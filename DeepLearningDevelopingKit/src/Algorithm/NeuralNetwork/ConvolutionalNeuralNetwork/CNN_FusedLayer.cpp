@@ -0,0 +1,414 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	        Fused Conv Pool Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN_FusedLayer.h"
+
+Neural::FusedConvPoolLayer::FusedConvPoolLayer(const FusedLayerInitor & _initor)
+	: _conv(_initor.Conv)
+{
+	this->_poolingMethod = _initor.Pool.PoolingMethod;
+	this->_poolSize = _initor.Pool.PoolSize;
+	this->_poolStride = std::max<size_t>(_initor.Pool.Stride, 1);
+	this->_convSize = _conv.GetOutputSize();
+	this->_training = _initor.Training;
+	this->_activationKernel = GetActivationKernel(_conv.activationFunction);
+
+	// Same geometry as a PoolingLayer on the convolution output.
+	this->_outputSize.m = _convSize.m / _poolStride;
+	this->_outputSize.n = _convSize.n / _poolStride;
+	this->_poolOffset = Pad::Offset(_initor.Pool.PaddingMethod, _convSize.m - _poolStride * _outputSize.m, _convSize.n - _poolStride * _outputSize.n);
+	if (!Pad::IsConstant(_initor.Pool.PaddingNum))
+		std::cerr << "ERROR : FusedLayer only supports constant pool padding, zero padding is used." << std::endl;
+	this->_poolPadding = Pad::IsConstant(_initor.Pool.PaddingNum) ? Pad::Value(_initor.Pool.PaddingNum) : 0;
+}
+
+void Neural::FusedConvPoolLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input)
+{
+	_conv.SetInput(_input);
+}
+
+void Neural::FusedConvPoolLayer::SetDelta(const std::vector<Feature> & _delta)
+{
+	this->_delta = _delta;
+}
+
+void Neural::FusedConvPoolLayer::SetTraining(const bool _training)
+{
+	if (_training && _conv.IsFrozen())
+	{
+		std::cerr << "ERROR : FusedLayer is frozen, no training." << std::endl;
+		return;
+	}
+	this->_training = _training;
+	if (!_training)
+	{
+		std::vector<int>().swap(_argmax);
+		std::vector<ElemType>().swap(_derivative);
+		std::vector<std::vector<int>>().swap(_argmaxBatch);
+		std::vector<std::vector<ElemType>>().swap(_derivativeBatch);
+	}
+}
+
+void Neural::FusedConvPoolLayer::ForwardPropagation(void)
+{
+	if (_conv._input.empty())
+	{
+		std::cerr << "ERROR : FusedLayer forward propagation without input." << std::endl;
+		return;
+	}
+	const size_t kernelNum = _conv._convNodeNum;
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	const ConvGeometry geometry = _conv.ForwardGeometry();
+	_averageInput.resize(_conv._inputSize.m * _conv._inputSize.n);
+	_conv.AverageInput(_averageInput.data());
+	// The SIMD direct kernels read a zero padded copy of the input.
+	const size_t direct = geometry.Stride == 1 && geometry.Dilation == 1 && geometry.Kernel.m == geometry.Kernel.n
+		&& (geometry.Kernel.m == 3 || geometry.Kernel.m == 5 || geometry.Kernel.m == 7) ? geometry.Kernel.m : 0;
+	if (direct != 0)
+	{
+		_padded.resize((geometry.Output.m + direct - 1) * (geometry.Output.n + direct - 1));
+		Convolution::PadRows(_averageInput.data(), geometry, _padded.data());
+	}
+	const ElemType * packed = _conv.GetPackedKernels();
+	// Outputs are detached here, before the bands of a kernel write to them in parallel.
+	_output.resize(kernelNum);
+	std::vector<ElemType *> outputs(kernelNum);
+	for (size_t k = 0; k < kernelNum; k++)
+	{
+		if (_output.at(k).ColumeSize() != _outputSize.m || _output.at(k).RowSize() != _outputSize.n)
+			_output.at(k).Init(_outputSize.m, _outputSize.n);
+		outputs[k] = _output.at(k).Data();
+	}
+	if (_training)
+	{
+		const bool mean = _poolingMethod == PoolingMethod::MeanPooling;
+		_argmax.resize(mean ? 0 : kernelNum * pixels);
+		_derivative.assign(mean ? kernelNum * _convSize.m * _convSize.n : kernelNum * pixels, ElemType(0));
+	}
+
+	// Work items are (group of GroupSize kernels, band of pooled rows) pairs.
+	const size_t bandRows = BandRows();
+	const size_t bandNum = (_outputSize.m + bandRows - 1) / bandRows;
+	const size_t groupNum = (kernelNum + GroupSize - 1) / GroupSize;
+	MathLib::ParallelFor(0, groupNum * bandNum, [&](size_t _itemBegin, size_t _itemEnd) {
+		std::vector<ElemType> tile;
+		for (size_t item = _itemBegin; item < _itemEnd; item++)
+		{
+			const size_t kernelBegin = (item / bandNum) * GroupSize, band = item % bandNum;
+			ForwardBand(kernelBegin, std::min(kernelNum, kernelBegin + GroupSize), direct, packed, outputs.data(),
+				band * bandRows, std::min(_outputSize.m, (band + 1) * bandRows), tile);
+		}
+	}, MathLib::ThreadPool::Grain(TileElements * _conv._kernelSize.m * _conv._kernelSize.n));
+	if (_poolingMethod == PoolingMethod::RandomPooling)
+		_randomSeed++;
+}
+
+void Neural::FusedConvPoolLayer::ForwardBand(const size_t _kernelBegin, const size_t _kernelEnd, const size_t _direct, const ElemType * _packed,
+	ElemType * const * _outputs, const size_t _rowBegin, const size_t _rowEnd, std::vector<ElemType> & _tile)
+{
+	const long long convM = _convSize.m, convN = _convSize.n;
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	const size_t kernelNum = _kernelEnd - _kernelBegin;
+	const ConvGeometry geometry = _conv.ForwardGeometry();
+	// Convolution rows [top, bottom) are read by the windows of the band, kernel g keeps them at tile + g * tileStride.
+	const long long top = std::max(0LL, (long long)(_rowBegin * _poolStride) - (long long)_poolOffset.m);
+	const long long bottom = std::min(convM, (long long)((_rowEnd - 1) * _poolStride + _poolSize.m) - (long long)_poolOffset.m);
+	const size_t tileStride = bottom > top ? (bottom - top) * convN : 0;
+	_tile.resize(kernelNum * tileStride);
+	if (bottom > top)
+	{
+		const ElemType * packed = _packed + _kernelBegin * geometry.KernelElements();
+		switch (_direct)
+		{
+		case 3:
+			Convolution::DirectRows<3>(_padded.data(), geometry, packed, kernelNum, top, bottom, _tile.data(), tileStride);
+			break;
+		case 5:
+			Convolution::DirectRows<5>(_padded.data(), geometry, packed, kernelNum, top, bottom, _tile.data(), tileStride);
+			break;
+		case 7:
+			Convolution::DirectRows<7>(_padded.data(), geometry, packed, kernelNum, top, bottom, _tile.data(), tileStride);
+			break;
+		default:
+			for (size_t g = 0; g < kernelNum; g++)
+				Convolution::CorrelateRows(_averageInput.data(), geometry, packed + g * geometry.KernelElements(), ElemType(0), top, bottom, _tile.data() + g * tileStride);
+			break;
+		}
+		for (size_t g = 0; g < kernelNum; g++)
+		{
+			const ElemType bias = _conv._convNodes.at(_kernelBegin + g).bias;
+			ElemType * tile = _tile.data() + g * tileStride;
+			for (size_t e = 0; e < tileStride; e++)
+				tile[e] += bias;
+		}
+		if (_activationKernel != nullptr)
+			_activationKernel(_tile.data(), _tile.size());
+		else
+			for (ElemType & x : _tile)
+				x = _conv.activationFunction(x);
+	}
+
+	const bool mean = _poolingMethod == PoolingMethod::MeanPooling;
+	const bool extreme = _poolingMethod == PoolingMethod::MaxPooling || _poolingMethod == PoolingMethod::MinPooling;
+	const bool isMax = _poolingMethod == PoolingMethod::MaxPooling;
+	const bool square = _poolSize.m == _poolSize.n && _poolSize.m >= 2 && _poolSize.m <= 4;
+	const ElemType area = ElemType(_poolSize.m * _poolSize.n);
+	// Output columns [bBegin, bEnd) have windows inside the convolution output horizontally.
+	size_t bBegin = 0, bEnd = _outputSize.n;
+	while (bBegin < _outputSize.n && bBegin * _poolStride < _poolOffset.n)
+		bBegin++;
+	while (bEnd > bBegin && (long long)((bEnd - 1) * _poolStride + _poolSize.n) - (long long)_poolOffset.n > convN)
+		bEnd--;
+	std::vector<int> rowArgmax(_outputSize.n);
+	for (size_t g = 0; g < kernelNum; g++)
+	{
+		const size_t k = _kernelBegin + g;
+		const ElemType * tile = _tile.data() + g * tileStride;
+		MathLib::RandomStream random(_randomSeed, k * _outputSize.m + _rowBegin);
+		for (size_t a = _rowBegin; a < _rowEnd; a++)
+		{
+			const long long m = (long long)(a * _poolStride) - (long long)_poolOffset.m;
+			const bool rowInside = m >= 0 && m + (long long)_poolSize.m <= convM;
+			ElemType * output = _outputs[k] + a * _outputSize.n;
+			// Windows inside the tile go through the SIMD rows of the PoolingLayer, indices relative to the tile.
+			const bool fast = extreme && square && rowInside && bEnd > bBegin;
+			if (fast)
+			{
+				const size_t count = bEnd - bBegin, n = bBegin * _poolStride - _poolOffset.n;
+				const size_t tileM = m - top;
+				switch (_poolSize.m * 2 + (isMax ? 1 : 0))
+				{
+				case 4: PoolingLayer::ExtremePoolRow<2, false>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				case 5: PoolingLayer::ExtremePoolRow<2, true>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				case 6: PoolingLayer::ExtremePoolRow<3, false>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				case 7: PoolingLayer::ExtremePoolRow<3, true>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				case 8: PoolingLayer::ExtremePoolRow<4, false>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				default: PoolingLayer::ExtremePoolRow<4, true>(tile, convN, tileM, n, _poolStride, count, output + bBegin, rowArgmax.data() + bBegin); break;
+				}
+				for (size_t c = bBegin; c < bEnd; c++)
+					rowArgmax[c] += int(top * convN);
+			}
+			for (size_t b = 0; b < _outputSize.n; b++)
+			{
+				if (fast && b >= bBegin && b < bEnd)
+					continue;
+				const long long n = (long long)(b * _poolStride) - (long long)_poolOffset.n;
+				ElemType result = 0;
+				int index = -1;
+				if (mean)
+				{
+					for (long long i = m; i < m + (long long)_poolSize.m; i++)
+						for (long long j = n; j < n + (long long)_poolSize.n; j++)
+							result += i >= 0 && i < convM && j >= 0 && j < convN ? tile[(i - top) * convN + j] : _poolPadding;
+					result /= area;
+				}
+				else if (_poolingMethod == PoolingMethod::RandomPooling)
+				{
+					const uint64_t pick = random.Next() % (_poolSize.m * _poolSize.n);
+					const long long i = m + (long long)(pick / _poolSize.n), j = n + (long long)(pick % _poolSize.n);
+					const bool inside = i >= 0 && i < convM && j >= 0 && j < convN;
+					result = inside ? tile[(i - top) * convN + j] : _poolPadding;
+					index = inside ? int(i * convN + j) : -1;
+				}
+				else
+				{
+					// Max or min, ties keep the first position in row-major order.
+					bool first = true;
+					for (long long i = m; i < m + (long long)_poolSize.m; i++)
+						for (long long j = n; j < n + (long long)_poolSize.n; j++)
+						{
+							const bool inside = i >= 0 && i < convM && j >= 0 && j < convN;
+							const ElemType value = inside ? tile[(i - top) * convN + j] : _poolPadding;
+							if (first || (isMax ? value > result : value < result))
+							{
+								first = false;
+								result = value;
+								index = inside ? int(i * convN + j) : -1;
+							}
+						}
+				}
+				output[b] = result;
+				rowArgmax[b] = index;
+			}
+			if (_training && !mean)
+			{
+				int * argmax = _argmax.data() + k * pixels + a * _outputSize.n;
+				ElemType * derivative = _derivative.data() + k * pixels + a * _outputSize.n;
+				for (size_t c = 0; c < _outputSize.n; c++)
+				{
+					argmax[c] = rowArgmax[c];
+					derivative[c] = rowArgmax[c] >= 0 ? _conv.activationFunctionDerivative(tile[rowArgmax[c] - top * convN]) : 0;
+				}
+			}
+		}
+
+		// Mean pooling keeps the derivative of the convolution rows this band owns, bands overlap on the rest.
+		if (_training && mean && bottom > top)
+		{
+			const long long ownBegin = _rowBegin == 0 ? top : std::max(top, (long long)(_rowBegin * _poolStride) - (long long)_poolOffset.m);
+			const long long ownEnd = _rowEnd == _outputSize.m ? bottom : std::min(bottom, (long long)(_rowEnd * _poolStride) - (long long)_poolOffset.m);
+			ElemType * derivative = _derivative.data() + k * convM * convN;
+			for (long long e = ownBegin * convN; e < ownEnd * convN; e++)
+				derivative[e] = _conv.activationFunctionDerivative(tile[e - top * convN]);
+		}
+	}
+}
+
+size_t Neural::FusedConvPoolLayer::BandRows(void) const
+{
+	const size_t tileRows = std::max<size_t>(_poolSize.m, TileElements / (GroupSize * std::max<size_t>(1, _convSize.n)));
+	return std::max<size_t>(1, (tileRows - _poolSize.m) / _poolStride + 1);
+}
+
+void Neural::FusedConvPoolLayer::BackwardPropagation(void)
+{
+	const size_t kernelNum = _conv._convNodeNum;
+	const bool mean = _poolingMethod == PoolingMethod::MeanPooling;
+	if (!_training || _delta.size() < kernelNum || (mean ? _derivative.empty() : _argmax.empty()))
+	{
+		std::cerr << "ERROR : FusedLayer backward propagation without training forward propagation or delta." << std::endl;
+		return;
+	}
+	RouteDelta();
+	_conv.SetDelta(_convDelta);
+	_conv.BackwardPropagation();
+}
+
+void Neural::FusedConvPoolLayer::RouteDelta(void)
+{
+	const size_t kernelNum = _conv._convNodeNum;
+	const bool mean = _poolingMethod == PoolingMethod::MeanPooling;
+	const long long convM = _convSize.m, convN = _convSize.n;
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	const ElemType area = ElemType(_poolSize.m * _poolSize.n);
+	_convDelta.resize(kernelNum);
+	MathLib::ParallelFor(0, kernelNum, [&](size_t _kernelBegin, size_t _kernelEnd) {
+		for (size_t k = _kernelBegin; k < _kernelEnd; k++)
+		{
+			MathLib::Matrix<ElemType> & convDeltaMat = _convDelta.at(k);
+			if (convDeltaMat.ColumeSize() != _convSize.m || convDeltaMat.RowSize() != _convSize.n)
+				convDeltaMat.Init(_convSize.m, _convSize.n);
+			ElemType * convDelta = convDeltaMat.Data();
+			std::fill(convDelta, convDelta + convM * convN, ElemType(0));
+			const Feature & deltaMat = _delta.at(k);
+			const ElemType * delta = deltaMat.Data();
+			if (!mean)
+			{
+				const int * argmax = _argmax.data() + k * pixels;
+				const ElemType * derivative = _derivative.data() + k * pixels;
+				for (size_t p = 0; p < pixels; p++)
+					if (argmax[p] >= 0)
+						convDelta[argmax[p]] += delta[p] * derivative[p];
+				continue;
+			}
+			for (size_t a = 0; a < _outputSize.m; a++)
+			{
+				const long long m = (long long)(a * _poolStride) - (long long)_poolOffset.m;
+				for (size_t b = 0; b < _outputSize.n; b++)
+				{
+					const long long n = (long long)(b * _poolStride) - (long long)_poolOffset.n;
+					const ElemType share = delta[a * _outputSize.n + b] / area;
+					for (long long i = std::max(0LL, m); i < std::min(convM, m + (long long)_poolSize.m); i++)
+						for (long long j = std::max(0LL, n); j < std::min(convN, n + (long long)_poolSize.n); j++)
+							convDelta[i * convN + j] += share;
+				}
+			}
+			const ElemType * derivative = _derivative.data() + k * convM * convN;
+			for (long long e = 0; e < convM * convN; e++)
+				convDelta[e] *= derivative[e];
+		}
+	});
+}
+
+void Neural::FusedConvPoolLayer::Update(void)
+{
+	_conv.Update();
+}
+
+void Neural::FusedConvPoolLayer::SetInputBatch(const FeatureBatch & _input)
+{
+	_conv.SetInputBatch(_input);
+}
+
+void Neural::FusedConvPoolLayer::SetDeltaBatch(const FeatureBatch & _delta)
+{
+	this->_deltaBatch = _delta;
+}
+
+void Neural::FusedConvPoolLayer::ForwardPropagationBatch(void)
+{
+	const size_t batchSize = _conv._inputBatch.size();
+	_outputBatch.resize(batchSize);
+	if (_training)
+	{
+		_argmaxBatch.resize(batchSize);
+		_derivativeBatch.resize(batchSize);
+	}
+	for (size_t n = 0; n < batchSize; n++)
+	{
+		// The buffers of sample n are lent to the single propagation.
+		_conv._input = Feature::Handles(_conv._inputBatch[n]);
+		std::swap(_output, _outputBatch[n]);
+		if (_training)
+		{
+			std::swap(_argmax, _argmaxBatch[n]);
+			std::swap(_derivative, _derivativeBatch[n]);
+		}
+		ForwardPropagation();
+		std::swap(_output, _outputBatch[n]);
+		if (_training)
+		{
+			std::swap(_argmax, _argmaxBatch[n]);
+			std::swap(_derivative, _derivativeBatch[n]);
+		}
+	}
+}
+
+void Neural::FusedConvPoolLayer::BackwardPropagationBatch(void)
+{
+	const size_t batchSize = _deltaBatch.size();
+	const size_t kernelNum = _conv._convNodeNum;
+	if (!_training || batchSize == 0 || _derivativeBatch.size() != batchSize || _conv._inputBatch.size() != batchSize)
+	{
+		std::cerr << "ERROR : FusedLayer batch backward propagation without training forward propagation or delta." << std::endl;
+		return;
+	}
+	_convDeltaBatch.resize(batchSize);
+	for (size_t n = 0; n < batchSize; n++)
+	{
+		if (_deltaBatch[n].size() < kernelNum)
+		{
+			std::cerr << "ERROR : FusedLayer batch backward propagation without delta." << std::endl;
+			return;
+		}
+		_delta = Feature::Handles(_deltaBatch[n]);
+		std::swap(_argmax, _argmaxBatch[n]);
+		std::swap(_derivative, _derivativeBatch[n]);
+		std::swap(_convDelta, _convDeltaBatch[n]);
+		RouteDelta();
+		std::swap(_argmax, _argmaxBatch[n]);
+		std::swap(_derivative, _derivativeBatch[n]);
+		std::swap(_convDelta, _convDeltaBatch[n]);
+	}
+	_conv._derivativeLastLayerBatch.resize(batchSize);
+	for (size_t n = 0; n < batchSize; n++)
+		_conv._derivativeLastLayerBatch[n] = MathLib::Matrix<ElemType>::Handles(_convDeltaBatch[n]);
+	_conv.BackwardPropagationBatch();
+}
+
+void Neural::FusedConvPoolLayer::Freeze(void)
+{
+	SetTraining(false);
+	_conv.SetAlgorithm(ConvolutionAlgorithm::Im2col);
+	_conv.Freeze();
+	std::vector<Feature>().swap(_delta);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_convDelta);
+	FeatureBatch().swap(_deltaBatch);
+	FeatureBatch().swap(_convDeltaBatch);
+}
@@ -0,0 +1,170 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	        Fused Conv Pool Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include "CNN_ConvolutionalLayer.h"
+#include "CNN_PoolingLayer.h"
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	// Fused Layer Initor
+	/// Used for initialization of a FusedConvPoolLayer.
+	struct FusedLayerInitor
+	{
+		// The convolution, its ActivationFunction is applied before pooling.
+		ConvLayerInitor Conv;
+		// The pooling, InputSize is ignored and taken from the output of the convolution.
+		/// Random padding is not supported, the padding has to be zero or one.
+		PoolLayerInitor Pool;
+		// Whether the forward propagation keeps what the backward propagation needs.
+		bool Training = false;
+	};
+
+	/***************************************************************************************************/
+	// Class : Fused Conv Pool Layer
+	/// Convolution, bias, activation and pooling in one pass : every work item computes a band of
+	/// convolution rows of a group of kernels into a tile that stays in L1, activates it and pools it,
+	/// so the feature maps of the convolution are never written out. Undilated square 3x3, 5x5 and 7x7
+	/// kernels at stride 1 use the SIMD rows of Convolution::DirectTiled.
+	/// In training mode the layer keeps the position and the activation derivative of the element every
+	/// window passed on (the derivative of every pixel for mean pooling), nothing else.
+	/// Equal to ConvolutionalLayer -> ProcessLayer -> PoolingLayer, and to ConvolutionalLayer -> PoolingLayer
+	/// -> ProcessLayer for max and min pooling with a monotonic activation.
+	class FusedConvPoolLayer
+	{
+	public: // Constructors
+
+		// Invoke constructor
+		FusedConvPoolLayer(const FusedLayerInitor & _initor);
+
+	public: // Getter
+
+		// The convolutional layer holding the kernels, biases and gradients.
+		inline ConvolutionalLayer & GetConvLayer(void) { return _conv; }
+		inline const Feature GetFeature(const size_t _index) const { return _output.at(_index); }
+		inline const std::vector<Feature> & GetFeatureAll(void) const { return _output; }
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetDelta(void) const { return _conv.GetDelta(); }
+		inline MathLib::Size GetOutputSize(void) const { return _outputSize; }
+		// Bytes kept by the forward propagation for the backward propagation.
+		inline size_t GetSavedBytes(void) const
+		{
+			size_t bytes = _argmax.size() * sizeof(int) + _derivative.size() * sizeof(ElemType);
+			for (size_t n = 0; n < _argmaxBatch.size(); n++)
+				bytes += _argmaxBatch[n].size() * sizeof(int);
+			for (size_t n = 0; n < _derivativeBatch.size(); n++)
+				bytes += _derivativeBatch[n].size() * sizeof(ElemType);
+			return bytes;
+		}
+
+	public: // Setter
+
+		// Set the input of the layer.
+		void SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input);
+		// Set the delta propagate back from next layer, one matrix of the output size per kernel.
+		void SetDelta(const std::vector<Feature> & _delta);
+		// Switch between training and inference.
+		/// Leaving training mode releases the saved state.
+		void SetTraining(const bool _training);
+
+	public: // BackPropagation Algorithm
+
+		// ForwardPropagation function
+		void ForwardPropagation(void);
+		// BackwardPropagation function
+		/// Only in training mode : the pooled delta is routed through the saved positions and derivatives
+		/// to the convolution output, then the ConvolutionalLayer propagates it.
+		void BackwardPropagation(void);
+		// Update function
+		void Update(void);
+
+	public: // Minibatch
+
+		void SetInputBatch(const FeatureBatch & _input);
+		void SetDeltaBatch(const FeatureBatch & _delta);
+		// ForwardPropagation of every sample of the batch.
+		/// The fused pass already keeps the kernels of a group in L1 over a band, the samples run one
+		/// by one and keep their saved state apart.
+		void ForwardPropagationBatch(void);
+		// BackwardPropagation of every sample of the batch.
+		/// The deltas are routed sample by sample, then the ConvolutionalLayer propagates the whole
+		/// batch at once.
+		void BackwardPropagationBatch(void);
+		inline const FeatureBatch & GetFeatureBatch(void) const { return _outputBatch; }
+		inline const FeatureBatch & GetDeltaBatch(void) const { return _conv.GetDeltaBatch(); }
+
+	public: // Inference
+
+		// Freeze the layer for inference.
+		/// Leaves training mode for good, freezes the ConvolutionalLayer on the packed kernels the fused
+		/// pass reads and releases the deltas. BackwardPropagation and Update are refused afterwards.
+		void Freeze(void);
+		inline bool IsFrozen(void) const { return _conv.IsFrozen(); }
+
+	private: // Inner working function
+
+		// Pooled rows [_rowBegin, _rowEnd) of the kernels [_kernelBegin, _kernelEnd).
+		/// _direct is the size of the SIMD direct kernel to use, 0 for the generic sliding window.
+		void ForwardBand(const size_t _kernelBegin, const size_t _kernelEnd, const size_t _direct, const ElemType * _packed,
+			ElemType * const * _outputs, const size_t _rowBegin, const size_t _rowEnd, std::vector<ElemType> & _tile);
+		// Pooled rows per band, so that the convolution rows of a band fill about TileElements.
+		size_t BandRows(void) const;
+		// Route _delta through the saved positions and derivatives to _convDelta.
+		void RouteDelta(void);
+
+	public:
+
+		ConvolutionalLayer _conv;
+
+		// Pooling
+		PoolingMethod _poolingMethod;
+		MathLib::Size _poolSize;
+		size_t _poolStride;
+		// Position of the convolution output inside the virtually padded one.
+		MathLib::Size _poolOffset;
+		ElemType _poolPadding;
+		// Size of the convolution output and of the pooled output.
+		MathLib::Size _convSize;
+		MathLib::Size _outputSize;
+
+		bool _training;
+		std::vector<Feature> _output;
+		// Saved for the backward propagation.
+		/// _argmax is the index into the convolution output of the element every window passed on, -1 for
+		/// the padding, and _derivative the activation derivative there. Mean pooling saves no position and
+		/// the derivative of every pixel of the convolution output instead.
+		std::vector<int> _argmax;
+		std::vector<ElemType> _derivative;
+		// Seed of random pooling, moves on at every forward propagation.
+		uint64_t _randomSeed = 0;
+
+		// Delta of the pooled output, and of the convolution output.
+		std::vector<Feature> _delta;
+		std::vector<MathLib::Matrix<ElemType>> _convDelta;
+
+		// Minibatch, one entry per sample.
+		FeatureBatch _outputBatch;
+		std::vector<std::vector<int>> _argmaxBatch;
+		std::vector<std::vector<ElemType>> _derivativeBatch;
+		FeatureBatch _deltaBatch;
+		FeatureBatch _convDeltaBatch;
+
+		// Work buffers
+		std::vector<ElemType> _averageInput;
+		std::vector<ElemType> _padded;
+		ActivationKernel _activationKernel;
+
+		// Kernels per work item, the direct rows compute four kernels per pass over the input.
+		static const size_t GroupSize = 4;
+		// Elements of the convolution tile of one work item, 32 KB of doubles.
+		static const size_t TileElements = 4096;
+	};
+}
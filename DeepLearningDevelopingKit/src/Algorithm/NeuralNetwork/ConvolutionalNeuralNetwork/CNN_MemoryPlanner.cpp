@@ -0,0 +1,133 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	        Memory Planner     	                                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN_MemoryPlanner.h"
+
+size_t Neural::MemoryPlanner::AddTensor(const size_t _elements, const size_t _begin, const size_t _end)
+{
+	_tensors.push_back(Tensor{ _elements, std::min(_begin, _end), std::max(_begin, _end), _tensors.size() });
+	return _tensors.size() - 1;
+}
+
+void Neural::MemoryPlanner::Share(const size_t _tensor, const size_t _base)
+{
+	const size_t root = Root(_base);
+	if (Root(_tensor) != root)
+		_tensors.at(Root(_tensor)).Base = root;
+}
+
+void Neural::MemoryPlanner::Clear(void)
+{
+	_tensors.clear();
+	_arenaOf.clear();
+	_arenaElements.clear();
+}
+
+size_t Neural::MemoryPlanner::Root(size_t _tensor) const
+{
+	while (_tensors.at(_tensor).Base != _tensor)
+		_tensor = _tensors.at(_tensor).Base;
+	return _tensor;
+}
+
+void Neural::MemoryPlanner::Plan(void)
+{
+	// A buffer spans the lifetimes of all the tensors written into it.
+	std::vector<Tensor> buffers(_tensors.size(), Tensor{ 0, SIZE_MAX, 0, 0 });
+	for (size_t t = 0; t < _tensors.size(); t++)
+	{
+		Tensor & buffer = buffers.at(Root(t));
+		buffer.Elements = std::max(buffer.Elements, _tensors.at(t).Elements);
+		buffer.Begin = std::min(buffer.Begin, _tensors.at(t).Begin);
+		buffer.End = std::max(buffer.End, _tensors.at(t).End);
+	}
+	std::vector<size_t> order;
+	for (size_t t = 0; t < _tensors.size(); t++)
+		if (Root(t) == t)
+			order.push_back(t);
+	std::stable_sort(order.begin(), order.end(), [&buffers](size_t _left, size_t _right) {
+		return buffers[_left].Elements > buffers[_right].Elements;
+	});
+
+	_arenaOf.assign(_tensors.size(), SIZE_MAX);
+	_arenaElements.clear();
+	std::vector<std::vector<size_t>> arenaBuffers;
+	for (size_t b : order)
+	{
+		const Tensor & buffer = buffers[b];
+		size_t best = SIZE_MAX;
+		for (size_t a = 0; a < _arenaElements.size(); a++)
+		{
+			bool free = true;
+			for (size_t other : arenaBuffers[a])
+				if (buffers[other].Begin <= buffer.End && buffer.Begin <= buffers[other].End)
+				{
+					free = false;
+					break;
+				}
+			if (!free)
+				continue;
+			// Tightest arena that already fits, otherwise the one that grows the least.
+			if (best == SIZE_MAX)
+				best = a;
+			else
+			{
+				const bool fits = _arenaElements[a] >= buffer.Elements, bestFits = _arenaElements[best] >= buffer.Elements;
+				if (fits != bestFits ? fits : (fits ? _arenaElements[a] < _arenaElements[best] : _arenaElements[a] > _arenaElements[best]))
+					best = a;
+			}
+		}
+		if (best == SIZE_MAX)
+		{
+			best = _arenaElements.size();
+			_arenaElements.push_back(0);
+			arenaBuffers.push_back(std::vector<size_t>());
+		}
+		_arenaElements[best] = std::max(_arenaElements[best], buffer.Elements);
+		arenaBuffers[best].push_back(b);
+		_arenaOf[b] = best;
+	}
+}
+
+size_t Neural::MemoryPlanner::GetPlannedElements(void) const
+{
+	size_t elements = 0;
+	for (size_t arena : _arenaElements)
+		elements += arena;
+	return elements;
+}
+
+size_t Neural::MemoryPlanner::GetTotalElements(void) const
+{
+	size_t elements = 0;
+	for (const Tensor & tensor : _tensors)
+		elements += tensor.Elements;
+	return elements;
+}
+
+size_t Neural::MemoryPlanner::GetPeakElements(void) const
+{
+	size_t lastStep = 0;
+	for (const Tensor & tensor : _tensors)
+		lastStep = std::max(lastStep, tensor.End);
+	size_t peak = 0;
+	for (size_t step = 0; step <= lastStep && !_tensors.empty(); step++)
+	{
+		// In place tensors count once, with the size of their buffer.
+		std::vector<size_t> live(_tensors.size(), 0);
+		for (size_t t = 0; t < _tensors.size(); t++)
+			if (_tensors[t].Begin <= step && step <= _tensors[t].End)
+				live[Root(t)] = std::max(live[Root(t)], _tensors[t].Elements);
+		size_t elements = 0;
+		for (size_t e : live)
+			elements += e;
+		peak = std::max(peak, elements);
+	}
+	return peak;
+}
@@ -0,0 +1,77 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	        Memory Planner     	                                                       */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	/***************************************************************************************************/
+	// Class : Memory Planner
+	/// Assigns tensors to a small set of reused arenas from their lifetimes.
+	/// A tensor is live over the steps [Begin, End] of one iteration, two tensors live at the same
+	/// step never share an arena, and an arena is as large as the largest tensor it holds.
+	/// Tensors written in place of another one (Share) are planned as a single buffer.
+	class MemoryPlanner
+	{
+	public: // Building
+
+		// Add a tensor of _elements live from step _begin to step _end, returns its id.
+		size_t AddTensor(const size_t _elements, const size_t _begin, const size_t _end);
+		// _tensor is written in place of _base, they get the same arena.
+		void Share(const size_t _tensor, const size_t _base);
+		// Remove every tensor and arena.
+		void Clear(void);
+
+		// Assign the arenas.
+		/// Buffers are placed from the largest to the smallest, each one into the arena that fits it
+		/// most tightly among those free over its whole lifetime, a new arena is opened otherwise.
+		void Plan(void);
+
+	public: // Getter
+
+		inline size_t GetTensorNum(void) const { return _tensors.size(); }
+		inline size_t GetTensorElements(const size_t _tensor) const { return _tensors.at(_tensor).Elements; }
+		// Arena of a tensor, valid after Plan().
+		inline size_t GetArena(const size_t _tensor) const { return _arenaOf.at(Root(_tensor)); }
+		inline size_t GetArenaNum(void) const { return _arenaElements.size(); }
+		inline size_t GetArenaElements(const size_t _arena) const { return _arenaElements.at(_arena); }
+		// Elements of all arenas, the memory the plan needs.
+		size_t GetPlannedElements(void) const;
+		// Elements of all tensors, the memory needed without any reuse.
+		size_t GetTotalElements(void) const;
+		// Largest number of elements live at one step, no plan can do better.
+		size_t GetPeakElements(void) const;
+
+	private:
+
+		// Buffer holding _tensor, after following the Share links.
+		size_t Root(size_t _tensor) const;
+
+		struct Tensor
+		{
+			size_t Elements;
+			size_t Begin;
+			size_t End;
+			// Tensor whose buffer this one is written into, itself if none.
+			size_t Base;
+		};
+
+		std::vector<Tensor> _tensors;
+		// Arena of every root tensor.
+		std::vector<size_t> _arenaOf;
+		std::vector<size_t> _arenaElements;
+	};
+}
@@ -6,6 +6,9 @@
 /***************************************************************************************************/
 #pragma once
 
+#include <cstring>
+#include <algorithm>
+
 #include "..\..\..\MathLib\MathLib.h"
 
 /***************************************************************************************************/
@@ -30,6 +33,12 @@ namespace Neural
 		RandomPadding
 	};
 
+	/***************************************************************************************************/
+	// Class : Pad
+	/// Appends paddings to a matrix.
+	/// Layers with constant padding (zero or one) never materialize the padded matrix : their kernels read
+	/// positions outside the input as Value(), with Offset() locating the input inside the virtual padded
+	/// matrix. Padding() and PaddingTo() remain for the cases that need a real copy (random padding).
 	class Pad
 	{
 		// Define the Element datatype.
@@ -37,98 +46,84 @@ namespace Neural
 		typedef double ElemType;
 
 	public:
-		static MathLib::Matrix<ElemType> Padding(const MathLib::Matrix<ElemType> & _input,const PaddingMethod _method,const PaddingNum _num,const size_t _sizeM,const size_t _sizeN)
+		// Padded copy of a matrix.
+		static MathLib::Matrix<ElemType> Padding(const MathLib::Matrix<ElemType> & _input, const PaddingMethod _method, const PaddingNum _num, const size_t _sizeM, const size_t _sizeN)
 		{
-			size_t paddingSizeM = _sizeM;
-			size_t paddingSizeN = _sizeN;
-			size_t inputSizeM = _input.GetSize().m, inputSizeN = _input.GetSize().n;
-			size_t outputSizeM = 0, outputSizeN = 0;
 			MathLib::Matrix<ElemType> output;
-			switch (_method)
-			{
-			case Neural::PaddingMethod::LeftUp:
-				outputSizeM = inputSizeM + paddingSizeM;
-				outputSizeN = inputSizeN + paddingSizeN;
-				output.Init(outputSizeM, outputSizeN);
+			PaddingTo(_input, _method, _num, _sizeM, _sizeN, output);
+			return output;
+		}
 
-				for (size_t i = 0; i < outputSizeM; i++)
-					for (size_t j = 0; j < outputSizeN; j++)
-						if (i < paddingSizeM || j < paddingSizeN)
-							output(i, j) = Pad::PaddingNum(_num);
+		// Padded copy of a matrix into _output.
+		/// _output is only reallocated when its size differs, the input rows are copied with memcpy
+		/// and only the border is filled.
+		static void PaddingTo(const MathLib::Matrix<ElemType> & _input, const PaddingMethod _method, const PaddingNum _num, const size_t _sizeM, const size_t _sizeN, MathLib::Matrix<ElemType> & _output)
+		{
+			const MathLib::Size inputSize = _input.GetSize();
+			const MathLib::Size outputSize = PaddedSize(inputSize, _method, _sizeM, _sizeN);
+			const MathLib::Size offset = Offset(_method, _sizeM, _sizeN);
+			if (_output.ColumeSize() != outputSize.m || _output.RowSize() != outputSize.n)
+				_output.Init(outputSize.m, outputSize.n);
+
+			const ElemType * input = _input.Data();
+			ElemType * output = _output.Data();
+			for (size_t i = 0; i < outputSize.m; i++)
+			{
+				ElemType * row = output + i * outputSize.n;
+				if (i < offset.m || i >= offset.m + inputSize.m)
+				{
+					FillBorder(row, outputSize.n, _num);
+					continue;
+				}
+				FillBorder(row, offset.n, _num);
+				if (inputSize.n > 0)
+					std::memcpy(row + offset.n, input + (i - offset.m) * inputSize.n, inputSize.n * sizeof(ElemType));
+				FillBorder(row + offset.n + inputSize.n, outputSize.n - offset.n - inputSize.n, _num);
+			}
+		}
 
-				for (size_t i = 0; i < inputSizeM; i++)
-					for (size_t j = 0; j < inputSizeN; j++)
-						output(i + paddingSizeM, j + paddingSizeN) = _input(i, j);
+		// Size of the padded matrix.
+		static MathLib::Size PaddedSize(const MathLib::Size _inputSize, const PaddingMethod _method, const size_t _sizeM, const size_t _sizeN)
+		{
+			const size_t sides = _method == PaddingMethod::Surround ? 2 : 1;
+			return MathLib::Size(_inputSize.m + sides * _sizeM, _inputSize.n + sides * _sizeN);
+		}
 
-				break;
+		// Position of the first input element inside the padded matrix.
+		static MathLib::Size Offset(const PaddingMethod _method, const size_t _sizeM, const size_t _sizeN)
+		{
+			switch (_method)
+			{
+			case Neural::PaddingMethod::LeftUp:
+				return MathLib::Size(_sizeM, _sizeN);
 			case Neural::PaddingMethod::LeftDown:
-				outputSizeM = inputSizeM + paddingSizeM;
-				outputSizeN = inputSizeN + paddingSizeN;
-				output.Init(outputSizeM, outputSizeN);
-
-				for (size_t i = 0; i < outputSizeM; i++)
-					for (size_t j = 0; j < outputSizeN; j++)
-						if (i > outputSizeM - paddingSizeM || j < paddingSizeN)
-							output(i, j) = Pad::PaddingNum(_num);
-
-				for (size_t i = 0; i < inputSizeM; i++)
-					for (size_t j = 0; j < inputSizeN; j++)
-						output(i, j + paddingSizeN) = _input(i, j);
-
-				break;
+				return MathLib::Size(0, _sizeN);
 			case Neural::PaddingMethod::RightUp:
-				outputSizeM = inputSizeM + paddingSizeM;
-				outputSizeN = inputSizeN + paddingSizeN;
-				output.Init(outputSizeM, outputSizeN);
-
-				for (size_t i = 0; i < outputSizeM; i++)
-					for (size_t j = 0; j < outputSizeN; j++)
-						if (i < paddingSizeM || j >  outputSizeN - paddingSizeN)
-							output(i, j) = Pad::PaddingNum(_num);
-
-				for (size_t i = 0; i < inputSizeM; i++)
-					for (size_t j = 0; j < inputSizeN; j++)
-						output(i + paddingSizeM, j) = _input(i, j);
-
-				break;
+				return MathLib::Size(_sizeM, 0);
 			case Neural::PaddingMethod::RightDown:
-				outputSizeM = inputSizeM + paddingSizeM;
-				outputSizeN = inputSizeN + paddingSizeN;
-				output.Init(outputSizeM, outputSizeN);
-
-				for (size_t i = 0; i < outputSizeM; i++)
-					for (size_t j = 0; j < outputSizeN; j++)
-						if (i > outputSizeM - paddingSizeM || j > outputSizeN - paddingSizeN)
-							output(i, j) = Pad::PaddingNum(_num);
-
-				for (size_t i = 0; i < inputSizeM; i++)
-					for (size_t j = 0; j < inputSizeN; j++)
-						output(i, j) = _input(i, j);
-
-				break;
+				return MathLib::Size(0, 0);
 			case Neural::PaddingMethod::Surround:
-				outputSizeM = inputSizeM + 2 * paddingSizeM;
-				outputSizeN = inputSizeN + 2 * paddingSizeN;
-				output.Init(outputSizeM, outputSizeN);
-
-				for (size_t i = 0; i < outputSizeM; i++)
-					for (size_t j = 0; j < outputSizeN; j++)
-						if (i < paddingSizeM || j < paddingSizeN)
-							output(i, j) = Pad::PaddingNum(_num);
-
-				for (size_t i = 0; i < inputSizeM; i++)
-					for (size_t j = 0; j < inputSizeN; j++)
-						output(i + paddingSizeM, j + paddingSizeN) = _input(i, j);
-
-				break;
 			default:
-				break;
+				return MathLib::Size(_sizeM, _sizeN);
 			}
-
-			return output;
 		}
 
+		// Whether every padded element has the same value, so the padding can stay virtual.
+		static bool IsConstant(const PaddingNum _num) { return _num != Neural::PaddingNum::RandomPadding; }
+
+		// Value of the padded elements of a constant padding.
+		static ElemType Value(const PaddingNum _num) { return _num == Neural::PaddingNum::OnePadding ? 1 : 0; }
+
 	private:
+		static void FillBorder(ElemType * _data, const size_t _size, const PaddingNum _num)
+		{
+			if (IsConstant(_num))
+				std::fill(_data, _data + _size, Value(_num));
+			else
+				for (size_t j = 0; j < _size; j++)
+					_data[j] = PaddingNum(_num);
+		}
+
 		static ElemType PaddingNum(const PaddingNum _num)
 		{
 			switch (_num)
@@ -148,4 +143,4 @@ namespace Neural
 			}
 		}
 	};
-}
\ No newline at end of file
+}
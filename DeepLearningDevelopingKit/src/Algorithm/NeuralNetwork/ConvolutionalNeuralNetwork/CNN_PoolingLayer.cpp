@@ -31,46 +31,118 @@ void Neural::PoolingLayer::SetDelta(const std::vector<Feature>& _delta)
 	this->_delta = _delta;
 }
 
-Neural::Feature Neural::PoolingLayer::MaxPool(const Feature & _feature)
+void Neural::PoolingLayer::MeanPool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output)
 {
-	Feature tempFeature(_outputSize.m, _outputSize.n,MathLib::MatrixType::Zero);
-	size_t kernelOffsetM = 0;
-	size_t kernelOffsetN = 0;
+	if (_output.ColumeSize() != _outputSize.m || _output.RowSize() != _outputSize.n)
+		_output.Init(_outputSize.m, _outputSize.n);
+	const long long featureM = _feature.ColumeSize(), featureN = _feature.RowSize();
+	const ElemType * feature = _feature.Data();
+	ElemType * output = _output.Data();
+	// _integral(i, j) is the sum of the feature above row i and left of column j.
+	const size_t integralN = featureN + 1;
+	_integral.assign((featureM + 1) * integralN, ElemType(0));
+	for (long long i = 0; i < featureM; i++)
+	{
+		ElemType rowSum = 0;
+		for (long long j = 0; j < featureN; j++)
+		{
+			rowSum += feature[i * featureN + j];
+			_integral[(i + 1) * integralN + j + 1] = _integral[i * integralN + j + 1] + rowSum;
+		}
+	}
+	const ElemType area = ElemType(_poolSize.m * _poolSize.n);
+	for (size_t a = 0; a < _outputSize.m; a++)
+	{
+		const long long m = (long long)(a * _stride) - (long long)_offset.m;
+		const long long top = std::max(0LL, std::min(featureM, m)), bottom = std::max(0LL, std::min(featureM, m + (long long)_poolSize.m));
+		for (size_t b = 0; b < _outputSize.n; b++)
+		{
+			const long long n = (long long)(b * _stride) - (long long)_offset.n;
+			const long long left = std::max(0LL, std::min(featureN, n)), right = std::max(0LL, std::min(featureN, n + (long long)_poolSize.n));
+			const ElemType sum = _integral[bottom * integralN + right] - _integral[top * integralN + right]
+				- _integral[bottom * integralN + left] + _integral[top * integralN + left];
+			const ElemType inside = ElemType((bottom - top) * (right - left));
+			output[a * _outputSize.n + b] = (sum + _padding * (area - inside)) / area;
+		}
+	}
+}
+
+void Neural::PoolingLayer::MeanUnpool(const Feature & _delta, const MathLib::Size _offset, Feature & _depooled)
+{
+	const long long inputM = _depooled.ColumeSize(), inputN = _depooled.RowSize();
+	const ElemType * delta = _delta.Data();
+	ElemType * depooled = _depooled.Data();
+	// Every window adds its share at its four corners, the prefix sums of the table give the delta.
+	const size_t integralN = inputN + 1;
+	_integral.assign((inputM + 1) * integralN, ElemType(0));
+	const ElemType area = ElemType(_poolSize.m * _poolSize.n);
 	for (size_t a = 0; a < _outputSize.m; a++)
 	{
+		const long long m = (long long)(a * _stride) - (long long)_offset.m;
+		const long long top = std::max(0LL, std::min(inputM, m)), bottom = std::max(0LL, std::min(inputM, m + (long long)_poolSize.m));
 		for (size_t b = 0; b < _outputSize.n; b++)
 		{
-			tempFeature(a, b) = MaxPoolPart(_feature, kernelOffsetM, kernelOffsetN);
-			kernelOffsetN += _stride;
+			const long long n = (long long)(b * _stride) - (long long)_offset.n;
+			const long long left = std::max(0LL, std::min(inputN, n)), right = std::max(0LL, std::min(inputN, n + (long long)_poolSize.n));
+			if (top == bottom || left == right)
+				continue;
+			const ElemType share = delta[a * _outputSize.n + b] / area;
+			_integral[top * integralN + left] += share;
+			_integral[top * integralN + right] -= share;
+			_integral[bottom * integralN + left] -= share;
+			_integral[bottom * integralN + right] += share;
+		}
+	}
+	std::vector<ElemType> column(inputN, ElemType(0));
+	for (long long i = 0; i < inputM; i++)
+	{
+		ElemType rowSum = 0;
+		for (long long j = 0; j < inputN; j++)
+		{
+			rowSum += _integral[i * integralN + j];
+			column[j] += rowSum;
+			depooled[i * inputN + j] = column[j];
 		}
-		kernelOffsetM += _stride;
-		kernelOffsetN = 0;
 	}
-	return tempFeature;
 }
 
-Neural::ElemType Neural::PoolingLayer::MaxPoolPart(const Feature & _feature, const size_t m, const size_t n)
+void Neural::PoolingLayer::RandomPool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax,
+	MathLib::RandomStream & _random)
 {
-	ElemType max{ 0.f };
-	for (size_t i = 0; i < _poolSize.m; i++)
+	if (_output.ColumeSize() != _outputSize.m || _output.RowSize() != _outputSize.n)
+		_output.Init(_outputSize.m, _outputSize.n);
+	const long long featureM = _feature.ColumeSize(), featureN = _feature.RowSize();
+	const ElemType * feature = _feature.Data();
+	ElemType * output = _output.Data();
+	const uint64_t area = _poolSize.m * _poolSize.n;
+	for (size_t a = 0; a < _outputSize.m; a++)
 	{
-		for (size_t j = 0; j < _poolSize.n; j++)
+		for (size_t b = 0; b < _outputSize.n; b++)
 		{
-			if (max < _feature(m + i, n + j))
-				max = _feature(m + i, n + j);
+			const uint64_t pick = _random.Next() % area;
+			const long long i = (long long)(a * _stride + pick / _poolSize.n) - (long long)_offset.m;
+			const long long j = (long long)(b * _stride + pick % _poolSize.n) - (long long)_offset.n;
+			const bool inside = i >= 0 && i < featureM && j >= 0 && j < featureN;
+			output[a * _outputSize.n + b] = inside ? feature[i * featureN + j] : _padding;
+			_argmax[a * _outputSize.n + b] = inside ? int(i * featureN + j) : -1;
 		}
 	}
-	return max;
 }
 
 void Neural::PoolingLayer::ForwardPropagation(void)
 {
-	Padding();
+	if (!Pad::IsConstant(_paddingNum))
+		Padding();
 	DownSampling();
 }
 
 void Neural::PoolingLayer::BackwardPropagation(void)
 {
+	if (_frozen)
+	{
+		std::cerr << "ERROR : PoolLayer is frozen, no backward propagation." << std::endl;
+		return;
+	}
 	UpSampling();
 }
 
@@ -79,45 +151,162 @@ void Neural::PoolingLayer::Update(void)
 
 }
 
+void Neural::PoolingLayer::SetInputBatch(const FeatureBatch & _input)
+{
+	this->_inputBatch = _input;
+}
+
+void Neural::PoolingLayer::SetDeltaBatch(const FeatureBatch & _delta)
+{
+	this->_deltaBatch = _delta;
+}
+
+void Neural::PoolingLayer::ForwardPropagationBatch(void)
+{
+	const size_t batchSize = _inputBatch.size();
+	_outputBatch.resize(batchSize);
+	_argmaxBatch.resize(batchSize);
+	for (size_t n = 0; n < batchSize; n++)
+	{
+		// The buffers of sample n are lent to the single propagation, nothing is copied.
+		_input = Feature::Handles(_inputBatch[n]);
+		std::swap(_output, _outputBatch[n]);
+		std::swap(_argmax, _argmaxBatch[n]);
+		ForwardPropagation();
+		std::swap(_output, _outputBatch[n]);
+		std::swap(_argmax, _argmaxBatch[n]);
+	}
+}
+
+void Neural::PoolingLayer::BackwardPropagationBatch(void)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : PoolLayer is frozen, no backward propagation." << std::endl;
+		return;
+	}
+	const size_t batchSize = _deltaBatch.size();
+	if (_inputBatch.size() != batchSize || _argmaxBatch.size() != batchSize)
+	{
+		std::cerr << "ERROR : PoolLayer batch backward propagation does not match the forward propagation." << std::endl;
+		return;
+	}
+	_deltaDepooledBatch.resize(batchSize);
+	for (size_t n = 0; n < batchSize; n++)
+	{
+		_input = Feature::Handles(_inputBatch[n]);
+		_delta = Feature::Handles(_deltaBatch[n]);
+		std::swap(_argmax, _argmaxBatch[n]);
+		std::swap(_deltaDepooled, _deltaDepooledBatch[n]);
+		UpSampling();
+		std::swap(_argmax, _argmaxBatch[n]);
+		std::swap(_deltaDepooled, _deltaDepooledBatch[n]);
+	}
+}
+
+void Neural::PoolingLayer::Freeze(void)
+{
+	this->_frozen = true;
+	std::vector<Feature>().swap(_input);
+	std::vector<Feature>().swap(_paddedInput);
+	std::vector<Feature>().swap(_delta);
+	std::vector<Feature>().swap(_deltaDepooled);
+	FeatureBatch().swap(_inputBatch);
+	FeatureBatch().swap(_deltaBatch);
+	FeatureBatch().swap(_deltaDepooledBatch);
+}
+
 void Neural::PoolingLayer::DownSampling(void)
 {
-	_output.clear();
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	_output.resize(_input.size());
+	_argmax.resize(_input.size() * pixels);
+	const bool virtualPadding = Pad::IsConstant(_paddingNum);
+	const bool overlapping = _stride < _poolSize.m || _stride < _poolSize.n;
+	const MathLib::Size offset = Pad::Offset(_paddingMethod, _paddingM, _paddingN);
+	// Random padding pools the padded copy, the windows then start at its origin.
+	const MathLib::Size featureOffset = virtualPadding ? offset : MathLib::Size(0, 0);
+	const ElemType padding = virtualPadding ? Pad::Value(_paddingNum) : 0;
 	for (size_t i = 0; i < _input.size(); i++)
 	{
-		Feature pooledFeature = MaxPool(_paddedInput.at(i));
-		_output.push_back(pooledFeature);
+		const Feature & feature = virtualPadding ? _input.at(i) : _paddedInput.at(i);
+		int * argmax = _argmax.data() + i * pixels;
+		switch (_poolingMethod)
+		{
+		case PoolingMethod::MeanPooling:
+			MeanPool(feature, featureOffset, padding, _output.at(i));
+			continue;
+		case PoolingMethod::MinPooling:
+			if (overlapping)
+				ExtremePoolSeparable<false>(feature, featureOffset, padding, _output.at(i), argmax);
+			else
+				ExtremePool<false>(feature, featureOffset, padding, _output.at(i), argmax);
+			break;
+		case PoolingMethod::RandomPooling:
+		{
+			MathLib::RandomStream random(_randomSeed, i);
+			RandomPool(feature, featureOffset, padding, _output.at(i), argmax, random);
+			break;
+		}
+		case PoolingMethod::MaxPooling:
+		default:
+			if (overlapping)
+				ExtremePoolSeparable<true>(feature, featureOffset, padding, _output.at(i), argmax);
+			else
+				ExtremePool<true>(feature, featureOffset, padding, _output.at(i), argmax);
+			break;
+		}
+		if (virtualPadding)
+			continue;
+		// The argmax points into the padded copy, bring it back to the input.
+		const long long paddedN = feature.RowSize();
+		const long long inputM = _input.at(i).ColumeSize(), inputN = _input.at(i).RowSize();
+		for (size_t p = 0; p < pixels; p++)
+		{
+			if (argmax[p] < 0)
+				continue;
+			const long long row = argmax[p] / paddedN - (long long)offset.m, column = argmax[p] % paddedN - (long long)offset.n;
+			argmax[p] = row >= 0 && row < inputM && column >= 0 && column < inputN ? int(row * inputN + column) : -1;
+		}
 	}
+	if (_poolingMethod == PoolingMethod::RandomPooling)
+		_randomSeed++;
 }
 
 void Neural::PoolingLayer::UpSampling(void)
 {
-	_deltaDepooled.clear();
+	// Max, min and random pooling send every delta to the position their window passed on,
+	// O(output) after clearing the input delta. Mean pooling spreads it over the window.
+	const size_t pixels = _outputSize.m * _outputSize.n;
+	const MathLib::Size offset = Pad::Offset(_paddingMethod, _paddingM, _paddingN);
+	_deltaDepooled.resize(_delta.size());
 	for (size_t i = 0; i < _delta.size(); i++)
 	{
-		MathLib::Matrix<ElemType> deltaDepoolMat(_outputSize.m * _poolSize.m, _outputSize.n * _poolSize.n);
-		for (size_t a = 0; a < _outputSize.m; a++)
+		const MathLib::Size inputSize = i < _input.size() ? _input.at(i).GetSize() : _inputSize;
+		Feature & deltaDepoolMat = _deltaDepooled.at(i);
+		if (deltaDepoolMat.ColumeSize() != inputSize.m || deltaDepoolMat.RowSize() != inputSize.n)
+			deltaDepoolMat.Init(inputSize.m, inputSize.n);
+		if (_poolingMethod == PoolingMethod::MeanPooling)
 		{
-			for (size_t b = 0; b < _outputSize.n; b++)
-			{
-				for (size_t m = 0; m < _poolSize.m; m++)
-				{
-					for (size_t n = 0; n < _poolSize.n; n++)
-					{
-						deltaDepoolMat(a * _poolSize.m + m, b * _poolSize.n + n) = _delta.at(i)(a, b);
-					}
-				}
-			}
+			MeanUnpool(_delta.at(i), offset, deltaDepoolMat);
+			continue;
 		}
-		_deltaDepooled.push_back(deltaDepoolMat);
+		ElemType * depooled = deltaDepoolMat.Data();
+		std::fill(depooled, depooled + inputSize.m * inputSize.n, ElemType(0));
+		if (i >= _input.size() || _argmax.size() < (i + 1) * pixels)
+			continue;
+		const Feature & delta = _delta.at(i);
+		const ElemType * deltaData = delta.Data();
+		const int * argmax = _argmax.data() + i * pixels;
+		for (size_t p = 0; p < pixels; p++)
+			if (argmax[p] >= 0)
+				depooled[argmax[p]] += deltaData[p];
 	}
 }
 
 void Neural::PoolingLayer::Padding(void)
 {
-	_paddedInput.clear();
+	_paddedInput.resize(_input.size());
 	for (size_t i = 0; i < _input.size(); i++)
-	{
-		MathLib::Matrix<ElemType> newMatrix = Pad::Padding(_input.at(i), _paddingMethod, _paddingNum, _paddingM, _paddingN);
-		_paddedInput.push_back(newMatrix);
-	}
+		Pad::PaddingTo(_input.at(i), _paddingMethod, _paddingNum, _paddingM, _paddingN, _paddedInput.at(i));
 }
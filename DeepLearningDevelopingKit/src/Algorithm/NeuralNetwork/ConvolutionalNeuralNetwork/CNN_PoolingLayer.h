@@ -13,6 +13,11 @@
 #include "..\LossFunction.h"
 #include "CNN_PaddingLayer.h"
 
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USING_SSE2_POOLING
+#include <emmintrin.h>
+#endif
+
 /***************************************************************************************************/
 // Namespace : Neural
 /// Provide Neural Network algorithm library.
@@ -24,6 +29,8 @@ namespace Neural
 
 	// Define Kernel and Feature.
 	typedef MathLib::Matrix<ElemType> Feature;
+	// A batch of samples, every sample a list of channels.
+	typedef std::vector<std::vector<MathLib::Matrix<ElemType>>> FeatureBatch;
 
 	// Method of pooling
 	/// For most situation, Max Pooling is the most common practice.
@@ -57,6 +64,9 @@ namespace Neural
 	/// Used for scalling down the features.
 	class PoolingLayer
 	{
+		// The fused layer pools its convolution tiles with the SIMD rows of the pooling layer.
+		friend class FusedConvPoolLayer;
+
 	public: // Constructors
 
 		// Invoke constructor
@@ -68,8 +78,25 @@ namespace Neural
 		void SetDelta(const std::vector<Feature> & _delta);
 
 		inline const Feature GetFeature(const size_t _index) const { return _output.at(_index); }
-		inline const std::vector<Feature> GetFeatureAll(void) const { return _output; }
-		inline const std::vector<Feature> GetDelta(void) const { return _deltaDepooled; }
+		inline const std::vector<Feature> & GetFeatureAll(void) const { return _output; }
+		inline const std::vector<Feature> & GetDelta(void) const { return _deltaDepooled; }
+		// Size of the pooled features.
+		inline MathLib::Size GetOutputSize(void) const { return _outputSize; }
+		// Position of the element every window passed on in the last forward propagation (max, min and random pooling).
+		/// Channel c, output (a, b) is at c * output pixels + a * output columns + b, the value is the
+		/// row-major index into the input of the channel, or -1 when the padding won. Not used by mean pooling.
+		inline const std::vector<int> & GetArgmax(void) const { return _argmax; }
+
+	public: // Minibatch
+
+		void SetInputBatch(const FeatureBatch & _input);
+		void SetDeltaBatch(const FeatureBatch & _delta);
+		// Forward and backward propagation of every sample of the batch.
+		/// Pooling has no weights to share, the samples run one by one on buffers kept per sample.
+		void ForwardPropagationBatch(void);
+		void BackwardPropagationBatch(void);
+		inline const FeatureBatch & GetFeatureBatch(void) const { return _outputBatch; }
+		inline const FeatureBatch & GetDeltaBatch(void) const { return _deltaDepooledBatch; }
 
 	public:
 
@@ -80,14 +107,54 @@ namespace Neural
 		// Update function
 		void Update(void);
 
+	public: // Inference
+
+		// Freeze the layer for inference.
+		/// Releases the deltas and the stored input, BackwardPropagation is refused afterwards.
+		void Freeze(void);
+		inline bool IsFrozen(void) const { return _frozen; }
 
 	private:
 		void DownSampling(void);
 		void UpSampling(void);
+		// Materialize the padded inputs, only needed for random padding.
 		void Padding(void);
 
-		Feature MaxPool(const Feature & _feature);
-		ElemType MaxPoolPart(const Feature & _feature, const size_t m, const size_t n);
+		// Max or min pooling of a feature with virtual padding.
+		/// The input sits at _offset inside the padded feature, windows reaching outside it read _padding.
+		/// _argmax receives the index into _feature of the winner of every window, -1 for the padding.
+		template<bool Max>
+		void ExtremePool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax);
+		// Max or min pooling of overlapping windows (stride < pool size).
+		/// The extreme of every window row is computed once and shared by all windows stacked on it,
+		/// a window then only compares its PoolSize.m row results.
+		template<bool Max>
+		void ExtremePoolSeparable(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax);
+		// Window inside the feature.
+		template<bool Max>
+		ElemType ExtremePoolPart(const Feature & _feature, const size_t m, const size_t n, int & _argmax);
+		// Window crossing the border of the feature.
+		template<bool Max>
+		ElemType ExtremePoolBorder(const Feature & _feature, const long long m, const long long n, const ElemType _padding, int & _argmax);
+		// _count consecutive P x P windows inside the feature, the first one at (m, n).
+		/// With SSE2 two windows are compared at once. Ties keep the first position in row-major order.
+		template<size_t P, bool Max>
+		static void ExtremePoolRow(const ElemType * _feature, const size_t _featureN, const size_t m, const size_t n, const size_t _stride,
+			const size_t _count, ElemType * _output, int * _argmax);
+		// Whether _value beats _best.
+		template<bool Max>
+		static inline bool Better(const ElemType _value, const ElemType _best) { return Max ? _value > _best : _value < _best; }
+
+		// Mean pooling from the summed-area table of the feature.
+		/// Every window costs four lookups whatever its size, padded positions count as _padding.
+		void MeanPool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output);
+		// Backward of mean pooling.
+		/// Every delta is spread evenly over the input part of its window through a difference table,
+		/// so the cost does not depend on the window size either.
+		void MeanUnpool(const Feature & _delta, const MathLib::Size _offset, Feature & _depooled);
+		// Random pooling : every window passes on one of its elements chosen uniformly.
+		void RandomPool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax,
+			MathLib::RandomStream & _random);
 
 	public:
 
@@ -108,9 +175,230 @@ namespace Neural
 		// Delta
 		std::vector<Feature> _delta;
 		std::vector<Feature> _deltaDepooled;
+		// Argmax of every output of every channel, see GetArgmax().
+		std::vector<int> _argmax;
+
+		// Minibatch, one entry per sample.
+		FeatureBatch _inputBatch;
+		FeatureBatch _outputBatch;
+		FeatureBatch _deltaBatch;
+		FeatureBatch _deltaDepooledBatch;
+		std::vector<std::vector<int>> _argmaxBatch;
+
+		// Row results of ExtremePoolSeparable.
+		std::vector<ElemType> _rowExtreme;
+		std::vector<int> _rowArgmax;
+		// Summed-area table of MeanPool, difference table of MeanUnpool.
+		std::vector<ElemType> _integral;
+		// Seed of random pooling, moves on at every forward propagation.
+		uint64_t _randomSeed = 0;
 
 		PoolingMethod _poolingMethod;
 		PaddingNum _paddingNum;
 		PaddingMethod _paddingMethod;
+
+		// Whether the layer was frozen for inference.
+		bool _frozen = false;
 	};
-}
\ No newline at end of file
+}
+
+
+namespace Neural
+{
+	template<bool Max>
+	void PoolingLayer::ExtremePool(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax)
+	{
+		if (_output.ColumeSize() != _outputSize.m || _output.RowSize() != _outputSize.n)
+			_output.Init(_outputSize.m, _outputSize.n);
+		const long long featureM = _feature.ColumeSize(), featureN = _feature.RowSize();
+		const ElemType * feature = _feature.Data();
+		ElemType * output = _output.Data();
+		const bool square = _poolSize.m == _poolSize.n && _poolSize.m >= 2 && _poolSize.m <= 4;
+		// Output columns [bBegin, bEnd) have windows inside the feature horizontally.
+		size_t bBegin = 0, bEnd = _outputSize.n;
+		while (bBegin < _outputSize.n && (long long)(bBegin * _stride) < (long long)_offset.n)
+			bBegin++;
+		while (bEnd > bBegin && (long long)((bEnd - 1) * _stride + _poolSize.n) - (long long)_offset.n > featureN)
+			bEnd--;
+		for (size_t a = 0; a < _outputSize.m; a++)
+		{
+			const long long m = (long long)(a * _stride) - (long long)_offset.m;
+			const bool rowInside = m >= 0 && m + (long long)_poolSize.m <= featureM;
+			ElemType * out = output + a * _outputSize.n;
+			int * argmax = _argmax + a * _outputSize.n;
+			size_t b = 0;
+			if (rowInside && square && bEnd > bBegin)
+			{
+				for (; b < bBegin; b++)
+					out[b] = ExtremePoolBorder<Max>(_feature, m, (long long)(b * _stride) - (long long)_offset.n, _padding, argmax[b]);
+				const size_t n = bBegin * _stride - _offset.n;
+				switch (_poolSize.m)
+				{
+				case 2:
+					ExtremePoolRow<2, Max>(feature, featureN, m, n, _stride, bEnd - bBegin, out + bBegin, argmax + bBegin);
+					break;
+				case 3:
+					ExtremePoolRow<3, Max>(feature, featureN, m, n, _stride, bEnd - bBegin, out + bBegin, argmax + bBegin);
+					break;
+				default:
+					ExtremePoolRow<4, Max>(feature, featureN, m, n, _stride, bEnd - bBegin, out + bBegin, argmax + bBegin);
+					break;
+				}
+				b = bEnd;
+			}
+			for (; b < _outputSize.n; b++)
+			{
+				const long long n = (long long)(b * _stride) - (long long)_offset.n;
+				if (rowInside && n >= 0 && n + (long long)_poolSize.n <= featureN)
+					out[b] = ExtremePoolPart<Max>(_feature, m, n, argmax[b]);
+				else
+					out[b] = ExtremePoolBorder<Max>(_feature, m, n, _padding, argmax[b]);
+			}
+		}
+	}
+
+	template<bool Max>
+	void PoolingLayer::ExtremePoolSeparable(const Feature & _feature, const MathLib::Size _offset, const ElemType _padding, Feature & _output, int * _argmax)
+	{
+		if (_output.ColumeSize() != _outputSize.m || _output.RowSize() != _outputSize.n)
+			_output.Init(_outputSize.m, _outputSize.n);
+		if (_outputSize.m == 0 || _outputSize.n == 0)
+			return;
+		const long long featureM = _feature.ColumeSize(), featureN = _feature.RowSize();
+		const ElemType * feature = _feature.Data();
+		ElemType * output = _output.Data();
+		// Row r of the row results is feature row r - _offset.m, one entry per output column.
+		const size_t rowNum = (_outputSize.m - 1) * _stride + _poolSize.m;
+		_rowExtreme.resize(rowNum * _outputSize.n);
+		_rowArgmax.resize(rowNum * _outputSize.n);
+		for (size_t r = 0; r < rowNum; r++)
+		{
+			const long long i = (long long)r - (long long)_offset.m;
+			const bool rowInside = i >= 0 && i < featureM;
+			for (size_t b = 0; b < _outputSize.n; b++)
+			{
+				const long long n = (long long)(b * _stride) - (long long)_offset.n;
+				ElemType best = _padding;
+				int bestIndex = -1;
+				for (long long j = n; j < n + (long long)_poolSize.n; j++)
+				{
+					const bool inside = rowInside && j >= 0 && j < featureN;
+					const ElemType value = inside ? feature[i * featureN + j] : _padding;
+					if (j == n || Better<Max>(value, best))
+					{
+						best = value;
+						bestIndex = inside ? int(i * featureN + j) : -1;
+					}
+				}
+				_rowExtreme[r * _outputSize.n + b] = best;
+				_rowArgmax[r * _outputSize.n + b] = bestIndex;
+			}
+		}
+		for (size_t a = 0; a < _outputSize.m; a++)
+		{
+			for (size_t b = 0; b < _outputSize.n; b++)
+			{
+				size_t best = a * _stride * _outputSize.n + b;
+				for (size_t u = 1; u < _poolSize.m; u++)
+				{
+					const size_t index = (a * _stride + u) * _outputSize.n + b;
+					if (Better<Max>(_rowExtreme[index], _rowExtreme[best]))
+						best = index;
+				}
+				output[a * _outputSize.n + b] = _rowExtreme[best];
+				_argmax[a * _outputSize.n + b] = _rowArgmax[best];
+			}
+		}
+	}
+
+	template<bool Max>
+	ElemType PoolingLayer::ExtremePoolPart(const Feature & _feature, const size_t m, const size_t n, int & _argmax)
+	{
+		const size_t featureN = _feature.RowSize();
+		const ElemType * feature = _feature.Data();
+		ElemType best = feature[m * featureN + n];
+		_argmax = int(m * featureN + n);
+		for (size_t i = 0; i < _poolSize.m; i++)
+		{
+			for (size_t j = 0; j < _poolSize.n; j++)
+			{
+				const size_t index = (m + i) * featureN + n + j;
+				if (Better<Max>(feature[index], best))
+				{
+					best = feature[index];
+					_argmax = int(index);
+				}
+			}
+		}
+		return best;
+	}
+
+	template<bool Max>
+	ElemType PoolingLayer::ExtremePoolBorder(const Feature & _feature, const long long m, const long long n, const ElemType _padding, int & _argmax)
+	{
+		const long long featureM = _feature.ColumeSize(), featureN = _feature.RowSize();
+		const ElemType * feature = _feature.Data();
+		ElemType best = 0;
+		_argmax = -1;
+		bool first = true;
+		for (long long i = m; i < m + (long long)_poolSize.m; i++)
+		{
+			for (long long j = n; j < n + (long long)_poolSize.n; j++)
+			{
+				const bool inside = i >= 0 && i < featureM && j >= 0 && j < featureN;
+				const ElemType value = inside ? feature[i * featureN + j] : _padding;
+				if (first || Better<Max>(value, best))
+				{
+					first = false;
+					best = value;
+					_argmax = inside ? int(i * featureN + j) : -1;
+				}
+			}
+		}
+		return best;
+	}
+
+	template<size_t P, bool Max>
+	void PoolingLayer::ExtremePoolRow(const ElemType * _feature, const size_t _featureN, const size_t m, const size_t n, const size_t _stride,
+		const size_t _count, ElemType * _output, int * _argmax)
+	{
+		size_t b = 0;
+#ifdef USING_SSE2_POOLING
+		for (; b + 2 <= _count; b += 2)
+		{
+			const size_t first = m * _featureN + n + b * _stride;
+			__m128d best = _mm_set_pd(_feature[first + _stride], _feature[first]);
+			__m128d bestIndex = _mm_set_pd(double(first + _stride), double(first));
+			for (size_t u = 0; u < P; u++)
+				for (size_t v = (u == 0 ? 1 : 0); v < P; v++)
+				{
+					const size_t index = first + u * _featureN + v;
+					const __m128d x = _mm_set_pd(_feature[index + _stride], _feature[index]);
+					const __m128d greater = Max ? _mm_cmpgt_pd(x, best) : _mm_cmplt_pd(x, best);
+					best = _mm_or_pd(_mm_and_pd(greater, x), _mm_andnot_pd(greater, best));
+					bestIndex = _mm_or_pd(_mm_and_pd(greater, _mm_set_pd(double(index + _stride), double(index))), _mm_andnot_pd(greater, bestIndex));
+				}
+			_mm_storeu_pd(_output + b, best);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(_argmax + b), _mm_cvttpd_epi32(bestIndex));
+		}
+#endif // USING_SSE2_POOLING
+		for (; b < _count; b++)
+		{
+			const size_t first = m * _featureN + n + b * _stride;
+			ElemType best = _feature[first];
+			size_t bestIndex = first;
+			for (size_t u = 0; u < P; u++)
+				for (size_t v = 0; v < P; v++)
+				{
+					const size_t index = first + u * _featureN + v;
+					if (Better<Max>(_feature[index], best))
+					{
+						best = _feature[index];
+						bestIndex = index;
+					}
+				}
+			_output[b] = best;
+			_argmax[b] = int(bestIndex);
+		}
+	}
+}
@@ -14,6 +14,8 @@ Neural::ProcessLayer::ProcessLayer(const ProcessLayerInitor _initor)
 	this->_dataSize= _initor.InputSize;
 	this->processFunction = _initor.ProcessFunction;
 	this->processFunctionDerivative = _initor.ProcessFunctionDerivative;
+	this->processKernel = GetActivationKernel(_initor.ProcessFunction);
+	this->deprocessKernel = GetActivationDerivativeKernel(_initor.ProcessFunctionDerivative);
 }
 
 void Neural::ProcessLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>>& _input)
@@ -23,30 +25,107 @@ void Neural::ProcessLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>>
 
 void Neural::ProcessLayer::Process(void)
 {
-	for (size_t i = 0; i < _data.size(); i++)
+	Process(_data);
+}
+
+void Neural::ProcessLayer::Process(std::vector<MathLib::Matrix<ElemType>> & _features)
+{
+	for (size_t i = 0; i < _features.size(); i++)
 	{
-		for (size_t a = 0; a < _dataSize.m; a++)
+		const size_t size = _features.at(i).ColumeSize() * _features.at(i).RowSize();
+		ElemType * data = _features.at(i).Data();
+		if (processKernel != nullptr)
+			processKernel(data, size);
+		else
+			for (size_t j = 0; j < size; j++)
+				data[j] = processFunction(data[j]);
+	}
+	if (!_frozen)
+		this->_output = MathLib::Matrix<ElemType>::Handles(_features);
+}
+
+void Neural::ProcessLayer::Process(FeatureBatch & _features)
+{
+	for (size_t n = 0; n < _features.size(); n++)
+		for (size_t i = 0; i < _features[n].size(); i++)
 		{
-			for (size_t b = 0; b < _dataSize.n; b++)
-			{
-				_data.at(i)(a, b) = processFunction(_data.at(i)(a, b));
-			}
+			const size_t size = _features[n][i].ColumeSize() * _features[n][i].RowSize();
+			ElemType * data = _features[n][i].Data();
+			if (processKernel != nullptr)
+				processKernel(data, size);
+			else
+				for (size_t j = 0; j < size; j++)
+					data[j] = processFunction(data[j]);
 		}
+	if (!_frozen)
+	{
+		this->_outputBatch.resize(_features.size());
+		for (size_t n = 0; n < _features.size(); n++)
+			this->_outputBatch[n] = MathLib::Matrix<ElemType>::Handles(_features[n]);
 	}
 }
 
+void Neural::ProcessLayer::Freeze(void)
+{
+	this->_frozen = true;
+	std::vector<MathLib::Matrix<ElemType>>().swap(_data);
+	std::vector<MathLib::Matrix<ElemType>>().swap(_output);
+	FeatureBatch().swap(_outputBatch);
+}
+
 void Neural::ProcessLayer::Deprocess(void)
 {
-	for (size_t i = 0; i < _data.size(); i++)
+	Deprocess(_data);
+}
+
+void Neural::ProcessLayer::Deprocess(std::vector<MathLib::Matrix<ElemType>> & _delta)
+{
+	if (_frozen)
 	{
-		for (size_t a = 0; a < _dataSize.m; a++)
+		std::cerr << "ERROR : ProcessLayer is frozen, no deprocess." << std::endl;
+		return;
+	}
+	if (_output.size() < _delta.size())
+	{
+		std::cerr << "ERROR : ProcessLayer deprocess without process output." << std::endl;
+		return;
+	}
+	for (size_t i = 0; i < _delta.size(); i++)
+	{
+		const MathLib::Matrix<ElemType> & outputMat = _output.at(i);
+		const size_t size = _delta.at(i).ColumeSize() * _delta.at(i).RowSize();
+		if (outputMat.ColumeSize() * outputMat.RowSize() != size)
 		{
-			for (size_t b = 0; b < _dataSize.n; b++)
-			{
-				_data.at(i)(a, b) = processFunctionDerivative(_data.at(i)(a, b)) * _data.at(i)(a, b);
-			}
+			std::cerr << "ERROR : ProcessLayer delta size mismatch." << std::endl;
+			return;
 		}
+		const ElemType * output = outputMat.Data();
+		ElemType * delta = _delta.at(i).Data();
+		if (deprocessKernel != nullptr)
+			deprocessKernel(output, delta, size);
+		else
+			for (size_t j = 0; j < size; j++)
+				delta[j] = delta[j] * processFunctionDerivative(output[j]);
 	}
 }
 
-
+void Neural::ProcessLayer::Deprocess(FeatureBatch & _delta)
+{
+	if (_frozen)
+	{
+		std::cerr << "ERROR : ProcessLayer is frozen, no deprocess." << std::endl;
+		return;
+	}
+	if (_outputBatch.size() != _delta.size())
+	{
+		std::cerr << "ERROR : ProcessLayer batch deprocess does not match the batch process." << std::endl;
+		return;
+	}
+	// The output of sample n is lent to the single Deprocess.
+	for (size_t n = 0; n < _delta.size(); n++)
+	{
+		std::swap(_output, _outputBatch[n]);
+		Deprocess(_delta[n]);
+		std::swap(_output, _outputBatch[n]);
+	}
+}
@@ -4,9 +4,11 @@
 /*                                                   www.tianshicangxie.com                                                        */
 /*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
 /***************************************************************************************************/
+#pragma once
 
 // Header files
 #include "..\..\..\MathLib\MathLib.h"
+#include "..\ActivationFunction.h"
 
 /***************************************************************************************************/
 // Namespace : Neural
@@ -16,6 +18,8 @@ namespace Neural
 	// Define the Element datatype.
 	/// Mainly using float and double.
 	typedef double ElemType;
+	// A batch of samples, every sample a list of channels.
+	typedef std::vector<std::vector<MathLib::Matrix<ElemType>>> FeatureBatch;
 
 	// Process Layer Initor
 	/// Used for initialization of a ProcessLayer.
@@ -33,6 +37,8 @@ namespace Neural
 	/***************************************************************************************************/
 	// Class : Process Layer
 	/// Used for processign data.Such as ReLU, Normalization, Regularization.
+	/// The built-in activations run the SIMD kernels instantiated from their policy (see ActivationFunction.h),
+	/// other functions are called element by element.
 	class ProcessLayer
 	{
 	public: // Constructor
@@ -40,20 +46,43 @@ namespace Neural
 		ProcessLayer(const ProcessLayerInitor _initor);
 
 		// Set the input of the ProcessLayer.
+		/// Only copies the matrix handles, Process() then detaches them from the caller.
 		void SetInput(const std::vector<MathLib::Matrix<ElemType>> &  _data);
 
-		// Processing the data.
+		// Processing the data set by SetInput.
 		void Process(void);
-		// Deprocessing the data.
+		// Processing the caller's matrices in place.
+		/// The layer keeps handles on the processed matrices for Deprocess, no element is copied
+		/// unless the caller writes to them afterwards.
+		void Process(std::vector<MathLib::Matrix<ElemType>> & _features);
+		// Deprocessing the delta set by SetInput.
 		void Deprocess(void);
+		// Deprocessing the caller's delta in place.
+		/// Every delta is multiplied by the derivative of the process function at the output of the
+		/// last Process.
+		void Deprocess(std::vector<MathLib::Matrix<ElemType>> & _delta);
+		// Processing every sample of a batch in place.
+		void Process(FeatureBatch & _features);
+		// Deprocessing the delta of every sample of the batch of the last Process.
+		void Deprocess(FeatureBatch & _delta);
 
 		inline const MathLib::Matrix<ElemType> GetOutput(const size_t _index) const { return _data.at(_index); }
-		inline const std::vector<MathLib::Matrix<ElemType>> GetOutputAll(void) const { return _data; }
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetOutputAll(void) const { return _data; }
+		// The function applied by Process.
+		inline ElemType(*GetProcessFunction(void) const)(ElemType x) { return processFunction; }
+
+		// Freeze the layer for inference.
+		/// Releases the handles on the processed matrices and stops keeping them, Deprocess is refused afterwards.
+		void Freeze(void);
 
 	private:
 
 		// Input of the layer.
 		std::vector<MathLib::Matrix<ElemType>> _data;
+		// Output of the last Process, the derivative is evaluated on it.
+		std::vector<MathLib::Matrix<ElemType>> _output;
+		// Output of the last batch Process.
+		FeatureBatch _outputBatch;
 
 		// Input size.
 		MathLib::Size _dataSize;
@@ -61,5 +90,11 @@ namespace Neural
 		// Process Function
 		ElemType(*processFunction)(ElemType x);
 		ElemType(*processFunctionDerivative)(ElemType x);
+		// Array kernels of the process function and of its derivative, nullptr if it has none.
+		ActivationKernel processKernel;
+		ActivationDerivativeKernel deprocessKernel;
+
+		// Whether the layer was frozen for inference.
+		bool _frozen = false;
 	};
-}
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	  Depthwise Separable Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "CNN_SeparableLayer.h"
+
+Neural::SeparableConvLayer::SeparableConvLayer(const SeparableLayerInitor & _initor)
+{
+	this->_channelNum = _initor.InputChannels;
+	this->_kernelNum = _initor.KernelNum;
+	this->_kernelSize = _initor.KernelSize;
+	this->_stride = std::max<size_t>(_initor.Stride, 1);
+	this->_dilation = std::max<size_t>(_initor.Dilation, 1);
+	this->_inputSize = _initor.InputSize;
+
+	this->_paddingM = _dilation * (_kernelSize.m / 2);
+	this->_paddingN = _dilation * (_kernelSize.n / 2);
+	this->_outputSize.m = ConvGeometry::OutputLength(_inputSize.m, _kernelSize.m, _paddingM, _stride, _dilation);
+	this->_outputSize.n = ConvGeometry::OutputLength(_inputSize.n, _kernelSize.n, _paddingN, _stride, _dilation);
+
+	for (size_t c = 0; c < _channelNum; c++)
+		this->_depthwiseNodes.push_back(ConvNode(_kernelSize, _outputSize));
+	for (size_t k = 0; k < _kernelNum; k++)
+		this->_pointwiseNodes.push_back(ConvNode(MathLib::Size(1, _channelNum), _outputSize));
+}
+
+void Neural::SeparableConvLayer::SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input)
+{
+	this->_input = _input;
+}
+
+void Neural::SeparableConvLayer::SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta)
+{
+	this->_derivativeLastLayer = _delta;
+}
+
+void Neural::SeparableConvLayer::SetLearnRate(const double _learnRate)
+{
+	this->learnRate = _learnRate;
+}
+
+void Neural::SeparableConvLayer::InvalidateKernelCache(void)
+{
+	this->_kernelVersion++;
+}
+
+const Neural::ElemType * Neural::SeparableConvLayer::GetPackedDepthwise(void)
+{
+	if (!_packedDepthwise.Valid(_kernelVersion))
+	{
+		std::vector<ConvKernel> kernels;
+		for (const ConvNode & node : _depthwiseNodes)
+			kernels.push_back(node.kernel);
+		_packedDepthwise.Data.resize(_channelNum * _kernelSize.m * _kernelSize.n);
+		Convolution::PackFlipped(kernels, _packedDepthwise.Data.data());
+		_packedDepthwise.Validate(_kernelVersion);
+	}
+	return _packedDepthwise.Data.data();
+}
+
+const Neural::ElemType * Neural::SeparableConvLayer::GetPackedPointwise(void)
+{
+	if (!_packedPointwise.Valid(_kernelVersion))
+	{
+		// A 1x1 kernel is its own flip, the weights are copied as they are.
+		_packedPointwise.Data.resize(_kernelNum * _channelNum);
+		for (size_t k = 0; k < _kernelNum; k++)
+		{
+			const ElemType * weights = _pointwiseNodes.at(k).kernel.Data();
+			std::copy(weights, weights + _channelNum, _packedPointwise.Data.data() + k * _channelNum);
+		}
+		_packedPointwise.Validate(_kernelVersion);
+	}
+	return _packedPointwise.Data.data();
+}
+
+Neural::ConvGeometry Neural::SeparableConvLayer::ForwardGeometry(void) const
+{
+	return ConvGeometry(_inputSize, _kernelSize, MathLib::Size(_paddingM, _paddingN), _stride, _outputSize, _dilation);
+}
+
+void Neural::SeparableConvLayer::ForwardPropagation(void)
+{
+	if (_input.size() != _channelNum)
+	{
+		std::cerr << "ERROR : SeparableConvLayer expects " << _channelNum << " input channels, got " << _input.size() << "." << std::endl;
+		return;
+	}
+	for (const MathLib::Matrix<ElemType> & channel : _input)
+		if (channel.ColumeSize() != _inputSize.m || channel.RowSize() != _inputSize.n)
+		{
+			std::cerr << "ERROR : SeparableConvLayer input does not match the input size." << std::endl;
+			return;
+		}
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t pixels = geometry.OutputPixels();
+	ForwardDepthwise(geometry);
+
+	// Output = pointwise weights (K x C) * depthwise output (C x pixels) + bias
+	_output.resize(_kernelNum * pixels);
+	Convolution::Pointwise(GetPackedPointwise(), _depthwiseOutput.data(), _kernelNum, _channelNum, pixels, _output.data());
+	MathLib::ParallelFor(0, _kernelNum, [&](size_t _kernelBegin, size_t _kernelEnd) {
+		for (size_t k = _kernelBegin; k < _kernelEnd; k++)
+		{
+			ConvFeature & feature = _pointwiseNodes.at(k).feature;
+			if (feature.ColumeSize() != _outputSize.m || feature.RowSize() != _outputSize.n)
+				feature.Init(_outputSize.m, _outputSize.n);
+			const ElemType * response = _output.data() + k * pixels;
+			const ElemType bias = _pointwiseNodes.at(k).bias;
+			ElemType * data = feature.Data();
+			for (size_t p = 0; p < pixels; p++)
+				data[p] = response[p] + bias;
+		}
+	}, MathLib::ThreadPool::Grain(pixels));
+}
+
+void Neural::SeparableConvLayer::ForwardDepthwise(const ConvGeometry & _geometry)
+{
+	const size_t pixels = _geometry.OutputPixels();
+	const size_t kernelElements = _geometry.KernelElements();
+	const size_t kernelSize = _kernelSize.m;
+	const ElemType * packed = GetPackedDepthwise();
+	_depthwiseOutput.resize(_channelNum * pixels);
+	if (_kernelSize.n == kernelSize && _stride == 1 && _dilation == 1 && (kernelSize == 3 || kernelSize == 5 || kernelSize == 7))
+	{
+		const size_t paddedPixels = (_outputSize.m + kernelSize - 1) * (_outputSize.n + kernelSize - 1);
+		_padded.resize(_channelNum * paddedPixels);
+		MathLib::ParallelFor(0, _channelNum, [&](size_t _channelBegin, size_t _channelEnd) {
+			for (size_t c = _channelBegin; c < _channelEnd; c++)
+				Convolution::PadRows(_input.at(c).Data(), _geometry, _padded.data() + c * paddedPixels);
+		}, MathLib::ThreadPool::Grain(paddedPixels));
+		switch (kernelSize)
+		{
+		case 3:
+			Convolution::DepthwiseTiled<3>(_padded.data(), _geometry, packed, _channelNum, _depthwiseOutput.data());
+			break;
+		case 5:
+			Convolution::DepthwiseTiled<5>(_padded.data(), _geometry, packed, _channelNum, _depthwiseOutput.data());
+			break;
+		default:
+			Convolution::DepthwiseTiled<7>(_padded.data(), _geometry, packed, _channelNum, _depthwiseOutput.data());
+			break;
+		}
+	}
+	else
+	{
+		MathLib::ParallelFor(0, _channelNum, [&](size_t _channelBegin, size_t _channelEnd) {
+			for (size_t c = _channelBegin; c < _channelEnd; c++)
+				Convolution::Correlate(_input.at(c).Data(), _geometry, packed + c * kernelElements, ElemType(0), _depthwiseOutput.data() + c * pixels);
+		}, MathLib::ThreadPool::Grain(pixels * kernelElements));
+	}
+	// The biases go into the buffer the pointwise convolution reads, the nodes get a copy.
+	MathLib::ParallelFor(0, _channelNum, [&](size_t _channelBegin, size_t _channelEnd) {
+		for (size_t c = _channelBegin; c < _channelEnd; c++)
+		{
+			ElemType * response = _depthwiseOutput.data() + c * pixels;
+			const ElemType bias = _depthwiseNodes.at(c).bias;
+			for (size_t p = 0; p < pixels; p++)
+				response[p] += bias;
+			ConvFeature & feature = _depthwiseNodes.at(c).feature;
+			if (feature.ColumeSize() != _outputSize.m || feature.RowSize() != _outputSize.n)
+				feature.Init(_outputSize.m, _outputSize.n);
+			std::copy(response, response + pixels, feature.Data());
+		}
+	}, MathLib::ThreadPool::Grain(2 * pixels));
+}
+
+void Neural::SeparableConvLayer::BackwardPropagation(void)
+{
+	if (_input.size() != _channelNum || _derivativeLastLayer.size() < _kernelNum)
+	{
+		std::cerr << "ERROR : SeparableConvLayer backward propagation without input or delta." << std::endl;
+		return;
+	}
+	const ConvGeometry geometry = ForwardGeometry();
+	const size_t pixels = geometry.OutputPixels();
+	const size_t kernelElements = geometry.KernelElements();
+	if (_depthwiseOutput.size() != _channelNum * pixels)
+	{
+		std::cerr << "ERROR : SeparableConvLayer backward propagation without forward propagation." << std::endl;
+		return;
+	}
+	_outputDelta.resize(_kernelNum * pixels);
+	for (size_t k = 0; k < _kernelNum; k++)
+	{
+		const ConvFeature & delta = _derivativeLastLayer.at(k);
+		if (delta.ColumeSize() * delta.RowSize() != pixels)
+		{
+			std::cerr << "ERROR : SeparableConvLayer delta does not match the output size." << std::endl;
+			return;
+		}
+		std::copy(delta.Data(), delta.Data() + pixels, _outputDelta.data() + k * pixels);
+	}
+
+	// Pointwise : dW = dY (K x pixels) * D^T (pixels x C), dD = W^T (C x K) * dY (K x pixels).
+	_kernelGradient.resize(std::max(_kernelNum * _channelNum, kernelElements));
+	MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::Trans, _kernelNum, _channelNum, pixels,
+		ElemType(1), _outputDelta.data(), pixels, _depthwiseOutput.data(), pixels, ElemType(0), _kernelGradient.data(), _channelNum);
+	for (size_t k = 0; k < _kernelNum; k++)
+	{
+		ConvNode & node = _pointwiseNodes.at(k);
+		std::copy(_kernelGradient.data() + k * _channelNum, _kernelGradient.data() + (k + 1) * _channelNum, node.kernelDelta.Data());
+		const ElemType * delta = _outputDelta.data() + k * pixels;
+		ElemType biasDelta = 0;
+		for (size_t p = 0; p < pixels; p++)
+			biasDelta += delta[p];
+		node.biasDelta = biasDelta;
+	}
+	_depthwiseDelta.resize(_channelNum * pixels);
+	MathLib::GEMM(MathLib::Transpose::Trans, MathLib::Transpose::NoTrans, _channelNum, pixels, _kernelNum,
+		ElemType(1), GetPackedPointwise(), _channelNum, _outputDelta.data(), pixels, ElemType(0), _depthwiseDelta.data(), pixels);
+
+	// Depthwise, channel by channel : dK = dD (1 x pixels) * im2col(X)^T, dX = col2im(K^T (k² x 1) * dD).
+	const ElemType * packed = GetPackedDepthwise();
+	_column.resize(kernelElements * pixels);
+	_columnDelta.resize(kernelElements * pixels);
+	// The delta of the last call is written over, unless someone still holds it.
+	_derivative.resize(_channelNum);
+	for (size_t c = 0; c < _channelNum; c++)
+	{
+		const ElemType * delta = _depthwiseDelta.data() + c * pixels;
+		Convolution::Im2col(_input.at(c).Data(), geometry, _column.data());
+		MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::Trans, 1, kernelElements, pixels,
+			ElemType(1), delta, pixels, _column.data(), pixels, ElemType(0), _kernelGradient.data(), kernelElements);
+		ConvNode & node = _depthwiseNodes.at(c);
+		// The packed kernels are flipped, flip the gradient back.
+		ElemType * kernelDelta = node.kernelDelta.Data();
+		for (size_t e = 0; e < kernelElements; e++)
+			kernelDelta[e] = _kernelGradient[kernelElements - 1 - e];
+		ElemType biasDelta = 0;
+		for (size_t p = 0; p < pixels; p++)
+			biasDelta += delta[p];
+		node.biasDelta = biasDelta;
+
+		MathLib::GEMM(MathLib::Transpose::Trans, MathLib::Transpose::NoTrans, kernelElements, pixels, 1,
+			ElemType(1), packed + c * kernelElements, kernelElements, delta, pixels, ElemType(0), _columnDelta.data(), pixels);
+		MathLib::Matrix<ElemType> & inputDelta = _derivative.at(c);
+		if (inputDelta.ColumeSize() != _inputSize.m || inputDelta.RowSize() != _inputSize.n)
+			inputDelta.Init(_inputSize.m, _inputSize.n);
+		Convolution::Col2im(_columnDelta.data(), geometry, inputDelta.Data());
+	}
+}
+
+void Neural::SeparableConvLayer::Update(void)
+{
+	for (ConvNode & node : _depthwiseNodes)
+	{
+		node.kernel -= node.kernelDeltaSum * learnRate;
+		node.bias -= node.biasDeltaSum * learnRate;
+	}
+	for (ConvNode & node : _pointwiseNodes)
+	{
+		node.kernel -= node.kernelDeltaSum * learnRate;
+		node.bias -= node.biasDeltaSum * learnRate;
+	}
+	InvalidateKernelCache();
+}
+
+void Neural::SeparableConvLayer::BatchDeltaSumUpdate(const size_t _batchSize)
+{
+	for (std::vector<ConvNode> * nodes : { &_depthwiseNodes, &_pointwiseNodes })
+		for (ConvNode & node : *nodes)
+		{
+			node.kernelDeltaSum += node.kernelDelta * (1 / (double)_batchSize);
+			node.biasDeltaSum += node.biasDelta * (1 / (double)_batchSize);
+		}
+}
+
+void Neural::SeparableConvLayer::BatchDeltaSumClear(void)
+{
+	for (std::vector<ConvNode> * nodes : { &_depthwiseNodes, &_pointwiseNodes })
+		for (ConvNode & node : *nodes)
+		{
+			node.kernelDeltaSum.Clear();
+			node.biasDeltaSum = 0;
+		}
+}
@@ -0,0 +1,154 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	  Depthwise Separable Layer     	                                             */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include "CNN_ConvolutionalLayer.h"
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	// Separable Layer Initor
+	/// Used for initialization of a SeparableConvLayer, the fields mean what they mean in ConvLayerInitor.
+	/// There is no padding to choose : like ConvolutionalLayer, the layer pads every side with zeros.
+	struct SeparableLayerInitor
+	{
+		// Stride of the depthwise convolution.
+		size_t Stride;
+		// Dilation of the depthwise convolution.
+		size_t Dilation = 1;
+		// The number of input channels, every one has its own depthwise kernel.
+		size_t InputChannels;
+		// The number of pointwise kernels, the channels of the output.
+		size_t KernelNum;
+		// Size of input matrix.
+		MathLib::Size InputSize;
+		// Size of the depthwise kernels.
+		MathLib::Size KernelSize;
+	};
+
+	/***************************************************************************************************/
+	// Class : Depthwise Separable Convolutional Layer
+	/// A depthwise convolution, one k x k kernel and bias per input channel, followed by a pointwise 1x1
+	/// convolution mixing the channels into KernelNum outputs. Costs C * k² + C * K multiplications per
+	/// pixel where a full convolution costs C * K * k².
+	/// Undilated square 3x3, 5x5 and 7x7 depthwise kernels at stride 1 run Convolution::DepthwiseTiled,
+	/// other ones the sliding window, the pointwise part always runs Convolution::Pointwise.
+	/// Stride, dilation and the output size follow ConvolutionalLayer, so does the padding : dilation * (k / 2)
+	/// zeros on every side. Like it, the layer applies no activation, a ProcessLayer does.
+	class SeparableConvLayer
+	{
+	public: // Constructors
+
+		// Invoke constructor
+		SeparableConvLayer(const SeparableLayerInitor & _initor);
+
+	public: // Getter
+
+		// Output of pointwise kernel _index.
+		inline const ConvFeature GetFeature(const size_t _index) const { return _pointwiseNodes.at(_index).feature; }
+		inline const std::vector<ConvFeature> GetFeatureAll(void) const {
+			std::vector<ConvFeature> features;
+			for (const ConvNode & node : _pointwiseNodes)
+				features.push_back(node.feature);
+			return features;
+		}
+		// Output of the depthwise convolution, one map per input channel.
+		inline const std::vector<ConvFeature> GetDepthwiseFeatureAll(void) const {
+			std::vector<ConvFeature> features;
+			for (const ConvNode & node : _depthwiseNodes)
+				features.push_back(node.feature);
+			return features;
+		}
+		// Delta of the input, one matrix per channel.
+		inline const std::vector<MathLib::Matrix<ElemType>> & GetDelta(void) const { return _derivative; }
+		inline MathLib::Size GetOutputSize(void) const { return _outputSize; }
+
+	public: // Kernel cache
+
+		inline size_t GetKernelVersion(void) const { return _kernelVersion; }
+		// Depthwise kernels rotated by 180° and packed, InputChannels x KernelElements.
+		const ElemType * GetPackedDepthwise(void);
+		// Pointwise weights packed, KernelNum x InputChannels.
+		const ElemType * GetPackedPointwise(void);
+
+	public: // Setter
+
+		// Set the input, InputChannels matrices of the input size.
+		void SetInput(const std::vector<MathLib::Matrix<ElemType>> & _input);
+		// Set the delta propagate back from next layer, one matrix of the output size per pointwise kernel.
+		void SetDelta(const std::vector<MathLib::Matrix<ElemType>> & _delta);
+		void SetLearnRate(const double _learnRate);
+		// Bump the kernel version, call it after writing the kernels of the nodes directly.
+		void InvalidateKernelCache(void);
+
+	public: // BackPropagation Algorithm
+
+		// ForwardPropagation function
+		void ForwardPropagation(void);
+		// BackwardPropagation function
+		/// Pointwise gradients by GEMM against the saved depthwise output, depthwise gradients through
+		/// the im2col of every channel.
+		void BackwardPropagation(void);
+		// Update function
+		void Update(void);
+		// Sum up the delta of a batch.
+		void BatchDeltaSumUpdate(const size_t _batchSize);
+		// Clear the deltaSum of a batch.
+		void BatchDeltaSumClear(void);
+
+	private: // Inner working function
+
+		ConvGeometry ForwardGeometry(void) const;
+		// The depthwise convolution of the input into _depthwiseOutput, biases included.
+		void ForwardDepthwise(const ConvGeometry & _geometry);
+
+	public:
+
+		// Depthwise kernels, one per input channel, their features are the depthwise output.
+		std::vector<ConvNode> _depthwiseNodes;
+		// Pointwise kernels, 1 x InputChannels, their features are the output of the layer.
+		std::vector<ConvNode> _pointwiseNodes;
+
+		size_t _channelNum;
+		size_t _kernelNum;
+		MathLib::Size _kernelSize;
+		size_t _stride;
+		size_t _dilation;
+		MathLib::Size _inputSize;
+		MathLib::Size _outputSize;
+		size_t _paddingM;
+		size_t _paddingN;
+
+		// Learning rate
+		/// Default value is 1
+		double learnRate = 1;
+
+		std::vector<MathLib::Matrix<ElemType>> _input;
+		std::vector<MathLib::Matrix<ElemType>> _derivativeLastLayer;
+		std::vector<MathLib::Matrix<ElemType>> _derivative;
+
+		// Kernel cache, see ConvolutionalLayer.
+		size_t _kernelVersion = 0;
+		KernelCacheEntry<ElemType> _packedDepthwise;
+		KernelCacheEntry<ElemType> _packedPointwise;
+
+		// Work buffers, kept between calls to avoid allocations.
+		/// _depthwiseOutput is InputChannels x pixels and is read again by the backward propagation.
+		std::vector<ElemType> _padded;
+		std::vector<ElemType> _depthwiseOutput;
+		std::vector<ElemType> _output;
+		std::vector<ElemType> _outputDelta;
+		std::vector<ElemType> _depthwiseDelta;
+		std::vector<ElemType> _kernelGradient;
+		std::vector<ElemType> _column;
+		std::vector<ElemType> _columnDelta;
+	};
+}
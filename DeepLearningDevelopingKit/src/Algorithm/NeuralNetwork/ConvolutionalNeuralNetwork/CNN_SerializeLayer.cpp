@@ -25,35 +25,31 @@ void Neural::SerializeLayer::SetDeserializedMat(const std::vector<MathLib::Matri
 
 MathLib::Matrix<Neural::ElemType> Neural::SerializeLayer::Serialize(void)
 {
-	_serializedMat.Clear();
-	for (size_t i = 0; i < _deserializedMat.size(); i++)
-	{
-		for (size_t a = 0; a <_deserializedSize.m; a++)
-		{
-			for (size_t b = 0; b < _deserializedSize.n; b++)
-			{
-				_serializedMat(i * _deserializedSize.m*_deserializedSize.n + a * _deserializedSize.m + b, 0) = _deserializedMat.at(i)(a, b);
-			}
-		}
-	}
+	_serializedMat = MathLib::Matrix<ElemType>::Join(_deserializedMat, _serializedSize.m, _serializedSize.n);
 	return _serializedMat;
 }
 
 std::vector<MathLib::Matrix<Neural::ElemType>> Neural::SerializeLayer::Deserialize(void)
 {
+	_deserializedMat = _serializedMat.Split(_deserializedSize.m, _deserializedSize.n);
+	return _deserializedMat;
+}
+
+MathLib::Vector<Neural::ElemType> Neural::SerializeLayer::SerializeVector(void)
+{
+	// The layer keeps no reference, so a freshly joined buffer is handed over as is.
+	MathLib::Matrix<ElemType> serialized = MathLib::Matrix<ElemType>::Join(_deserializedMat, _serializedSize.m, _serializedSize.n);
 	_deserializedMat.clear();
-	size_t deserializedNum = _serializedSize.m / (_deserializedSize.m * _deserializedSize.n);
-	for (size_t i = 0; i < deserializedNum; i++)
+	return MathLib::Vector<ElemType>(serialized.Release());
+}
+
+std::vector<MathLib::Matrix<Neural::ElemType>> Neural::SerializeLayer::DeserializeVector(MathLib::Vector<ElemType> && _input)
+{
+	if (_input.Size() != _serializedSize.m * _serializedSize.n)
 	{
-		MathLib::Matrix<ElemType> tempMat(_deserializedSize.m, _deserializedSize.n);
-		for (size_t a = 0; a <_deserializedSize.m; a++)
-		{
-			for (size_t b = 0; b < _deserializedSize.n; b++)
-			{
-				tempMat(a, b) = _serializedMat(i * _deserializedSize.m * _deserializedSize.n + a * _deserializedSize.m + b, 0);
-			}
-		}
-		_deserializedMat.push_back(tempMat);
+		std::cerr << "ERROR : Serialized Vector size does not match the SerializeLayer." << std::endl;
+		return std::vector<MathLib::Matrix<ElemType>>();
 	}
-	return _deserializedMat;
+	_serializedMat = MathLib::Matrix<ElemType>(_input.Release(), _serializedSize.m, _serializedSize.n);
+	return Deserialize();
 }
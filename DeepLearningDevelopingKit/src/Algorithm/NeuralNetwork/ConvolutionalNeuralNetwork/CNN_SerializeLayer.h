@@ -4,6 +4,7 @@
 /*                                                   www.tianshicangxie.com                                                        */
 /*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
 /***************************************************************************************************/
+#pragma once
 
 #include "..\..\..\MathLib\MathLib.h"
 
@@ -28,6 +29,8 @@ namespace Neural
 	// Class : Serialize Layer
 	/// Used for serialize the data from a serial of Matrix into a single Vector, and
 	/// deserialize it back in the oppsite diraction.
+	/// Both directions are reshapes : the serialized Matrix and the deserialized Matrixs view the
+	/// same buffer, feature maps that already are consecutive views of one buffer are never copied.
 	class SerializeLayer
 	{
 	public:
@@ -41,6 +44,13 @@ namespace Neural
 		MathLib::Matrix<ElemType> Serialize(void);
 		std::vector<MathLib::Matrix<ElemType>> Deserialize(void);
 
+		// Serialize into a Vector for the fully connected layers.
+		/// The buffer is moved into the Vector, it is only copied when the feature maps are still shared.
+		MathLib::Vector<ElemType> SerializeVector(void);
+		// Deserialize a Vector coming back from the fully connected layers.
+		/// The buffer of _input is taken over and the Matrixs returned view it.
+		std::vector<MathLib::Matrix<ElemType>> DeserializeVector(MathLib::Vector<ElemType> && _input);
+
 	private:
 
 		MathLib::Matrix<ElemType> _serializedMat;
@@ -0,0 +1,267 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 Convolutional Neural Network     	                                          */
+/*								        		 	   Winograd Convolution     	                                                   */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <algorithm>
+
+#include "CNN_Convolution.h"
+
+/***************************************************************************************************/
+// Namespace : Neural
+/// Provide Neural Network algorithm library.
+namespace Neural
+{
+	// Winograd tile
+	/// F2x2 : F(2x2, 3x3), 4x4 input tiles, 16 instead of 36 multiplications per tile (2.25x).
+	/// F4x4 : F(4x4, 3x3), 6x6 input tiles, 36 instead of 144 multiplications per tile (4x),
+	/// its transforms carry larger constants, so its rounding error is a few times that of F2x2.
+	enum class WinogradTile {
+		F2x2,
+		F4x4
+	};
+
+	/***************************************************************************************************/
+	// Class : Winograd
+	/// Minimal filtering 3x3 cross-correlation at stride 1 (Lavin & Gray) :
+	/// Y = A^T * [(G * g * G^T) . (B^T * d * B)] * A for every output tile.
+	/// Kernels are transformed once by TransformKernels(). Forward() transforms all input tiles in one
+	/// batch, then for every tile multiplies it elementwise against each transformed kernel and transforms
+	/// the product straight back, so the products never leave the stack.
+	/// The B^T and A^T transforms are written out by hand, they are mostly additions.
+	/// With a single input channel the A^T transform runs once per kernel and tile, as many operations as
+	/// the elementwise stage saves, so the engine does not beat a GEMM on the lowered input.
+	template<class T>
+	class Winograd
+	{
+	public:
+
+		explicit Winograd(const WinogradTile _tile = WinogradTile::F4x4);
+
+	public:
+
+		// Size of an output tile.
+		inline size_t OutputTile(void) const { return _m; }
+		// Size of an input tile, OutputTile() + 2.
+		inline size_t InputTile(void) const { return _m + 2; }
+		inline WinogradTile GetTile(void) const { return _tile; }
+
+		// Transform _kernelNum contiguous 3x3 cross-correlation kernels.
+		/// _transformed receives _kernelNum x InputTile()^2 elements.
+		void TransformKernels(const T * _kernels, const size_t _kernelNum, std::vector<T> & _transformed) const;
+
+		// Cross-correlate one input with every transformed kernel.
+		/// _geometry must describe a 3x3 kernel at stride 1, _output receives _kernelNum x OutputPixels() elements.
+		void Forward(const T * _input, const ConvGeometry & _geometry, const T * _transformed, const size_t _kernelNum, T * _output);
+
+	private:
+
+		// One dimensional B^T and A^T transforms of a strided vector.
+		template<size_t M> static void InputTransform(const T * _d, const size_t _in, T * _v, const size_t _out);
+		template<size_t M> static void OutputTransform(const T * _p, const size_t _in, T * _y, const size_t _out);
+		// Two dimensional tile transforms, columns first then rows.
+		template<size_t M> static void InputTile(const T * _d, T * _v);
+		template<size_t M> static void OutputTile(const T * _p, T * _y);
+		template<size_t M> void ForwardTiles(const T * _input, const ConvGeometry & _geometry, const T * _transformed, const size_t _kernelNum, T * _output);
+
+	private:
+
+		WinogradTile _tile;
+		size_t _m;
+		// Kernel transform G, (m + 2) x 3.
+		std::vector<T> _G;
+		// Transformed input tiles, tiles x InputTile()^2.
+		std::vector<T> _inputTiles;
+	};
+}
+
+
+namespace Neural
+{
+	template<class T>
+	Winograd<T>::Winograd(const WinogradTile _tile)
+		: _tile(_tile)
+	{
+		if (_tile == WinogradTile::F2x2)
+		{
+			_m = 2;
+			_G = {
+				T(1),      T(0),      T(0),
+				T(0.5),  T(0.5),  T(0.5),
+				T(0.5), T(-0.5),  T(0.5),
+				T(0),      T(0),      T(1) };
+		}
+		else
+		{
+			_m = 4;
+			_G = {
+				T(1) / 4,          T(0),          T(0),
+				T(-1) / 6,   T(-1) / 6,   T(-1) / 6,
+				T(-1) / 6,    T(1) / 6,   T(-1) / 6,
+				T(1) / 24,   T(1) / 12,    T(1) / 6,
+				T(1) / 24,  T(-1) / 12,    T(1) / 6,
+				T(0),          T(0),          T(1) };
+		}
+	}
+
+	template<class T>
+	template<size_t M>
+	void Winograd<T>::InputTransform(const T * _d, const size_t _in, T * _v, const size_t _out)
+	{
+		if (M == 2)
+		{
+			const T d0 = _d[0], d1 = _d[_in], d2 = _d[2 * _in], d3 = _d[3 * _in];
+			_v[0] = d0 - d2;
+			_v[_out] = d1 + d2;
+			_v[2 * _out] = d2 - d1;
+			_v[3 * _out] = d1 - d3;
+		}
+		else
+		{
+			const T d0 = _d[0], d1 = _d[_in], d2 = _d[2 * _in], d3 = _d[3 * _in], d4 = _d[4 * _in], d5 = _d[5 * _in];
+			_v[0] = 4 * d0 - 5 * d2 + d4;
+			_v[_out] = d3 + d4 - 4 * (d1 + d2);
+			_v[2 * _out] = d4 - d3 + 4 * (d1 - d2);
+			_v[3 * _out] = d4 - d2 + 2 * (d3 - d1);
+			_v[4 * _out] = d4 - d2 + 2 * (d1 - d3);
+			_v[5 * _out] = 4 * d1 - 5 * d3 + d5;
+		}
+	}
+
+	template<class T>
+	template<size_t M>
+	void Winograd<T>::OutputTransform(const T * _p, const size_t _in, T * _y, const size_t _out)
+	{
+		if (M == 2)
+		{
+			const T p0 = _p[0], p1 = _p[_in], p2 = _p[2 * _in], p3 = _p[3 * _in];
+			_y[0] = p0 + p1 + p2;
+			_y[_out] = p1 - p2 - p3;
+		}
+		else
+		{
+			const T p0 = _p[0], p1 = _p[_in], p2 = _p[2 * _in], p3 = _p[3 * _in], p4 = _p[4 * _in], p5 = _p[5 * _in];
+			const T sum12 = p1 + p2, difference12 = p1 - p2, sum34 = p3 + p4, difference34 = p3 - p4;
+			_y[0] = p0 + sum12 + sum34;
+			_y[_out] = difference12 + 2 * difference34;
+			_y[2 * _out] = sum12 + 4 * sum34;
+			_y[3 * _out] = difference12 + 8 * difference34 + p5;
+		}
+	}
+
+	template<class T>
+	template<size_t M>
+	void Winograd<T>::InputTile(const T * _d, T * _v)
+	{
+		const size_t alpha = M + 2;
+		T temp[6 * 6];
+		for (size_t j = 0; j < alpha; j++)
+			InputTransform<M>(_d + j, alpha, temp + j, alpha);
+		for (size_t i = 0; i < alpha; i++)
+			InputTransform<M>(temp + i * alpha, 1, _v + i * alpha, 1);
+	}
+
+	template<class T>
+	template<size_t M>
+	void Winograd<T>::OutputTile(const T * _p, T * _y)
+	{
+		const size_t alpha = M + 2;
+		T temp[4 * 6];
+		for (size_t j = 0; j < alpha; j++)
+			OutputTransform<M>(_p + j, alpha, temp + j, alpha);
+		for (size_t i = 0; i < M; i++)
+			OutputTransform<M>(temp + i * alpha, 1, _y + i * M, 1);
+	}
+
+	template<class T>
+	void Winograd<T>::TransformKernels(const T * _kernels, const size_t _kernelNum, std::vector<T> & _transformed) const
+	{
+		const size_t alpha = InputTile();
+		_transformed.resize(_kernelNum * alpha * alpha);
+		T temp[6 * 3];
+		for (size_t k = 0; k < _kernelNum; k++)
+		{
+			const T * g = _kernels + k * 9;
+			T * u = _transformed.data() + k * alpha * alpha;
+			// temp (alpha x 3) = G * g, u (alpha x alpha) = temp * G^T
+			for (size_t i = 0; i < alpha; i++)
+				for (size_t j = 0; j < 3; j++)
+					temp[i * 3 + j] = _G[i * 3] * g[j] + _G[i * 3 + 1] * g[3 + j] + _G[i * 3 + 2] * g[6 + j];
+			for (size_t i = 0; i < alpha; i++)
+				for (size_t j = 0; j < alpha; j++)
+					u[i * alpha + j] = temp[i * 3] * _G[j * 3] + temp[i * 3 + 1] * _G[j * 3 + 1] + temp[i * 3 + 2] * _G[j * 3 + 2];
+		}
+	}
+
+	template<class T>
+	void Winograd<T>::Forward(const T * _input, const ConvGeometry & _geometry, const T * _transformed, const size_t _kernelNum, T * _output)
+	{
+		if (_m == 2)
+			ForwardTiles<2>(_input, _geometry, _transformed, _kernelNum, _output);
+		else
+			ForwardTiles<4>(_input, _geometry, _transformed, _kernelNum, _output);
+	}
+
+	template<class T>
+	template<size_t M>
+	void Winograd<T>::ForwardTiles(const T * _input, const ConvGeometry & _geometry, const T * _transformed, const size_t _kernelNum, T * _output)
+	{
+		const size_t alpha = M + 2, positions = alpha * alpha;
+		const size_t inputM = _geometry.Input.m, inputN = _geometry.Input.n;
+		const size_t outputM = _geometry.Output.m, outputN = _geometry.Output.n;
+		const size_t tileM = (outputM + M - 1) / M, tileN = (outputN + M - 1) / M;
+		_inputTiles.resize(tileM * tileN * positions);
+
+		// Input transform of every tile, reads outside the input are zero (implicit padding).
+		MathLib::ParallelFor(0, tileM, [&](size_t _tileBegin, size_t _tileEnd) {
+			T d[6 * 6];
+			for (size_t ti = _tileBegin; ti < _tileEnd; ti++)
+				for (size_t tj = 0; tj < tileN; tj++)
+				{
+					const long long rowBegin = (long long)(ti * M) - (long long)_geometry.Padding.m;
+					const long long columnBegin = (long long)(tj * M) - (long long)_geometry.Padding.n;
+					const bool interior = rowBegin >= 0 && columnBegin >= 0
+						&& rowBegin + (long long)alpha <= (long long)inputM && columnBegin + (long long)alpha <= (long long)inputN;
+					for (size_t i = 0; i < alpha; i++)
+					{
+						const long long row = rowBegin + (long long)i;
+						for (size_t j = 0; j < alpha; j++)
+						{
+							const long long column = columnBegin + (long long)j;
+							d[i * alpha + j] = interior || (row >= 0 && row < (long long)inputM && column >= 0 && column < (long long)inputN)
+								? _input[row * (long long)inputN + column] : T(0);
+						}
+					}
+					InputTile<M>(d, _inputTiles.data() + (ti * tileN + tj) * positions);
+				}
+		}, MathLib::ThreadPool::Grain(tileN * positions * alpha));
+
+		// Elementwise product and output transform, clipped at the border of the output.
+		MathLib::ParallelFor(0, tileM, [&](size_t _tileBegin, size_t _tileEnd) {
+			T product[6 * 6], y[4 * 4];
+			for (size_t ti = _tileBegin; ti < _tileEnd; ti++)
+				for (size_t tj = 0; tj < tileN; tj++)
+				{
+					const T * v = _inputTiles.data() + (ti * tileN + tj) * positions;
+					const size_t rows = std::min(M, outputM - ti * M), columns = std::min(M, outputN - tj * M);
+					for (size_t k = 0; k < _kernelNum; k++)
+					{
+						const T * u = _transformed + k * positions;
+						for (size_t p = 0; p < positions; p++)
+							product[p] = u[p] * v[p];
+						OutputTile<M>(product, y);
+						T * out = _output + k * outputM * outputN + ti * M * outputN + tj * M;
+						for (size_t i = 0; i < rows; i++)
+							for (size_t j = 0; j < columns; j++)
+								out[i * outputN + j] = y[i * M + j];
+					}
+				}
+		}, MathLib::ThreadPool::Grain(tileN * positions * _kernelNum * 2));
+	}
+}
@@ -9,6 +9,8 @@
 
 #include <cmath>
 
+#include "..\..\MathLib\FastMath.hpp"
+
 /************************************************************************************************************/
 /* Loss functions */
 enum class LossFunction {
@@ -40,5 +42,5 @@ inline double ZeroOne(double x) {
 
 // Cross-Entropy Cost Function
 inline double CEC(double _predict, double _expectation) {
-	return -1 * (_expectation * log(_predict) + (1 - _expectation)*log(1 - _predict));
+	return -1 * (_expectation * MathLib::FastMath::Log(_predict) + (1 - _expectation) * MathLib::FastMath::Log1P(-_predict));
 }
\ No newline at end of file
@@ -11,7 +11,9 @@
 
 Data::NumericSet::NumericSet()
 {
-
+	sampleSize = 0;
+	inputSize = 0;
+	lableSize = 0;
 }
 
 void Data::NumericSet::LoadFromJson(const std::string & _filePath)
@@ -22,6 +24,9 @@ void Data::NumericSet::LoadFromJson(const std::string & _filePath)
 void Data::NumericSet::AddToSet(const Sample & _sample)
 {
 	_samples.push_back(_sample);
+	sampleSize = _samples.size();
+	inputSize = _sample.first.Size();
+	lableSize = _sample.second.Size();
 }
 
 void Data::NumericSet::Serialize(const std::string & _filePath, const std::vector<Sample>& _samples) const
@@ -98,7 +103,8 @@ void Data::NumericSet::PrintToConsole(void)
 
 Data::ImageSet::ImageSet()
 {
-
+	sampleSize = 0;
+	lableSize = 0;
 }
 
 const Data::ImageSet::Sample Data::ImageSet::GetBatch(void) const
@@ -5,6 +5,7 @@
 /*                                                   www.tianshicangxie.com                                                        */
 /*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
 /***************************************************************************************************/
+#pragma once
 
 // Header files
 #include <vector>
@@ -0,0 +1,190 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	   Principal Component Analysis                                               */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// Header files
+#include "PCA.h"
+
+Data::PCA::PCA(const size_t _componentNum, const PCAMethod _method)
+{
+	this->_componentNum = _componentNum;
+	this->_method = _method;
+}
+
+void Data::PCA::Fit(const NumericSet & _set)
+{
+	const size_t sampleNum = _set.GetSampleSize();
+	if (sampleNum == 0)
+	{
+		std::cerr << "ERROR : PCA fitted on an empty dataset." << std::endl;
+		return;
+	}
+	const size_t inputSize = _set.GetSample(0).first.Size();
+	Matrix<double> data(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		const Vector<double> input = _set.GetSample(i).first;
+		for (size_t j = 0; j < inputSize; j++)
+			data(i, j) = input(j);
+	}
+	Fit(data);
+}
+
+void Data::PCA::Fit(const ImageSet & _set)
+{
+	const size_t sampleNum = _set.GetSampleSize();
+	if (sampleNum == 0)
+	{
+		std::cerr << "ERROR : PCA fitted on an empty dataset." << std::endl;
+		return;
+	}
+	const Matrix<double> & first = _set.GetSample(0).first;
+	const size_t inputSize = first.ColumeSize() * first.RowSize();
+	Matrix<double> data(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		const Matrix<double> image = _set.GetSample(i).first;
+		std::copy(image.Data(), image.Data() + inputSize, data.Data() + i * inputSize);
+	}
+	Fit(data);
+}
+
+void Data::PCA::Fit(const Matrix<double> & _data)
+{
+	const size_t sampleNum = _data.ColumeSize();
+	const size_t inputSize = _data.RowSize();
+	const size_t componentNum = std::min(_componentNum, std::min(sampleNum, inputSize));
+	if (componentNum == 0)
+	{
+		std::cerr << "ERROR : PCA fitted without samples or components." << std::endl;
+		return;
+	}
+
+	// Center the data.
+	std::vector<double> sum(inputSize, 0.0);
+	const double * data = _data.Data();
+	ParallelAccumulate(0, sampleNum, inputSize, [data, inputSize](size_t _sample, double * _accumulator) {
+		for (size_t j = 0; j < inputSize; j++)
+			_accumulator[j] += data[_sample * inputSize + j];
+	}, sum.data(), 64);
+	_mean = Vector<double>(inputSize);
+	for (size_t j = 0; j < inputSize; j++)
+		_mean(j) = sum[j] / sampleNum;
+	Matrix<double> centered(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+		for (size_t j = 0; j < inputSize; j++)
+			centered(i, j) = _data(i, j) - _mean(j);
+	const double scale = sampleNum > 1 ? 1.0 / (sampleNum - 1) : 1.0;
+
+	_components = Matrix<double>(inputSize, componentNum);
+	_variance = Vector<double>(componentNum);
+	switch (_method)
+	{
+	case PCAMethod::RandomizedSVD:
+	{
+		std::tuple<Matrix<double>, Vector<double>, Matrix<double>> svd = MatrixDecomposition::RandomizedSVD(centered, componentNum);
+		_components = std::get<2>(svd);
+		for (size_t k = 0; k < componentNum; k++)
+			_variance(k) = std::get<1>(svd)(k) * std::get<1>(svd)(k) * scale;
+		break;
+	}
+	case PCAMethod::Covariance:
+	default:
+	{
+		Matrix<double> covariance = MatMul(centered, centered, Transpose::Trans);
+		std::pair<Vector<double>, Matrix<double>> eigen = MatrixDecomposition::EVD(covariance);
+		for (size_t k = 0; k < componentNum; k++)
+		{
+			const size_t column = inputSize - 1 - k;
+			_variance(k) = std::max(eigen.first(column), 0.0) * scale;
+			for (size_t j = 0; j < inputSize; j++)
+				_components(j, k) = eigen.second(j, column);
+		}
+		break;
+	}
+	}
+}
+
+Vector<double> Data::PCA::Transform(const Vector<double> & _input) const
+{
+	const size_t inputSize = _components.ColumeSize();
+	const size_t componentNum = _components.RowSize();
+	Vector<double> output(componentNum);
+	for (size_t j = 0; j < inputSize; j++)
+	{
+		const double centered = _input(j) - _mean(j);
+		for (size_t k = 0; k < componentNum; k++)
+			output(k) += centered * _components(j, k);
+	}
+	return output;
+}
+
+Vector<double> Data::PCA::Transform(const Matrix<double> & _image) const
+{
+	const size_t inputSize = _components.ColumeSize();
+	Vector<double> input(inputSize);
+	for (size_t j = 0; j < inputSize; j++)
+		input(j) = _image.Data()[j];
+	return Transform(input);
+}
+
+Data::NumericSet Data::PCA::Transform(const NumericSet & _set) const
+{
+	const size_t sampleNum = _set.GetSampleSize();
+	const size_t inputSize = _components.ColumeSize();
+	Matrix<double> data(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		const Vector<double> input = _set.GetSample(i).first;
+		for (size_t j = 0; j < inputSize; j++)
+			data(i, j) = input(j);
+	}
+	const Matrix<double> projected = TransformMatrix(data);
+
+	NumericSet output;
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		Vector<double> input(projected.RowSize());
+		for (size_t k = 0; k < projected.RowSize(); k++)
+			input(k) = projected(i, k);
+		output.AddToSet(NumericSet::Sample(input, _set.GetSample(i).second));
+	}
+	return output;
+}
+
+Data::NumericSet Data::PCA::Transform(const ImageSet & _set) const
+{
+	const size_t sampleNum = _set.GetSampleSize();
+	const size_t inputSize = _components.ColumeSize();
+	Matrix<double> data(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		const Matrix<double> image = _set.GetSample(i).first;
+		std::copy(image.Data(), image.Data() + inputSize, data.Data() + i * inputSize);
+	}
+	const Matrix<double> projected = TransformMatrix(data);
+
+	NumericSet output;
+	for (size_t i = 0; i < sampleNum; i++)
+	{
+		Vector<double> input(projected.RowSize());
+		for (size_t k = 0; k < projected.RowSize(); k++)
+			input(k) = projected(i, k);
+		output.AddToSet(NumericSet::Sample(input, _set.GetSample(i).second));
+	}
+	return output;
+}
+
+Matrix<double> Data::PCA::TransformMatrix(const Matrix<double> & _data) const
+{
+	const size_t sampleNum = _data.ColumeSize();
+	const size_t inputSize = _components.ColumeSize();
+	Matrix<double> centered(sampleNum, inputSize);
+	for (size_t i = 0; i < sampleNum; i++)
+		for (size_t j = 0; j < inputSize; j++)
+			centered(i, j) = _data(i, j) - _mean(j);
+	return MatMul(centered, _components);
+}
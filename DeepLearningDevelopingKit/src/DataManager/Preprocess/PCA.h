@@ -0,0 +1,77 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	   Principal Component Analysis                                               */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <iostream>
+
+#include "..\..\MathLib\MathLib.h"
+#include "..\..\Algorithm\MatrixAnalysis\EVD.hpp"
+#include "..\..\Algorithm\MatrixAnalysis\SVD.hpp"
+#include "..\Dataset\DataSet.h"
+
+/***************************************************************************************************/
+// Namespace : Data
+/// Used for management of data.
+namespace Data
+{
+	// PCA Method
+	/// Covariance : eigen decomposition of the full covariance matrix, exact.
+	/// RandomizedSVD : randomized truncated SVD of the centered data, for wide inputs such as images.
+	enum class PCAMethod {
+		Covariance,
+		RandomizedSVD
+	};
+
+	/***************************************************************************************************/
+	// Class : PCA
+	/// Projects the inputs of a dataset onto their first principal components.
+	/// Images are flattened row by row, lables are passed through untouched.
+	class PCA
+	{
+	public:
+
+		PCA(const size_t _componentNum, const PCAMethod _method = PCAMethod::Covariance);
+
+	public: // Fit
+
+		// Fit on the inputs of a dataset.
+		void Fit(const NumericSet & _set);
+		void Fit(const ImageSet & _set);
+		// Fit on a data matrix, one sample per row.
+		void Fit(const Matrix<double> & _data);
+
+	public: // Transform
+
+		Vector<double> Transform(const Vector<double> & _input) const;
+		Vector<double> Transform(const Matrix<double> & _image) const;
+		NumericSet Transform(const NumericSet & _set) const;
+		NumericSet Transform(const ImageSet & _set) const;
+		// Transform a data matrix, one sample per row.
+		Matrix<double> TransformMatrix(const Matrix<double> & _data) const;
+
+	public: // Getter
+
+		inline size_t GetComponentNum(void) const { return this->_componentNum; }
+		// Mean of the fitted inputs.
+		inline const Vector<double> & GetMean(void) const { return this->_mean; }
+		// Principal directions as columns, input size x component number.
+		inline const Matrix<double> & GetComponents(void) const { return this->_components; }
+		// Variance of the fitted inputs along every principal direction.
+		inline const Vector<double> & GetExplainedVariance(void) const { return this->_variance; }
+
+	private:
+
+		size_t _componentNum;
+		PCAMethod _method;
+
+		Vector<double> _mean;
+		Matrix<double> _components;
+		Vector<double> _variance;
+	};
+}
@@ -10,9 +10,6 @@
 #ifdef CNNImageRecognization
 #include "..\\Algorithm\NeuralNetwork\NeuralLib.h"
 
-Vector<double> Matrix2Vector(const Matrix<double> & _mat);
-Matrix<double> Vector2Matrix(const Vector<double> & _vec);
-
 int main(int argc, char ** argv)
 {
 	// Visualization
@@ -130,128 +127,136 @@ int main(int argc, char ** argv)
 
 	/***************************************************************************************************/
 	// Start Training
+	/// The convolutional part propagates batchSize samples per call, the fully connected part runs
+	/// sample by sample in between.
+	const size_t batchSize = 8;
 	int totalTrainIteration = 100;
 	for (size_t iteration = 0; iteration < totalTrainIteration; iteration++)
 	{
-		for (size_t ID = 0; ID < TrainSet.GetSampleSize(); ID++)
+		for (size_t first = 0; first < TrainSet.GetSampleSize(); first += batchSize)
 		{
-			auto sample = TrainSet.GetSample(ID);
-
-			// Initialzing input
-			std::vector<MathLib::Matrix<double>> input{ sample.first + Random() };
+			const size_t count = std::min<size_t>(batchSize, TrainSet.GetSampleSize() - first);
+
+			// Initialzing input and lables
+			Neural::FeatureBatch input(count);
+			std::vector<MathLib::Vector<double>> lables;
+			for (size_t n = 0; n < count; n++)
+			{
+				auto sample = TrainSet.GetSample(first + n);
+				input[n] = { sample.first + Random() };
+				lables.push_back(sample.second);
+			}
 
 			/***************************************************************************************************/
 			// Forward Propagation
 			// convLayer 1
-			convLayer1.SetInput(input);
-			convLayer1.ForwardPropagation();
+			convLayer1.SetInputBatch(input);
+			convLayer1.ForwardPropagationBatch();
 			std::vector<Neural::ConvKernel> conv1kernals = convLayer1.GetKernelAll();
-			std::vector<Neural::ConvFeature> conv1features = convLayer1.GetFeatureAll();
+			Neural::FeatureBatch conv1features = convLayer1.GetFeatureBatch();
 			// poolLayer 1
-			poolLayer1.SetInput(conv1features);
-			poolLayer1.ForwardPropagation();
-			std::vector<Neural::Feature> pool1features = poolLayer1.GetFeatureAll();
+			poolLayer1.SetInputBatch(conv1features);
+			poolLayer1.ForwardPropagationBatch();
+			Neural::FeatureBatch pool1features = poolLayer1.GetFeatureBatch();
 			// processLayer 1
-			process1.SetInput(pool1features);
-			process1.Process();
-			std::vector<Neural::Feature> process1output = process1.GetOutputAll();
+			Neural::FeatureBatch process1output = pool1features;
+			process1.Process(process1output);
 			// convLayer 2
-			convLayer2.SetInput(process1output);
-			convLayer2.ForwardPropagation();
+			convLayer2.SetInputBatch(process1output);
+			convLayer2.ForwardPropagationBatch();
 			std::vector<Neural::ConvKernel> conv2kernals = convLayer2.GetKernelAll();
-			std::vector<Neural::ConvFeature> conv2features = convLayer2.GetFeatureAll();
+			Neural::FeatureBatch conv2features = convLayer2.GetFeatureBatch();
 			// poolLayer 2
-			poolLayer2.SetInput(conv2features);
-			poolLayer2.ForwardPropagation();
-			std::vector<Neural::Feature> pool2features = poolLayer2.GetFeatureAll();
+			poolLayer2.SetInputBatch(conv2features);
+			poolLayer2.ForwardPropagationBatch();
+			Neural::FeatureBatch pool2features = poolLayer2.GetFeatureBatch();
 			// processLayer 2
-			process2.SetInput(pool2features);
-			process2.Process();
-			std::vector<Neural::Feature> process2output = process2.GetOutputAll();
-			// serialLayer
-			serial.SetDeserializedMat(process2output);
-			MathLib::Vector<double> serializedVec = Matrix2Vector(serial.Serialize());
-			// inputLayer
-			inputLayer.SetInput(serializedVec);
-			inputLayer.ForwardPropagation();
-			MathLib::Vector<double> inputout = inputLayer.GetOutput();
-			// hiddenLayer 1
-			hiddenLayer1.SetInput(inputout);
-			hiddenLayer1.ForwardPropagation();
-			MathLib::Vector<double> hidden1output = hiddenLayer1.GetOutput();
-			// hiddenLayer 2
-			hiddenLayer2.SetInput(hidden1output);
-			hiddenLayer2.ForwardPropagation();
-			MathLib::Vector<double> hidden2output = hiddenLayer2.GetOutput();
-			// outputLayer
-			outputLayer.SetInput(hidden2output);
-			outputLayer.ForwardPropagation();
-			MathLib::Vector<double> output = outputLayer.GetOutput();
+			Neural::FeatureBatch process2output = pool2features;
+			process2.Process(process2output);
+
+			// Fully connected part, forward and backward for every sample of the batch.
+			Neural::FeatureBatch deserialized(count);
+			for (size_t n = 0; n < count; n++)
+			{
+				// serialLayer
+				serial.SetDeserializedMat(process2output[n]);
+				MathLib::Vector<double> serializedVec = serial.SerializeVector();
+				// inputLayer
+				inputLayer.SetInput(serializedVec);
+				inputLayer.ForwardPropagation();
+				MathLib::Vector<double> inputout = inputLayer.GetOutput();
+				// hiddenLayer 1
+				hiddenLayer1.SetInput(inputout);
+				hiddenLayer1.ForwardPropagation();
+				MathLib::Vector<double> hidden1output = hiddenLayer1.GetOutput();
+				// hiddenLayer 2
+				hiddenLayer2.SetInput(hidden1output);
+				hiddenLayer2.ForwardPropagation();
+				MathLib::Vector<double> hidden2output = hiddenLayer2.GetOutput();
+				// outputLayer
+				outputLayer.SetInput(hidden2output);
+				outputLayer.ForwardPropagation();
+				MathLib::Vector<double> output = outputLayer.GetOutput();
+
+				// Calculating Error
+				MathLib::Vector<double> error = output - lables[n];
+
+				MathLib::Vector<double> outputLayerDelta = outputLayer.BackwardPropagation(lables[n]);
+				// hiddenLayer 1
+				MathLib::Vector<double> hiddenLayer2Delta = hiddenLayer2.BackwardPropagation(outputLayerDelta);
+				// hiddenLayer 2
+				MathLib::Vector<double> hiddenLayer1Delta = hiddenLayer1.BackwardPropagation(hiddenLayer2Delta);
+				// outputLayer
+				MathLib::Vector<double> inputLayerDelta = inputLayer.BackwardPropagation(hiddenLayer1Delta);
+				// serialLayer
+				deserialized[n] = serial.DeserializeVector(std::move(inputLayerDelta));
+
+				int batchsize = TrainSet.GetSampleSize();
+				hiddenLayer1.BatchDeltaSumUpdate(batchsize);
+				hiddenLayer2.BatchDeltaSumUpdate(batchsize);
+				outputLayer.BatchDeltaSumUpdate(batchsize);
+
+				outputLayer.LossSumUpdate();
+			}
 			/***************************************************************************************************/
 
-			// Initialzing lable
-			MathLib::Vector<double> lable = sample.second;
-
-			// Calculating Error
-			MathLib::Vector<double> error = output - lable;
-
 			/***************************************************************************************************/
 			// Backward Propagation
-			MathLib::Vector<double> outputLayerDelta = outputLayer.BackwardPropagation(lable);
-			// hiddenLayer 1
-			MathLib::Vector<double> hiddenLayer2Delta = hiddenLayer2.BackwardPropagation(outputLayerDelta);
-			// hiddenLayer 2
-			MathLib::Vector<double> hiddenLayer1Delta = hiddenLayer1.BackwardPropagation(hiddenLayer2Delta);
-			// outputLayer
-			MathLib::Vector<double> inputLayerDelta = inputLayer.BackwardPropagation(hiddenLayer1Delta);
-			// serialLayer
-			serial.SetSerializedMat(Vector2Matrix(inputLayerDelta));
-			std::vector<MathLib::Matrix<double>> deserialized = serial.Deserialize();
 			// process 2
-			process2.SetInput(deserialized);
-			process2.Deprocess();
-			std::vector<MathLib::Matrix<double>> deprocess2output = process2.GetOutputAll();
+			process2.Deprocess(deserialized);
 			// poolLayer 2
-			poolLayer2.SetDelta(deprocess2output);
-			poolLayer2.BackwardPropagation();
-			std::vector<MathLib::Matrix<double>> pool2Delta = poolLayer2.GetDelta();
+			poolLayer2.SetDeltaBatch(deserialized);
+			poolLayer2.BackwardPropagationBatch();
 			// convLayer 2
-			convLayer2.SetDelta(pool2Delta);
-			convLayer2.BackwardPropagation();
-			std::vector<MathLib::Matrix<double>> conv2Delta = convLayer2.GetDelta();
+			convLayer2.SetDeltaBatch(poolLayer2.GetDeltaBatch());
+			convLayer2.BackwardPropagationBatch();
+			Neural::FeatureBatch conv2Delta = convLayer2.GetDeltaBatch();
 			// process 1
-			process1.SetInput(conv2Delta);
-			process1.Deprocess();
-			std::vector<MathLib::Matrix<double>> deprocess1output = process1.GetOutputAll();
+			process1.Deprocess(conv2Delta);
 			// poolLayer 1
-			poolLayer1.SetDelta(deprocess1output);
-			poolLayer1.BackwardPropagation();
-			std::vector<MathLib::Matrix<double>> pool1Delta = poolLayer1.GetDelta();
+			poolLayer1.SetDeltaBatch(conv2Delta);
+			poolLayer1.BackwardPropagationBatch();
 			// convLayer 1
-			convLayer1.SetDelta(pool1Delta);
-			convLayer1.BackwardPropagation();
-			std::vector<MathLib::Matrix<double>> conv1Delta = convLayer1.GetDelta();
+			convLayer1.SetDeltaBatch(poolLayer1.GetDeltaBatch());
+			convLayer1.BackwardPropagationBatch();
 			/***************************************************************************************************/
 
 
 			/***************************************************************************************************/
 			// Updating
+			/// The kernel deltas of a batch call are the sums over the batch.
 			int batchsize = TrainSet.GetSampleSize();
 			convLayer1.BatchDeltaSumUpdate(batchsize);
 			convLayer2.BatchDeltaSumUpdate(batchsize);
-			hiddenLayer1.BatchDeltaSumUpdate(batchsize);
-			hiddenLayer2.BatchDeltaSumUpdate(batchsize);
-			outputLayer.BatchDeltaSumUpdate(batchsize);
-
-			outputLayer.LossSumUpdate();
 
-			Visual::Plot2D::Plot2DMatrixVec(input, "input", Visual::Plot2DMode::RB, 0, 0, false);
+			// The first sample of the batch is shown.
+			Visual::Plot2D::Plot2DMatrixVec(input[0], "input", Visual::Plot2DMode::RB, 0, 0, false);
 			Visual::Plot2D::Plot2DMatrixVec(conv1kernals, "conv1kernals", Visual::Plot2DMode::RB, 350, 0, false);
-			Visual::Plot2D::Plot2DMatrixVec(conv1features, "conv1features", Visual::Plot2DMode::RB, 400, 0, false);
-			Visual::Plot2D::Plot2DMatrixVec(pool1features, "pool1features", Visual::Plot2DMode::RB, 750, 0, true);
+			Visual::Plot2D::Plot2DMatrixVec(conv1features[0], "conv1features", Visual::Plot2DMode::RB, 400, 0, false);
+			Visual::Plot2D::Plot2DMatrixVec(pool1features[0], "pool1features", Visual::Plot2DMode::RB, 750, 0, true);
 			Visual::Plot2D::Plot2DMatrixVec(conv2kernals, "conv2kernals", Visual::Plot2DMode::RB, 900, 0, false);
-			Visual::Plot2D::Plot2DMatrixVec(conv2features, "conv2features", Visual::Plot2DMode::RB, 1100, 0, false);
-			Visual::Plot2D::Plot2DMatrixVec(pool2features, "pool2features", Visual::Plot2DMode::RB, 1300, 0, true);
+			Visual::Plot2D::Plot2DMatrixVec(conv2features[0], "conv2features", Visual::Plot2DMode::RB, 1100, 0, false);
+			Visual::Plot2D::Plot2DMatrixVec(pool2features[0], "pool2features", Visual::Plot2DMode::RB, 1300, 0, true);
 
 		}
 			
@@ -277,18 +282,4 @@ int main(int argc, char ** argv)
 }
 
 
-Vector<double> Matrix2Vector(const Matrix<double> & _mat) {
-	Vector<double> vec(_mat.ColumeSize(), VectorType::Zero);
-	for (size_t i = 0; i < _mat.ColumeSize(); i++)
-		vec(i) = _mat(i, 0);
-	return vec;
-}
-
-Matrix<double> Vector2Matrix(const Vector<double> & _vec) {
-	Matrix<double> mat(_vec.Size(), 1, MatrixType::Zero);
-	for (size_t i = 0; i < _vec.Size(); i++)
-		mat(i, 0) = _vec(i);
-	return mat;
-}
-
 #endif // CNNImageRecognization
@@ -10,9 +10,6 @@
 #ifdef CNNImageRecognization
 #include "..\\Algorithm\NeuralNetwork\NeuralLib.h"
 
-Vector<double> Matrix2Vector(const Matrix<double> & _mat);
-Matrix<double> Vector2Matrix(const Vector<double> & _vec);
-
 #include <thread>
 #include <vector>
 #include <mutex>
@@ -90,7 +87,7 @@ static void trainThreadFunc(
 			std::vector<Neural::Feature> process2output = process2.GetOutputAll();
 			// serialLayer
 			serial.SetDeserializedMat(process2output);
-			MathLib::Vector<double> serializedVec = Matrix2Vector(serial.Serialize());
+			MathLib::Vector<double> serializedVec = serial.SerializeVector();
 			// inputLayer
 			inputLayer.SetInput(serializedVec);
 			inputLayer.ForwardPropagation();
@@ -125,8 +122,7 @@ static void trainThreadFunc(
 			// outputLayer
 			MathLib::Vector<double> inputLayerDelta = inputLayer.BackwardPropagation(hiddenLayer1Delta);
 			// serialLayer
-			serial.SetSerializedMat(Vector2Matrix(inputLayerDelta));
-			std::vector<MathLib::Matrix<double>> deserialized = serial.Deserialize();
+			std::vector<MathLib::Matrix<double>> deserialized = serial.DeserializeVector(std::move(inputLayerDelta));
 			// process 2
 			process2.SetInput(deserialized);
 			process2.Deprocess();
@@ -357,19 +353,5 @@ int main(int argc, char ** argv)
 }
 
 
-Vector<double> Matrix2Vector(const Matrix<double> & _mat) {
-	Vector<double> vec(_mat.ColumeSize(), VectorType::Zero);
-	for (size_t i = 0; i < _mat.ColumeSize(); i++)
-		vec(i) = _mat(i, 0);
-	return vec;
-}
-
-Matrix<double> Vector2Matrix(const Vector<double> & _vec) {
-	Matrix<double> mat(_vec.Size(), 1, MatrixType::Zero);
-	for (size_t i = 0; i < _vec.Size(); i++)
-		mat(i, 0) = _vec(i);
-	return mat;
-}
-
 #endif // CNNImageRecognization
 
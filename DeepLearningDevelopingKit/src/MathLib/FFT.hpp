@@ -0,0 +1,321 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Math Library 	                                                              */
+/*								        		 	     Fast Fourier Transform                                                   */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	/***************************************************************************************************/
+	// Class : FFT
+	/// Plan of a complex discrete Fourier transform of a length that factors into 2, 3 and 5.
+	/// Mixed radix Stockham autosort algorithm (radix 4, 2, 3 and 5 passes), twiddles are precomputed
+	/// once per plan. The scratch buffer lives in the plan, so a plan must not be shared between threads.
+	template<class T>
+	class FFT
+	{
+	public:
+
+		typedef std::complex<T> Complex;
+
+		// Constructor
+		/// Build the plan for length _n, lengths with another prime factor are rounded up with GoodSize().
+		explicit FFT(const size_t _n = 1);
+
+	public:
+
+		// Smallest length >= _n of the form 2^a * 3^b * 5^c.
+		static size_t GoodSize(const size_t _n);
+		// Smallest even length >= _n of the form 2^a * 3^b * 5^c.
+		static size_t GoodEvenSize(const size_t _n);
+
+		inline size_t Size(void) const { return n; }
+
+		// Complex product written out, std::complex operator* takes the slow NaN-checking path.
+		static inline Complex Multiply(const Complex & _a, const Complex & _b)
+		{
+			return Complex(_a.real() * _b.real() - _a.imag() * _b.imag(), _a.real() * _b.imag() + _a.imag() * _b.real());
+		}
+
+		// Forward transform in place, X[k] = sum x[t] * exp(-2 pi i t k / n).
+		/// With _lanes > 1, _lanes interleaved sequences are transformed at once, element t of
+		/// sequence c is at _data[t * _lanes + c] (the columns of a row-major array).
+		void Forward(Complex * _data, const size_t _lanes = 1);
+		// Inverse transform in place, normalized by 1 / n.
+		void Inverse(Complex * _data, const size_t _lanes = 1);
+
+	private:
+
+		void Transform(Complex * _data, const size_t _lanes);
+
+	private:
+
+		size_t n;
+		std::vector<size_t> _radix;
+		// exp(-2 pi i t / n) for t in [0, n).
+		std::vector<Complex> _twiddle;
+		// sin(2 pi / 3), and cos(2 pi / 5), cos(4 pi / 5), sin(2 pi / 5), sin(4 pi / 5).
+		T _radix3;
+		T _radix5[4];
+		std::vector<Complex> _scratch;
+	};
+
+	/***************************************************************************************************/
+	// Class : RealFFT2D
+	/// Plan of a two dimensional real to complex transform of an _m x _n row-major array, _n even.
+	/// The spectrum holds the non-redundant half, _m x (_n / 2 + 1) complex values.
+	/// Rows go through a half length complex transform, then all columns of the half spectrum are transformed
+	/// together as interleaved lanes.
+	template<class T>
+	class RealFFT2D
+	{
+	public:
+
+		typedef std::complex<T> Complex;
+
+		RealFFT2D(const size_t _m = 2, const size_t _n = 2);
+
+	public:
+
+		inline size_t ColumeSize(void) const { return m; }
+		inline size_t RowSize(void) const { return n; }
+		// Number of complex values of a spectrum.
+		inline size_t SpectrumSize(void) const { return m * (n / 2 + 1); }
+
+		// Real array to half spectrum.
+		void Forward(const T * _input, Complex * _spectrum);
+		// Half spectrum to real array, normalized. _spectrum is used as scratch and overwritten.
+		void Inverse(Complex * _spectrum, T * _output);
+
+	private:
+
+		size_t m, n;
+		FFT<T> _rowPlan;
+		FFT<T> _columnPlan;
+		// exp(-2 pi i k / n) for k in [0, n / 2].
+		std::vector<Complex> _realTwiddle;
+		std::vector<Complex> _row;
+	};
+}
+
+
+namespace MathLib
+{
+	template<class T>
+	FFT<T>::FFT(const size_t _n)
+		: n(GoodSize(std::max<size_t>(1, _n)))
+	{
+		size_t rest = n;
+		while (rest % 4 == 0) { _radix.push_back(4); rest /= 4; }
+		while (rest % 2 == 0) { _radix.push_back(2); rest /= 2; }
+		while (rest % 3 == 0) { _radix.push_back(3); rest /= 3; }
+		while (rest % 5 == 0) { _radix.push_back(5); rest /= 5; }
+		_twiddle.resize(n);
+		_radix3 = T(std::sin(2 * 3.14159265358979323846 / 3));
+		_radix5[0] = T(std::cos(2 * 3.14159265358979323846 / 5));
+		_radix5[1] = T(std::cos(4 * 3.14159265358979323846 / 5));
+		_radix5[2] = T(std::sin(2 * 3.14159265358979323846 / 5));
+		_radix5[3] = T(std::sin(4 * 3.14159265358979323846 / 5));
+		const double pi = 3.14159265358979323846;
+		for (size_t t = 0; t < n; t++)
+			_twiddle[t] = Complex(T(std::cos(2 * pi * t / n)), T(-std::sin(2 * pi * t / n)));
+	}
+
+	template<class T>
+	size_t FFT<T>::GoodSize(const size_t _n)
+	{
+		for (size_t size = std::max<size_t>(1, _n);; size++)
+		{
+			size_t rest = size;
+			for (size_t factor : { 2, 3, 5 })
+				while (rest % factor == 0)
+					rest /= factor;
+			if (rest == 1)
+				return size;
+		}
+	}
+
+	template<class T>
+	size_t FFT<T>::GoodEvenSize(const size_t _n)
+	{
+		size_t size = GoodSize(std::max<size_t>(2, _n));
+		while (size % 2 != 0)
+			size = GoodSize(size + 1);
+		return size;
+	}
+
+	template<class T>
+	void FFT<T>::Forward(Complex * _data, const size_t _lanes)
+	{
+		Transform(_data, _lanes);
+	}
+
+	template<class T>
+	void FFT<T>::Inverse(Complex * _data, const size_t _lanes)
+	{
+		// ifft(x) = conj(fft(conj(x))) / n
+		const size_t total = n * _lanes;
+		for (size_t t = 0; t < total; t++)
+			_data[t] = std::conj(_data[t]);
+		Transform(_data, _lanes);
+		const T scale = T(1) / T(n);
+		for (size_t t = 0; t < total; t++)
+			_data[t] = Complex(_data[t].real() * scale, -_data[t].imag() * scale);
+	}
+
+	template<class T>
+	void FFT<T>::Transform(Complex * _data, const size_t _lanes)
+	{
+		if (n == 1)
+			return;
+		_scratch.resize(n * _lanes);
+		Complex * in = _data;
+		Complex * out = _scratch.data();
+		size_t span = 1;
+		for (const size_t radix : _radix)
+		{
+			const size_t butterflies = n / radix;
+			const size_t twiddleStep = n / (span * radix);
+			const size_t inStride = butterflies * _lanes, outStride = span * _lanes;
+			for (size_t block = 0; block < butterflies / span; block++)
+			{
+				for (size_t position = 0; position < span; position++)
+				{
+					Complex w[5];
+					for (size_t r = 1; r < radix; r++)
+						w[r] = _twiddle[position * r * twiddleStep];
+					const Complex * x = in + (block * span + position) * _lanes;
+					Complex * y = out + (block * span * radix + position) * _lanes;
+					for (size_t lane = 0; lane < _lanes; lane++)
+					{
+						Complex v[5];
+						v[0] = x[lane];
+						for (size_t r = 1; r < radix; r++)
+							v[r] = position == 0 ? x[r * inStride + lane] : Multiply(x[r * inStride + lane], w[r]);
+						switch (radix)
+						{
+						case 2:
+							y[lane] = v[0] + v[1];
+							y[outStride + lane] = v[0] - v[1];
+							break;
+						case 3:
+						{
+							const Complex sum = v[1] + v[2], difference = (v[1] - v[2]) * _radix3;
+							const Complex middle = v[0] - sum * T(0.5);
+							y[lane] = v[0] + sum;
+							y[outStride + lane] = Complex(middle.real() + difference.imag(), middle.imag() - difference.real());
+							y[2 * outStride + lane] = Complex(middle.real() - difference.imag(), middle.imag() + difference.real());
+							break;
+						}
+						case 4:
+						{
+							const Complex a = v[0] + v[2], b = v[0] - v[2], c = v[1] + v[3], d = v[1] - v[3];
+							const Complex minusID(d.imag(), -d.real());
+							y[lane] = a + c;
+							y[outStride + lane] = b + minusID;
+							y[2 * outStride + lane] = a - c;
+							y[3 * outStride + lane] = b - minusID;
+							break;
+						}
+						default:
+						{
+							const Complex a1 = v[1] + v[4], b1 = v[1] - v[4], a2 = v[2] + v[3], b2 = v[2] - v[3];
+							const Complex t1 = v[0] + a1 * _radix5[0] + a2 * _radix5[1];
+							const Complex t2 = v[0] + a1 * _radix5[1] + a2 * _radix5[0];
+							const Complex u1 = b1 * _radix5[2] + b2 * _radix5[3];
+							const Complex u2 = b1 * _radix5[3] - b2 * _radix5[2];
+							y[lane] = v[0] + a1 + a2;
+							y[outStride + lane] = Complex(t1.real() + u1.imag(), t1.imag() - u1.real());
+							y[4 * outStride + lane] = Complex(t1.real() - u1.imag(), t1.imag() + u1.real());
+							y[2 * outStride + lane] = Complex(t2.real() + u2.imag(), t2.imag() - u2.real());
+							y[3 * outStride + lane] = Complex(t2.real() - u2.imag(), t2.imag() + u2.real());
+							break;
+						}
+						}
+					}
+				}
+			}
+			std::swap(in, out);
+			span *= radix;
+		}
+		if (in != _data)
+			std::copy(in, in + n * _lanes, _data);
+	}
+
+	template<class T>
+	RealFFT2D<T>::RealFFT2D(const size_t _m, const size_t _n)
+		: m(_m), n(_n + (_n % 2)), _rowPlan(n / 2), _columnPlan(_m)
+	{
+		if (_rowPlan.Size() != n / 2 || _columnPlan.Size() != m)
+			std::cerr << "ERROR : RealFFT2D size must factor into 2, 3 and 5, use FFT::GoodEvenSize()." << std::endl;
+		_realTwiddle.resize(n / 2 + 1);
+		const double pi = 3.14159265358979323846;
+		for (size_t k = 0; k <= n / 2; k++)
+			_realTwiddle[k] = Complex(T(std::cos(2 * pi * k / n)), T(-std::sin(2 * pi * k / n)));
+		_row.resize(n / 2);
+	}
+
+	template<class T>
+	void RealFFT2D<T>::Forward(const T * _input, Complex * _spectrum)
+	{
+		const size_t half = n / 2, width = half + 1;
+		for (size_t i = 0; i < m; i++)
+		{
+			// Pack even and odd samples as one complex sequence of half length.
+			const T * row = _input + i * n;
+			for (size_t t = 0; t < half; t++)
+				_row[t] = Complex(row[2 * t], row[2 * t + 1]);
+			_rowPlan.Forward(_row.data());
+			Complex * out = _spectrum + i * width;
+			for (size_t k = 0; k <= half; k++)
+			{
+				const Complex z = _row[k % half];
+				const Complex zMirror = std::conj(_row[(half - k) % half]);
+				const Complex even = (z + zMirror) * T(0.5);
+				const Complex difference = (z - zMirror) * T(0.5);
+				const Complex odd(difference.imag(), -difference.real());
+				out[k] = even + FFT<T>::Multiply(_realTwiddle[k], odd);
+			}
+		}
+		_columnPlan.Forward(_spectrum, width);
+	}
+
+	template<class T>
+	void RealFFT2D<T>::Inverse(Complex * _spectrum, T * _output)
+	{
+		const size_t half = n / 2, width = half + 1;
+		_columnPlan.Inverse(_spectrum, width);
+		for (size_t i = 0; i < m; i++)
+		{
+			const Complex * in = _spectrum + i * width;
+			for (size_t k = 0; k < half; k++)
+			{
+				const Complex x = in[k];
+				const Complex xMirror = std::conj(in[half - k]);
+				const Complex even = (x + xMirror) * T(0.5);
+				const Complex odd = FFT<T>::Multiply((x - xMirror) * T(0.5), std::conj(_realTwiddle[k]));
+				_row[k] = even + Complex(-odd.imag(), odd.real());
+			}
+			_rowPlan.Inverse(_row.data());
+			T * row = _output + i * n;
+			for (size_t t = 0; t < half; t++)
+			{
+				row[2 * t] = _row[t].real();
+				row[2 * t + 1] = _row[t].imag();
+			}
+		}
+	}
+}
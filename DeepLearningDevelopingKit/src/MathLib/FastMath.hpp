@@ -0,0 +1,461 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Math Library 	                                                              */
+/*								        		 	              FastMath   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USING_SSE2_FASTMATH
+#include <emmintrin.h>
+#endif // SSE2
+
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	/***************************************************************************************************/
+	// Namespace : FastMath
+	/// Table driven exp and log and the functions built on them, for double : 64 entries bring the argument
+	/// close enough to a table point for a polynomial of degree 6 (exp) or 3 (log).
+	/// The Apply kernels process two elements per SSE2 instruction, the scalar functions run the same
+	/// operations in the same order, so both give bit identical results.
+	/// Max error against a correctly rounded result, measured in FastMath_test :
+	///   Exp      1 ulp      (results below 2^-1021 are flushed to zero)
+	///   ExpM1    2 ulp
+	///   Log      2 ulp
+	///   Log1P    2 ulp
+	///   Tanh     2 ulp
+	///   Sigmoid  2 ulp
+	///   Softplus 2 ulp
+	namespace FastMath
+	{
+		namespace Internal
+		{
+			const double Log2E = 1.4426950408889634;
+			const double Ln2Hi = 6.93147180369123816490e-01;
+			const double Ln2Lo = 1.90821492927058770002e-10;
+			// 1.5 * 2^52, adding it rounds a double to an integer held in the low mantissa bits.
+			const double RoundShifter = 6755399441055744.0;
+			// 2^52, used to turn small integers held in the mantissa bits back into doubles.
+			const double IntShifter = 4503599627370496.0;
+			const double Sqrt2 = 1.4142135623730951;
+			const double ExpLower = -708.0;
+			const double ExpUpper = 709.78;
+			const double ExpM1Lower = -40.0;
+			// Above it e^x - 1 rounds to e^x.
+			const double ExpM1Upper = 40.0;
+			const double TanhUpper = 20.0;
+			// x = (64 m - j) ln2 / 64 + r, |r| <= ln2 / 128, e^x = 2^m * 2^(-j / 64) * e^r. m is rounded up,
+			// so that 2^(m - 1) is still normal at x = ExpLower.
+			const size_t ExpTableSize = 64;
+			const double ExpTableLog2E = ExpTableSize * Log2E;
+			const double ExpTableLn2Hi = Ln2Hi / ExpTableSize;
+			const double ExpTableLn2Lo = Ln2Lo / ExpTableSize;
+			// 2^(-j / 64) = ExpTableHigh[j] + ExpTableLow[j], ExpTableHigh[j] correctly rounded.
+			const double ExpTableHigh[ExpTableSize] = {
+				1.0, 0.9892280131939755, 0.9785720620877001, 0.9680308967461472,
+				0.9576032806985737, 0.9472879907934828, 0.93708381705515, 0.9269895625416927,
+				0.9170040432046712, 0.9071260877501994, 0.8973545375015536, 0.8876882462632606,
+				0.8781260801866497, 0.8686669176368531, 0.859309649061239, 0.8500531768592617,
+				0.8408964152537145, 0.8318382901633682, 0.8228777390769825, 0.8140137109286739,
+				0.8052451659746271, 0.7965710756711335, 0.7879904225539432, 0.7795022001189185,
+				0.7711054127039704, 0.7627990753722692, 0.7545822137967114, 0.7464538641456324,
+				0.7384130729697497, 0.7304588970903235, 0.7225904034885233, 0.714806669195985,
+				0.7071067811865476, 0.6994898362691556, 0.691954940981916, 0.6845012114872953,
+				0.6771277734684463, 0.6698337620266515, 0.6626183215798707, 0.6554806057623822,
+				0.6484197773255048, 0.6414350080393891, 0.6345254785958666, 0.6276903785123455,
+				0.620928906036742, 0.614240268053435, 0.6076236799902345, 0.6010783657263515,
+				0.5946035575013605, 0.5881984958251406, 0.5818624293887887, 0.5755946149764913,
+				0.5693943173783458, 0.5632608093041209, 0.5571933712979462, 0.5511912916539204,
+				0.5452538663326288, 0.5393803988785599, 0.5335702003384118, 0.5278225891802786,
+				0.5221368912137069, 0.5165124395106142, 0.5109485743270583, 0.5054446430258502 };
+			const double ExpTableLow[ExpTableSize] = {
+				0.0, 2.0194376554639083e-17, 4.480383895518334e-17, 5.166192980338163e-17,
+				-5.3099730280979813e-17, 1.7017017676082648e-17, -3.061381706502071e-17, 4.880943745363797e-17,
+				1.6415536121228136e-17, -4.9847657694601744e-17, 9.113729213956043e-18, 3.214865898278286e-17,
+				1.4800703477244367e-17, 1.5821946496464785e-17, -9.256902091315555e-18, -4.01185968519885e-18,
+				4.099505010290748e-17, 2.94549634835655e-17, -5.062839956837386e-17, -3.356477542353542e-17,
+				1.2353596284898944e-17, -5.047203271155982e-17, -5.068458235639152e-18, 1.8906035266787638e-17,
+				3.9749174048488104e-17, -5.5124708561712805e-17, -5.082276638771475e-17, 7.096460077142018e-18,
+				-1.741997278446398e-17, -2.800188593037608e-17, -1.5118790674969937e-17, -6.0158212445268276e-18,
+				-4.833646656726457e-17, -4.8071066045256615e-17, -3.385255829397393e-17, 4.7968989595594244e-17,
+				3.850474189901495e-17, 4.463641297415866e-17, -1.4293656050194307e-17, -3.590768067759727e-17,
+				1.2691251397444157e-17, 8.567974591217805e-18, 1.333966065671093e-18, -3.3556949106484392e-18,
+				2.3290137959184684e-17, -9.49390815651265e-18, -3.856315346340744e-17, 3.3224907496261506e-17,
+				1.991007615732823e-17, 2.7771016271090395e-17, 1.9146024184620467e-17, 1.6253551094319136e-17,
+				4.456406338012704e-17, 2.5829283793977284e-17, 5.2051392284227855e-17, 2.6330184357853472e-17,
+				-1.5233910399062356e-17, -3.328330218028296e-17, -3.949926983420791e-17, 8.79662869386046e-19,
+				4.2759448527689824e-17, 3.800419437013544e-18, 2.554612514486722e-17, -7.617389301684289e-18 };
+			// Taylor coefficients 1 / k!, k = 6 .. 1, of (e^r - 1) / r, the next term is below 2^-64 on |r| <= ln2 / 128.
+			const double ExpCoefficient[6] = { 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0 };
+			// x = 2^e * m, m in [sqrt(2)/2, sqrt(2)), c = k / 64 the nearest to m, log(m) = log(c) + 2 atanh(f),
+			// f = (m - c) / (m + c), |f| <= 1 / 181.
+			const double LogTableScale = 64.0;
+			const size_t LogTableFirst = 45;
+			const size_t LogTableSize = 47;
+			// log(k / 64) = LogTableHigh[k - 45] + LogTableLow[k - 45], LogTableHigh correctly rounded.
+			const double LogTableHigh[LogTableSize] = {
+				-0.3522205935893521, -0.33024168687057687, -0.3087354816496133, -0.2876820724517809,
+				-0.26706278524904525, -0.24686007793152578, -0.22705745063534608, -0.2076393647782445,
+				-0.18859116980755003, -0.16989903679539747, -0.15154989812720093, -0.13353139262452263,
+				-0.1158318155251217, -0.09844007281325252, -0.0813456394539524, -0.06453852113757118,
+				-0.048009219186360606, -0.0317486983145803, -0.015748356968139168, 0.0,
+				0.015504186535965254, 0.030771658666753687, 0.0458095360312942, 0.06062462181643484,
+				0.07522342123758753, 0.08961215868968714, 0.10379679368164356, 0.11778303565638346,
+				0.13157635778871926, 0.1451820098444979, 0.15860503017663857, 0.17185025692665923,
+				0.184922338494012, 0.19782574332991987, 0.21056476910734964, 0.22314355131420976,
+				0.2355660713127669, 0.24783616390458127, 0.25995752443692605, 0.27193371548364176,
+				0.2837681731306446, 0.2954642128938359, 0.3070250352949119, 0.3184537311185346,
+				0.329753286372468, 0.3409265869705932, 0.3519764231571782 };
+			const double LogTableLow[LogTableSize] = {
+				-5.7233316949182485e-18, 1.0828321637483858e-17, 1.6199186085148102e-17, -2.607160616442564e-17,
+				7.32891532732017e-18, -1.361743371748368e-17, -9.551415762738488e-18, -1.2053243216686129e-17,
+				7.432164219196925e-18, 4.868008764439071e-19, -5.1669593684615594e-18, 3.664457663660085e-18,
+				-4.338484369808096e-18, 4.439009633675136e-18, -5.07707635593117e-18, 6.470486661692933e-18,
+				-1.4390903347292205e-18, -3.0382263084680858e-18, -1.0021578630528974e-18, 0.0,
+				-3.278321022892429e-19, 1.0431732029005968e-18, 1.902959866474257e-18, 2.6424025938726934e-18,
+				-5.930604196293241e-18, -5.4268129336647135e-18, 5.47772415726659e-18, -1.1971685747593677e-18,
+				1.1123000879729588e-17, 8.242418783022475e-18, 1.1257003872182592e-17, -6.0224538210113705e-18,
+				3.0236614153574064e-18, 1.2821194372980142e-17, -4.249405314729895e-18, -9.091270597324799e-18,
+				-2.3943371495187355e-18, -1.2432209578702523e-17, 2.069806938978935e-17, 7.83319637697442e-19,
+				-2.032665581126656e-17, -2.16461086040599e-17, -1.2319916200101964e-17, 2.7114779367326236e-17,
+				2.122020616196946e-18, 1.7467136443544747e-17, -1.2953893030191963e-17 };
+			// Coefficients 1 / (2k + 1), k = 3 .. 1, of (atanh(f) / f - 1) / f^2, the next term is below 2^-70.
+			const double LogCoefficient[3] = { 1.0 / 7.0, 1.0 / 5.0, 1.0 / 3.0 };
+
+			inline uint64_t ToBits(const double _x) { uint64_t bits; std::memcpy(&bits, &_x, sizeof(bits)); return bits; }
+			inline double FromBits(const uint64_t _bits) { double x; std::memcpy(&x, &_bits, sizeof(x)); return x; }
+
+			// e^r - 1 on |r| <= ln2 / 128.
+			inline double ExpM1Poly(const double _r)
+			{
+				double p = ExpCoefficient[0];
+				p = p * _r + ExpCoefficient[1];
+				p = p * _r + ExpCoefficient[2];
+				p = p * _r + ExpCoefficient[3];
+				p = p * _r + ExpCoefficient[4];
+				p = p * _r + ExpCoefficient[5];
+				return p * _r;
+			}
+
+			// Split x = k * ln2 / 64 + r, k = 64 m - j, returns r, 2^(m - 1) (halved so that m = 1024 is still
+			// representable) and the two parts of 2^(-j / 64).
+			inline double Reduce(const double _x, double & _halfScale, double & _high, double & _low)
+			{
+				const double shifted = _x * ExpTableLog2E + RoundShifter;
+				const double k = shifted - RoundShifter;
+				const uint64_t bits = ToBits(shifted);
+				_halfScale = FromBits((((bits + ExpTableSize - 1) >> 6) + 1022) << 52);
+				_high = ExpTableHigh[(0 - bits) & (ExpTableSize - 1)];
+				_low = ExpTableLow[(0 - bits) & (ExpTableSize - 1)];
+				return (_x - k * ExpTableLn2Hi) - k * ExpTableLn2Lo;
+			}
+
+			// log(x + correction) for a positive finite x, the correction at most half an ulp of x.
+			/// It only moves the numerator of f, by correction / 2^e.
+			inline double LogReduced(const double _x, const double _correction)
+			{
+				// Scale subnormals into the normal range.
+				const bool subnormal = _x < std::numeric_limits<double>::min();
+				const double x = subnormal ? _x * 18014398509481984.0 : _x;
+				const uint64_t bits = ToBits(x);
+				const uint64_t exponentBits = (bits >> 52) & 0x7ff;
+				double e = double(exponentBits) - 1023.0 - (subnormal ? 54.0 : 0.0);
+				double m = FromBits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+				double correction = _correction * FromBits((2046 - exponentBits) << 52);
+				const bool high = m > Sqrt2;
+				m = high ? m * 0.5 : m;
+				e = high ? e + 1.0 : e;
+				correction = high ? correction * 0.5 : correction;
+
+				const double shifted = m * LogTableScale + RoundShifter;
+				const size_t k = size_t(ToBits(shifted) & 0xff) - LogTableFirst;
+				const double c = (shifted - RoundShifter) * (1.0 / LogTableScale);
+				const double f = ((m - c) + correction) / (m + c);
+				const double s = f * f;
+				double p = LogCoefficient[0];
+				p = p * s + LogCoefficient[1];
+				p = p * s + LogCoefficient[2];
+				const double twoF = 2.0 * f;
+				return (e * Ln2Hi + LogTableHigh[k]) + (twoF + (twoF * s * p + (e * Ln2Lo + LogTableLow[k])));
+			}
+
+			// The special values of log(x) around the result _y for a positive finite x.
+			inline double LogSpecial(const double _x, const double _y)
+			{
+				return _x > 0.0
+					? (_x == std::numeric_limits<double>::infinity() ? _x : _y)
+					: (_x == 0.0 ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN());
+			}
+
+#ifdef USING_SSE2_FASTMATH
+			inline __m128d Select(const __m128d _mask, const __m128d _a, const __m128d _b)
+			{
+				return _mm_or_pd(_mm_and_pd(_mask, _a), _mm_andnot_pd(_mask, _b));
+			}
+
+			inline __m128d SignMask(void) { return _mm_set1_pd(-0.0); }
+
+			inline __m128d ExpM1Poly(const __m128d _r)
+			{
+				__m128d p = _mm_set1_pd(ExpCoefficient[0]);
+				p = _mm_add_pd(_mm_mul_pd(p, _r), _mm_set1_pd(ExpCoefficient[1]));
+				p = _mm_add_pd(_mm_mul_pd(p, _r), _mm_set1_pd(ExpCoefficient[2]));
+				p = _mm_add_pd(_mm_mul_pd(p, _r), _mm_set1_pd(ExpCoefficient[3]));
+				p = _mm_add_pd(_mm_mul_pd(p, _r), _mm_set1_pd(ExpCoefficient[4]));
+				p = _mm_add_pd(_mm_mul_pd(p, _r), _mm_set1_pd(ExpCoefficient[5]));
+				return _mm_mul_pd(p, _r);
+			}
+
+			// The table is read one lane at a time, SSE2 has no gather.
+			inline __m128d Reduce(const __m128d _x, __m128d & _halfScale, __m128d & _high, __m128d & _low)
+			{
+				const __m128d shifter = _mm_set1_pd(RoundShifter);
+				const __m128d shifted = _mm_add_pd(_mm_mul_pd(_x, _mm_set1_pd(ExpTableLog2E)), shifter);
+				const __m128d k = _mm_sub_pd(shifted, shifter);
+				const __m128i bits = _mm_castpd_si128(shifted);
+				const __m128i m = _mm_srli_epi64(_mm_add_epi64(bits, _mm_set1_epi64x(ExpTableSize - 1)), 6);
+				_halfScale = _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(m, _mm_set1_epi64x(1022)), 52));
+				const size_t j0 = (0 - size_t(unsigned(_mm_cvtsi128_si32(bits)))) & (ExpTableSize - 1);
+				const size_t j1 = (0 - size_t(unsigned(_mm_cvtsi128_si32(_mm_srli_si128(bits, 8))))) & (ExpTableSize - 1);
+				_high = _mm_loadh_pd(_mm_load_sd(ExpTableHigh + j0), ExpTableHigh + j1);
+				_low = _mm_loadh_pd(_mm_load_sd(ExpTableLow + j0), ExpTableLow + j1);
+				return _mm_sub_pd(_mm_sub_pd(_x, _mm_mul_pd(k, _mm_set1_pd(ExpTableLn2Hi))), _mm_mul_pd(k, _mm_set1_pd(ExpTableLn2Lo)));
+			}
+
+			inline __m128d Exp(const __m128d _x)
+			{
+				const __m128d lower = _mm_set1_pd(ExpLower);
+				const __m128d upper = _mm_set1_pd(ExpUpper);
+				const __m128d x = _mm_min_pd(upper, _mm_max_pd(lower, _x));
+				__m128d halfScale, high, low;
+				const __m128d r = Reduce(x, halfScale, high, low);
+				const __m128d t = _mm_add_pd(_mm_mul_pd(high, ExpM1Poly(r)), low);
+				const __m128d y = _mm_mul_pd(_mm_mul_pd(_mm_add_pd(high, t), halfScale), _mm_set1_pd(2.0));
+				return Select(_mm_cmplt_pd(_x, lower), _mm_setzero_pd(),
+					Select(_mm_cmpgt_pd(_x, upper), _mm_set1_pd(std::numeric_limits<double>::infinity()), y));
+			}
+
+			inline __m128d ExpM1(const __m128d _x)
+			{
+				const __m128d upper = _mm_set1_pd(ExpUpper);
+				const __m128d x = _mm_min_pd(upper, _mm_max_pd(_mm_set1_pd(ExpM1Lower), _x));
+				__m128d halfScale, high, low;
+				const __m128d r = Reduce(x, halfScale, high, low);
+				const __m128d scale = _mm_mul_pd(halfScale, _mm_set1_pd(2.0));
+				const __m128d t = _mm_add_pd(_mm_mul_pd(high, ExpM1Poly(r)), low);
+				const __m128d y = Select(_mm_cmpgt_pd(x, _mm_set1_pd(ExpM1Upper)), _mm_mul_pd(_mm_mul_pd(_mm_add_pd(high, t), halfScale), _mm_set1_pd(2.0)),
+					_mm_add_pd(_mm_mul_pd(scale, t), _mm_sub_pd(_mm_mul_pd(scale, high), _mm_set1_pd(1.0))));
+				return Select(_mm_cmpgt_pd(_x, upper), _mm_set1_pd(std::numeric_limits<double>::infinity()), y);
+			}
+
+			inline __m128d LogReduced(const __m128d _x, const __m128d _correction)
+			{
+				const __m128d subnormal = _mm_cmplt_pd(_x, _mm_set1_pd(std::numeric_limits<double>::min()));
+				const __m128d x = Select(subnormal, _mm_mul_pd(_x, _mm_set1_pd(18014398509481984.0)), _x);
+				const __m128i bits = _mm_castpd_si128(x);
+				const __m128d intShifter = _mm_set1_pd(IntShifter);
+				const __m128i exponentBits = _mm_and_si128(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(0x7ff));
+				__m128d e = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(exponentBits, _mm_castpd_si128(intShifter))), intShifter);
+				e = _mm_sub_pd(_mm_sub_pd(e, _mm_set1_pd(1023.0)), _mm_and_pd(subnormal, _mm_set1_pd(54.0)));
+				__m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000fffffffffffffLL)), _mm_set1_epi64x(0x3ff0000000000000LL)));
+				__m128d correction = _mm_mul_pd(_correction, _mm_castsi128_pd(_mm_slli_epi64(_mm_sub_epi64(_mm_set1_epi64x(2046), exponentBits), 52)));
+				const __m128d high = _mm_cmpgt_pd(m, _mm_set1_pd(Sqrt2));
+				m = Select(high, _mm_mul_pd(m, _mm_set1_pd(0.5)), m);
+				e = Select(high, _mm_add_pd(e, _mm_set1_pd(1.0)), e);
+				correction = Select(high, _mm_mul_pd(correction, _mm_set1_pd(0.5)), correction);
+
+				const __m128d shifter = _mm_set1_pd(RoundShifter);
+				const __m128d shifted = _mm_add_pd(_mm_mul_pd(m, _mm_set1_pd(LogTableScale)), shifter);
+				const __m128i index = _mm_castpd_si128(shifted);
+				const size_t k0 = size_t(_mm_cvtsi128_si32(index) & 0xff) - LogTableFirst;
+				const size_t k1 = size_t(_mm_cvtsi128_si32(_mm_srli_si128(index, 8)) & 0xff) - LogTableFirst;
+				const __m128d c = _mm_mul_pd(_mm_sub_pd(shifted, shifter), _mm_set1_pd(1.0 / LogTableScale));
+				const __m128d f = _mm_div_pd(_mm_add_pd(_mm_sub_pd(m, c), correction), _mm_add_pd(m, c));
+				const __m128d s = _mm_mul_pd(f, f);
+				__m128d p = _mm_set1_pd(LogCoefficient[0]);
+				p = _mm_add_pd(_mm_mul_pd(p, s), _mm_set1_pd(LogCoefficient[1]));
+				p = _mm_add_pd(_mm_mul_pd(p, s), _mm_set1_pd(LogCoefficient[2]));
+				const __m128d twoF = _mm_mul_pd(_mm_set1_pd(2.0), f);
+				const __m128d tableHigh = _mm_loadh_pd(_mm_load_sd(LogTableHigh + k0), LogTableHigh + k1);
+				const __m128d tableLow = _mm_loadh_pd(_mm_load_sd(LogTableLow + k0), LogTableLow + k1);
+				return _mm_add_pd(_mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(Ln2Hi)), tableHigh),
+					_mm_add_pd(twoF, _mm_add_pd(_mm_mul_pd(_mm_mul_pd(twoF, s), p), _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(Ln2Lo)), tableLow))));
+			}
+
+			inline __m128d LogSpecial(const __m128d _x, const __m128d _y)
+			{
+				const __m128d infinity = _mm_set1_pd(std::numeric_limits<double>::infinity());
+				return Select(_mm_cmpgt_pd(_x, _mm_setzero_pd()),
+					Select(_mm_cmpeq_pd(_x, infinity), _x, _y),
+					Select(_mm_cmpeq_pd(_x, _mm_setzero_pd()), _mm_sub_pd(_mm_setzero_pd(), infinity), _mm_set1_pd(std::numeric_limits<double>::quiet_NaN())));
+			}
+
+			inline __m128d Log(const __m128d _x)
+			{
+				return LogSpecial(_x, LogReduced(_x, _mm_setzero_pd()));
+			}
+
+			inline __m128d Log1P(const __m128d _x)
+			{
+				const __m128d one = _mm_set1_pd(1.0);
+				const __m128d w = _mm_add_pd(one, _x);
+				const __m128d y = LogSpecial(w, LogReduced(w, _mm_sub_pd(_x, _mm_sub_pd(w, one))));
+				return Select(_mm_cmpeq_pd(w, one), _x, y);
+			}
+
+			inline __m128d Tanh(const __m128d _x)
+			{
+				const __m128d a = _mm_andnot_pd(SignMask(), _x);
+				const __m128d t = ExpM1(_mm_mul_pd(_mm_set1_pd(2.0), _mm_min_pd(_mm_set1_pd(TanhUpper), a)));
+				const __m128d y = _mm_div_pd(t, _mm_add_pd(t, _mm_set1_pd(2.0)));
+				return _mm_or_pd(y, _mm_and_pd(SignMask(), _x));
+			}
+
+			inline __m128d Sigmoid(const __m128d _x)
+			{
+				const __m128d e = Exp(_mm_or_pd(SignMask(), _x));
+				const __m128d inverse = _mm_div_pd(_mm_set1_pd(1.0), _mm_add_pd(_mm_set1_pd(1.0), e));
+				return Select(_mm_cmplt_pd(_x, _mm_setzero_pd()), _mm_mul_pd(e, inverse), inverse);
+			}
+
+			inline __m128d Softplus(const __m128d _x)
+			{
+				const __m128d l = Log1P(Exp(_mm_or_pd(SignMask(), _x)));
+				return Select(_mm_cmpgt_pd(_x, _mm_setzero_pd()), _mm_add_pd(_x, l), l);
+			}
+#endif // USING_SSE2_FASTMATH
+		}
+
+		// e^x
+		inline double Exp(const double _x)
+		{
+			const double x = _x < Internal::ExpLower ? Internal::ExpLower : (_x > Internal::ExpUpper ? Internal::ExpUpper : _x);
+			double halfScale, high, low;
+			const double r = Internal::Reduce(x, halfScale, high, low);
+			const double t = high * Internal::ExpM1Poly(r) + low;
+			const double y = (high + t) * halfScale * 2.0;
+			return _x < Internal::ExpLower ? 0.0 : (_x > Internal::ExpUpper ? std::numeric_limits<double>::infinity() : y);
+		}
+
+		// e^x - 1, accurate near zero.
+		inline double ExpM1(const double _x)
+		{
+			const double x = _x < Internal::ExpM1Lower ? Internal::ExpM1Lower : (_x > Internal::ExpUpper ? Internal::ExpUpper : _x);
+			double halfScale, high, low;
+			const double r = Internal::Reduce(x, halfScale, high, low);
+			const double scale = halfScale * 2.0;
+			const double t = high * Internal::ExpM1Poly(r) + low;
+			// The scale overflows at m = 1024, where the result is e^x as Exp computes it.
+			const double y = x > Internal::ExpM1Upper ? (high + t) * halfScale * 2.0 : scale * t + (scale * high - 1.0);
+			return _x > Internal::ExpUpper ? std::numeric_limits<double>::infinity() : y;
+		}
+
+		// Natural logarithm
+		inline double Log(const double _x)
+		{
+			return Internal::LogSpecial(_x, Internal::LogReduced(_x, 0.0));
+		}
+
+		// log(1 + x), accurate near zero.
+		inline double Log1P(const double _x)
+		{
+			// 1 + x is rounded, the rounding error corrects the logarithm.
+			const double w = 1.0 + _x;
+			return w == 1.0 ? _x : Internal::LogSpecial(w, Internal::LogReduced(w, _x - (w - 1.0)));
+		}
+
+		// Hyperbolic tangent
+		inline double Tanh(const double _x)
+		{
+			const double a = std::abs(_x);
+			const double t = ExpM1(2.0 * (Internal::TanhUpper < a ? Internal::TanhUpper : a));
+			return std::copysign(t / (t + 2.0), _x);
+		}
+
+		// Logistic function 1 / (1 + e^-x)
+		inline double Sigmoid(const double _x)
+		{
+			const double e = Exp(-std::abs(_x));
+			const double inverse = 1.0 / (1.0 + e);
+			return _x < 0.0 ? e * inverse : inverse;
+		}
+
+		// log(1 + e^x) without overflow.
+		inline double Softplus(const double _x)
+		{
+			const double l = Log1P(Exp(-std::abs(_x)));
+			return _x > 0.0 ? _x + l : l;
+		}
+
+		/***************************************************************************************************/
+		// Array kernels
+		/// Apply a function in place to _size contiguous elements.
+#ifdef USING_SSE2_FASTMATH
+#define FASTMATH_APPLY(Function)																\
+		inline void Apply##Function(double * _data, const size_t _size)							\
+		{																						\
+			size_t i = 0;																		\
+			for (; i + 8 <= _size; i += 8)														\
+			{																					\
+				const __m128d x0 = _mm_loadu_pd(_data + i);										\
+				const __m128d x1 = _mm_loadu_pd(_data + i + 2);									\
+				const __m128d x2 = _mm_loadu_pd(_data + i + 4);									\
+				const __m128d x3 = _mm_loadu_pd(_data + i + 6);									\
+				_mm_storeu_pd(_data + i, Internal::Function(x0));								\
+				_mm_storeu_pd(_data + i + 2, Internal::Function(x1));							\
+				_mm_storeu_pd(_data + i + 4, Internal::Function(x2));							\
+				_mm_storeu_pd(_data + i + 6, Internal::Function(x3));							\
+			}																					\
+			for (; i + 2 <= _size; i += 2)														\
+				_mm_storeu_pd(_data + i, Internal::Function(_mm_loadu_pd(_data + i)));			\
+			for (; i < _size; i++)																\
+				_data[i] = Function(_data[i]);													\
+		}
+#else
+#define FASTMATH_APPLY(Function)																\
+		inline void Apply##Function(double * _data, const size_t _size)							\
+		{																						\
+			for (size_t i = 0; i < _size; i++)													\
+				_data[i] = Function(_data[i]);													\
+		}
+#endif // USING_SSE2_FASTMATH
+
+		FASTMATH_APPLY(Exp)
+		FASTMATH_APPLY(ExpM1)
+		FASTMATH_APPLY(Log)
+		FASTMATH_APPLY(Log1P)
+		FASTMATH_APPLY(Tanh)
+		FASTMATH_APPLY(Sigmoid)
+
+#undef FASTMATH_APPLY
+
+		// Softplus runs Exp, then Log1P, over blocks of the array : chained on the same register their
+		// latencies add up and the processor finds little else to overlap them with.
+		inline void ApplySoftplus(double * _data, const size_t _size)
+		{
+			const size_t blockSize = 256;
+			double block[blockSize];
+			for (size_t i = 0; i < _size; i += blockSize)
+			{
+				const size_t count = _size - i < blockSize ? _size - i : blockSize;
+				for (size_t j = 0; j < count; j++)
+					block[j] = -std::abs(_data[i + j]);
+				ApplyExp(block, count);
+				ApplyLog1P(block, count);
+				for (size_t j = 0; j < count; j++)
+					_data[i + j] = _data[i + j] > 0.0 ? _data[i + j] + block[j] : block[j];
+			}
+		}
+	}
+}
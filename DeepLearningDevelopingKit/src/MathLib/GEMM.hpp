@@ -0,0 +1,165 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Math Library 	                                                              */
+/*								        		 	                 GEMM   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USING_SSE2_GEMM
+#include <emmintrin.h>
+#endif
+
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	// Transpose flag of a GEMM operand.
+	enum class Transpose {
+		NoTrans,
+		Trans
+	};
+
+	// Register tile of GEMM
+	/// _C (4 x 4, row stride _ldc) += _alpha * sum over p < _depth of op(A)(i, p) * B(p, j), where op(A)(i, p)
+	/// is _A[i * _rowStep + p * _depthStep] and B is packed with row stride _ldb. The sixteen sums stay in
+	/// registers for the whole depth, C is read and written once.
+	template<class T>
+	inline void GEMMTile(const T * _A, const size_t _rowStep, const size_t _depthStep, const T * _B, const size_t _ldb,
+		const size_t _depth, const T _alpha, T * _C, const size_t _ldc)
+	{
+		T sum[4][4] = {};
+		for (size_t p = 0; p < _depth; p++)
+		{
+			const T * b = _B + p * _ldb;
+			for (size_t r = 0; r < 4; r++)
+			{
+				const T a = _A[r * _rowStep + p * _depthStep];
+				for (size_t j = 0; j < 4; j++)
+					sum[r][j] += a * b[j];
+			}
+		}
+		for (size_t r = 0; r < 4; r++)
+			for (size_t j = 0; j < 4; j++)
+				_C[r * _ldc + j] += _alpha * sum[r][j];
+	}
+
+#ifdef USING_SSE2_GEMM
+	template<>
+	inline void GEMMTile<double>(const double * _A, const size_t _rowStep, const size_t _depthStep, const double * _B, const size_t _ldb,
+		const size_t _depth, const double _alpha, double * _C, const size_t _ldc)
+	{
+		__m128d sum[4][2];
+		for (size_t r = 0; r < 4; r++)
+			sum[r][0] = sum[r][1] = _mm_setzero_pd();
+		for (size_t p = 0; p < _depth; p++)
+		{
+			const __m128d b0 = _mm_loadu_pd(_B + p * _ldb);
+			const __m128d b1 = _mm_loadu_pd(_B + p * _ldb + 2);
+			for (size_t r = 0; r < 4; r++)
+			{
+				const __m128d a = _mm_set1_pd(_A[r * _rowStep + p * _depthStep]);
+				sum[r][0] = _mm_add_pd(sum[r][0], _mm_mul_pd(a, b0));
+				sum[r][1] = _mm_add_pd(sum[r][1], _mm_mul_pd(a, b1));
+			}
+		}
+		const __m128d alpha = _mm_set1_pd(_alpha);
+		for (size_t r = 0; r < 4; r++)
+		{
+			double * c = _C + r * _ldc;
+			_mm_storeu_pd(c, _mm_add_pd(_mm_loadu_pd(c), _mm_mul_pd(alpha, sum[r][0])));
+			_mm_storeu_pd(c + 2, _mm_add_pd(_mm_loadu_pd(c + 2), _mm_mul_pd(alpha, sum[r][1])));
+		}
+	}
+#endif // USING_SSE2_GEMM
+
+	/***************************************************************************************************/
+	// GEMM
+	/// General matrix multiplication on row-major buffers :
+	/// C = alpha * op(A) * op(B) + beta * C
+	/// op(A) is _m x _k, op(B) is _k x _n, C is _m x _n.
+	/// _lda, _ldb and _ldc are the row strides of the buffers as they are stored (before op()).
+	/// Rows of C are split over the global ThreadPool, every element of C is computed by exactly one
+	/// thread in a fixed order, so the result does not depend on the number of threads.
+	/// C is computed in 4 x 4 register tiles (see GEMMTile) over blocks of blockK products, rows and
+	/// columns left over take the same sums one element at a time.
+	/// Zeros of op(A) are multiplied like any other value, a NaN or an infinity of op(B) reaches C.
+	template<class T>
+	void GEMM(const Transpose _transA, const Transpose _transB,
+		const size_t _m, const size_t _n, const size_t _k,
+		const T _alpha, const T * _A, const size_t _lda,
+		const T * _B, const size_t _ldb,
+		const T _beta, T * _C, const size_t _ldc)
+	{
+		if (_m == 0 || _n == 0)
+			return;
+
+		// Pack op(B) into a contiguous _k x _n block, so the inner loop always runs along a row.
+		const T * B = _B;
+		size_t ldb = _ldb;
+		std::vector<T> packedB;
+		if (_transB == Transpose::Trans)
+		{
+			packedB.resize(_k * _n);
+			for (size_t p = 0; p < _k; p++)
+				for (size_t j = 0; j < _n; j++)
+					packedB[p * _n + j] = _B[j * _ldb + p];
+			B = packedB.data();
+			ldb = _n;
+		}
+
+		const size_t blockK = 256;
+		const size_t blockN = 512;
+		// op(A)(i, p) is A[i * rowStep + p * depthStep].
+		const size_t rowStep = _transA == Transpose::NoTrans ? _lda : 1;
+		const size_t depthStep = _transA == Transpose::NoTrans ? 1 : _lda;
+		const size_t grain = ThreadPool::Grain(_n * _k);
+
+		ParallelFor(0, _m, [&](size_t _rowBegin, size_t _rowEnd) {
+			for (size_t i = _rowBegin; i < _rowEnd; i++)
+			{
+				T * c = _C + i * _ldc;
+				if (_beta == T(0))
+					std::fill(c, c + _n, T(0));
+				else if (_beta != T(1))
+					for (size_t j = 0; j < _n; j++)
+						c[j] *= _beta;
+			}
+			for (size_t j0 = 0; j0 < _n; j0 += blockN)
+			{
+				const size_t j1 = std::min(_n, j0 + blockN);
+				for (size_t p0 = 0; p0 < _k; p0 += blockK)
+				{
+					const size_t p1 = std::min(_k, p0 + blockK);
+					for (size_t i = _rowBegin; i < _rowEnd; i += 4)
+					{
+						const size_t rows = std::min<size_t>(4, _rowEnd - i);
+						const T * a = _A + (_transA == Transpose::NoTrans ? i * _lda + p0 : p0 * _lda + i);
+						const T * b = B + p0 * ldb;
+						size_t j = j0;
+						if (rows == 4)
+							for (; j + 4 <= j1; j += 4)
+								GEMMTile(a, rowStep, depthStep, b + j, ldb, p1 - p0, _alpha, _C + i * _ldc + j, _ldc);
+						for (size_t r = 0; r < rows; r++)
+							for (size_t jj = (rows == 4 ? j : j0); jj < j1; jj++)
+							{
+								T sum = 0;
+								for (size_t p = 0; p < p1 - p0; p++)
+									sum += a[r * rowStep + p * depthStep] * b[p * ldb + jj];
+								_C[(i + r) * _ldc + jj] += _alpha * sum;
+							}
+					}
+				}
+			}
+		}, grain);
+	}
+}
@@ -17,6 +17,8 @@
 #ifdef USING_STANDARD_MATHLIB
 #include "Matrix.hpp"
 #include "Vector.hpp"
+#include "SparseMatrix.hpp"
+#include "FFT.hpp"
 #include "MathTool.hpp"
 #include "RandomEngine.h"
 #endif // USING_DYNAMIC_MATHLIB
\ No newline at end of file
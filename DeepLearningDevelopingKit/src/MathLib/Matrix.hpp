@@ -12,9 +12,12 @@
 #include <vector>
 #include <iomanip>
 #include <cmath>
+#include <memory>
+#include <algorithm>
 
 #include "MathLibError.h"
 #include "MathTool.hpp"
+#include "GEMM.hpp"
 #include "Vector.hpp"
 
 /***************************************************************************************************/
@@ -41,7 +44,13 @@ namespace MathLib
 
 	/***************************************************************************************************/
 	// Class : Matrix
-	/// Implemented in std::vector.
+	/// Implemented in a contiguous row-major std::vector shared by reference counting.
+	/// Copies share the same buffer, which is only duplicated on the first mutation (copy-on-write).
+	/// A Matrix may also view a contiguous range of a larger buffer (see Reshape, Split and Join),
+	/// the range is what gets duplicated when a view is written to.
+	/// An alias (see Alias) is a view that writes through to the buffer instead, for arenas whose
+	/// reuse is planned by their owner. Only Alias() and Handle() return aliases : a copy of an alias
+	/// holds its own elements, a snapshot the reuse of the arena does not reach.
 	/// Specialized for mechine learning purpose.
 	template<class T>
 	class Matrix
@@ -59,15 +68,16 @@ namespace MathLib
 		/// Using data from a given pointer, which is pointed to a 2D array, to initialize the Matrix.
 		Matrix(const std::initializer_list<int> & _list);
 		// Copy constructor
+		/// Shares the buffer of _mat, no element is copied until one of them is modified.
+		/// The copy of an alias copies the elements it views.
 		Matrix(const Matrix& _mat);
+		// Move constructor
+		Matrix(Matrix&& _mat);
+		// Constructor (Adopting a buffer)
+		/// Take over the elements of _elements as a _m x _n row-major matrix, nothing is copied.
+		Matrix(std::vector<T> && _elements, const size_t _m, const size_t _n);
 
-		~Matrix() {
-			for (size_t i = 0; i < _data.size(); i++)
-			{
-				_data.at(i).clear();
-			}
-			_data.clear();
-		}
+		~Matrix() = default;
 
 	public: // Initializing
 
@@ -135,19 +145,84 @@ namespace MathLib
 		// Inverse matrix
 		const Matrix<T> Inverse(void) const;
 
+	public: // Views
+
+		// Reshape
+		/// Return a _m x _n Matrix over the same elements in the same row-major order, nothing is copied.
+		/// _m * _n must equal the number of elements.
+		const Matrix<T> Reshape(const size_t _m, const size_t _n) const;
+		// Split
+		/// Cut the elements into consecutive _m x _n matrices viewing the same buffer, nothing is copied.
+		/// The number of elements must be a multiple of _m * _n.
+		std::vector<Matrix<T>> Split(const size_t _m, const size_t _n) const;
+		// Join
+		/// Concatenate the elements of _parts into a _m x _n Matrix. Parts that are consecutive views of
+		/// one buffer (as returned by Split) are joined without copying, otherwise they are copied once.
+		static Matrix<T> Join(const std::vector<Matrix<T>> & _parts, const size_t _m, const size_t _n);
+		// Release
+		/// Move the elements out as a row-major std::vector, leaving an empty Matrix. The buffer itself is
+		/// handed over when this Matrix is its only owner and views all of it, otherwise it is copied.
+		std::vector<T> Release(void);
+		// Alias
+		/// Return a _m x _n view of the elements starting at _offset that is never detached : it and every
+		/// copy of it write to this buffer, and see what other aliases write to it. Init() and Release()
+		/// turn an alias back into an ordinary Matrix.
+		Matrix<T> Alias(const size_t _offset, const size_t _m, const size_t _n);
+		// Handle
+		/// Another alias of the elements of an alias, a copy of any other Matrix.
+		Matrix<T> Handle(void) const;
+		// Handles
+		/// The Handle of every Matrix of _matrices.
+		static std::vector<Matrix<T>> Handles(const std::vector<Matrix<T>> & _matrices);
+		// Whether the Matrix writes through to a shared buffer.
+		inline bool IsAlias(void) const { return _alias; }
+
 	private: // Inner woking functions
 
 		// Swap two columns
 		void SwapColumn(const size_t _i, const size_t _j);
 		// Resize the matrix
 		void Resize(const size_t _m, const size_t _n);
+		// Share the buffer of _other, or copy the elements it views if it is an alias.
+		inline void Share(const Matrix<T> & _other)
+		{
+			if (_other._alias)
+			{
+				const auto begin = _other._data->begin() + _other._offset;
+				_data = std::make_shared<std::vector<T>>(begin, begin + _other.m * _other.n);
+				_offset = 0;
+			}
+			else
+			{
+				_data = _other._data;
+				_offset = _other._offset;
+			}
+			_alias = false;
+			size = _other.size;
+			m = _other.m;
+			n = _other.n;
+		}
+		// Detach
+		/// Make sure this Matrix is the only owner of its buffer before writing to it.
+		inline void Detach(void)
+		{
+			if (_data.use_count() > 1 && !_alias)
+			{
+				_data = std::make_shared<std::vector<T>>(_data->begin() + _offset, _data->begin() + _offset + m * n);
+				_offset = 0;
+			}
+		}
 
 	public: // Pointers
 
 		// Pointer
-		T * Data() { return this->_data[0]; }
+		/// Detach the buffer first, so the returned pointer can be written safely.
+		T * Data() { Detach(); return this->_data->data() + _offset; }
 		// Const pointer
-		const T * Data() const { return this->_data[0]; }
+		const T * Data() const { return this->_data->data() + _offset; }
+		// Shared
+		/// Whether the buffer is currently shared with other Matrix objects.
+		inline bool IsShared(void) const { return _data.use_count() > 1; }
 
 	public: // Operator Overloading 
 
@@ -155,18 +230,19 @@ namespace MathLib
 		/// Used for accessing the element in the Matrix.
 		inline T operator()(size_t _i, size_t _j) const
 		{
-			return this->_data[_i][_j];
+			return (*this->_data)[_offset + _i * n + _j];
 		}
 
 		/// Used for referencing the element in the Matrix.
 		inline T & operator()(size_t _i, size_t _j)
 		{
-			return this->_data[_i][_j];
+			Detach();
+			return (*this->_data)[_offset + _i * n + _j];
 		}
 
 		// "<<" operator
 		/// Used for streaming in format.
-		friend std::ostream& operator<<(std::ostream& _outstream, Matrix<T>& _mat)
+		friend std::ostream& operator<<(std::ostream& _outstream, const Matrix<T>& _mat)
 		{
 			_outstream << typeid(_mat).name() << std::endl;
 			_outstream << std::fixed << std::setprecision(3);
@@ -184,11 +260,22 @@ namespace MathLib
 		}
 
 		// "=" operator
+		/// Shares the buffer of _other instead of copying it, unless _other is an alias.
 		Matrix<T> & operator = (const Matrix<T> & _other)
+		{
+			if (this != &_other)
+				Share(_other);
+			return (*this);
+		}
+
+		/// Moving an alias moves the alias.
+		Matrix<T> & operator = (Matrix<T> && _other)
 		{
 			if (this != &_other)
 			{
-				_data = _other._data;
+				_data = std::move(_other._data);
+				_offset = _other._offset;
+				_alias = _other._alias;
 				size = _other.size;
 				m = _other.m;
 				n = _other.n;
@@ -316,10 +403,8 @@ namespace MathLib
 				std::cerr << "ERROR : Invalid Matrix Addtion!" << std::endl;
 				return temp;
 			}
-			for (size_t i = 0; i < self.m; i++)
-				for (size_t k = 0; k < _other.n; k++)
-					for (size_t j = 0; j < self.n; j++)
-						temp(i, k) += self(i, j) * _other(j, k);
+			GEMM(Transpose::NoTrans, Transpose::NoTrans, self.m, _other.n, self.n,
+				T(1), self.Data(), self.n, _other.Data(), _other.n, T(0), temp.Data(), temp.n);
 			return temp;
 		}
 
@@ -336,7 +421,11 @@ namespace MathLib
 		}
 
 	private:
-		std::vector<std::vector<T>> _data;
+		std::shared_ptr<std::vector<T>> _data;
+		// Index of element (0, 0) in the buffer.
+		size_t _offset = 0;
+		// Whether writes go to the shared buffer instead of a copy.
+		bool _alias = false;
 		size_t m, n;
 		Size size;
 	};
@@ -349,6 +438,7 @@ namespace MathLib
 	/// After default constructor and before use the Matrix object, Init() should be involked.
 	template<class T>
 	inline Matrix<T>::Matrix(void)
+		: _data(std::make_shared<std::vector<T>>()), m(0), n(0), size(0, 0)
 	{
 
 	}
@@ -365,77 +455,66 @@ namespace MathLib
 	/// Using data from a given pointer, which is pointed to a 2D array, to initialize the Matrix.
 	template<class T>
 	inline Matrix<T>::Matrix(const std::initializer_list<int>& _list)
+		: _data(std::make_shared<std::vector<T>>()), m(0), n(0), size(0, 0)
 	{
 	}
 
 	// Copy constructor
+	/// Shares the buffer of _mat, no element is copied until one of them is modified.
 	template<class T>
 	inline Matrix<T>::Matrix(const Matrix & _mat)
 	{
-		this->_data = _mat._data;
+		Share(_mat);
+	}
+
+	// Move constructor
+	template<class T>
+	inline Matrix<T>::Matrix(Matrix && _mat)
+	{
+		this->_data = std::move(_mat._data);
+		this->_offset = _mat._offset;
+		this->_alias = _mat._alias;
 		this->size = _mat.size;
 		this->m = _mat.m;
 		this->n = _mat.n;
 	}
 
+	// Constructor (Adopting a buffer)
+	/// Take over the elements of _elements as a _m x _n row-major matrix, nothing is copied.
+	template<class T>
+	inline Matrix<T>::Matrix(std::vector<T> && _elements, const size_t _m, const size_t _n)
+		: _data(std::make_shared<std::vector<T>>(std::move(_elements))), m(_m), n(_n), size(_m, _n)
+	{
+		if (_data->size() != _m * _n)
+		{
+			std::cerr << "ERROR : Invalid Matrix Buffer Size!" << std::endl;
+			_data->resize(_m * _n);
+		}
+	}
+
 	// Initializing function
 	/// Initializing the Matrix after defined by default constructor.
 	template<class T>
 	inline void Matrix<T>::Init(const size_t _m, const size_t _n, const MatrixType _type)
 	{
+		_data = std::make_shared<std::vector<T>>(_m * _n, T(0));
+		_offset = 0;
+		_alias = false;
+		std::vector<T> & data = *_data;
 		switch (_type)
 		{
 		case MatrixType::Zero:
-			for (size_t i = 0; i < _m; i++)
-			{
-				std::vector<T> tempVec;
-				for (size_t j = 0; j < _n; j++)
-				{
-					T tempElem = 0.f;
-					tempVec.push_back(tempElem);
-				}
-				_data.push_back(tempVec);
-			}
 			break;
 		case MatrixType::Ones:
-			for (size_t i = 0; i < _m; i++)
-			{
-				std::vector<T> tempVec;
-				for (size_t j = 0; j < _n; j++)
-				{
-					T tempElem = 1.f;
-					tempVec.push_back(tempElem);
-				}
-				_data.push_back(tempVec);
-			}
+			std::fill(data.begin(), data.end(), T(1));
 			break;
 		case MatrixType::Random:
-			for (size_t i = 0; i < _m; i++)
-			{
-				std::vector<T> tempVec;
-				for (size_t j = 0; j < _n; j++)
-				{
-					T tempElem = Random();
-					tempVec.push_back(tempElem);
-				}
-				_data.push_back(tempVec);
-			}
+			for (size_t i = 0; i < data.size(); i++)
+				data[i] = Random();
 			break;
 		case MatrixType::Identity:
-			for (size_t i = 0; i < _m; i++)
-			{
-				std::vector<T> tempVec;
-				for (size_t j = 0; j < _n; j++)
-				{
-					T tempElem;
-					if (i == j)
-						tempElem = 1.f;
-					else
-						tempElem = 0.f;
-					tempVec.push_back(tempElem);
-				}
-				_data.push_back(tempVec);
-			}
+			for (size_t i = 0; i < _m && i < _n; i++)
+				data[i * _n + i] = T(1);
 			break;
 		default:
 			break;
@@ -449,16 +528,13 @@ namespace MathLib
 	template<class T>
 	inline const T Matrix<T>::Sum(void) const
 	{
-		const Matrix<T> & self = *this;
-		T Sum = 0;
-		for (size_t i = 0; i < m; i++)
-		{
-			for (size_t j = 0; j < n; j++)
-			{
-				Sum += self(i, j);
-			}
-		}
-		return Sum;
+		const T * data = Data();
+		return ParallelReduce(0, m * n, T(0), [data](size_t _begin, size_t _end) {
+			T sum = 0;
+			for (size_t i = _begin; i < _end; i++)
+				sum += data[i];
+			return sum;
+		}, [](T _left, T _right) { return _left + _right; }, 4096);
 	}
 
 	template<class T>
@@ -543,14 +619,14 @@ namespace MathLib
 	template<class T>
 	inline void Matrix<T>::Clear(void)
 	{
-		Matrix<T> & self = *this;
-		for (size_t i = 0; i < m; i++)
+		// A shared buffer is simply dropped instead of being copied and then overwritten.
+		if (_data.use_count() > 1 && !_alias)
 		{
-			for (size_t j = 0; j < n; j++)
-			{
-				self(i, j) = 0.f;
-			}
+			_data = std::make_shared<std::vector<T>>(m * n, T(0));
+			_offset = 0;
 		}
+		else
+			std::fill(_data->begin() + _offset, _data->begin() + _offset + m * n, T(0));
 	}
 
 	template<class T>
@@ -588,9 +664,9 @@ namespace MathLib
 	inline const Matrix<T> Matrix<T>::Transpostion(void) const
 	{
 		const Matrix<T> & self = *this;
-		Matrix<T> tempMat(n, n);
+		Matrix<T> tempMat(n, m);
 		for (size_t i = 0; i < n; i++)
-			for (size_t j = 0; j < n; j++)
+			for (size_t j = 0; j < m; j++)
 				tempMat(i, j) = self(j, i);
 		return tempMat;
 	}
@@ -618,15 +694,18 @@ namespace MathLib
 	template<class T>
 	inline const T MathLib::Matrix<T>::Cofactor(const size_t _i, const size_t _j) const
 	{
-		Matrix<T> tempMat = *this;
-		auto iter1 = tempMat._data.begin() + _i;
-		tempMat._data.erase(iter1);
-		for (size_t i = 0; i < m - 1; i++)
+		const Matrix<T> & self = *this;
+		Matrix<T> tempMat(m - 1, n - 1);
+		for (size_t i = 0, a = 0; i < m; i++)
 		{
-			auto iter2 = tempMat._data.at(i).begin() + _j;
-			tempMat._data.at(i).erase(iter2);
+			if (i == _i) continue;
+			for (size_t j = 0, b = 0; j < n; j++)
+			{
+				if (j == _j) continue;
+				tempMat(a, b++) = self(i, j);
+			}
+			a++;
 		}
-		tempMat.Resize(m - 1, n - 1);
 		return tempMat.Determinant();
 	}
 
@@ -674,12 +753,14 @@ namespace MathLib
 	template<class T>
 	inline const T Matrix<T>::ForbenivsNorm(void) const
 	{
-		const Matrix<T> & self = *this;
-		T sum{ 0.f };
-		for (size_t i = 0; i < n; i++)
-			for (size_t j = 0; j < n; j++)
-				sum += self(i, j) * self(i, j);
-		return std::sqrtf(sum);
+		const T * data = Data();
+		const T sum = ParallelReduce(0, m * n, T(0), [data](size_t _begin, size_t _end) {
+			T partial = 0;
+			for (size_t i = _begin; i < _end; i++)
+				partial += data[i] * data[i];
+			return partial;
+		}, [](T _left, T _right) { return _left + _right; }, 4096);
+		return std::sqrt(sum);
 	}
 
 	template<class T>
@@ -696,13 +777,170 @@ namespace MathLib
 	template<class T>
 	inline void Matrix<T>::SwapColumn(const size_t _i, const size_t _j)
 	{
-		swap(_data.at(_i), _data.at(_j));
+		if (_i == _j) return;
+		Detach();
+		const auto begin = _data->begin() + _offset;
+		std::swap_ranges(begin + _i * n, begin + (_i + 1) * n, begin + _j * n);
 	}
 
 	template<class T>
 	inline void Matrix<T>::Resize(const size_t _m, const size_t _n)
 	{
+		Detach();
+		// A view keeps only its own range before growing or shrinking.
+		if (_alias || _offset != 0 || _data->size() != m * n)
+			_data = std::make_shared<std::vector<T>>(_data->begin() + _offset, _data->begin() + _offset + m * n);
+		_offset = 0;
+		_alias = false;
+		_data->resize(_m * _n);
 		m = _m;
 		n = _n;
+		size.m = _m;
+		size.n = _n;
+	}
+
+	template<class T>
+	inline const Matrix<T> Matrix<T>::Reshape(const size_t _m, const size_t _n) const
+	{
+		Matrix<T> view(*this);
+		if (_m * _n != m * n)
+		{
+			std::cerr << "ERROR : Invalid Matrix Reshape!" << std::endl;
+			return view;
+		}
+		view.m = view.size.m = _m;
+		view.n = view.size.n = _n;
+		return view;
+	}
+
+	template<class T>
+	inline std::vector<Matrix<T>> Matrix<T>::Split(const size_t _m, const size_t _n) const
+	{
+		std::vector<Matrix<T>> parts;
+		const size_t elements = _m * _n;
+		if (elements == 0 || (m * n) % elements != 0)
+		{
+			std::cerr << "ERROR : Invalid Matrix Split!" << std::endl;
+			return parts;
+		}
+		// The parts of an alias view a copy of its elements.
+		const Matrix<T> source(*this);
+		parts.reserve(m * n / elements);
+		for (size_t i = 0; i < m * n / elements; i++)
+		{
+			Matrix<T> view(source);
+			view._offset = source._offset + i * elements;
+			view.m = view.size.m = _m;
+			view.n = view.size.n = _n;
+			parts.push_back(std::move(view));
+		}
+		return parts;
+	}
+
+	template<class T>
+	inline Matrix<T> Matrix<T>::Join(const std::vector<Matrix<T>> & _parts, const size_t _m, const size_t _n)
+	{
+		size_t elements = 0;
+		bool consecutive = !_parts.empty() && !_parts[0]._alias;
+		for (size_t i = 0; i < _parts.size(); i++)
+		{
+			const Matrix<T> & part = _parts[i];
+			if (i > 0 && (part._data != _parts[0]._data || part._offset != _parts[0]._offset + elements))
+				consecutive = false;
+			elements += part.m * part.n;
+		}
+		if (elements != _m * _n)
+		{
+			std::cerr << "ERROR : Invalid Matrix Join!" << std::endl;
+			return Matrix<T>(_m, _n);
+		}
+		if (consecutive)
+		{
+			Matrix<T> view(_parts[0]);
+			view.m = view.size.m = _m;
+			view.n = view.size.n = _n;
+			return view;
+		}
+		std::vector<T> joined(elements);
+		T * out = joined.data();
+		for (const Matrix<T> & part : _parts)
+			out = std::copy(part.Data(), part.Data() + part.m * part.n, out);
+		return Matrix<T>(std::move(joined), _m, _n);
+	}
+
+	template<class T>
+	inline std::vector<T> Matrix<T>::Release(void)
+	{
+		std::vector<T> elements;
+		if (_data.use_count() == 1 && !_alias && _offset == 0 && _data->size() == m * n)
+			elements = std::move(*_data);
+		else
+			elements.assign(_data->begin() + _offset, _data->begin() + _offset + m * n);
+		_data = std::make_shared<std::vector<T>>();
+		_offset = 0;
+		_alias = false;
+		m = n = 0;
+		size = Size(0, 0);
+		return elements;
+	}
+
+	template<class T>
+	inline Matrix<T> Matrix<T>::Alias(const size_t _offset, const size_t _m, const size_t _n)
+	{
+		Matrix<T> alias;
+		if (this->_offset + _offset + _m * _n > _data->size())
+		{
+			std::cerr << "ERROR : Matrix Alias out of the buffer!" << std::endl;
+			return alias;
+		}
+		alias._data = _data;
+		alias._offset = this->_offset + _offset;
+		alias._alias = true;
+		alias.m = alias.size.m = _m;
+		alias.n = alias.size.n = _n;
+		return alias;
+	}
+
+	template<class T>
+	inline Matrix<T> Matrix<T>::Handle(void) const
+	{
+		if (!_alias)
+			return *this;
+		Matrix<T> alias;
+		alias._data = _data;
+		alias._offset = _offset;
+		alias._alias = true;
+		alias.m = alias.size.m = m;
+		alias.n = alias.size.n = n;
+		return alias;
+	}
+
+	template<class T>
+	inline std::vector<Matrix<T>> Matrix<T>::Handles(const std::vector<Matrix<T>> & _matrices)
+	{
+		std::vector<Matrix<T>> handles;
+		handles.reserve(_matrices.size());
+		for (const Matrix<T> & matrix : _matrices)
+			handles.push_back(matrix.Handle());
+		return handles;
+	}
+
+	// Matrix multiplication
+	/// Return op(A) * op(B), where op() optionally transposes its operand without forming the transpose.
+	template<class T>
+	inline Matrix<T> MatMul(const Matrix<T> & _A, const Matrix<T> & _B, const Transpose _transA = Transpose::NoTrans, const Transpose _transB = Transpose::NoTrans)
+	{
+		const size_t m = _transA == Transpose::NoTrans ? _A.ColumeSize() : _A.RowSize();
+		const size_t k = _transA == Transpose::NoTrans ? _A.RowSize() : _A.ColumeSize();
+		const size_t kB = _transB == Transpose::NoTrans ? _B.ColumeSize() : _B.RowSize();
+		const size_t n = _transB == Transpose::NoTrans ? _B.RowSize() : _B.ColumeSize();
+		Matrix<T> temp(m, n);
+		if (k != kB)
+		{
+			std::cerr << "ERROR : Invalid Matrix Multiplication!" << std::endl;
+			return temp;
+		}
+		GEMM(_transA, _transB, m, n, k, T(1), _A.Data(), _A.RowSize(), _B.Data(), _B.RowSize(), T(0), temp.Data(), n);
+		return temp;
 	}
 }
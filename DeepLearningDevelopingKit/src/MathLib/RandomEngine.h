@@ -5,11 +5,14 @@
 /*                                                   www.tianshicangxie.com                                                        */
 /*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
 /***************************************************************************************************/
+#pragma once
 
 // Header files
 #include <iostream>
 #include <random>
 #include <chrono>
+#include <cstdint>
+#include <cmath>
 
 template<class T>
 class RandomEngine
@@ -28,3 +31,60 @@ private:
 	std::default_random_engine _engine;
 };
 
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	/***************************************************************************************************/
+	// Class : RandomStream
+	/// Counter based random numbers (SplitMix64), the sequence only depends on the seed and the stream id.
+	/// Parallel code gives every work item (a row, a sample, a kernel) its own stream instead of sharing
+	/// one generator between threads, so the numbers drawn do not depend on the number of threads.
+	class RandomStream
+	{
+	public:
+
+		RandomStream(const uint64_t _seed, const uint64_t _stream = 0)
+		{
+			_state = Mix(_seed + 0x9E3779B97F4A7C15ULL * (Mix(_stream) + 1));
+		}
+
+	public:
+
+		// Next 64 random bits.
+		inline uint64_t Next(void)
+		{
+			_state += 0x9E3779B97F4A7C15ULL;
+			return Mix(_state);
+		}
+
+		// Uniform value within [_lowerLimit, _upperLimit).
+		inline double Uniform(const double _lowerLimit = -1, const double _upperLimit = 1)
+		{
+			const double unit = (Next() >> 11) * (1.0 / 9007199254740992.0);
+			return _lowerLimit + (_upperLimit - _lowerLimit) * unit;
+		}
+
+		// Standard normal value (Box-Muller).
+		inline double Normal(void)
+		{
+			const double u1 = 1.0 - Uniform(0, 1);
+			const double u2 = Uniform(0, 1);
+			return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+		}
+
+	private:
+
+		static inline uint64_t Mix(uint64_t _z)
+		{
+			_z = (_z ^ (_z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			_z = (_z ^ (_z >> 27)) * 0x94D049BB133111EBULL;
+			return _z ^ (_z >> 31);
+		}
+
+	private:
+
+		uint64_t _state;
+	};
+}
@@ -0,0 +1,219 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Math Library 	                                                              */
+/*								        		 	             Sparse Matrix                                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+#include "MathLibError.h"
+#include "ThreadPool.hpp"
+#include "Matrix.hpp"
+#include "Vector.hpp"
+
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	/***************************************************************************************************/
+	// Class : SparseMatrix
+	/// Compressed sparse row (CSR) storage : the non-zero elements of row i are
+	/// _value[_rowBegin[i] .. _rowBegin[i + 1]) at the columns _columnIndex[...], sorted by column.
+	/// Built once from triplets or from a dense Matrix, the pattern is immutable afterwards.
+	template<class T>
+	class SparseMatrix
+	{
+	public:
+
+		// Triplet (row, column, value) used to build a SparseMatrix.
+		typedef std::tuple<size_t, size_t, T> Triplet;
+
+	public: // Constructors
+
+		// Default constructor
+		/// An empty 0 x 0 matrix.
+		SparseMatrix(void);
+		// Constructor (Using triplets)
+		/// Duplicated positions are summed up, explicit zeros are kept.
+		SparseMatrix(const size_t _m, const size_t _n, std::vector<Triplet> _triplets);
+		// Constructor (Using a dense Matrix)
+		/// Elements with |a(i, j)| <= _threshold are dropped.
+		explicit SparseMatrix(const Matrix<T> & _mat, const T _threshold = T(0));
+
+	public: // Quantification
+
+		// Number of rows.
+		inline size_t ColumeSize(void) const { return m; }
+		// Number of columns.
+		inline size_t RowSize(void) const { return n; }
+		// Number of stored elements.
+		inline size_t NonZeroSize(void) const { return _value.size(); }
+		// Diagonal elements, zero where not stored.
+		std::vector<T> Diagonal(void) const;
+
+	public: // Storage
+
+		inline const std::vector<size_t> & RowBegin(void) const { return _rowBegin; }
+		inline const std::vector<size_t> & ColumnIndex(void) const { return _columnIndex; }
+		inline const std::vector<T> & Value(void) const { return _value; }
+
+	public: // Arithmatic
+
+		// Sparse matrix vector product
+		/// _y = A * _x, _x holds n elements and _y holds m elements.
+		/// Rows are split over the global ThreadPool, every _y(i) is computed by one thread.
+		void Multiply(const T * _x, T * _y) const;
+		// Transform into a dense Matrix.
+		Matrix<T> Densify(void) const;
+
+	public: // Operator Overloading
+
+		// "( )" operator
+		/// Read the element at (_i, _j), zero if not stored. Binary search within the row.
+		T operator()(const size_t _i, const size_t _j) const;
+
+		// "*" operator
+		/// Sparse matrix vector product.
+		Vector<T> operator*(const Vector<T> & _vec) const;
+
+	private:
+
+		size_t m, n;
+		std::vector<size_t> _rowBegin;
+		std::vector<size_t> _columnIndex;
+		std::vector<T> _value;
+	};
+}
+
+
+namespace MathLib
+{
+	template<class T>
+	SparseMatrix<T>::SparseMatrix(void)
+		: m(0), n(0), _rowBegin(1, 0)
+	{
+	}
+
+	template<class T>
+	SparseMatrix<T>::SparseMatrix(const size_t _m, const size_t _n, std::vector<Triplet> _triplets)
+		: m(_m), n(_n), _rowBegin(_m + 1, 0)
+	{
+		std::sort(_triplets.begin(), _triplets.end(), [](const Triplet & _a, const Triplet & _b) {
+			return std::get<0>(_a) != std::get<0>(_b) ? std::get<0>(_a) < std::get<0>(_b) : std::get<1>(_a) < std::get<1>(_b);
+		});
+		_columnIndex.reserve(_triplets.size());
+		_value.reserve(_triplets.size());
+		size_t lastRow = 0;
+		for (size_t t = 0; t < _triplets.size(); t++)
+		{
+			const size_t i = std::get<0>(_triplets[t]);
+			const size_t j = std::get<1>(_triplets[t]);
+			if (i >= m || j >= n)
+			{
+				std::cerr << "ERROR : Triplet (" << i << ", " << j << ") is out of the range of the SparseMatrix." << std::endl;
+				continue;
+			}
+			if (!_value.empty() && i == lastRow && j == _columnIndex.back())
+			{
+				_value.back() += std::get<2>(_triplets[t]);
+				continue;
+			}
+			_columnIndex.push_back(j);
+			_value.push_back(std::get<2>(_triplets[t]));
+			_rowBegin[i + 1]++;
+			lastRow = i;
+		}
+		for (size_t i = 0; i < m; i++)
+			_rowBegin[i + 1] += _rowBegin[i];
+	}
+
+	template<class T>
+	SparseMatrix<T>::SparseMatrix(const Matrix<T> & _mat, const T _threshold)
+		: m(_mat.ColumeSize()), n(_mat.RowSize()), _rowBegin(_mat.ColumeSize() + 1, 0)
+	{
+		const T * data = _mat.Data();
+		for (size_t i = 0; i < m; i++)
+		{
+			for (size_t j = 0; j < n; j++)
+			{
+				const T value = data[i * n + j];
+				if (std::abs(value) > _threshold)
+				{
+					_columnIndex.push_back(j);
+					_value.push_back(value);
+				}
+			}
+			_rowBegin[i + 1] = _value.size();
+		}
+	}
+
+	template<class T>
+	std::vector<T> SparseMatrix<T>::Diagonal(void) const
+	{
+		std::vector<T> diagonal(std::min(m, n), T(0));
+		for (size_t i = 0; i < diagonal.size(); i++)
+			diagonal[i] = (*this)(i, i);
+		return diagonal;
+	}
+
+	template<class T>
+	void SparseMatrix<T>::Multiply(const T * _x, T * _y) const
+	{
+		const size_t * rowBegin = _rowBegin.data();
+		const size_t * columnIndex = _columnIndex.data();
+		const T * value = _value.data();
+		const size_t grain = std::max<size_t>(64, m * 16 / (_value.size() + 1));
+		ParallelFor(0, m, [=](size_t _rowFirst, size_t _rowLast) {
+			for (size_t i = _rowFirst; i < _rowLast; i++)
+			{
+				T sum = 0;
+				for (size_t k = rowBegin[i]; k < rowBegin[i + 1]; k++)
+					sum += value[k] * _x[columnIndex[k]];
+				_y[i] = sum;
+			}
+		}, grain);
+	}
+
+	template<class T>
+	Matrix<T> SparseMatrix<T>::Densify(void) const
+	{
+		Matrix<T> dense(m, n);
+		T * data = dense.Data();
+		for (size_t i = 0; i < m; i++)
+			for (size_t k = _rowBegin[i]; k < _rowBegin[i + 1]; k++)
+				data[i * n + _columnIndex[k]] = _value[k];
+		return dense;
+	}
+
+	template<class T>
+	T SparseMatrix<T>::operator()(const size_t _i, const size_t _j) const
+	{
+		const auto first = _columnIndex.begin() + _rowBegin[_i];
+		const auto last = _columnIndex.begin() + _rowBegin[_i + 1];
+		const auto position = std::lower_bound(first, last, _j);
+		if (position == last || *position != _j)
+			return T(0);
+		return _value[position - _columnIndex.begin()];
+	}
+
+	template<class T>
+	Vector<T> SparseMatrix<T>::operator*(const Vector<T> & _vec) const
+	{
+		Vector<T> result(m);
+		try
+		{
+			if (_vec.Size() != n)
+				throw unmatched_size();
+			Multiply(_vec.data(), result.data());
+		}
+		catch (std::exception& except) { ExceptionHandle(except); }
+		return result;
+	}
+}
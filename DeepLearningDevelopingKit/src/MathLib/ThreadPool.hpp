@@ -0,0 +1,299 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Math Library 	                                                              */
+/*								        		 	             ThreadPool   	                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <exception>
+
+/***************************************************************************************************/
+// Namespace : MathLib
+/// Provide basic mathematic support and calculation tools for different algorithms.
+namespace MathLib
+{
+	/***************************************************************************************************/
+	// Class : ThreadPool
+	/// A fixed set of worker threads shared by all parallel kernels of the library.
+	/// Work is handed out through ParallelFor, the calling thread always takes part in the work,
+	/// so ParallelFor can safely be nested inside another ParallelFor.
+	class ThreadPool
+	{
+	public: // Constructors
+
+		// Constructor
+		/// _threadNum is the total number of threads working on a ParallelFor, including the caller.
+		explicit ThreadPool(const size_t _threadNum)
+		{
+			Start(_threadNum);
+		}
+
+		~ThreadPool()
+		{
+			Stop();
+		}
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool & operator = (const ThreadPool &) = delete;
+
+	public: // Global pool
+
+		// Global
+		/// The pool used by MathLib and the neural network layers.
+		/// Sized by the hardware concurrency at the first call.
+		static ThreadPool & Global(void)
+		{
+			static ThreadPool pool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+			return pool;
+		}
+
+	public: // Setter and Getter
+
+		// Get the number of threads.
+		inline size_t GetThreadNum(void) const { return _threadNum; }
+		// Set the number of threads.
+		/// Must not be called while a ParallelFor is running.
+		void SetThreadNum(const size_t _num)
+		{
+			Stop();
+			Start(std::max<size_t>(1, _num));
+		}
+		// Get whether the deterministic mode is on.
+		inline bool IsDeterministic(void) const { return _deterministic; }
+		// Set the deterministic mode.
+		/// In deterministic mode ParallelReduce and ParallelAccumulate split their range into blocks of
+		/// exactly _grain indices and combine the partial results in a fixed binary tree, so the result is
+		/// bitwise identical for any number of threads. Otherwise they use one block per thread.
+		inline void SetDeterministic(const bool _flag) { _deterministic = _flag; }
+
+	public: // Grain
+
+		// Multiply-adds a chunk needs to be worth handing to another thread.
+		/// Handing out a chunk costs about a microsecond (see the ParallelConv test), more when the worker
+		/// sleeps, 32k multiply-adds take ten of them : smaller chunks run faster on the calling thread.
+		static const size_t MinChunkWork = 32 * 1024;
+		// Grain
+		/// The grain of a ParallelFor whose indices cost _work multiply-adds each, so that every chunk
+		/// holds at least MinChunkWork of them. Small layers run on the calling thread alone.
+		static inline size_t Grain(const size_t _work)
+		{
+			return std::max<size_t>(1, MinChunkWork / std::max<size_t>(1, _work));
+		}
+
+	public: // Parallel
+
+		// ParallelFor
+		/// Split [_begin, _end) into at most GetThreadNum() contiguous ranges of at least _grain indices,
+		/// and call _func(rangeBegin, rangeEnd) for each of them in parallel.
+		/// Returns after every range is finished, then rethrows the first exception thrown by _func if any.
+		void ParallelFor(const size_t _begin, const size_t _end, const std::function<void(size_t, size_t)> & _func, const size_t _grain = 1)
+		{
+			if (_end <= _begin)
+				return;
+			const size_t total = _end - _begin;
+			const size_t grain = std::max<size_t>(1, _grain);
+			const size_t chunkNum = std::min(_threadNum, (total + grain - 1) / grain);
+			if (chunkNum <= 1)
+			{
+				_func(_begin, _end);
+				return;
+			}
+
+			std::shared_ptr<Job> job = std::make_shared<Job>();
+			job->begin = _begin;
+			job->total = total;
+			job->chunkNum = chunkNum;
+			job->func = &_func;
+			{
+				std::lock_guard<std::mutex> lock(_queueMutex);
+				for (size_t i = 1; i < chunkNum; i++)
+					_queue.push_back(job);
+			}
+			_queueCondition.notify_all();
+
+			RunJob(*job);
+
+			std::unique_lock<std::mutex> lock(job->doneMutex);
+			job->doneCondition.wait(lock, [&job] { return job->done == job->chunkNum; });
+			if (job->error)
+				std::rethrow_exception(job->error);
+		}
+
+		// ParallelReduce
+		/// Reduce [_begin, _end) : _map(rangeBegin, rangeEnd) returns the partial result of a range,
+		/// partial results are merged with _combine(left, right), _identity is returned for an empty range.
+		template<class T, class Map, class Combine>
+		T ParallelReduce(const size_t _begin, const size_t _end, const T & _identity, const Map & _map, const Combine & _combine, const size_t _grain = 1)
+		{
+			if (_end <= _begin)
+				return _identity;
+			const size_t total = _end - _begin;
+			const size_t grain = std::max<size_t>(1, _grain);
+			const size_t blockNum = _deterministic ? (total + grain - 1) / grain : std::min(_threadNum, (total + grain - 1) / grain);
+			const bool deterministic = _deterministic;
+			std::vector<T> partials(blockNum, _identity);
+			ParallelFor(0, blockNum, [&](size_t _blockBegin, size_t _blockEnd) {
+				for (size_t block = _blockBegin; block < _blockEnd; block++)
+				{
+					const size_t rangeBegin = deterministic ? _begin + block * grain : _begin + total * block / blockNum;
+					const size_t rangeEnd = deterministic ? std::min(_end, rangeBegin + grain) : _begin + total * (block + 1) / blockNum;
+					partials[block] = _map(rangeBegin, rangeEnd);
+				}
+			});
+			for (size_t step = 1; step < blockNum; step *= 2)
+				for (size_t i = 0; i + step < blockNum; i += 2 * step)
+					partials[i] = _combine(partials[i], partials[i + step]);
+			return partials[0];
+		}
+
+		// ParallelAccumulate
+		/// Sum the contributions of every index of [_begin, _end) into _result[0, _length).
+		/// _func(index, accumulator) adds the contribution of one index to a zeroed accumulator of _length elements,
+		/// every block of indices owns its own accumulator, so _func never needs to lock.
+		template<class T, class Func>
+		void ParallelAccumulate(const size_t _begin, const size_t _end, const size_t _length, const Func & _func, T * _result, const size_t _grain = 1)
+		{
+			std::vector<T> sum = ParallelReduce(_begin, _end, std::vector<T>(),
+				[&](size_t _rangeBegin, size_t _rangeEnd) {
+				std::vector<T> accumulator(_length, T(0));
+				for (size_t i = _rangeBegin; i < _rangeEnd; i++)
+					_func(i, accumulator.data());
+				return accumulator;
+			},
+				[](const std::vector<T> & _left, const std::vector<T> & _right) {
+				if (_left.empty()) return _right;
+				if (_right.empty()) return _left;
+				std::vector<T> merged(_left);
+				for (size_t i = 0; i < merged.size(); i++)
+					merged[i] += _right[i];
+				return merged;
+			}, _grain);
+			for (size_t i = 0; i < sum.size(); i++)
+				_result[i] += sum[i];
+		}
+
+	private: // Inner working functions
+
+		// Job shared by all threads working on one ParallelFor.
+		struct Job
+		{
+			size_t begin;
+			size_t total;
+			size_t chunkNum;
+			const std::function<void(size_t, size_t)> * func;
+			std::atomic<size_t> next{ 0 };
+			size_t done{ 0 };
+			std::exception_ptr error;
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+		};
+
+		// Claim chunks of a job until none is left.
+		/// A chunk that throws still counts as done, the first exception is kept for ParallelFor to rethrow.
+		static void RunJob(Job & _job)
+		{
+			size_t chunk;
+			while ((chunk = _job.next.fetch_add(1)) < _job.chunkNum)
+			{
+				const size_t chunkBegin = _job.begin + _job.total * chunk / _job.chunkNum;
+				const size_t chunkEnd = _job.begin + _job.total * (chunk + 1) / _job.chunkNum;
+				std::exception_ptr error;
+				try
+				{
+					(*_job.func)(chunkBegin, chunkEnd);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+				std::lock_guard<std::mutex> lock(_job.doneMutex);
+				if (error && !_job.error)
+					_job.error = error;
+				if (++_job.done == _job.chunkNum)
+					_job.doneCondition.notify_all();
+			}
+		}
+
+		void WorkerLoop(void)
+		{
+			while (true)
+			{
+				std::shared_ptr<Job> job;
+				{
+					std::unique_lock<std::mutex> lock(_queueMutex);
+					_queueCondition.wait(lock, [this] { return _stop || !_queue.empty(); });
+					if (_stop && _queue.empty())
+						return;
+					job = _queue.front();
+					_queue.pop_front();
+				}
+				RunJob(*job);
+			}
+		}
+
+		void Start(const size_t _num)
+		{
+			_threadNum = _num;
+			_stop = false;
+			for (size_t i = 1; i < _threadNum; i++)
+				_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+
+		void Stop(void)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_queueMutex);
+				_stop = true;
+			}
+			_queueCondition.notify_all();
+			for (std::thread & worker : _workers)
+				worker.join();
+			_workers.clear();
+		}
+
+	private:
+
+		size_t _threadNum;
+		bool _stop;
+		bool _deterministic = false;
+		std::vector<std::thread> _workers;
+		std::deque<std::shared_ptr<Job>> _queue;
+		std::mutex _queueMutex;
+		std::condition_variable _queueCondition;
+	};
+
+	// ParallelFor
+	/// Shortcut of ThreadPool::Global().ParallelFor().
+	inline void ParallelFor(const size_t _begin, const size_t _end, const std::function<void(size_t, size_t)> & _func, const size_t _grain = 1)
+	{
+		ThreadPool::Global().ParallelFor(_begin, _end, _func, _grain);
+	}
+
+	// ParallelReduce
+	/// Shortcut of ThreadPool::Global().ParallelReduce().
+	template<class T, class Map, class Combine>
+	inline T ParallelReduce(const size_t _begin, const size_t _end, const T & _identity, const Map & _map, const Combine & _combine, const size_t _grain = 1)
+	{
+		return ThreadPool::Global().ParallelReduce(_begin, _end, _identity, _map, _combine, _grain);
+	}
+
+	// ParallelAccumulate
+	/// Shortcut of ThreadPool::Global().ParallelAccumulate().
+	template<class T, class Func>
+	inline void ParallelAccumulate(const size_t _begin, const size_t _end, const size_t _length, const Func & _func, T * _result, const size_t _grain = 1)
+	{
+		ThreadPool::Global().ParallelAccumulate(_begin, _end, _length, _func, _result, _grain);
+	}
+}
@@ -47,6 +47,9 @@ namespace MathLib
 		// Constructor (Using given Data)
 		/// Using data from a given pointer, which is pointed to an array, to initialize the Vector.
 		Vector(const std::initializer_list<int> & _list);
+		// Constructor (Adopting a buffer)
+		/// Take over the elements of _elements, nothing is copied.
+		explicit Vector(std::vector<T> && _elements);
 
 	public: // Initializing
 
@@ -96,9 +99,12 @@ namespace MathLib
 	public: // Pointer
 
 		// Pointer
-		T * data() { return this->_data[0]; }
+		T * data() { return this->_data.data(); }
 		// Const pointer
-		const T * data() const { return this->_data[0]; }
+		const T * data() const { return this->_data.data(); }
+		// Release
+		/// Move the elements out, leaving an empty Vector.
+		std::vector<T> Release(void) { std::vector<T> elements; elements.swap(this->_data); n = 0; return elements; }
 
 	public: // Operator Overloading
 
@@ -131,11 +137,12 @@ namespace MathLib
 		}
 
 		// "=" operator
+		/// A default constructed Vector takes the size of the assigned one.
 		Vector<T> & operator = (const Vector<T> & _other)
 		{
 			try
 			{
-				if (this->n != _other.n)
+				if (this->n != 0 && this->n != _other.n)
 					throw unmatched_size();
 				else
 					if (this != &_other)
@@ -281,7 +288,7 @@ namespace MathLib
 	/// Take no parameters.
 	/// After default constructor and before use the Vector object, Init() should be involked.
 	template<class T>
-	inline Vector<T>::Vector(void)
+	inline Vector<T>::Vector(void) : n(0)
 	{
 
 	}
@@ -308,6 +315,14 @@ namespace MathLib
 		}
 	}
 
+	// Constructor (Adopting a buffer)
+	/// Take over the elements of _elements, nothing is copied.
+	template<class T>
+	inline Vector<T>::Vector(std::vector<T> && _elements)
+		: _data(std::move(_elements)), n(_data.size())
+	{
+	}
+
 	// Initializing function
 	/// Initializing the Vector after defined by default constructor.
 	template<class T>
@@ -0,0 +1,252 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	  Batch Normalization Test                                                     */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define BatchNormDebug
+
+#ifdef BatchNormDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+int main()
+{
+	// The forward propagation against a two pass reference, on inputs far from zero.
+	const size_t batchSize = 3, channelNum = 2;
+	const MathLib::Size size(5, 7);
+	Neural::BatchNormLayerInitor initor;
+	initor.Channels = channelNum;
+	initor.InputSize = size;
+	Neural::BatchNormLayer layer(initor);
+	for (size_t c = 0; c < channelNum; c++)
+	{
+		layer._gamma[c] = 0.5 + c;
+		layer._beta[c] = 0.25 - c;
+	}
+	Neural::FeatureBatch input = RandomBatch(batchSize, channelNum, size, 1000);
+	layer.SetInputBatch(input);
+	layer.ForwardPropagationBatch();
+	double forwardError = 0;
+	for (size_t c = 0; c < channelNum; c++)
+	{
+		const double count = double(batchSize * size.m * size.n);
+		double mean = 0, variance = 0;
+		for (size_t n = 0; n < batchSize; n++)
+			for (size_t i = 0; i < size.m; i++)
+				for (size_t j = 0; j < size.n; j++)
+					mean += input[n][c](i, j) / count;
+		for (size_t n = 0; n < batchSize; n++)
+			for (size_t i = 0; i < size.m; i++)
+				for (size_t j = 0; j < size.n; j++)
+					variance += (input[n][c](i, j) - mean) * (input[n][c](i, j) - mean) / count;
+		for (size_t n = 0; n < batchSize; n++)
+			for (size_t i = 0; i < size.m; i++)
+				for (size_t j = 0; j < size.n; j++)
+				{
+					const double expected = layer._gamma[c] * (input[n][c](i, j) - mean) / sqrt(variance + initor.Epsilon) + layer._beta[c];
+					forwardError = max(forwardError, abs(expected - layer.GetFeatureBatch()[n][c](i, j)));
+				}
+	}
+	cout << "Forward against two passes : " << forwardError << endl;
+
+	// Gradients against central differences, the statistics move with the input.
+	input = RandomBatch(batchSize, channelNum, size);
+	const Neural::FeatureBatch weights = RandomBatch(batchSize, channelNum, size);
+	layer.SetInputBatch(input);
+	layer.ForwardPropagationBatch();
+	layer.SetDeltaBatch(weights);
+	layer.BackwardPropagationBatch();
+	const Neural::FeatureBatch delta = layer.GetDeltaBatch();
+	const vector<double> gammaDelta = layer._gammaDelta, betaDelta = layer._betaDelta;
+	double gammaError = 0, betaError = 0, inputError = 0;
+	for (size_t c = 0; c < channelNum; c++)
+	{
+		gammaError = max(gammaError, CheckValue(layer, weights, gammaDelta[c],
+			[&] { return layer._gamma[c]; }, [&](double _value) { layer._gamma[c] = _value; }));
+		betaError = max(betaError, CheckValue(layer, weights, betaDelta[c],
+			[&] { return layer._beta[c]; }, [&](double _value) { layer._beta[c] = _value; }));
+	}
+	for (size_t n = 0; n < batchSize; n++)
+		for (size_t c = 0; c < channelNum; c++)
+			for (size_t i = 0; i < size.m; i++)
+				for (size_t j = 0; j < size.n; j++)
+					inputError = max(inputError, CheckValue(layer, weights, delta[n][c](i, j),
+						[&] { return input[n][c](i, j); },
+						[&](double _value) { input[n][c](i, j) = _value; layer.SetInputBatch(input); }));
+	cout << "Gradients : gamma " << gammaError << "  beta " << betaError << "  input " << inputError << endl;
+
+	// conv -> batch norm -> relu -> max pool, trained for a few steps, then frozen : the batch norm moves
+	// into the kernels and the rest fuses into one layer.
+	const size_t modelBatch = 4;
+	Neural::SequentialInitor modelInitor;
+	modelInitor.InputChannels = 3;
+	modelInitor.InputSize = MathLib::Size(32, 32);
+	modelInitor.BatchSize = modelBatch;
+	Neural::Sequential model(modelInitor);
+	Neural::ConvLayerInitor convInitor;
+	convInitor.Stride = 1;
+	convInitor.KernelNum = 8;
+	convInitor.KernelSize = MathLib::Size(3, 3);
+	convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	convInitor.ActivationFunction = ActivationFunction::Linear;
+	convInitor.Algorithm = Neural::ConvolutionAlgorithm::Auto;
+	Neural::PoolLayerInitor poolInitor;
+	poolInitor.Stride = 2;
+	poolInitor.PoolSize = MathLib::Size(2, 2);
+	poolInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	poolInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	poolInitor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+	Neural::ProcessLayerInitor reluInitor;
+	reluInitor.ProcessFunction = ReLU;
+	reluInitor.ProcessFunctionDerivative = ReLUDerivative;
+	model.Add(convInitor);
+	model.Add(Neural::BatchNormLayerInitor());
+	model.Add(reluInitor);
+	model.Add(poolInitor);
+	model.Add(Neural::BatchNormLayerInitor());
+	model.SetLearnRate(0.01);
+	for (size_t step = 0; step < 20; step++)
+	{
+		model.SetInputBatch(RandomBatch(modelBatch, 3, MathLib::Size(32, 32)));
+		model.ForwardPropagation();
+		model.SetDeltaBatch(RandomBatch(modelBatch, 8, MathLib::Size(16, 16)));
+		model.BackwardPropagation();
+		model.BatchDeltaSumUpdate(modelBatch);
+		model.Update();
+		model.BatchDeltaSumClear();
+	}
+	const Neural::FeatureBatch test = RandomBatch(modelBatch, 3, MathLib::Size(32, 32));
+	model.SetTraining(false);
+	model.SetInputBatch(test);
+	model.ForwardPropagation();
+	vector<vector<MathLib::Matrix<double>>> expected;
+	for (const vector<MathLib::Matrix<double>> & sample : model.GetOutputBatch())
+	{
+		expected.push_back(vector<MathLib::Matrix<double>>());
+		for (const MathLib::Matrix<double> & map : sample)
+			expected.back().push_back(map * 1.0);
+	}
+	model.Freeze(&cout);
+	model.PrintSummary();
+	model.SetInputBatch(test);
+	model.ForwardPropagation();
+	double foldError = 0;
+	for (size_t n = 0; n < modelBatch; n++)
+		foldError = max(foldError, MaxError(model.GetOutputBatch()[n], expected[n]));
+	cout << "Folded output error : " << foldError << endl;
+
+	// Inference of conv -> batch norm -> relu, twice, 32 channels of 64x64 over a batch of 8, before and
+	// after folding : the model differs by the two batch norms alone, which cost one sweep each.
+	const size_t repeat = 20, benchBatch = 8, benchChannels = 32;
+	const MathLib::Size benchSize(64, 64);
+	modelInitor.InputChannels = benchChannels;
+	modelInitor.InputSize = benchSize;
+	modelInitor.BatchSize = benchBatch;
+	Neural::Sequential bench(modelInitor);
+	convInitor.KernelNum = benchChannels;
+	for (size_t l = 0; l < 2; l++)
+	{
+		bench.Add(convInitor);
+		bench.Add(Neural::BatchNormLayerInitor());
+		bench.Add(reluInitor);
+	}
+	for (size_t step = 0; step < 3; step++)
+	{
+		bench.SetInputBatch(RandomBatch(benchBatch, benchChannels, benchSize));
+		bench.ForwardPropagation();
+	}
+	const Neural::FeatureBatch benchInput = RandomBatch(benchBatch, benchChannels, benchSize);
+	bench.SetTraining(false);
+	bench.SetInputBatch(benchInput);
+	// Best of repeat runs, the first one warms up.
+	auto best = [&](function<void(void)> _run) {
+		double time = INFINITY;
+		for (size_t r = 0; r <= repeat; r++)
+		{
+			const auto start = chrono::steady_clock::now();
+			_run();
+			if (r > 0)
+				time = min(time, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		}
+		return time;
+	};
+	const double unfolded = best([&] { bench.ForwardPropagation(); });
+	expected.clear();
+	for (const vector<MathLib::Matrix<double>> & sample : bench.GetOutputBatch())
+	{
+		expected.push_back(vector<MathLib::Matrix<double>>());
+		for (const MathLib::Matrix<double> & map : sample)
+			expected.back().push_back(map * 1.0);
+	}
+	initor.Channels = benchChannels;
+	initor.InputSize = benchSize;
+	Neural::BatchNormLayer sweep(initor);
+	sweep.SetTraining(false);
+	sweep.SetInputBatch(benchInput);
+	const double batchNorm = 2 * best([&] { sweep.ForwardPropagationBatch(); });
+	bench.Freeze();
+	bench.SetInputBatch(benchInput);
+	const double folded = best([&] { bench.ForwardPropagation(); });
+	foldError = 0;
+	for (size_t n = 0; n < benchBatch; n++)
+		foldError = max(foldError, MaxError(bench.GetOutputBatch()[n], expected[n]));
+	cout << bench.GetLayerNum() << " layers folded, output error " << foldError << "  inference " << unfolded << "ms -> "
+		<< folded << "ms, the two batch norms alone " << batchNorm << "ms" << endl;
+
+	// Training forward and backward of 32 channels of 56x56 over a batch of 8, against the three pass
+	// forward of the reference above and against the one sweep of the inference forward, which reads and
+	// writes every value once.
+	initor.Channels = 32;
+	initor.InputSize = MathLib::Size(56, 56);
+	Neural::BatchNormLayer big(initor);
+	const Neural::FeatureBatch bigInput = RandomBatch(8, 32, initor.InputSize);
+	big.SetInputBatch(bigInput);
+	big.SetDeltaBatch(RandomBatch(8, 32, initor.InputSize));
+	big.ForwardPropagationBatch();
+	const size_t pixels = 56 * 56;
+	const double forward = best([&] { big.ForwardPropagationBatch(); });
+	const double backward = best([&] { big.BackwardPropagationBatch(); });
+	Neural::FeatureBatch reference = RandomBatch(8, 32, initor.InputSize);
+	const double threePass = best([&] {
+		for (size_t c = 0; c < 32; c++)
+		{
+			double mean = 0, variance = 0;
+			for (size_t n = 0; n < 8; n++)
+				for (size_t p = 0; p < pixels; p++)
+					mean += bigInput[n][c].Data()[p];
+			mean /= 8 * pixels;
+			for (size_t n = 0; n < 8; n++)
+				for (size_t p = 0; p < pixels; p++)
+					variance += (bigInput[n][c].Data()[p] - mean) * (bigInput[n][c].Data()[p] - mean);
+			const double inverse = 1 / sqrt(variance / (8 * pixels) + initor.Epsilon);
+			for (size_t n = 0; n < 8; n++)
+			{
+				double * output = reference[n][c].Data();
+				for (size_t p = 0; p < pixels; p++)
+					output[p] = (bigInput[n][c].Data()[p] - mean) * inverse;
+			}
+		}
+	});
+	big.SetTraining(false);
+	const double oneSweep = best([&] { big.ForwardPropagationBatch(); });
+	cout << "8 x 32 x 56x56 forward : " << forward << "ms  backward : " << backward << "ms  three pass forward : "
+		<< threePass << "ms  one sweep : " << oneSweep << "ms" << endl;
+
+	system("pause");
+	return 0;
+}
+
+#endif // BatchNormDebug
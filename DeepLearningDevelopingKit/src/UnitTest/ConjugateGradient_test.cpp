@@ -0,0 +1,110 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	      Conjugate Gradient Solver Test                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define ConjugateGradientDebug
+
+#ifdef ConjugateGradientDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "..\MathLib\MathLib.h"
+#include "..\Algorithm\MatrixAnalysis\ConjugateGradient.hpp"
+
+using namespace std;
+using namespace MathLib;
+using namespace MathLib::IterativeSolver;
+
+void Print(const char * _name, const CGReport<double> & _report)
+{
+	cout << _name << " : converged = " << _report.Converged << "  iterations = " << _report.Iteration
+		<< "  true residual = " << _report.TrueResidual << "  setup = " << _report.SetupTime << "ms  solve = " << _report.SolveTime << "ms" << endl;
+}
+
+int main()
+{
+	// Five point Laplacian of a 200 x 200 grid, 40000 unknowns.
+	const size_t grid = 200, n = grid * grid;
+	vector<SparseMatrix<double>::Triplet> triplets;
+	for (size_t i = 0; i < grid; i++)
+		for (size_t j = 0; j < grid; j++)
+		{
+			const size_t row = i * grid + j;
+			triplets.push_back(make_tuple(row, row, 4.0 + 1e-2 * (i % 7)));
+			if (i > 0) triplets.push_back(make_tuple(row, row - grid, -1.0));
+			if (i + 1 < grid) triplets.push_back(make_tuple(row, row + grid, -1.0));
+			if (j > 0) triplets.push_back(make_tuple(row, row - 1, -1.0));
+			if (j + 1 < grid) triplets.push_back(make_tuple(row, row + 1, -1.0));
+		}
+	SparseMatrix<double> laplacian(n, n, triplets);
+	Vector<double> b(n);
+	RandomStream stream(5);
+	for (size_t i = 0; i < n; i++)
+		b(i) = stream.Uniform();
+
+	CGInitor<double> initor;
+	initor.Tolerance = 1e-10;
+	for (Preconditioner precondition : { Preconditioner::None, Preconditioner::Jacobi, Preconditioner::IncompleteCholesky })
+	{
+		initor.Precondition = precondition;
+		Vector<double> x;
+		CGReport<double> report = ConjugateGradient(laplacian, b, x, initor);
+		Print(precondition == Preconditioner::None ? "Laplacian, none" : precondition == Preconditioner::Jacobi ? "Laplacian, Jacobi" : "Laplacian, IC(0)", report);
+	}
+
+	// Dense SPD system, IC of a dense matrix is its exact Cholesky factor.
+	const size_t m = 200;
+	Matrix<double> R(m, m, MatrixType::Random);
+	Matrix<double> A = MatMul(R, R, Transpose::Trans);
+	for (size_t i = 0; i < m; i++)
+		A(i, i) += m;
+	Vector<double> c(m, VectorType::Ones), y, z;
+	initor.Precondition = Preconditioner::Jacobi;
+	Print("Dense, Jacobi", ConjugateGradient(A, c, y, initor));
+	initor.Precondition = Preconditioner::IncompleteCholesky;
+	Print("Dense, Cholesky", ConjugateGradient(A, c, z, initor));
+
+	// Ridge regression on sparse features, matrix-free (X^T * X + lambda * I) * w = X^T * t.
+	const size_t sampleNum = 5000, featureNum = 2000;
+	const double lambda = 1e-1;
+	vector<SparseMatrix<double>::Triplet> features, featuresT;
+	for (size_t s = 0; s < sampleNum; s++)
+		for (size_t k = 0; k < 10; k++)
+		{
+			const size_t f = size_t(stream.Next() % featureNum);
+			const double v = stream.Normal();
+			features.push_back(make_tuple(s, f, v));
+			featuresT.push_back(make_tuple(f, s, v));
+		}
+	SparseMatrix<double> X(sampleNum, featureNum, features), XT(featureNum, sampleNum, featuresT);
+	Vector<double> target(sampleNum);
+	for (size_t s = 0; s < sampleNum; s++)
+		target(s) = stream.Normal();
+	Vector<double> rhs = XT * target;
+	vector<double> diagonal(featureNum, lambda);
+	for (const auto & triplet : featuresT)
+		diagonal[get<0>(triplet)] += get<2>(triplet) * get<2>(triplet);
+	vector<double> buffer(sampleNum);
+	LinearOperator<double> normal = [&](const double * _in, double * _out) {
+		X.Multiply(_in, buffer.data());
+		XT.Multiply(buffer.data(), _out);
+		for (size_t i = 0; i < featureNum; i++)
+			_out[i] += lambda * _in[i];
+	};
+	initor.Precondition = Preconditioner::Jacobi;
+	size_t monitored = 0;
+	initor.Monitor = [&monitored](size_t, double) { monitored++; };
+	Vector<double> w;
+	CGReport<double> report = ConjugateGradient(normal, rhs, w, initor, diagonal);
+	Print("Ridge, matrix-free Jacobi", report);
+	cout << "Monitor calls : " << monitored << "  history : " << report.History.size() << "  operator calls : " << report.OperatorCall << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // ConjugateGradientDebug
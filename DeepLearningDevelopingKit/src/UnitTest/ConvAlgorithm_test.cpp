@@ -0,0 +1,127 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	     Convolution Algorithm Test                                               */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define ConvAlgorithmDebug
+
+#ifdef ConvAlgorithmDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+// One convolutional layer configuration of the image recognization example.
+struct Config
+{
+	const char * name;
+	size_t inputSize;
+	size_t kernelSize;
+	size_t kernelNum;
+	size_t channelNum;
+};
+
+Neural::ConvolutionalLayer MakeLayer(const Config & _config)
+{
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(_config.inputSize, _config.inputSize);
+	initor.KernelSize = MathLib::Size(_config.kernelSize, _config.kernelSize);
+	initor.Stride = 1;
+	initor.KernelNum = _config.kernelNum;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	return Neural::ConvolutionalLayer(initor);
+}
+
+// Milliseconds per forward propagation.
+double Time(Neural::ConvolutionalLayer & _layer, const size_t _repeat)
+{
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < _repeat; r++)
+		_layer.ForwardPropagation();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / _repeat;
+}
+
+int main()
+{
+	const Config configs[] = {
+		{ "32x32, 5x5, 5 kernels, 1 channel", 32, 5, 5, 1 },
+		{ "8x8, 3x3, 10 kernels, 5 channels", 8, 3, 10, 5 },
+		{ "64x64, 7x7, 8 kernels, 1 channel", 64, 7, 8, 1 },
+		{ "64x64, 11x11, 8 kernels, 1 channel", 64, 11, 8, 1 },
+		{ "224x224, 3x3, 8 kernels, 3 channels", 224, 3, 8, 3 },
+		{ "448x448, 7x7, 8 kernels, 3 channels", 448, 7, 8, 3 }
+	};
+	const pair<Neural::ConvolutionAlgorithm, const char *> algorithms[] = {
+		{ Neural::ConvolutionAlgorithm::Im2col, "Im2col" },
+		{ Neural::ConvolutionAlgorithm::DirectTiled, "DirectTiled" },
+		{ Neural::ConvolutionAlgorithm::FFT, "FFT" },
+		{ Neural::ConvolutionAlgorithm::Auto, "Auto" }
+	};
+	for (const Config & config : configs)
+	{
+		Neural::ConvolutionalLayer layer = MakeLayer(config);
+		vector<MathLib::Matrix<double>> input;
+		for (size_t c = 0; c < config.channelNum; c++)
+			input.push_back(MathLib::Matrix<double>(config.inputSize, config.inputSize, MathLib::MatrixType::Random));
+		layer.SetInput(input);
+
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+		layer.ForwardPropagation();
+		const vector<Neural::ConvFeature> reference = layer.GetFeatureAll();
+		// Fewer repetitions on the large maps.
+		const size_t repeat = max<size_t>(1, 64 * 64 * 10 / (config.inputSize * config.inputSize));
+		const double direct = Time(layer, 2 * repeat);
+
+		cout << config.name << endl;
+		cout << "  Direct : " << direct << "ms" << endl;
+		for (const auto & algorithm : algorithms)
+		{
+			layer.SetAlgorithm(algorithm.first);
+			layer.ForwardPropagation();
+			const double error = MaxError(reference, layer.GetFeatureAll());
+			const double elapsed = Time(layer, 20 * repeat);
+			cout << "  " << algorithm.second << " : " << elapsed << "ms  Speedup : " << direct / elapsed << "  Max error : " << error << endl;
+		}
+	}
+
+	// The cached kernel forms survive forward passes and are rebuilt after Update().
+	Neural::ConvolutionalLayer layer = MakeLayer(configs[0]);
+	layer.SetInput({ MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random) });
+	layer.SetAlgorithm(Neural::ConvolutionAlgorithm::FFT);
+	layer.ForwardPropagation();
+	const size_t version = layer.GetKernelVersion();
+	const complex<double> * spectra = layer.GetKernelSpectra();
+	layer.ForwardPropagation();
+	cout << "Kernel cache reused : " << (layer.GetKernelVersion() == version && layer.GetKernelSpectra() == spectra) << endl;
+	for (Neural::ConvNode & node : layer._convNodes)
+		node.kernelDeltaSum = MathLib::Matrix<double>(5, 5, MathLib::MatrixType::Random);
+	layer.Update();
+	const pair<Neural::ConvolutionAlgorithm, const char *> cached[] = {
+		{ Neural::ConvolutionAlgorithm::FFT, "FFT" },
+		{ Neural::ConvolutionAlgorithm::Im2col, "Im2col" },
+		{ Neural::ConvolutionAlgorithm::DirectTiled, "DirectTiled" }
+	};
+	for (const auto & algorithm : cached)
+	{
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+		layer.ForwardPropagation();
+		const vector<Neural::ConvFeature> reference = layer.GetFeatureAll();
+		layer.SetAlgorithm(algorithm.first);
+		layer.ForwardPropagation();
+		cout << "Max error after Update, " << algorithm.second << " : " << MaxError(reference, layer.GetFeatureAll()) << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // ConvAlgorithmDebug
@@ -0,0 +1,104 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	   Convolution Backward Test                                                  */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define ConvBackwardDebug
+
+#ifdef ConvBackwardDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+int main()
+{
+	struct Config { size_t inputSize, kernelSize, stride, dilation, kernelNum, channelNum; };
+	const Config configs[] = {
+		{ 9, 3, 1, 1, 3, 2 },
+		{ 10, 5, 2, 1, 4, 3 },
+		{ 11, 3, 2, 2, 2, 1 },
+		{ 8, 4, 3, 1, 3, 2 }
+	};
+	for (const Config & config : configs)
+	{
+		Neural::ConvLayerInitor initor;
+		initor.InputSize = MathLib::Size(config.inputSize, config.inputSize);
+		initor.KernelSize = MathLib::Size(config.kernelSize, config.kernelSize);
+		initor.Stride = config.stride;
+		initor.Dilation = config.dilation;
+		initor.KernelNum = config.kernelNum;
+		initor.ActivationFunction = ActivationFunction::Linear;
+		initor.PaddingMethod = Neural::PaddingMethod::Surround;
+		initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+		Neural::ConvolutionalLayer layer(initor);
+		const MathLib::Size output = layer.GetOutputSize();
+
+		vector<MathLib::Matrix<double>> input, weights;
+		for (size_t c = 0; c < config.channelNum; c++)
+			input.push_back(MathLib::Matrix<double>(config.inputSize, config.inputSize, MathLib::MatrixType::Random));
+		for (size_t k = 0; k < config.kernelNum; k++)
+			weights.push_back(MathLib::Matrix<double>(output.m, output.n, MathLib::MatrixType::Random));
+		layer.SetInput(input);
+		layer.ForwardPropagation();
+		layer.SetDelta(weights);
+		layer.BackwardPropagation();
+		const vector<MathLib::Matrix<double>> delta = layer.GetDelta();
+
+		double kernelError = 0, biasError = 0, inputError = 0;
+		for (size_t k = 0; k < config.kernelNum; k++)
+		{
+			Neural::ConvNode & node = layer._convNodes.at(k);
+			const Neural::ConvKernel kernelDelta = node.kernelDelta;
+			for (size_t m = 0; m < config.kernelSize; m++)
+				for (size_t n = 0; n < config.kernelSize; n++)
+					kernelError = max(kernelError, CheckValue(layer, weights, kernelDelta(m, n),
+						[&] { return node.kernel(m, n); },
+						[&](double _value) { node.kernel(m, n) = _value; layer.InvalidateKernelCache(); }));
+			biasError = max(biasError, CheckValue(layer, weights, node.biasDelta,
+				[&] { return node.bias; }, [&](double _value) { node.bias = _value; }));
+		}
+		for (size_t c = 0; c < config.channelNum; c++)
+			for (size_t i = 0; i < config.inputSize; i++)
+				for (size_t j = 0; j < config.inputSize; j++)
+					inputError = max(inputError, CheckValue(layer, weights, delta[c](i, j),
+						[&] { return input[c](i, j); },
+						[&](double _value) { input[c](i, j) = _value; layer.SetInput(input); }));
+
+		cout << config.inputSize << "x" << config.inputSize << " kernel " << config.kernelSize << " stride " << config.stride
+			<< " dilation " << config.dilation << " : kernel " << kernelError << "  bias " << biasError << "  input " << inputError << endl;
+	}
+
+	// Backward time of the image recognization sized layer.
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(32, 32);
+	initor.KernelSize = MathLib::Size(5, 5);
+	initor.Stride = 1;
+	initor.KernelNum = 5;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	Neural::ConvolutionalLayer layer(initor);
+	vector<MathLib::Matrix<double>> delta;
+	for (size_t k = 0; k < 5; k++)
+		delta.push_back(MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random));
+	layer.SetInput({ MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random) });
+	layer.SetDelta(delta);
+	layer.ForwardPropagation();
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < 100; r++)
+		layer.BackwardPropagation();
+	cout << "32x32, 5x5, 5 kernels backward : " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / 100 << "ms" << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // ConvBackwardDebug
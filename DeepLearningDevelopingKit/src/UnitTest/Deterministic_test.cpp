@@ -0,0 +1,107 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	         Deterministic Parallel Test                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define DeterministicDebug
+
+#ifdef DeterministicDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <atomic>
+#include <stdexcept>
+#include "..\MathLib\MathLib.h"
+#include "..\Algorithm\MatrixAnalysis\SVD.hpp"
+
+using namespace std;
+using namespace MathLib;
+using namespace MathLib::MatrixDecomposition;
+
+// Results of the parallel routines under the current thread number.
+struct Result
+{
+	double sum;
+	double norm;
+	vector<double> accumulated;
+	vector<double> singularValues;
+};
+
+Result Run(const Matrix<double> & _mat)
+{
+	Result result;
+	result.sum = _mat.Sum();
+	result.norm = _mat.ForbenivsNorm();
+
+	// Column sums accumulated row by row, as a gradient would be accumulated sample by sample.
+	const size_t m = _mat.ColumeSize();
+	const size_t n = _mat.RowSize();
+	const double * data = _mat.Data();
+	result.accumulated.assign(n, 0.0);
+	ParallelAccumulate(0, m, n, [data, n](size_t _row, double * _accumulator) {
+		for (size_t j = 0; j < n; j++)
+			_accumulator[j] += data[_row * n + j];
+	}, result.accumulated.data(), 8);
+
+	tuple<Matrix<double>, Vector<double>, Matrix<double>> svd = RandomizedSVD(_mat, 5);
+	for (size_t k = 0; k < 5; k++)
+		result.singularValues.push_back(get<1>(svd)(k));
+	return result;
+}
+
+bool BitwiseEqual(const Result & _a, const Result & _b)
+{
+	return memcmp(&_a.sum, &_b.sum, sizeof(double)) == 0
+		&& memcmp(&_a.norm, &_b.norm, sizeof(double)) == 0
+		&& memcmp(_a.accumulated.data(), _b.accumulated.data(), _a.accumulated.size() * sizeof(double)) == 0
+		&& memcmp(_a.singularValues.data(), _b.singularValues.data(), _a.singularValues.size() * sizeof(double)) == 0;
+}
+
+int main()
+{
+	Matrix<double> mat(300, 200);
+	RandomStream stream(42);
+	for (size_t i = 0; i < 300; i++)
+		for (size_t j = 0; j < 200; j++)
+			mat(i, j) = stream.Uniform() * 1e3;
+
+	ThreadPool::Global().SetDeterministic(true);
+	ThreadPool::Global().SetThreadNum(1);
+	const Result reference = Run(mat);
+	for (size_t threadNum : { 2, 3, 8 })
+	{
+		ThreadPool::Global().SetThreadNum(threadNum);
+		cout << "Deterministic, " << threadNum << " threads : bitwise identical = " << BitwiseEqual(reference, Run(mat)) << endl;
+	}
+
+	// Without the deterministic mode the blocks follow the thread number and the last bits may differ.
+	ThreadPool::Global().SetDeterministic(false);
+	ThreadPool::Global().SetThreadNum(3);
+	const Result relaxed = Run(mat);
+	cout << "Relaxed, 3 threads : sum difference = " << relaxed.sum - reference.sum << endl;
+
+	// An exception thrown by a worker reaches the caller of ParallelFor once every chunk is finished.
+	std::atomic<size_t> finished{ 0 };
+	bool caught = false;
+	try
+	{
+		ParallelFor(0, 3, [&](size_t _begin, size_t _end) {
+			for (size_t i = _begin; i < _end; i++, finished++)
+				if (i == 2)
+					throw std::runtime_error("chunk failed");
+		});
+	}
+	catch (const std::runtime_error &)
+	{
+		caught = true;
+	}
+	cout << "Worker exception rethrown : " << caught << "  chunks finished : " << finished << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // DeterministicDebug
@@ -0,0 +1,101 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	 Eigenvalue Decomposition Test                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define EVDDebug
+
+#ifdef EVDDebug
+
+// Header files
+#include <iostream>
+#include <cmath>
+#include "..\MathLib\MathLib.h"
+#include "..\Algorithm\MatrixAnalysis\EVD.hpp"
+#include "..\Algorithm\MatrixAnalysis\SVD.hpp"
+#include "..\DataManager\Preprocess\PCA.h"
+#include "..\Util\Timer\Time.hpp"
+
+using namespace std;
+using namespace MathLib;
+using namespace MathLib::MatrixDecomposition;
+
+// Largest absolute element of A * V - V * diag(lambda) and of V^T * V - I.
+void EigenError(const Matrix<double> & _A, const Vector<double> & _values, const Matrix<double> & _vectors, double & _residual, double & _orthogonality)
+{
+	const size_t n = _A.ColumeSize();
+	Matrix<double> AV = MatMul(_A, _vectors);
+	Matrix<double> VtV = MatMul(_vectors, _vectors, Transpose::Trans);
+	_residual = 0;
+	_orthogonality = 0;
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++)
+		{
+			_residual = max(_residual, abs(AV(i, j) - _vectors(i, j) * _values(j)));
+			_orthogonality = max(_orthogonality, abs(VtV(i, j) - (i == j ? 1.0 : 0.0)));
+		}
+}
+
+int main()
+{
+	double residual, orthogonality;
+
+	// Random symmetric matrix.
+	const size_t n = 300;
+	Matrix<double> R(n, n, MatrixType::Random);
+	Matrix<double> A = R + R.Transpostion();
+	Util::Timer timer;
+	timer.Start();
+	pair<Vector<double>, Matrix<double>> eigen = EVD(A);
+	const int elapsed = timer.GetTime();
+	EigenError(A, eigen.first, eigen.second, residual, orthogonality);
+	bool ascending = true;
+	for (size_t i = 1; i < n; i++)
+		ascending = ascending && eigen.first(i - 1) <= eigen.first(i);
+	cout << "EVD " << n << "x" << n << " : " << elapsed << "ms" << endl;
+	cout << "Residual : " << residual << "  Orthogonality : " << orthogonality << "  Ascending : " << ascending << endl;
+
+	// Clustered eigenvalues exercise the deflation.
+	Matrix<double> Q = QRD(Matrix<double>(n, n, MatrixType::Random)).first;
+	Matrix<double> D(n, n);
+	for (size_t i = 0; i < n; i++)
+		D(i, i) = double(i % 4);
+	Matrix<double> C = MatMul(MatMul(Q, D), Q, Transpose::NoTrans, Transpose::Trans);
+	eigen = EVD(C);
+	EigenError(C, eigen.first, eigen.second, residual, orthogonality);
+	cout << "Clustered residual : " << residual << "  Orthogonality : " << orthogonality << endl;
+
+	// Randomized truncated SVD recovers a low rank matrix.
+	const size_t rank = 8;
+	Matrix<double> L = MatMul(Matrix<double>(400, rank, MatrixType::Random), Matrix<double>(rank, 250, MatrixType::Random));
+	tuple<Matrix<double>, Vector<double>, Matrix<double>> svd = RandomizedSVD(L, rank);
+	Matrix<double> US = get<0>(svd);
+	for (size_t i = 0; i < US.ColumeSize(); i++)
+		for (size_t j = 0; j < rank; j++)
+			US(i, j) *= get<1>(svd)(j);
+	Matrix<double> L2 = MatMul(US, get<2>(svd), Transpose::NoTrans, Transpose::Trans);
+	double reconstruction = 0;
+	for (size_t i = 0; i < L.ColumeSize(); i++)
+		for (size_t j = 0; j < L.RowSize(); j++)
+			reconstruction = max(reconstruction, abs(L(i, j) - L2(i, j)));
+	cout << "Randomized SVD reconstruction error : " << reconstruction << endl;
+
+	// PCA by covariance and by randomized SVD agree on the explained variance.
+	Matrix<double> samples = MatMul(Matrix<double>(200, 3, MatrixType::Random), Matrix<double>(3, 20, MatrixType::Random));
+	Data::PCA exact(3, Data::PCAMethod::Covariance);
+	Data::PCA randomized(3, Data::PCAMethod::RandomizedSVD);
+	exact.Fit(samples);
+	randomized.Fit(samples);
+	double varianceError = 0;
+	for (size_t k = 0; k < 3; k++)
+		varianceError = max(varianceError, abs(exact.GetExplainedVariance()(k) - randomized.GetExplainedVariance()(k)));
+	Vector<double> variance = exact.GetExplainedVariance();
+	cout << "PCA variance : " << variance;
+	cout << "PCA method difference : " << varianceError << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // EVDDebug
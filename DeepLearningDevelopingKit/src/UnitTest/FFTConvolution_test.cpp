@@ -0,0 +1,119 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	        FFT Convolution Test                                                     */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define FFTConvolutionDebug
+
+#ifdef FFTConvolutionDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "..\MathLib\FFT.hpp"
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+// Largest error of the FFT against a plain DFT.
+double TransformError(const size_t _n)
+{
+	mt19937 engine(3);
+	uniform_real_distribution<double> distribution(-1, 1);
+	vector<complex<double>> x(_n), X;
+	for (complex<double> & v : x)
+		v = complex<double>(distribution(engine), distribution(engine));
+	X = x;
+	MathLib::FFT<double> plan(_n);
+	plan.Forward(X.data());
+	double error = 0;
+	for (size_t k = 0; k < _n; k++)
+	{
+		complex<double> sum = 0;
+		for (size_t t = 0; t < _n; t++)
+			sum += x[t] * polar(1.0, -2 * 3.14159265358979323846 * double(t * k % _n) / _n);
+		error = max(error, abs(sum - X[k]));
+	}
+	plan.Inverse(X.data());
+	for (size_t t = 0; t < _n; t++)
+		error = max(error, abs(X[t] - x[t]));
+	return error;
+}
+
+Neural::ConvolutionalLayer MakeLayer(const size_t _inputSize, const size_t _kernelSize, const size_t _kernelNum)
+{
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(_inputSize, _inputSize);
+	initor.KernelSize = MathLib::Size(_kernelSize, _kernelSize);
+	initor.Stride = 1;
+	initor.KernelNum = _kernelNum;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	return Neural::ConvolutionalLayer(initor);
+}
+
+double Time(Neural::ConvolutionalLayer & _layer, const size_t _repeat)
+{
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < _repeat; r++)
+		_layer.ForwardPropagation();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / _repeat;
+}
+
+int main()
+{
+	for (size_t n : { 8, 12, 30, 60, 240, 250 })
+		cout << "FFT length " << n << " error : " << TransformError(n) << endl;
+
+	// Agreement with the direct path, also after a weight update.
+	{
+		Neural::ConvolutionalLayer layer = MakeLayer(32, 5, 5);
+		vector<MathLib::Matrix<double>> input{ MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random) };
+		layer.SetInput(input);
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+		layer.ForwardPropagation();
+		vector<Neural::ConvFeature> reference = layer.GetFeatureAll();
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::FFT);
+		layer.ForwardPropagation();
+		cout << "32x32, 5x5 FFT error : " << MaxError(reference, layer.GetFeatureAll());
+
+		for (Neural::ConvNode & node : layer._convNodes)
+			node.kernelDeltaSum = MathLib::Matrix<double>(5, 5, MathLib::MatrixType::Random);
+		layer.Update();
+		layer.ForwardPropagation();
+		vector<Neural::ConvFeature> updated = layer.GetFeatureAll();
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+		layer.ForwardPropagation();
+		cout << "  after Update : " << MaxError(layer.GetFeatureAll(), updated) << endl;
+	}
+
+	// Large feature maps and kernels.
+	for (size_t kernelSize : { 3, 7, 11 })
+	{
+		Neural::ConvolutionalLayer layer = MakeLayer(224, kernelSize, 8);
+		vector<MathLib::Matrix<double>> input{ MathLib::Matrix<double>(224, 224, MathLib::MatrixType::Random) };
+		layer.SetInput(input);
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Im2col);
+		layer.ForwardPropagation();
+		vector<Neural::ConvFeature> reference = layer.GetFeatureAll();
+		const double im2col = Time(layer, 10);
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::FFT);
+		layer.ForwardPropagation();
+		const double error = MaxError(reference, layer.GetFeatureAll());
+		const double fft = Time(layer, 10);
+		cout << "224x224, " << kernelSize << "x" << kernelSize << ", 8 kernels  Im2col : " << im2col << "ms  FFT : " << fft
+			<< "ms  error : " << error << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // FFTConvolutionDebug
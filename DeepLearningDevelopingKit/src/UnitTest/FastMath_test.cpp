@@ -0,0 +1,120 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	             FastMath Test                                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define FastMathDebug
+
+#ifdef FastMathDebug
+
+// Header files
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "..\MathLib\FastMath.hpp"
+
+using namespace std;
+using namespace MathLib;
+
+// Distance in units in the last place between two finite doubles.
+double UlpDistance(const double _a, const double _b)
+{
+	if (_a == _b)
+		return 0;
+	if (isnan(_a) || isnan(_b))
+		return isnan(_a) && isnan(_b) ? 0 : numeric_limits<double>::infinity();
+	int64_t a, b;
+	memcpy(&a, &_a, sizeof(a));
+	memcpy(&b, &_b, sizeof(b));
+	if (a < 0) a = INT64_MIN - a;
+	if (b < 0) b = INT64_MIN - b;
+	return double(a > b ? uint64_t(a) - uint64_t(b) : uint64_t(b) - uint64_t(a));
+}
+
+// Max ulp error of a function against a long double reference over [_lower, _upper].
+template<class Fast, class Reference>
+double MaxUlp(Fast _fast, Reference _reference, const double _lower, const double _upper)
+{
+	mt19937_64 engine(7);
+	uniform_real_distribution<double> distribution(_lower, _upper);
+	double maxUlp = 0;
+	for (size_t i = 0; i < 1000000; i++)
+	{
+		const double x = distribution(engine);
+		maxUlp = max(maxUlp, UlpDistance(_fast(x), double(_reference((long double)x))));
+	}
+	return maxUlp;
+}
+
+int main()
+{
+	cout << "Exp      : " << MaxUlp(FastMath::Exp, [](long double x) { return expl(x); }, -708, 709.7) << " ulp" << endl;
+	cout << "ExpM1    : " << MaxUlp(FastMath::ExpM1, [](long double x) { return expm1l(x); }, -1, 1) << " ulp (|x| < 1)  "
+		<< MaxUlp(FastMath::ExpM1, [](long double x) { return expm1l(x); }, -50, 700) << " ulp" << endl;
+	cout << "Log      : " << MaxUlp(FastMath::Log, [](long double x) { return logl(x); }, 0.5, 2) << " ulp (near 1)  "
+		<< MaxUlp(FastMath::Log, [](long double x) { return logl(x); }, 0, 1e300) << " ulp" << endl;
+	cout << "Log1P    : " << MaxUlp(FastMath::Log1P, [](long double x) { return log1pl(x); }, -0.5, 1) << " ulp" << endl;
+	cout << "Tanh     : " << MaxUlp(FastMath::Tanh, [](long double x) { return tanhl(x); }, -1, 1) << " ulp (|x| < 1)  "
+		<< MaxUlp(FastMath::Tanh, [](long double x) { return tanhl(x); }, -30, 30) << " ulp" << endl;
+	cout << "Sigmoid  : " << MaxUlp(FastMath::Sigmoid, [](long double x) { return 1 / (1 + expl(-x)); }, -700, 40) << " ulp" << endl;
+	cout << "Softplus : " << MaxUlp(FastMath::Softplus, [](long double x) { return x > 0 ? x + log1pl(expl(-x)) : log1pl(expl(x)); }, -700, 700) << " ulp" << endl;
+
+	// Special values.
+	cout << "Exp(-inf) = " << FastMath::Exp(-numeric_limits<double>::infinity()) << "  Exp(inf) = " << FastMath::Exp(numeric_limits<double>::infinity())
+		<< "  Log(0) = " << FastMath::Log(0.0) << "  Log(-1) = " << FastMath::Log(-1.0) << "  Log(denorm_min) = " << FastMath::Log(numeric_limits<double>::denorm_min()) << endl;
+
+	// The array kernels match the scalar functions bit for bit.
+	vector<double> samples(1001);
+	mt19937_64 sampleEngine(3);
+	uniform_real_distribution<double> sampleDistribution(-50, 50);
+	for (double & x : samples)
+		x = sampleDistribution(sampleEngine);
+	bool identical = true;
+	vector<double> kernel = samples;
+	FastMath::ApplyTanh(kernel.data(), kernel.size());
+	for (size_t i = 0; i < samples.size(); i++)
+		identical = identical && kernel[i] == FastMath::Tanh(samples[i]);
+	kernel = samples;
+	FastMath::ApplySoftplus(kernel.data(), kernel.size());
+	for (size_t i = 0; i < samples.size(); i++)
+		identical = identical && kernel[i] == FastMath::Softplus(samples[i]);
+	kernel = samples;
+	FastMath::ApplySigmoid(kernel.data(), kernel.size());
+	for (size_t i = 0; i < samples.size(); i++)
+		identical = identical && kernel[i] == FastMath::Sigmoid(samples[i]);
+	cout << "Array kernels match scalar : " << identical << endl;
+
+	// Throughput of the array kernels against libm, best of ten runs over 1M values.
+	vector<double> data(1 << 20);
+	mt19937_64 engine(1);
+	uniform_real_distribution<double> distribution(-10, 10);
+	for (double & x : data)
+		x = distribution(engine);
+	vector<double> values;
+	auto best = [&](function<void(void)> _run) {
+		double time = INFINITY;
+		for (size_t r = 0; r < 10; r++)
+		{
+			values = data;
+			const auto start = chrono::steady_clock::now();
+			_run();
+			time = min(time, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		}
+		return time;
+	};
+	cout << "ApplySigmoid  : " << best([&] { FastMath::ApplySigmoid(values.data(), values.size()); }) << "ms  libm : "
+		<< best([&] { for (double & x : values) x = 1 / (1 + exp(-x)); }) << "ms" << endl;
+	cout << "ApplyTanh     : " << best([&] { FastMath::ApplyTanh(values.data(), values.size()); }) << "ms  libm : "
+		<< best([&] { for (double & x : values) x = tanh(x); }) << "ms" << endl;
+	cout << "ApplySoftplus : " << best([&] { FastMath::ApplySoftplus(values.data(), values.size()); }) << "ms  libm : "
+		<< best([&] { for (double & x : values) x = x > 0 ? x + log1p(exp(-x)) : log1p(exp(x)); }) << "ms" << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // FastMathDebug
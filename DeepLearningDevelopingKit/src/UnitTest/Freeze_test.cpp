@@ -0,0 +1,138 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	            Freeze Test                                                              */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define FreezeDebug
+
+#ifdef FreezeDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN.h"
+#include "..\Algorithm\NeuralNetwork\BackpropagationNeuralNetwork\BNN_Layer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+int main()
+{
+	Neural::ConvLayerInitor convInitor;
+	convInitor.Stride = 1;
+	convInitor.KernelNum = 8;
+	convInitor.KernelSize = MathLib::Size(3, 3);
+	convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	convInitor.ActivationFunction = ActivationFunction::ReLU;
+	convInitor.Algorithm = Neural::ConvolutionAlgorithm::Auto;
+	Neural::PoolLayerInitor maxInitor;
+	maxInitor.Stride = 2;
+	maxInitor.PoolSize = MathLib::Size(2, 2);
+	maxInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	maxInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	maxInitor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+	Neural::PoolLayerInitor meanInitor = maxInitor;
+	meanInitor.PoolingMethod = Neural::PoolingMethod::MeanPooling;
+	Neural::ProcessLayerInitor reluInitor;
+	reluInitor.ProcessFunction = ReLU;
+	reluInitor.ProcessFunctionDerivative = ReLUDerivative;
+	Neural::ProcessLayerInitor sigmoidInitor;
+	sigmoidInitor.ProcessFunction = Sigmoid;
+	sigmoidInitor.ProcessFunctionDerivative = SigmoidDerivative;
+	Neural::ProcessLayerInitor linearInitor;
+	linearInitor.ProcessFunction = Linear;
+	linearInitor.ProcessFunctionDerivative = LinearDerivative;
+
+	// conv -> relu -> max pool folds into one layer, conv -> linear -> mean pool too (the linear layer is
+	// dropped), the last conv -> sigmoid stays.
+	Neural::SequentialInitor initor;
+	initor.InputChannels = 3;
+	initor.InputSize = MathLib::Size(64, 64);
+	Neural::Sequential model(initor);
+	model.Add(convInitor);
+	model.Add(reluInitor);
+	model.Add(maxInitor);
+	convInitor.KernelNum = 16;
+	convInitor.KernelSize = MathLib::Size(5, 5);
+	model.Add(convInitor);
+	model.Add(linearInitor);
+	model.Add(meanInitor);
+	convInitor.KernelNum = 4;
+	convInitor.KernelSize = MathLib::Size(3, 3);
+	model.Add(convInitor);
+	model.Add(sigmoidInitor);
+	model.SetLearnRate(0.1);
+
+	// One training step, so that gradients, deltas and saved state exist.
+	vector<MathLib::Matrix<double>> input, delta;
+	for (size_t c = 0; c < 3; c++)
+		input.push_back(MathLib::Matrix<double>(64, 64, MathLib::MatrixType::Random));
+	for (size_t c = 0; c < 4; c++)
+		delta.push_back(MathLib::Matrix<double>(16, 16, MathLib::MatrixType::Random));
+	model.SetInput(input);
+	model.ForwardPropagation();
+	model.SetDelta(delta);
+	model.BackwardPropagation();
+	model.BatchDeltaSumUpdate(1);
+	model.Update();
+	model.BatchDeltaSumClear();
+	model.ForwardPropagation();
+	// The output is an alias of an arena, keep a copy of its elements.
+	vector<MathLib::Matrix<double>> expected;
+	for (const MathLib::Matrix<double> & map : model.GetOutput())
+		expected.push_back(map * 1.0);
+	model.PrintSummary();
+
+	model.Freeze(&cout);
+	model.PrintSummary();
+	model.SetInput(input);
+	model.ForwardPropagation();
+	cout << "Frozen output error : " << MaxError(model.GetOutput(), expected) << endl;
+	model.ForwardPropagation();
+	cout << "Frozen output error, second pass : " << MaxError(model.GetOutput(), expected) << endl;
+	cout << "Refused (three errors expected) :" << endl;
+	model.SetTraining(true);
+	model.SetDelta(delta);
+	model.BackwardPropagation();
+	model.Update();
+
+	// Fully connected layers pack their weights into one matrix and drop the per node copies.
+	const size_t inputNum = 256, hiddenNum = 128, outputNum = 10;
+	Neural::HiddenLayer hidden(inputNum, hiddenNum);
+	hidden.SetActivationFunction(ActivationFunction::ReLU);
+	hidden.SetLossFunction(LossFunction::MES);
+	Neural::OutputLayer output(hiddenNum, outputNum);
+	output.SetActivationFunction(ActivationFunction::Sigmoid);
+	output.SetLossFunction(LossFunction::MES);
+	Vector<double> sample(inputNum);
+	for (size_t i = 0; i < inputNum; i++)
+		sample(i) = MathLib::Random();
+	hidden.SetInput(sample);
+	hidden.ForwardPropagation();
+	output.SetInput(hidden.GetOutput());
+	output.ForwardPropagation();
+	const Vector<double> bnnExpected = output.GetOutput();
+	const size_t bnnBefore = hidden.GetMemoryBytes() + output.GetMemoryBytes();
+	hidden.Freeze();
+	output.Freeze();
+	hidden.SetInput(sample);
+	hidden.ForwardPropagation();
+	output.SetInput(hidden.GetOutput());
+	output.ForwardPropagation();
+	double bnnError = 0;
+	for (size_t i = 0; i < outputNum; i++)
+		bnnError = max(bnnError, abs(output.GetOutput()(i) - bnnExpected(i)));
+	cout << "BNN frozen : " << bnnBefore << " bytes -> " << hidden.GetMemoryBytes() + output.GetMemoryBytes() << " bytes  output error : " << bnnError << endl;
+	cout << "Refused (one error expected) :" << endl;
+	output.Update();
+
+	system("pause");
+	return 0;
+}
+
+#endif // FreezeDebug
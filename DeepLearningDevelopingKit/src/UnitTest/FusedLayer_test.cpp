@@ -0,0 +1,155 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	         Fused Layer Test                                                         */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define FusedLayerDebug
+
+#ifdef FusedLayerDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_FusedLayer.h"
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ProcessLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+Neural::FusedLayerInitor Initor(const size_t _size, const size_t _kernelSize, const size_t _kernelNum, const ActivationFunction _activation,
+	const size_t _poolSize, const size_t _poolStride, const Neural::PoolingMethod _method)
+{
+	Neural::FusedLayerInitor initor;
+	initor.Conv.InputSize = MathLib::Size(_size, _size);
+	initor.Conv.KernelSize = MathLib::Size(_kernelSize, _kernelSize);
+	initor.Conv.Stride = 1;
+	initor.Conv.KernelNum = _kernelNum;
+	initor.Conv.ActivationFunction = _activation;
+	initor.Conv.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.Conv.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	initor.Pool.Stride = _poolStride;
+	initor.Pool.PoolSize = MathLib::Size(_poolSize, _poolSize);
+	initor.Pool.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.Pool.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	initor.Pool.PoolingMethod = _method;
+	initor.Training = true;
+	return initor;
+}
+
+int main()
+{
+	struct Config { size_t size, kernelSize, kernelNum, channelNum, poolSize, poolStride; ActivationFunction activation; Neural::PoolingMethod method; const char * name; };
+	const Config configs[] = {
+		{ 16, 3, 4, 2, 2, 2, ActivationFunction::ReLU, Neural::PoolingMethod::MaxPooling, "ReLU max 2/2" },
+		{ 15, 5, 3, 3, 3, 2, ActivationFunction::Sigmoid, Neural::PoolingMethod::MaxPooling, "Sigmoid max 3/2" },
+		{ 13, 3, 2, 1, 3, 3, ActivationFunction::ReLU, Neural::PoolingMethod::MinPooling, "ReLU min 3/3" },
+		{ 14, 3, 3, 2, 2, 2, ActivationFunction::Sigmoid, Neural::PoolingMethod::MeanPooling, "Sigmoid mean 2/2" },
+		{ 17, 5, 2, 2, 4, 3, ActivationFunction::Linear, Neural::PoolingMethod::MeanPooling, "Linear mean 4/3" },
+		{ 70, 3, 2, 1, 2, 2, ActivationFunction::ReLU, Neural::PoolingMethod::MaxPooling, "ReLU max 2/2 several bands" }
+	};
+
+	// Fused forward and backward against ConvolutionalLayer -> activation -> PoolingLayer.
+	for (const Config & config : configs)
+	{
+		const Neural::FusedLayerInitor initor = Initor(config.size, config.kernelSize, config.kernelNum, config.activation, config.poolSize, config.poolStride, config.method);
+		Neural::FusedConvPoolLayer fused(initor);
+		Neural::ConvolutionalLayer conv(initor.Conv);
+		conv._convNodes = fused.GetConvLayer()._convNodes;
+		conv.InvalidateKernelCache();
+		Neural::PoolLayerInitor poolInitor = initor.Pool;
+		poolInitor.InputSize = conv.GetOutputSize();
+		Neural::PoolingLayer pool(poolInitor);
+
+		vector<MathLib::Matrix<double>> input;
+		for (size_t c = 0; c < config.channelNum; c++)
+			input.push_back(MathLib::Matrix<double>(config.size, config.size, MathLib::MatrixType::Random));
+		fused.SetInput(input);
+		fused.ForwardPropagation();
+		conv.SetInput(input);
+		conv.ForwardPropagation();
+		vector<MathLib::Matrix<double>> activated = conv.GetFeatureAll();
+		for (MathLib::Matrix<double> & feature : activated)
+			for (size_t e = 0; e < feature.ColumeSize() * feature.RowSize(); e++)
+				feature.Data()[e] = conv.activationFunction(feature.Data()[e]);
+		pool.SetInput(activated);
+		pool.ForwardPropagation();
+
+		vector<MathLib::Matrix<double>> delta;
+		for (size_t k = 0; k < config.kernelNum; k++)
+			delta.push_back(MathLib::Matrix<double>(fused.GetOutputSize().m, fused.GetOutputSize().n, MathLib::MatrixType::Random));
+		fused.SetDelta(delta);
+		fused.BackwardPropagation();
+		pool.SetDelta(delta);
+		pool.BackwardPropagation();
+		vector<MathLib::Matrix<double>> convDelta = pool.GetDelta();
+		for (size_t k = 0; k < config.kernelNum; k++)
+			for (size_t e = 0; e < convDelta[k].ColumeSize() * convDelta[k].RowSize(); e++)
+				convDelta[k].Data()[e] *= conv.activationFunctionDerivative(activated[k].Data()[e]);
+		conv.SetDelta(convDelta);
+		conv.BackwardPropagation();
+
+		vector<MathLib::Matrix<double>> fusedKernelDelta, kernelDelta;
+		for (size_t k = 0; k < config.kernelNum; k++)
+		{
+			fusedKernelDelta.push_back(fused.GetConvLayer()._convNodes[k].kernelDelta);
+			kernelDelta.push_back(conv._convNodes[k].kernelDelta);
+		}
+		cout << config.name << " forward error : " << MaxError(fused.GetFeatureAll(), pool.GetFeatureAll())
+			<< "  kernel delta error : " << MaxError(fusedKernelDelta, kernelDelta)
+			<< "  input delta error : " << MaxError(fused.GetDelta(), conv.GetDelta()) << endl;
+	}
+
+	// Throughput of the fused layer against the separate layers, 4 x 64x64 inputs, 16 3x3 kernels, ReLU, 2x2 max pooling.
+	{
+		const size_t size = 64, kernelNum = 16, channelNum = 4, repeat = 20;
+		const Neural::FusedLayerInitor initor = Initor(size, 3, kernelNum, ActivationFunction::ReLU, 2, 2, Neural::PoolingMethod::MaxPooling);
+		Neural::FusedConvPoolLayer fused(initor);
+		Neural::ConvolutionalLayer conv(initor.Conv);
+		conv._convNodes = fused.GetConvLayer()._convNodes;
+		conv.InvalidateKernelCache();
+		Neural::PoolLayerInitor poolInitor = initor.Pool;
+		poolInitor.InputSize = conv.GetOutputSize();
+		Neural::PoolingLayer pool(poolInitor);
+		Neural::ProcessLayerInitor processInitor;
+		processInitor.InputSize = MathLib::Size(size / 2, size / 2);
+		processInitor.ProcessFunction = ReLU;
+		processInitor.ProcessFunctionDerivative = ReLUDerivative;
+		Neural::ProcessLayer process(processInitor);
+		const vector<MathLib::Matrix<double>> input(channelNum, MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+		fused.SetInput(input);
+		conv.SetInput(input);
+
+		auto start = chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; r++)
+		{
+			conv.ForwardPropagation();
+			pool.SetInput(conv.GetFeatureAll());
+			pool.ForwardPropagation();
+			process.SetInput(pool.GetFeatureAll());
+			process.Process();
+		}
+		auto separate = chrono::steady_clock::now();
+		fused.SetTraining(false);
+		for (size_t r = 0; r < repeat; r++)
+			fused.ForwardPropagation();
+		auto inference = chrono::steady_clock::now();
+		fused.SetTraining(true);
+		for (size_t r = 0; r < repeat; r++)
+			fused.ForwardPropagation();
+		auto training = chrono::steady_clock::now();
+		cout << "Separate layers : " << chrono::duration<double, milli>(separate - start).count() / repeat << "ms  Fused inference : "
+			<< chrono::duration<double, milli>(inference - separate).count() / repeat << "ms  Fused training : "
+			<< chrono::duration<double, milli>(training - inference).count() / repeat << "ms" << endl;
+		cout << "Fused error : " << MaxError(fused.GetFeatureAll(), process.GetOutputAll()) << endl;
+		cout << "Feature maps of the separate layers : " << kernelNum * size * size * sizeof(double) << " bytes  Saved by the fused layer : "
+			<< fused.GetSavedBytes() << " bytes" << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // FusedLayerDebug
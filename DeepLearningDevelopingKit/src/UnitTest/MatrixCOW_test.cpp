@@ -0,0 +1,70 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	     Matrix Copy-On-Write Test                                                 */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define MatrixCOWDebug
+
+#ifdef MatrixCOWDebug
+
+// Header files
+#include <iostream>
+#include "..\MathLib\MathLib.h"
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+
+using namespace std;
+using namespace MathLib;
+
+int main()
+{
+	Matrix<double> A(3, 3, MatrixType::Random);
+
+	// Copying only shares the buffer.
+	Matrix<double> B = A;
+	cout << "Shared after copy : " << (A.IsShared() && B.IsShared()) << endl;
+	const Matrix<double> & constA = A;
+	const Matrix<double> & constB = B;
+	cout << "Same buffer : " << (constA.Data() == constB.Data()) << endl;
+
+	// Writing to one of them detaches it, the other one keeps the old value.
+	double old = constA(1, 1);
+	B(1, 1) = old + 1;
+	cout << "Detached after write : " << (!A.IsShared() && !B.IsShared()) << endl;
+	cout << "Original untouched : " << (constA(1, 1) == old) << "  Copy modified : " << (constB(1, 1) == old + 1) << endl;
+
+	// Getters of the layers hand out snapshots in O(1).
+	Neural::ConvLayerInitor convInitor;
+	convInitor.InputSize = MathLib::Size(5, 5);
+	convInitor.KernelSize = MathLib::Size(3, 3);
+	convInitor.Stride = 1;
+	convInitor.KernelNum = 2;
+	convInitor.ActivationFunction = ActivationFunction::Linear;
+	convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	Neural::ConvolutionalLayer convLayer(convInitor);
+
+	std::vector<Neural::ConvKernel> kernels = convLayer.GetKernelAll();
+	const std::vector<Neural::ConvKernel> & constKernels = kernels;
+	// Read through the const reference, a non-const read would detach the snapshot before the layer writes.
+	double kernelOld = constKernels.at(0)(0, 0);
+	cout << "Kernel snapshot shared before layer update : " << constKernels.at(0).IsShared() << endl;
+	convLayer._convNodes.at(0).kernel(0, 0) = kernelOld + 1;
+	cout << "Snapshot unchanged after layer update : " << (constKernels.at(0)(0, 0) == kernelOld)
+		<< "  Layer modified : " << (convLayer._convNodes.at(0).kernel(0, 0) == kernelOld + 1) << endl;
+
+	// Aliases write through to their arena, a copy of an alias is a snapshot and only a handle stays an alias.
+	Matrix<double> arena(4, 4, MatrixType::Zero);
+	Matrix<double> view = arena.Alias(4, 2, 2);
+	const Matrix<double> snapshot = view;
+	const Matrix<double> handle = view.Handle();
+	view(0, 0) = 1;
+	const Matrix<double> & constArena = arena;
+	cout << "Arena written through alias : " << (constArena(1, 0) == 1) << "  Handle is alias : " << (handle.IsAlias() && handle(0, 0) == 1) << endl;
+	cout << "Copy of alias is snapshot : " << (!snapshot.IsAlias() && snapshot(0, 0) == 0) << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // MatrixCOWDebug
@@ -0,0 +1,118 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	          Max Pooling Test                                                         */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define MaxPoolingDebug
+
+#ifdef MaxPoolingDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_PoolingLayer.h"
+
+using namespace std;
+
+Neural::PoolLayerInitor Initor(const size_t _size, const size_t _pool, const size_t _stride)
+{
+	Neural::PoolLayerInitor initor;
+	initor.Stride = _stride;
+	initor.InputSize = MathLib::Size(_size, _size);
+	initor.PoolSize = MathLib::Size(_pool, _pool);
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	initor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+	return initor;
+}
+
+int main()
+{
+	// Forward and backward against an element by element reference, on inputs below zero as well.
+	const size_t cases[][3] = { { 8, 2, 2 }, { 9, 3, 3 }, { 16, 4, 4 }, { 11, 3, 2 }, { 10, 5, 5 } };
+	for (const auto & c : cases)
+	{
+		const size_t size = c[0], poolSize = c[1], stride = c[2];
+		Neural::PoolingLayer pool(Initor(size, poolSize, stride));
+		MathLib::Matrix<double> input(size, size, MathLib::MatrixType::Random);
+		input(0, 0) = -5;
+		pool.SetInput({ input, input * -1.0 });
+		pool.ForwardPropagation();
+
+		const size_t outputM = pool._outputSize.m, outputN = pool._outputSize.n;
+		const MathLib::Size offset = Neural::Pad::Offset(Neural::PaddingMethod::Surround, pool._paddingM, pool._paddingN);
+		double forwardError = 0;
+		size_t argmaxMismatch = 0;
+		for (size_t k = 0; k < 2; k++)
+		{
+			const MathLib::Matrix<double> & channel = pool._input.at(k);
+			for (size_t a = 0; a < outputM; a++)
+				for (size_t b = 0; b < outputN; b++)
+				{
+					double max = -INFINITY;
+					int argmax = -1;
+					for (long long i = (long long)(a * stride) - (long long)offset.m; i < (long long)(a * stride + poolSize) - (long long)offset.m; i++)
+						for (long long j = (long long)(b * stride) - (long long)offset.n; j < (long long)(b * stride + poolSize) - (long long)offset.n; j++)
+						{
+							const bool inside = i >= 0 && i < (long long)size && j >= 0 && j < (long long)size;
+							const double value = inside ? channel(i, j) : 0;
+							if (max < value)
+							{
+								max = value;
+								argmax = inside ? int(i * size + j) : -1;
+							}
+						}
+					forwardError = std::max(forwardError, abs(pool.GetFeature(k)(a, b) - max));
+					if (pool.GetArgmax()[k * outputM * outputN + a * outputN + b] != argmax)
+						argmaxMismatch++;
+				}
+		}
+
+		// Every delta lands on the maximum of its window and nowhere else.
+		MathLib::Matrix<double> delta(outputM, outputN, MathLib::MatrixType::Random);
+		pool.SetDelta({ delta, delta });
+		pool.BackwardPropagation();
+		double backwardError = 0;
+		for (size_t k = 0; k < 2; k++)
+		{
+			MathLib::Matrix<double> reference(size, size);
+			for (size_t p = 0; p < outputM * outputN; p++)
+			{
+				const int argmax = pool.GetArgmax()[k * outputM * outputN + p];
+				if (argmax >= 0)
+					reference(argmax / size, argmax % size) += delta(p / outputN, p % outputN);
+			}
+			for (size_t i = 0; i < size; i++)
+				for (size_t j = 0; j < size; j++)
+					backwardError = std::max(backwardError, abs(pool.GetDelta().at(k)(i, j) - reference(i, j)));
+		}
+		cout << size << "x" << size << " pool " << poolSize << " stride " << stride << " forward error : " << forwardError
+			<< "  argmax mismatch : " << argmaxMismatch << "  backward error : " << backwardError << endl;
+	}
+
+	// Timing of the 2x2 / 3x3 / 4x4 windows against a 5x5 window of the generic path, per input element.
+	for (size_t poolSize = 2; poolSize <= 5; poolSize++)
+	{
+		const size_t size = 240, channelNum = 8, repeat = 20;
+		Neural::PoolingLayer pool(Initor(size, poolSize, poolSize));
+		pool.SetInput(vector<MathLib::Matrix<double>>(channelNum, MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random)));
+		pool.SetDelta(vector<MathLib::Matrix<double>>(channelNum, MathLib::Matrix<double>(pool._outputSize.m, pool._outputSize.n, MathLib::MatrixType::Random)));
+		auto start = chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; r++)
+			pool.ForwardPropagation();
+		auto middle = chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; r++)
+			pool.BackwardPropagation();
+		auto end = chrono::steady_clock::now();
+		cout << poolSize << "x" << poolSize << " forward : " << chrono::duration<double, milli>(middle - start).count() / repeat
+			<< "ms  backward : " << chrono::duration<double, milli>(end - middle).count() / repeat << "ms" << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // MaxPoolingDebug
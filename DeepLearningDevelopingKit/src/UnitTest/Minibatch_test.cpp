@@ -0,0 +1,249 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Minibatch Test                                                            */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define MinibatchDebug
+
+#ifdef MinibatchDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+int main()
+{
+	const size_t batchSize = 8;
+	Neural::ConvLayerInitor convInitor;
+	convInitor.Stride = 1;
+	convInitor.KernelNum = 6;
+	convInitor.KernelSize = MathLib::Size(5, 5);
+	convInitor.InputSize = MathLib::Size(32, 32);
+	convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	convInitor.ActivationFunction = ActivationFunction::ReLU;
+	convInitor.Algorithm = Neural::ConvolutionAlgorithm::Im2col;
+	Neural::PoolLayerInitor poolInitor;
+	poolInitor.Stride = 2;
+	poolInitor.PoolSize = MathLib::Size(2, 2);
+	poolInitor.InputSize = MathLib::Size(32, 32);
+	poolInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	poolInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	poolInitor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+	Neural::ProcessLayerInitor reluInitor;
+	reluInitor.InputSize = MathLib::Size(32, 32);
+	reluInitor.ProcessFunction = ReLU;
+	reluInitor.ProcessFunctionDerivative = ReLUDerivative;
+	Neural::FusedLayerInitor fusedInitor;
+	fusedInitor.Conv = convInitor;
+	fusedInitor.Pool = poolInitor;
+	fusedInitor.Training = true;
+
+	// Every layer on a batch against the same layer called sample by sample.
+	{
+		Neural::ConvolutionalLayer conv(convInitor);
+		Neural::PoolingLayer pool(poolInitor);
+		Neural::ProcessLayer relu(reluInitor);
+		Neural::FusedConvPoolLayer fused(fusedInitor);
+		fused._conv._convNodes = conv._convNodes;
+		const Neural::FeatureBatch input = RandomBatch(batchSize, 3, MathLib::Size(32, 32));
+		const Neural::FeatureBatch convDelta = RandomBatch(batchSize, 6, MathLib::Size(32, 32));
+		const Neural::FeatureBatch poolDelta = RandomBatch(batchSize, 6, MathLib::Size(16, 16));
+
+		conv.SetInputBatch(input);
+		conv.ForwardPropagationBatch();
+		conv.SetDeltaBatch(convDelta);
+		conv.BackwardPropagationBatch();
+		const Neural::FeatureBatch convFeatures = conv.GetFeatureBatch();
+		const Neural::FeatureBatch convDeltas = conv.GetDeltaBatch();
+		vector<MathLib::Matrix<double>> kernelDeltas, kernelDeltaSums;
+		for (size_t k = 0; k < conv._convNodes.size(); k++)
+		{
+			kernelDeltas.push_back(conv._convNodes[k].kernelDelta * 1.0);
+			kernelDeltaSums.push_back(MathLib::Matrix<double>(5, 5, MathLib::MatrixType::Zero));
+		}
+		double featureError = 0, deltaError = 0, kernelError = 0;
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			conv.SetInput(input[n]);
+			conv.ForwardPropagation();
+			featureError = max(featureError, MaxError(conv.GetFeatureAll(), convFeatures[n]));
+			conv.SetDelta(convDelta[n]);
+			conv.BackwardPropagation();
+			deltaError = max(deltaError, MaxError(conv.GetDelta(), convDeltas[n]));
+			for (size_t k = 0; k < conv._convNodes.size(); k++)
+				kernelDeltaSums[k] += conv._convNodes[k].kernelDelta;
+		}
+		kernelError = MaxError(kernelDeltas, kernelDeltaSums);
+		cout << "Conv batch of " << batchSize << " feature error : " << featureError << "  input delta error : " << deltaError
+			<< "  kernel delta error : " << kernelError << endl;
+
+		pool.SetInputBatch(convFeatures);
+		pool.ForwardPropagationBatch();
+		pool.SetDeltaBatch(poolDelta);
+		pool.BackwardPropagationBatch();
+		featureError = deltaError = 0;
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			pool.SetInput(convFeatures[n]);
+			pool.ForwardPropagation();
+			featureError = max(featureError, MaxError(pool.GetFeatureAll(), pool.GetFeatureBatch()[n]));
+			pool.SetDelta(poolDelta[n]);
+			pool.BackwardPropagation();
+			deltaError = max(deltaError, MaxError(pool.GetDelta(), pool.GetDeltaBatch()[n]));
+		}
+		cout << "Pool batch feature error : " << featureError << "  delta error : " << deltaError << endl;
+
+		Neural::FeatureBatch processed = RandomBatch(batchSize, 6, MathLib::Size(32, 32));
+		const Neural::FeatureBatch original = processed;
+		Neural::FeatureBatch deprocessed = convDelta;
+		for (Neural::FeatureBatch * batch : { &processed, &deprocessed })
+			for (vector<MathLib::Matrix<double>> & sample : *batch)
+				for (MathLib::Matrix<double> & map : sample)
+					map = map * 1.0;
+		relu.Process(processed);
+		relu.Deprocess(deprocessed);
+		featureError = deltaError = 0;
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			relu.SetInput(original[n]);
+			relu.Process();
+			featureError = max(featureError, MaxError(relu.GetOutputAll(), processed[n]));
+			relu.SetInput(convDelta[n]);
+			relu.Deprocess();
+			deltaError = max(deltaError, MaxError(relu.GetOutputAll(), deprocessed[n]));
+		}
+		cout << "Process batch output error : " << featureError << "  delta error : " << deltaError << endl;
+
+		fused.SetInputBatch(input);
+		fused.ForwardPropagationBatch();
+		fused.SetDeltaBatch(poolDelta);
+		fused.BackwardPropagationBatch();
+		const Neural::FeatureBatch fusedFeatures = fused.GetFeatureBatch();
+		const Neural::FeatureBatch fusedDeltas = fused.GetDeltaBatch();
+		featureError = deltaError = 0;
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			fused.SetInput(input[n]);
+			fused.ForwardPropagation();
+			featureError = max(featureError, MaxError(fused.GetFeatureAll(), fusedFeatures[n]));
+			fused.SetDelta(poolDelta[n]);
+			fused.BackwardPropagation();
+			deltaError = max(deltaError, MaxError(fused.GetDelta(), fusedDeltas[n]));
+		}
+		cout << "Fused batch feature error : " << featureError << "  input delta error : " << deltaError << endl;
+		// The DirectTiled batch path against the same layer sample by sample.
+		convInitor.Algorithm = Neural::ConvolutionAlgorithm::DirectTiled;
+		Neural::ConvolutionalLayer tiled(convInitor);
+		convInitor.Algorithm = Neural::ConvolutionAlgorithm::Im2col;
+		tiled.SetInputBatch(input);
+		tiled.ForwardPropagationBatch();
+		featureError = 0;
+		for (size_t n = 0; n < batchSize; n++)
+		{
+			tiled.SetInput(input[n]);
+			tiled.ForwardPropagation();
+			featureError = max(featureError, MaxError(tiled.GetFeatureAll(), tiled.GetFeatureBatch()[n]));
+		}
+		cout << "DirectTiled batch feature error : " << featureError << endl;
+	}
+
+	// Throughput of the layer of ImageRecognization_Example, 32x32 input and 5x5 kernels, and of a whole model.
+	/// Every time is the best of three rounds, other jobs on the machine only ever add to it.
+	const size_t samples = 1024, rounds = 3;
+	auto best = [&](const function<void(void)> & _run) {
+		double seconds = INFINITY;
+		for (size_t round = 0; round < rounds; round++)
+		{
+			auto start = chrono::steady_clock::now();
+			_run();
+			seconds = min(seconds, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+		return samples / seconds;
+	};
+	convInitor.KernelNum = 16;
+	for (Neural::ConvolutionAlgorithm algorithm : { Neural::ConvolutionAlgorithm::Im2col, Neural::ConvolutionAlgorithm::Auto })
+		for (size_t n : { 1, 8, 32, 128 })
+		{
+			convInitor.Algorithm = algorithm;
+			Neural::ConvolutionalLayer conv(convInitor);
+			const Neural::FeatureBatch input = RandomBatch(n, 1, MathLib::Size(32, 32));
+			const Neural::FeatureBatch delta = RandomBatch(n, 16, conv.GetOutputSize());
+			const size_t repeat = samples / n;
+			const double single = best([&] {
+				for (size_t r = 0; r < repeat; r++)
+					for (size_t s = 0; s < n; s++)
+					{
+						conv.SetInput(input[s]);
+						conv.ForwardPropagation();
+					}
+			});
+			const double forward = best([&] {
+				for (size_t r = 0; r < repeat; r++)
+				{
+					conv.SetInputBatch(input);
+					conv.ForwardPropagationBatch();
+				}
+			});
+			const double training = best([&] {
+				for (size_t r = 0; r < repeat; r++)
+				{
+					conv.SetInputBatch(input);
+					conv.ForwardPropagationBatch();
+					conv.SetDeltaBatch(delta);
+					conv.BackwardPropagationBatch();
+				}
+			});
+			cout << (algorithm == Neural::ConvolutionAlgorithm::Im2col ? "Im2col" : "Auto") << " conv N = " << n
+				<< "  one by one : " << single << " samples/s  batch forward : " << forward
+				<< " samples/s  batch forward + backward : " << training << " samples/s" << endl;
+		}
+
+	convInitor.Algorithm = Neural::ConvolutionAlgorithm::Auto;
+	convInitor.KernelNum = 8;
+	for (size_t n : { 1, 8, 32, 128 })
+	{
+		Neural::SequentialInitor initor;
+		initor.InputChannels = 1;
+		initor.InputSize = MathLib::Size(32, 32);
+		initor.BatchSize = n;
+		Neural::Sequential model(initor);
+		model.Add(convInitor);
+		model.Add(reluInitor);
+		model.Add(poolInitor);
+		convInitor.KernelNum = 16;
+		model.Add(convInitor);
+		convInitor.KernelNum = 8;
+		model.Add(reluInitor);
+		model.Add(poolInitor);
+		const Neural::FeatureBatch input = RandomBatch(n, 1, MathLib::Size(32, 32));
+		const Neural::FeatureBatch delta = RandomBatch(n, model.GetOutputShape().Channels, model.GetOutputShape().Size);
+		const size_t repeat = samples / n;
+		const double training = best([&] {
+			for (size_t r = 0; r < repeat; r++)
+			{
+				model.SetInputBatch(input);
+				model.ForwardPropagation();
+				model.SetDeltaBatch(delta);
+				model.BackwardPropagation();
+			}
+		});
+		cout << "Sequential N = " << n << "  forward + backward : " << training
+			<< " samples/s  arenas : " << model.GetArenaBytes() << " bytes" << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+
+#endif // MinibatchDebug
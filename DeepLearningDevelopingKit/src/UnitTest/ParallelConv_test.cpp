@@ -0,0 +1,113 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	     Parallel Convolution Test                                                 */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define ParallelConvDebug
+
+#ifdef ParallelConvDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+// Forward and backward propagation of every algorithm for every thread number.
+void Run(const size_t size, const size_t kernelSize, const size_t kernelNum, const size_t channelNum)
+{
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(size, size);
+	initor.KernelSize = MathLib::Size(kernelSize, kernelSize);
+	initor.Stride = 1;
+	initor.KernelNum = kernelNum;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	Neural::ConvolutionalLayer layer(initor);
+
+	vector<MathLib::Matrix<double>> input, delta;
+	for (size_t c = 0; c < channelNum; c++)
+		input.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	for (size_t k = 0; k < kernelNum; k++)
+		delta.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	layer.SetInput(input);
+	layer.SetDelta(delta);
+
+	const pair<Neural::ConvolutionAlgorithm, const char *> algorithms[] = {
+		{ Neural::ConvolutionAlgorithm::Direct, "Direct" },
+		{ Neural::ConvolutionAlgorithm::Im2col, "Im2col" },
+		{ Neural::ConvolutionAlgorithm::DirectTiled, "DirectTiled" },
+		{ Neural::ConvolutionAlgorithm::FFT, "FFT" }
+	};
+	const size_t threadNums[] = { 1, 2, 4, 8, 16, 32 };
+	const size_t hardwareThreads = max<size_t>(1, thread::hardware_concurrency());
+	cout << size << "x" << size << ", " << kernelSize << "x" << kernelSize << ", " << kernelNum << " kernels, " << channelNum << " channels" << endl;
+
+	for (const auto & algorithm : algorithms)
+	{
+		layer.SetAlgorithm(algorithm.first);
+		vector<MathLib::Matrix<double>> referenceFeature, referenceDelta, referenceKernelDelta;
+		double serial = 0;
+		cout << " " << algorithm.second << endl;
+		for (const size_t threadNum : threadNums)
+		{
+			MathLib::ThreadPool::Global().SetThreadNum(threadNum);
+			const size_t repeat = max<size_t>(1, (algorithm.first == Neural::ConvolutionAlgorithm::Direct ? 2 : 10) * 64 * 64 / (size * size));
+			auto start = chrono::steady_clock::now();
+			for (size_t r = 0; r < repeat; r++)
+			{
+				layer.ForwardPropagation();
+				layer.BackwardPropagation();
+			}
+			const double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeat;
+
+			vector<MathLib::Matrix<double>> kernelDelta;
+			for (const Neural::ConvNode & node : layer._convNodes)
+				kernelDelta.push_back(node.kernelDelta);
+			if (threadNum == 1)
+			{
+				referenceFeature = layer.GetFeatureAll();
+				referenceDelta = layer.GetDelta();
+				referenceKernelDelta = kernelDelta;
+				serial = elapsed;
+			}
+			cout << "  " << threadNum << " threads : " << elapsed << "ms  Speedup : " << serial / elapsed
+				<< "  Max difference : " << max(MaxError(referenceFeature, layer.GetFeatureAll()),
+					max(MaxError(referenceDelta, layer.GetDelta()), MaxError(referenceKernelDelta, kernelDelta)))
+				<< (threadNum > hardwareThreads ? "  (more threads than cores)" : "") << endl;
+		}
+	}
+}
+
+int main()
+{
+	// Speedups only mean something up to the number of cores, run it on a multi-core machine.
+	cout << "Hardware threads : " << thread::hardware_concurrency() << endl;
+
+	// What a chunk handed to a worker costs, ThreadPool::MinChunkWork must stay well above it.
+	for (const size_t threadNum : { 2, 4 })
+	{
+		MathLib::ThreadPool::Global().SetThreadNum(threadNum);
+		const size_t repeat = 10000;
+		auto start = chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; r++)
+			MathLib::ParallelFor(0, threadNum, [](size_t, size_t) {});
+		cout << "Empty ParallelFor, " << threadNum << " threads : " << chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repeat << "us" << endl;
+	}
+
+	// The grain keeps the small layer on the calling thread, the large one spreads over the pool.
+	Run(64, 5, 16, 4);
+	Run(8, 3, 4, 1);
+
+	system("pause");
+	return 0;
+}
+#endif // ParallelConvDebug
@@ -0,0 +1,167 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	  Pointwise Convolution Test                                                  */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define PointwiseConvDebug
+
+#ifdef PointwiseConvDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+Neural::ConvLayerInitor Initor(const size_t _m, const size_t _n, const size_t _kernelNum, const Neural::ConvolutionAlgorithm _algorithm)
+{
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(_m, _n);
+	initor.KernelSize = MathLib::Size(1, 1);
+	initor.Stride = 1;
+	initor.KernelNum = _kernelNum;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	initor.Algorithm = _algorithm;
+	return initor;
+}
+
+int main()
+{
+	const size_t m = 12, n = 10, channelNum = 3, kernelNum = 4;
+	vector<MathLib::Matrix<double>> input, weights;
+	for (size_t c = 0; c < channelNum; c++)
+		input.push_back(MathLib::Matrix<double>(m, n, MathLib::MatrixType::Random));
+	for (size_t k = 0; k < kernelNum; k++)
+		weights.push_back(MathLib::Matrix<double>(m, n, MathLib::MatrixType::Random));
+
+	// Every algorithm against the padded sliding window of Direct.
+	Neural::ConvolutionalLayer direct(Initor(m, n, kernelNum, Neural::ConvolutionAlgorithm::Direct));
+	direct.SetInput(input);
+	direct.ForwardPropagation();
+	const pair<Neural::ConvolutionAlgorithm, const char *> algorithms[] = {
+		{ Neural::ConvolutionAlgorithm::Im2col, "Im2col" },
+		{ Neural::ConvolutionAlgorithm::Winograd4x4, "Winograd4x4" },
+		{ Neural::ConvolutionAlgorithm::FFT, "FFT" },
+		{ Neural::ConvolutionAlgorithm::DirectTiled, "DirectTiled" },
+		{ Neural::ConvolutionAlgorithm::Auto, "Auto" }
+	};
+	for (const auto & algorithm : algorithms)
+	{
+		Neural::ConvolutionalLayer layer(Initor(m, n, kernelNum, algorithm.first));
+		layer._convNodes = direct._convNodes;
+		layer.SetInput(input);
+		layer.ForwardPropagation();
+		cout << algorithm.second << " forward : " << MaxError(layer.GetFeatureAll(), direct.GetFeatureAll()) << endl;
+	}
+
+	// Gradients against central differences.
+	Neural::ConvolutionalLayer layer(Initor(m, n, kernelNum, Neural::ConvolutionAlgorithm::Auto));
+	layer.SetInput(input);
+	layer.ForwardPropagation();
+	layer.SetDelta(weights);
+	layer.BackwardPropagation();
+	const vector<MathLib::Matrix<double>> delta = layer.GetDelta();
+	double kernelError = 0, biasError = 0, inputError = 0;
+	for (Neural::ConvNode & node : layer._convNodes)
+	{
+		kernelError = max(kernelError, CheckValue(layer, weights, node.kernelDelta(0, 0),
+			[&] { return node.kernel(0, 0); },
+			[&](double _value) { node.kernel(0, 0) = _value; layer.InvalidateKernelCache(); }));
+		biasError = max(biasError, CheckValue(layer, weights, node.biasDelta,
+			[&] { return node.bias; }, [&](double _value) { node.bias = _value; }));
+	}
+	for (size_t c = 0; c < channelNum; c++)
+		for (size_t i = 0; i < m; i++)
+			for (size_t j = 0; j < n; j++)
+				inputError = max(inputError, CheckValue(layer, weights, delta[c](i, j),
+					[&] { return input[c](i, j); },
+					[&](double _value) { input[c](i, j) = _value; layer.SetInput(input); }));
+	cout << "gradients : kernel " << kernelError << "  bias " << biasError << "  input " << inputError << endl;
+
+	// The batch against the samples one by one.
+	const size_t batchSize = 5;
+	Neural::FeatureBatch inputBatch(batchSize), deltaBatch(batchSize);
+	for (size_t s = 0; s < batchSize; s++)
+	{
+		for (size_t c = 0; c < channelNum; c++)
+			inputBatch[s].push_back(MathLib::Matrix<double>(m, n, MathLib::MatrixType::Random));
+		for (size_t k = 0; k < kernelNum; k++)
+			deltaBatch[s].push_back(MathLib::Matrix<double>(m, n, MathLib::MatrixType::Random));
+	}
+	layer.SetInputBatch(inputBatch);
+	layer.SetDeltaBatch(deltaBatch);
+	layer.ForwardPropagationBatch();
+	layer.BackwardPropagationBatch();
+	vector<double> kernelSum(kernelNum, 0);
+	double featureError = 0, deltaError = 0, kernelSumError = 0;
+	for (size_t s = 0; s < batchSize; s++)
+	{
+		layer.SetInput(inputBatch[s]);
+		layer.SetDelta(deltaBatch[s]);
+		layer.ForwardPropagation();
+		layer.BackwardPropagation();
+		featureError = max(featureError, MaxError(layer.GetFeatureAll(), layer.GetFeatureBatch()[s]));
+		deltaError = max(deltaError, MaxError(layer.GetDelta(), layer.GetDeltaBatch()[s]));
+		for (size_t k = 0; k < kernelNum; k++)
+			kernelSum[k] += layer._convNodes[k].kernelDelta(0, 0);
+	}
+	layer.ForwardPropagationBatch();
+	layer.BackwardPropagationBatch();
+	for (size_t k = 0; k < kernelNum; k++)
+		kernelSumError = max(kernelSumError, abs(kernelSum[k] - layer._convNodes[k].kernelDelta(0, 0)));
+	cout << "batch : feature " << featureError << "  delta " << deltaError << "  kernel delta " << kernelSumError << endl;
+
+	// Time of a 64 kernel layer on 32 channels of 56x56, against a 64 x 32 GEMM over the raw channels
+	// with the average folded into the weights, which gives the same features.
+	const size_t size = 56, bigChannels = 32, bigKernels = 64, repeat = 20;
+	vector<MathLib::Matrix<double>> bigInput, bigDelta;
+	for (size_t c = 0; c < bigChannels; c++)
+		bigInput.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	for (size_t k = 0; k < bigKernels; k++)
+		bigDelta.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	Neural::ConvolutionalLayer big(Initor(size, size, bigKernels, Neural::ConvolutionAlgorithm::Auto));
+	big.SetInput(bigInput);
+	big.SetDelta(bigDelta);
+	big.ForwardPropagation();
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		big.ForwardPropagation();
+	auto forward = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		big.BackwardPropagation();
+	auto backward = chrono::steady_clock::now();
+
+	const size_t pixels = size * size;
+	vector<double> channels(bigChannels * pixels), packedWeights(bigKernels * bigChannels), output(bigKernels * pixels);
+	for (size_t c = 0; c < bigChannels; c++)
+		copy(bigInput[c].Data(), bigInput[c].Data() + pixels, channels.begin() + c * pixels);
+	for (size_t k = 0; k < bigKernels; k++)
+		for (size_t c = 0; c < bigChannels; c++)
+			packedWeights[k * bigChannels + c] = big.GetPackedKernels()[k] / bigChannels;
+	auto packed = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::NoTrans, bigKernels, pixels, bigChannels,
+			1.0, packedWeights.data(), bigChannels, channels.data(), pixels, 0.0, output.data(), pixels);
+	auto end = chrono::steady_clock::now();
+	double packedError = 0;
+	for (size_t k = 0; k < bigKernels; k++)
+		for (size_t p = 0; p < pixels; p++)
+			packedError = max(packedError, abs(output[k * pixels + p] + big._convNodes[k].bias - big.GetFeatureAll()[k].Data()[p]));
+	cout << "32 -> 64 channels, 1x1, 56x56 forward : " << chrono::duration<double, milli>(forward - start).count() / repeat
+		<< "ms  backward : " << chrono::duration<double, milli>(backward - forward).count() / repeat
+		<< "ms  64 x 32 GEMM on the channels : " << chrono::duration<double, milli>(end - packed).count() / repeat
+		<< "ms (error " << packedError << ")" << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // PointwiseConvDebug
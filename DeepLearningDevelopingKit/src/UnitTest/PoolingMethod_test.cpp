@@ -0,0 +1,152 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	        Pooling Method Test                                                      */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define PoolingMethodDebug
+
+#ifdef PoolingMethodDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_PoolingLayer.h"
+
+using namespace std;
+
+Neural::PoolLayerInitor Initor(const size_t _size, const size_t _pool, const size_t _stride, const Neural::PoolingMethod _method)
+{
+	Neural::PoolLayerInitor initor;
+	initor.Stride = _stride;
+	initor.InputSize = MathLib::Size(_size, _size);
+	initor.PoolSize = MathLib::Size(_pool, _pool);
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::OnePadding;
+	initor.PoolingMethod = _method;
+	return initor;
+}
+
+// Value of the padded input at (i, j) in input coordinates.
+double At(const MathLib::Matrix<double> & _input, const long long i, const long long j)
+{
+	const bool inside = i >= 0 && i < (long long)_input.ColumeSize() && j >= 0 && j < (long long)_input.RowSize();
+	return inside ? _input(i, j) : 1.0;
+}
+
+int main()
+{
+	const pair<Neural::PoolingMethod, const char *> methods[] = {
+		{ Neural::PoolingMethod::MaxPooling, "Max" },
+		{ Neural::PoolingMethod::MinPooling, "Min" },
+		{ Neural::PoolingMethod::MeanPooling, "Mean" },
+		{ Neural::PoolingMethod::RandomPooling, "Random" }
+	};
+	// Non-overlapping and overlapping windows.
+	const size_t cases[][3] = { { 12, 2, 2 }, { 11, 3, 3 }, { 13, 3, 2 }, { 10, 5, 1 }, { 9, 4, 3 } };
+
+	// Forward and backward of every method against an element by element reference.
+	for (const auto & method : methods)
+	{
+		for (const auto & c : cases)
+		{
+			const size_t size = c[0], poolSize = c[1], stride = c[2];
+			Neural::PoolingLayer pool(Initor(size, poolSize, stride, method.first));
+			const MathLib::Matrix<double> input(size, size, MathLib::MatrixType::Random);
+			pool.SetInput({ input });
+			pool.ForwardPropagation();
+			const size_t outputM = pool._outputSize.m, outputN = pool._outputSize.n;
+			const MathLib::Matrix<double> delta(outputM, outputN, MathLib::MatrixType::Random);
+			pool.SetDelta({ delta });
+			pool.BackwardPropagation();
+
+			const MathLib::Size offset = Neural::Pad::Offset(Neural::PaddingMethod::Surround, pool._paddingM, pool._paddingN);
+			MathLib::Matrix<double> referenceDelta(size, size);
+			double forwardError = 0;
+			for (size_t a = 0; a < outputM; a++)
+				for (size_t b = 0; b < outputN; b++)
+				{
+					const long long top = (long long)(a * stride) - (long long)offset.m, left = (long long)(b * stride) - (long long)offset.n;
+					const int argmax = pool.GetArgmax()[a * outputN + b];
+					double reference = 0;
+					if (method.first == Neural::PoolingMethod::MeanPooling)
+					{
+						for (long long i = top; i < top + (long long)poolSize; i++)
+							for (long long j = left; j < left + (long long)poolSize; j++)
+							{
+								reference += At(input, i, j) / (poolSize * poolSize);
+								if (i >= 0 && i < (long long)size && j >= 0 && j < (long long)size)
+									referenceDelta(i, j) += delta(a, b) / (poolSize * poolSize);
+							}
+					}
+					else if (method.first == Neural::PoolingMethod::RandomPooling)
+					{
+						// The pick has to lie in the window and carry its value.
+						bool inWindow = argmax < 0;
+						if (argmax >= 0)
+						{
+							const long long i = argmax / size, j = argmax % size;
+							inWindow = i >= top && i < top + (long long)poolSize && j >= left && j < left + (long long)poolSize;
+							referenceDelta(i, j) += delta(a, b);
+						}
+						reference = argmax >= 0 ? input(argmax / size, argmax % size) : 1.0;
+						if (!inWindow)
+							reference = INFINITY;
+					}
+					else
+					{
+						const bool isMax = method.first == Neural::PoolingMethod::MaxPooling;
+						reference = isMax ? -INFINITY : INFINITY;
+						int referenceArgmax = -1;
+						for (long long i = top; i < top + (long long)poolSize; i++)
+							for (long long j = left; j < left + (long long)poolSize; j++)
+							{
+								const double value = At(input, i, j);
+								if (isMax ? value > reference : value < reference)
+								{
+									reference = value;
+									const bool inside = i >= 0 && i < (long long)size && j >= 0 && j < (long long)size;
+									referenceArgmax = inside ? int(i * size + j) : -1;
+								}
+							}
+						if (referenceArgmax != argmax)
+							reference = INFINITY;
+						if (referenceArgmax >= 0)
+							referenceDelta(referenceArgmax / size, referenceArgmax % size) += delta(a, b);
+					}
+					forwardError = max(forwardError, abs(pool.GetFeature(0)(a, b) - reference));
+				}
+			double backwardError = 0;
+			for (size_t i = 0; i < size; i++)
+				for (size_t j = 0; j < size; j++)
+					backwardError = max(backwardError, abs(pool.GetDelta().at(0)(i, j) - referenceDelta(i, j)));
+			cout << method.second << " " << size << "x" << size << " pool " << poolSize << " stride " << stride
+				<< " forward error : " << forwardError << "  backward error : " << backwardError << endl;
+		}
+	}
+
+	// Mean pooling cost against the window size, and overlapping max pooling at stride 1.
+	const size_t size = 256, repeat = 10;
+	const MathLib::Matrix<double> image(size, size, MathLib::MatrixType::Random);
+	for (size_t poolSize = 3; poolSize <= 15; poolSize += 6)
+	{
+		for (const auto & method : { methods[2], methods[0] })
+		{
+			Neural::PoolingLayer pool(Initor(size, poolSize, 1, method.first));
+			pool.SetInput({ image });
+			auto start = chrono::steady_clock::now();
+			for (size_t r = 0; r < repeat; r++)
+				pool.ForwardPropagation();
+			auto end = chrono::steady_clock::now();
+			cout << method.second << " pool " << poolSize << "x" << poolSize << " stride 1 : "
+				<< chrono::duration<double, milli>(end - start).count() / repeat << "ms" << endl;
+		}
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // PoolingMethodDebug
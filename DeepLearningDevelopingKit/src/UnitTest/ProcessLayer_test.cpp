@@ -0,0 +1,109 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	        Process Layer Test                                                        */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define ProcessLayerDebug
+
+#ifdef ProcessLayerDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ProcessLayer.h"
+
+using namespace std;
+
+struct Activation
+{
+	const char * name;
+	double(*function)(double);
+	double(*derivative)(double);
+};
+
+int main()
+{
+	const Activation activations[] = {
+		{ "Linear", Linear, LinearDerivative },
+		{ "Sigmoid", Sigmoid, SigmoidDerivative },
+		{ "ReLU", ReLU, ReLUDerivative },
+		{ "LeakyReLU", LeakyReLU, LeakyReLUDerivative },
+		{ "ELU", ELU, ELUDerivative },
+		{ "Tanh", Tanh, TanhDerivative },
+		{ "Softplus", Softplus, SoftplusDerivative }
+	};
+	const size_t size = 128, channelNum = 8, repeat = 50;
+
+	for (const Activation & activation : activations)
+	{
+		Neural::ProcessLayerInitor initor;
+		initor.InputSize = MathLib::Size(size, size);
+		initor.ProcessFunction = activation.function;
+		initor.ProcessFunctionDerivative = activation.derivative;
+		Neural::ProcessLayer process(initor);
+
+		// Inputs within [-20, 20) plus zeros and an odd sized channel for the scalar tail.
+		vector<MathLib::Matrix<double>> input;
+		for (size_t c = 0; c < channelNum; c++)
+			input.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random) * 20.0);
+		input[0](0, 0) = 0;
+		input[0](0, 1) = -0.0;
+		input.push_back(MathLib::Matrix<double>(3, 5, MathLib::MatrixType::Random) * 20.0);
+		vector<MathLib::Matrix<double>> delta;
+		for (const MathLib::Matrix<double> & channel : input)
+			delta.push_back(MathLib::Matrix<double>(channel.ColumeSize(), channel.RowSize(), MathLib::MatrixType::Random));
+
+		// The in place kernels against the scalar functions, bit for bit.
+		vector<MathLib::Matrix<double>> output = input, outputDelta = delta;
+		process.Process(output);
+		process.Deprocess(outputDelta);
+		size_t forwardMismatch = 0, backwardMismatch = 0;
+		for (size_t c = 0; c < input.size(); c++)
+			for (size_t i = 0; i < input[c].ColumeSize(); i++)
+				for (size_t j = 0; j < input[c].RowSize(); j++)
+				{
+					const double y = activation.function(input[c](i, j));
+					if (y != output[c](i, j))
+						forwardMismatch++;
+					if (delta[c](i, j) * activation.derivative(y) != outputDelta[c](i, j))
+						backwardMismatch++;
+				}
+		input.pop_back();
+		delta.pop_back();
+
+		// Element by element through the function pointers on a copy, as the layer used to do.
+		auto start = chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; r++)
+		{
+			vector<MathLib::Matrix<double>> copy = input;
+			for (MathLib::Matrix<double> & channel : copy)
+				for (size_t i = 0; i < size; i++)
+					for (size_t j = 0; j < size; j++)
+						channel(i, j) = activation.function(channel(i, j));
+			for (size_t c = 0; c < channelNum; c++)
+				for (size_t i = 0; i < size; i++)
+					for (size_t j = 0; j < size; j++)
+						copy[c](i, j) = activation.derivative(copy[c](i, j)) * delta[c](i, j);
+		}
+		auto middle = chrono::steady_clock::now();
+		// In place with the policy kernels, the buffers are reused across repetitions.
+		vector<MathLib::Matrix<double>> features = input, features2 = delta;
+		for (size_t r = 0; r < repeat; r++)
+		{
+			process.Process(features);
+			process.Deprocess(features2);
+		}
+		auto end = chrono::steady_clock::now();
+		cout << activation.name << " forward mismatch : " << forwardMismatch << "  backward mismatch : " << backwardMismatch
+			<< "  Scalar copy : " << chrono::duration<double, milli>(middle - start).count() / repeat << "ms  Policy in place : "
+			<< chrono::duration<double, milli>(end - middle).count() / repeat << "ms" << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // ProcessLayerDebug
@@ -0,0 +1,176 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	 Separable Convolution Test                                                  */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define SeparableConvDebug
+
+#ifdef SeparableConvDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_SeparableLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+Neural::SeparableLayerInitor Initor(const size_t _inputSize, const size_t _kernelSize, const size_t _stride, const size_t _dilation,
+	const size_t _channelNum, const size_t _kernelNum)
+{
+	Neural::SeparableLayerInitor initor;
+	initor.InputSize = MathLib::Size(_inputSize, _inputSize);
+	initor.KernelSize = MathLib::Size(_kernelSize, _kernelSize);
+	initor.Stride = _stride;
+	initor.Dilation = _dilation;
+	initor.InputChannels = _channelNum;
+	initor.KernelNum = _kernelNum;
+	return initor;
+}
+
+int main()
+{
+	struct Config { size_t inputSize, kernelSize, stride, dilation, channelNum, kernelNum; };
+	const Config configs[] = {
+		{ 13, 3, 1, 1, 3, 5 },
+		{ 12, 5, 1, 1, 2, 4 },
+		{ 11, 7, 1, 1, 2, 3 },
+		{ 10, 3, 2, 1, 3, 2 },
+		{ 11, 3, 1, 2, 2, 3 },
+		{ 9, 4, 1, 1, 2, 2 }
+	};
+	for (const Config & config : configs)
+	{
+		Neural::SeparableConvLayer layer(Initor(config.inputSize, config.kernelSize, config.stride, config.dilation, config.channelNum, config.kernelNum));
+		const MathLib::Size output = layer.GetOutputSize();
+		vector<MathLib::Matrix<double>> input, weights;
+		for (size_t c = 0; c < config.channelNum; c++)
+			input.push_back(MathLib::Matrix<double>(config.inputSize, config.inputSize, MathLib::MatrixType::Random));
+		for (size_t k = 0; k < config.kernelNum; k++)
+			weights.push_back(MathLib::Matrix<double>(output.m, output.n, MathLib::MatrixType::Random));
+		layer.SetInput(input);
+		layer.ForwardPropagation();
+
+		// Reference : every channel through a one kernel ConvolutionalLayer, then the 1x1 sums by hand.
+		Neural::ConvLayerInitor convInitor;
+		convInitor.InputSize = MathLib::Size(config.inputSize, config.inputSize);
+		convInitor.KernelSize = MathLib::Size(config.kernelSize, config.kernelSize);
+		convInitor.Stride = config.stride;
+		convInitor.Dilation = config.dilation;
+		convInitor.KernelNum = 1;
+		convInitor.ActivationFunction = ActivationFunction::Linear;
+		convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+		convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+		convInitor.Algorithm = Neural::ConvolutionAlgorithm::Direct;
+		vector<MathLib::Matrix<double>> depthwise;
+		for (size_t c = 0; c < config.channelNum; c++)
+		{
+			Neural::ConvolutionalLayer conv(convInitor);
+			conv._convNodes[0] = layer._depthwiseNodes[c];
+			conv.InvalidateKernelCache();
+			conv.SetInput({ input[c] });
+			conv.ForwardPropagation();
+			depthwise.push_back(conv.GetFeature(0));
+		}
+		double forwardError = 0;
+		for (size_t k = 0; k < config.kernelNum; k++)
+		{
+			const Neural::ConvNode & node = layer._pointwiseNodes[k];
+			for (size_t i = 0; i < output.m; i++)
+				for (size_t j = 0; j < output.n; j++)
+				{
+					double sum = node.bias;
+					for (size_t c = 0; c < config.channelNum; c++)
+						sum += node.kernel(0, c) * depthwise[c](i, j);
+					forwardError = max(forwardError, abs(sum - layer.GetFeature(k)(i, j)));
+				}
+		}
+
+		layer.SetDelta(weights);
+		layer.BackwardPropagation();
+		const vector<MathLib::Matrix<double>> delta = layer.GetDelta();
+		double kernelError = 0, biasError = 0, inputError = 0;
+		for (vector<Neural::ConvNode> * nodes : { &layer._depthwiseNodes, &layer._pointwiseNodes })
+			for (Neural::ConvNode & node : *nodes)
+			{
+				const Neural::ConvKernel kernelDelta = node.kernelDelta;
+				for (size_t m = 0; m < node.kernel.ColumeSize(); m++)
+					for (size_t n = 0; n < node.kernel.RowSize(); n++)
+						kernelError = max(kernelError, CheckValue(layer, weights, kernelDelta(m, n),
+							[&] { return node.kernel(m, n); },
+							[&](double _value) { node.kernel(m, n) = _value; layer.InvalidateKernelCache(); }));
+				biasError = max(biasError, CheckValue(layer, weights, node.biasDelta,
+					[&] { return node.bias; }, [&](double _value) { node.bias = _value; }));
+			}
+		for (size_t c = 0; c < config.channelNum; c++)
+			for (size_t i = 0; i < config.inputSize; i++)
+				for (size_t j = 0; j < config.inputSize; j++)
+					inputError = max(inputError, CheckValue(layer, weights, delta[c](i, j),
+						[&] { return input[c](i, j); },
+						[&](double _value) { input[c](i, j) = _value; layer.SetInput(input); }));
+
+		cout << config.inputSize << "x" << config.inputSize << " kernel " << config.kernelSize << " stride " << config.stride
+			<< " dilation " << config.dilation << " : forward " << forwardError << "  kernel " << kernelError << "  bias " << biasError
+			<< "  input " << inputError << endl;
+	}
+
+	// Time of a 32 -> 64 channel 3x3 layer on 32x32 maps, against the same depthwise part on one kernel
+	// ConvolutionalLayers and the same pointwise part as a GEMM.
+	const size_t channelNum = 32, kernelNum = 64, size = 32, repeat = 20;
+	Neural::SeparableConvLayer layer(Initor(size, 3, 1, 1, channelNum, kernelNum));
+	vector<MathLib::Matrix<double>> input, delta;
+	for (size_t c = 0; c < channelNum; c++)
+		input.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	for (size_t k = 0; k < kernelNum; k++)
+		delta.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+	layer.SetInput(input);
+	layer.SetDelta(delta);
+	layer.ForwardPropagation();
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		layer.ForwardPropagation();
+	auto forward = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		layer.BackwardPropagation();
+	auto backward = chrono::steady_clock::now();
+
+	Neural::ConvLayerInitor convInitor;
+	convInitor.InputSize = MathLib::Size(size, size);
+	convInitor.KernelSize = MathLib::Size(3, 3);
+	convInitor.Stride = 1;
+	convInitor.KernelNum = 1;
+	convInitor.ActivationFunction = ActivationFunction::Linear;
+	convInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	convInitor.Algorithm = Neural::ConvolutionAlgorithm::Im2col;
+	vector<Neural::ConvolutionalLayer> convs(channelNum, Neural::ConvolutionalLayer(convInitor));
+	vector<double> depthwise(channelNum * size * size), pointwise(kernelNum * size * size);
+	auto generic = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+	{
+		for (size_t c = 0; c < channelNum; c++)
+		{
+			convs[c].SetInput({ input[c] });
+			convs[c].ForwardPropagation();
+			const Neural::ConvFeature feature = convs[c].GetFeature(0);
+			copy(feature.Data(), feature.Data() + size * size, depthwise.data() + c * size * size);
+		}
+		MathLib::GEMM(MathLib::Transpose::NoTrans, MathLib::Transpose::NoTrans, kernelNum, size * size, channelNum,
+			1.0, layer.GetPackedPointwise(), channelNum, depthwise.data(), size * size, 0.0, pointwise.data(), size * size);
+	}
+	auto end = chrono::steady_clock::now();
+	const double flops = 2.0 * size * size * (channelNum * 9 + channelNum * kernelNum);
+	const double forwardTime = chrono::duration<double>(forward - start).count() / repeat;
+	cout << "32 -> 64 channels, 3x3, 32x32 forward : " << forwardTime * 1000 << "ms (" << flops / forwardTime * 1e-9 << " GFLOP/s)  backward : "
+		<< chrono::duration<double, milli>(backward - forward).count() / repeat << "ms  generic path forward : "
+		<< chrono::duration<double, milli>(end - generic).count() / repeat << "ms" << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // SeparableConvDebug
@@ -0,0 +1,176 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	          Sequential Test                                                          */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define SequentialDebug
+
+#ifdef SequentialDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+int main()
+{
+	// Initors without input sizes, the model infers them.
+	Neural::ConvLayerInitor convInitor1;
+	convInitor1.Stride = 1;
+	convInitor1.KernelNum = 8;
+	convInitor1.KernelSize = MathLib::Size(3, 3);
+	convInitor1.PaddingMethod = Neural::PaddingMethod::Surround;
+	convInitor1.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	convInitor1.ActivationFunction = ActivationFunction::ReLU;
+	Neural::ConvLayerInitor convInitor2 = convInitor1;
+	convInitor2.KernelNum = 16;
+	convInitor2.KernelSize = MathLib::Size(5, 5);
+	Neural::PoolLayerInitor poolInitor;
+	poolInitor.Stride = 2;
+	poolInitor.PoolSize = MathLib::Size(2, 2);
+	poolInitor.PaddingMethod = Neural::PaddingMethod::Surround;
+	poolInitor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	poolInitor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+	Neural::ProcessLayerInitor reluInitor;
+	reluInitor.ProcessFunction = ReLU;
+	reluInitor.ProcessFunctionDerivative = ReLUDerivative;
+	Neural::ProcessLayerInitor sigmoidInitor;
+	sigmoidInitor.ProcessFunction = Sigmoid;
+	sigmoidInitor.ProcessFunctionDerivative = SigmoidDerivative;
+	Neural::FusedLayerInitor fusedInitor;
+	fusedInitor.Conv = convInitor1;
+	fusedInitor.Conv.KernelNum = 4;
+	fusedInitor.Pool = poolInitor;
+
+	Neural::SequentialInitor initor;
+	initor.InputChannels = 3;
+	initor.InputSize = MathLib::Size(32, 32);
+	Neural::Sequential model(initor);
+	Neural::ConvolutionalLayer & conv1 = model.Add(convInitor1);
+	model.Add(reluInitor);
+	model.Add(poolInitor);
+	Neural::ConvolutionalLayer & conv2 = model.Add(convInitor2);
+	model.Add(sigmoidInitor);
+	model.Add(reluInitor);
+	model.Add(poolInitor);
+	Neural::FusedConvPoolLayer & fused = model.Add(fusedInitor);
+	model.Add(sigmoidInitor);
+	cout << "Output shape : " << model.GetOutputShape().Channels << "x" << model.GetOutputShape().Size.m << "x" << model.GetOutputShape().Size.n << endl;
+
+	// The same layers wired by hand, with the same kernels.
+	convInitor1.InputSize = MathLib::Size(32, 32);
+	Neural::ConvolutionalLayer refConv1(convInitor1);
+	refConv1._convNodes = conv1._convNodes;
+	reluInitor.InputSize = MathLib::Size(32, 32);
+	Neural::ProcessLayer refRelu1(reluInitor);
+	poolInitor.InputSize = MathLib::Size(32, 32);
+	Neural::PoolingLayer refPool1(poolInitor);
+	convInitor2.InputSize = MathLib::Size(16, 16);
+	Neural::ConvolutionalLayer refConv2(convInitor2);
+	refConv2._convNodes = conv2._convNodes;
+	sigmoidInitor.InputSize = MathLib::Size(16, 16);
+	Neural::ProcessLayer refSigmoid2(sigmoidInitor);
+	reluInitor.InputSize = MathLib::Size(16, 16);
+	Neural::ProcessLayer refRelu2(reluInitor);
+	poolInitor.InputSize = MathLib::Size(16, 16);
+	Neural::PoolingLayer refPool2(poolInitor);
+	fusedInitor.Conv.InputSize = MathLib::Size(8, 8);
+	fusedInitor.Training = true;
+	Neural::FusedConvPoolLayer refFused(fusedInitor);
+	refFused._conv._convNodes = fused._conv._convNodes;
+	sigmoidInitor.InputSize = MathLib::Size(4, 4);
+	Neural::ProcessLayer refSigmoid3(sigmoidInitor);
+
+	for (size_t step = 0; step < 3; step++)
+	{
+		vector<MathLib::Matrix<double>> input, delta;
+		for (size_t c = 0; c < 3; c++)
+			input.push_back(MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random));
+		for (size_t c = 0; c < 4; c++)
+			delta.push_back(MathLib::Matrix<double>(4, 4, MathLib::MatrixType::Random));
+
+		model.SetInput(input);
+		model.ForwardPropagation();
+		const double * outputBuffer = model.GetOutput().front().Data();
+		model.SetDelta(delta);
+		model.BackwardPropagation();
+
+		refConv1.SetInput(input);
+		refConv1.ForwardPropagation();
+		refRelu1.SetInput(refConv1.GetFeatureAll());
+		refRelu1.Process();
+		refPool1.SetInput(refRelu1.GetOutputAll());
+		refPool1.ForwardPropagation();
+		refConv2.SetInput(refPool1.GetFeatureAll());
+		refConv2.ForwardPropagation();
+		refSigmoid2.SetInput(refConv2.GetFeatureAll());
+		refSigmoid2.Process();
+		refRelu2.SetInput(refSigmoid2.GetOutputAll());
+		refRelu2.Process();
+		refPool2.SetInput(refRelu2.GetOutputAll());
+		refPool2.ForwardPropagation();
+		refFused.SetInput(refPool2.GetFeatureAll());
+		refFused.ForwardPropagation();
+		refSigmoid3.SetInput(refFused.GetFeatureAll());
+		refSigmoid3.Process();
+		const vector<MathLib::Matrix<double>> refOutput = refSigmoid3.GetOutputAll();
+
+		refSigmoid3.SetInput(delta);
+		refSigmoid3.Deprocess();
+		refFused.SetDelta(refSigmoid3.GetOutputAll());
+		refFused.BackwardPropagation();
+		refPool2.SetDelta(refFused.GetDelta());
+		refPool2.BackwardPropagation();
+		refRelu2.SetInput(refPool2.GetDelta());
+		refRelu2.Deprocess();
+		refSigmoid2.SetInput(refRelu2.GetOutputAll());
+		refSigmoid2.Deprocess();
+		refConv2.SetDelta(refSigmoid2.GetOutputAll());
+		refConv2.BackwardPropagation();
+		refPool1.SetDelta(refConv2.GetDelta());
+		refPool1.BackwardPropagation();
+		refRelu1.SetInput(refPool1.GetDelta());
+		refRelu1.Deprocess();
+		refConv1.SetDelta(refRelu1.GetOutputAll());
+		refConv1.BackwardPropagation();
+
+		double kernelError = 0;
+		for (size_t k = 0; k < conv2._convNodes.size(); k++)
+			kernelError = max(kernelError, MaxError({ conv2._convNodes[k].kernelDelta }, { refConv2._convNodes[k].kernelDelta }));
+		for (size_t k = 0; k < conv1._convNodes.size(); k++)
+			kernelError = max(kernelError, MaxError({ conv1._convNodes[k].kernelDelta }, { refConv1._convNodes[k].kernelDelta }));
+		cout << "Step " << step << " output error : " << MaxError(model.GetOutput(), refOutput)
+			<< "  input delta error : " << MaxError(model.GetDelta(), refConv1.GetDelta())
+			<< "  kernel delta error : " << kernelError
+			<< "  same output buffer : " << (outputBuffer == model.GetOutput().front().Data()) << endl;
+	}
+	model.PrintSummary();
+
+	// Inference only keeps the activations of two neighbouring layers.
+	model.SetTraining(false);
+	vector<MathLib::Matrix<double>> input(3, MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random));
+	model.SetInput(input);
+	model.ForwardPropagation();
+	model.PrintSummary();
+
+	// A copy of the output is a snapshot, the next forward propagation reuses the arena but not the copy.
+	const vector<MathLib::Matrix<double>> snapshot = model.GetOutput();
+	MathLib::Matrix<double> before(snapshot.front().ColumeSize(), snapshot.front().RowSize());
+	std::copy(snapshot.front().Data(), snapshot.front().Data() + before.ColumeSize() * before.RowSize(), before.Data());
+	model.SetInput(vector<MathLib::Matrix<double>>(3, MathLib::Matrix<double>(32, 32, MathLib::MatrixType::Random)));
+	model.ForwardPropagation();
+	cout << "Output snapshot kept : " << (MaxError({ snapshot.front() }, { before }) == 0)
+		<< "  arena reused : " << (MaxError({ model.GetOutput().front() }, { before }) > 0) << endl;
+
+	system("pause");
+	return 0;
+}
+
+#endif // SequentialDebug
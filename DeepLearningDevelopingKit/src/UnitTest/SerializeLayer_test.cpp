@@ -0,0 +1,130 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	       Serialize Layer Test                                                       */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define SerializeLayerViewDebug
+
+#ifdef SerializeLayerViewDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_SerializeLayer.h"
+
+using namespace std;
+
+// The copies the layer and the examples used to make, with the row-major index done right.
+MathLib::Matrix<double> CopySerialize(const vector<MathLib::Matrix<double>> & _features)
+{
+	const size_t m = _features[0].ColumeSize(), n = _features[0].RowSize();
+	MathLib::Matrix<double> serialized(_features.size() * m * n, 1);
+	for (size_t i = 0; i < _features.size(); i++)
+		for (size_t a = 0; a < m; a++)
+			for (size_t b = 0; b < n; b++)
+				serialized(i * m * n + a * n + b, 0) = _features[i](a, b);
+	return serialized;
+}
+
+MathLib::Vector<double> Matrix2Vector(const MathLib::Matrix<double> & _mat)
+{
+	MathLib::Vector<double> vec(_mat.ColumeSize());
+	for (size_t i = 0; i < _mat.ColumeSize(); i++)
+		vec(i) = _mat(i, 0);
+	return vec;
+}
+
+// Buffer address, without detaching a shared Matrix.
+const double * Address(const MathLib::Matrix<double> & _mat)
+{
+	return _mat.Data();
+}
+
+int main()
+{
+	// Non square feature maps, where the old a * m + b index overlapped.
+	const size_t m = 6, n = 9, channelNum = 64, repeat = 1000;
+	Neural::SerializeLayerInitor initor;
+	initor.SerializeSize = MathLib::Size(m * n * channelNum, 1);
+	initor.DeserializeSize = MathLib::Size(m, n);
+	Neural::SerializeLayer serial(initor);
+
+	vector<MathLib::Matrix<double>> features;
+	for (size_t c = 0; c < channelNum; c++)
+		features.push_back(MathLib::Matrix<double>(m, n, MathLib::MatrixType::Random));
+	const MathLib::Matrix<double> reference = CopySerialize(features);
+
+	// Separate feature maps are gathered once, in row-major order.
+	serial.SetDeserializedMat(features);
+	const MathLib::Matrix<double> serialized = serial.Serialize();
+	size_t mismatch = 0;
+	for (size_t i = 0; i < reference.ColumeSize(); i++)
+		if (serialized(i, 0) != reference(i, 0))
+			mismatch++;
+	cout << "Serialize mismatches : " << mismatch << endl;
+
+	// Deserialize hands out views of the serialized buffer, serializing them again is a reshape.
+	const vector<MathLib::Matrix<double>> deserialized = serial.Deserialize();
+	mismatch = 0;
+	bool views = true;
+	for (size_t c = 0; c < channelNum; c++)
+	{
+		views = views && Address(deserialized[c]) == Address(serialized) + c * m * n;
+		for (size_t a = 0; a < m; a++)
+			for (size_t b = 0; b < n; b++)
+				if (deserialized[c](a, b) != features[c](a, b))
+					mismatch++;
+	}
+	serial.SetDeserializedMat(deserialized);
+	const bool reshaped = Address(serial.Serialize()) == Address(serialized);
+	cout << "Deserialize mismatches : " << mismatch << "  views : " << views << "  reshaped : " << reshaped << endl;
+
+	// Writing to one view copies that view only.
+	vector<MathLib::Matrix<double>> written = deserialized;
+	written[1](0, 0) = 42;
+	cout << "Copy on write : " << (serialized(m * n, 0) == reference(m * n, 0)) << (Address(written[0]) == Address(serialized)) << endl;
+
+	// Through a Vector, the buffer moves across the boundary in both directions.
+	MathLib::Vector<double> delta(m * n * channelNum, MathLib::VectorType::Random);
+	const double * deltaData = static_cast<const MathLib::Vector<double> &>(delta).data();
+	vector<MathLib::Matrix<double>> deltaMaps = serial.DeserializeVector(std::move(delta));
+	const bool adopted = Address(deltaMaps[0]) == deltaData;
+	serial.SetDeserializedMat(features);
+	features.clear();
+	MathLib::Vector<double> vec = serial.SerializeVector();
+	mismatch = 0;
+	for (size_t i = 0; i < vec.Size(); i++)
+		if (vec(i) != reference(i, 0))
+			mismatch++;
+	cout << "Vector mismatches : " << mismatch << "  adopted : " << adopted << endl;
+
+	// Cost of the boundary : copy and copy again, against views.
+	for (size_t c = 0; c < channelNum; c++)
+		features.push_back(reference.Reshape(channelNum * m, n).Split(m, n)[c]);
+	auto start = chrono::steady_clock::now();
+	double checksum = 0;
+	for (size_t r = 0; r < repeat; r++)
+	{
+		MathLib::Vector<double> copied = Matrix2Vector(CopySerialize(features));
+		checksum += copied(r % copied.Size());
+	}
+	auto middle = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+	{
+		serial.SetDeserializedMat(features);
+		MathLib::Matrix<double> flat = serial.Serialize();
+		serial.SetSerializedMat(flat);
+		checksum += serial.Deserialize()[r % channelNum](0, 0);
+	}
+	auto end = chrono::steady_clock::now();
+	cout << "Copy : " << chrono::duration<double, micro>(middle - start).count() / repeat << "us  View : "
+		<< chrono::duration<double, micro>(end - middle).count() / repeat << "us  (" << checksum << ")" << endl;
+
+	system("pause");
+	return 0;
+}
+
+#endif // SerializeLayerViewDebug
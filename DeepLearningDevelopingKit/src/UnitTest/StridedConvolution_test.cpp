@@ -0,0 +1,120 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	     Strided Convolution Test                                                  */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define StridedConvolutionDebug
+
+#ifdef StridedConvolutionDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+
+using namespace std;
+
+Neural::ConvolutionalLayer MakeLayer(const size_t _inputSize, const size_t _kernelSize, const size_t _stride, const size_t _dilation)
+{
+	Neural::ConvLayerInitor initor;
+	initor.InputSize = MathLib::Size(_inputSize, _inputSize);
+	initor.KernelSize = MathLib::Size(_kernelSize, _kernelSize);
+	initor.Stride = _stride;
+	initor.Dilation = _dilation;
+	initor.KernelNum = 4;
+	initor.ActivationFunction = ActivationFunction::Linear;
+	initor.PaddingMethod = Neural::PaddingMethod::Surround;
+	initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+	return Neural::ConvolutionalLayer(initor);
+}
+
+// Feature of kernel k computed tap by tap from the definition.
+Neural::ConvFeature Reference(const Neural::ConvolutionalLayer & _layer, const MathLib::Matrix<double> & _input, const size_t _k)
+{
+	const Neural::ConvKernel & kernel = _layer._convNodes.at(_k).kernel;
+	const long long kernelM = kernel.ColumeSize(), kernelN = kernel.RowSize();
+	const long long inputM = _input.ColumeSize(), inputN = _input.RowSize();
+	const MathLib::Size output = _layer.GetOutputSize();
+	Neural::ConvFeature feature(output.m, output.n);
+	for (size_t i = 0; i < output.m; i++)
+		for (size_t j = 0; j < output.n; j++)
+		{
+			double sum = _layer._convNodes.at(_k).bias;
+			for (long long u = 0; u < kernelM; u++)
+				for (long long v = 0; v < kernelN; v++)
+				{
+					const long long row = (long long)(i * _layer._stride) + u * (long long)_layer._dilation - (long long)_layer._paddingM;
+					const long long column = (long long)(j * _layer._stride) + v * (long long)_layer._dilation - (long long)_layer._paddingN;
+					if (row >= 0 && row < inputM && column >= 0 && column < inputN)
+						sum += _input(row, column) * kernel(kernelM - 1 - u, kernelN - 1 - v);
+				}
+			feature(i, j) = sum;
+		}
+	return feature;
+}
+
+// Milliseconds per forward propagation.
+double Time(Neural::ConvolutionalLayer & _layer, const size_t _repeat)
+{
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < _repeat; r++)
+		_layer.ForwardPropagation();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / _repeat;
+}
+
+int main()
+{
+	const pair<Neural::ConvolutionAlgorithm, const char *> algorithms[] = {
+		{ Neural::ConvolutionAlgorithm::Direct, "Direct" },
+		{ Neural::ConvolutionAlgorithm::Im2col, "Im2col" },
+		{ Neural::ConvolutionAlgorithm::FFT, "FFT" },
+		{ Neural::ConvolutionAlgorithm::Auto, "Auto" }
+	};
+	const MathLib::Matrix<double> input(33, 33, MathLib::MatrixType::Random);
+	for (size_t kernelSize : { 3, 5 })
+		for (size_t stride : { 1, 2, 3 })
+			for (size_t dilation : { 1, 2 })
+			{
+				Neural::ConvolutionalLayer layer = MakeLayer(33, kernelSize, stride, dilation);
+				layer.SetInput({ input });
+				cout << kernelSize << "x" << kernelSize << " stride " << stride << " dilation " << dilation << " output "
+					<< layer.GetOutputSize().m << "x" << layer.GetOutputSize().n << " max error :";
+				for (const auto & algorithm : algorithms)
+				{
+					layer.SetAlgorithm(algorithm.first);
+					layer.ForwardPropagation();
+					double error = 0;
+					for (size_t k = 0; k < 4; k++)
+					{
+						const Neural::ConvFeature reference = Reference(layer, input, k);
+						const Neural::ConvFeature feature = layer.GetFeature(k);
+						if (feature.ColumeSize() != reference.ColumeSize() || feature.RowSize() != reference.RowSize())
+							error = INFINITY;
+						else
+							for (size_t i = 0; i < feature.ColumeSize(); i++)
+								for (size_t j = 0; j < feature.RowSize(); j++)
+									error = max(error, abs(feature(i, j) - reference(i, j)));
+					}
+					cout << " " << algorithm.second << " " << error;
+				}
+				cout << endl;
+			}
+
+	// A stride 2 layer does a quarter of the work of a stride 1 layer.
+	const MathLib::Matrix<double> image(128, 128, MathLib::MatrixType::Random);
+	for (size_t stride : { 1, 2 })
+	{
+		Neural::ConvolutionalLayer layer = MakeLayer(128, 5, stride, 1);
+		layer.SetInput({ image });
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Im2col);
+		cout << "128x128 5x5 stride " << stride << " Im2col : " << Time(layer, 20) << "ms" << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // StridedConvolutionDebug
@@ -0,0 +1,105 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	           Unit Test Utility                                                         */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+#pragma once
+
+// Header files
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "..\MathLib\MathLib.h"
+
+/// Comparison and finite difference helpers shared by the unit tests.
+
+// Max Error
+/// Largest absolute difference between two matrices, infinity if their sizes differ.
+inline double MaxError(const MathLib::Matrix<double> & _first, const MathLib::Matrix<double> & _second)
+{
+	if (_first.ColumeSize() != _second.ColumeSize() || _first.RowSize() != _second.RowSize())
+		return INFINITY;
+	double error = 0;
+	for (size_t i = 0; i < _first.ColumeSize(); i++)
+		for (size_t j = 0; j < _first.RowSize(); j++)
+			error = std::max(error, std::abs(_first(i, j) - _second(i, j)));
+	return error;
+}
+
+// Max Error
+/// Largest absolute difference between two sets of matrices, infinity if their sizes differ.
+inline double MaxError(const std::vector<MathLib::Matrix<double>> & _first, const std::vector<MathLib::Matrix<double>> & _second)
+{
+	if (_first.size() != _second.size())
+		return INFINITY;
+	double error = 0;
+	for (size_t k = 0; k < _first.size(); k++)
+		error = std::max(error, MaxError(_first[k], _second[k]));
+	return error;
+}
+
+// Random Batch
+/// Random maps, channel c scaled by c + 1 so that the channels differ in spread, then shifted by _offset.
+inline std::vector<std::vector<MathLib::Matrix<double>>> RandomBatch(const size_t _batchSize, const size_t _channels, const MathLib::Size _size, const double _offset = 0)
+{
+	std::vector<std::vector<MathLib::Matrix<double>>> batch(_batchSize);
+	for (size_t n = 0; n < _batchSize; n++)
+		for (size_t c = 0; c < _channels; c++)
+		{
+			MathLib::Matrix<double> map(_size.m, _size.n, MathLib::MatrixType::Random);
+			for (size_t i = 0; i < _size.m; i++)
+				for (size_t j = 0; j < _size.n; j++)
+					map(i, j) = map(i, j) * (c + 1) + _offset;
+			batch[n].push_back(map);
+		}
+	return batch;
+}
+
+// Weighted Sum
+/// Sum of weight * value, a loss whose gradient with respect to the values is the weights.
+inline double WeightedSum(const std::vector<MathLib::Matrix<double>> & _values, const std::vector<MathLib::Matrix<double>> & _weights)
+{
+	double sum = 0;
+	for (size_t k = 0; k < _weights.size(); k++)
+		for (size_t i = 0; i < _weights[k].ColumeSize(); i++)
+			for (size_t j = 0; j < _weights[k].RowSize(); j++)
+				sum += _weights[k](i, j) * _values[k](i, j);
+	return sum;
+}
+
+// Loss
+/// Weighted sum of the features of one forward propagation.
+template<class Layer>
+double Loss(Layer & _layer, const std::vector<MathLib::Matrix<double>> & _weights)
+{
+	_layer.ForwardPropagation();
+	return WeightedSum(_layer.GetFeatureAll(), _weights);
+}
+
+// Loss
+/// Weighted sum of the features of one batch forward propagation.
+template<class Layer>
+double Loss(Layer & _layer, const std::vector<std::vector<MathLib::Matrix<double>>> & _weights)
+{
+	_layer.ForwardPropagationBatch();
+	double loss = 0;
+	for (size_t n = 0; n < _weights.size(); n++)
+		loss += WeightedSum(_layer.GetFeatureBatch()[n], _weights[n]);
+	return loss;
+}
+
+// Check Value
+/// Relative error of the analytic gradient of one value against a central difference of the loss.
+template<class Layer, class Weights, class Get, class Set>
+double CheckValue(Layer & _layer, const Weights & _weights, const double _analytic, Get _get, Set _set)
+{
+	const double h = 1e-5, value = _get();
+	_set(value + h);
+	const double plus = Loss(_layer, _weights);
+	_set(value - h);
+	const double minus = Loss(_layer, _weights);
+	_set(value);
+	const double numeric = (plus - minus) / (2 * h);
+	return std::abs(numeric - _analytic) / std::max(1.0, std::abs(numeric));
+}
@@ -0,0 +1,120 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	        Virtual Padding Test                                                     */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define VirtualPaddingDebug
+
+#ifdef VirtualPaddingDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_PoolingLayer.h"
+#include "UnitTest.h"
+
+using namespace std;
+
+// Padded matrix built element by element.
+MathLib::Matrix<double> ReferencePadding(const MathLib::Matrix<double> & _input, const Neural::PaddingMethod _method, const double _value, const size_t _sizeM, const size_t _sizeN)
+{
+	const MathLib::Size size = Neural::Pad::PaddedSize(_input.GetSize(), _method, _sizeM, _sizeN);
+	const MathLib::Size offset = Neural::Pad::Offset(_method, _sizeM, _sizeN);
+	MathLib::Matrix<double> output(size.m, size.n);
+	for (size_t i = 0; i < size.m; i++)
+		for (size_t j = 0; j < size.n; j++)
+		{
+			const bool inside = i >= offset.m && i < offset.m + _input.ColumeSize() && j >= offset.n && j < offset.n + _input.RowSize();
+			output(i, j) = inside ? _input(i - offset.m, j - offset.n) : _value;
+		}
+	return output;
+}
+
+int main()
+{
+	const MathLib::Matrix<double> input(7, 9, MathLib::MatrixType::Random);
+	const pair<Neural::PaddingMethod, const char *> methods[] = {
+		{ Neural::PaddingMethod::LeftUp, "LeftUp" },
+		{ Neural::PaddingMethod::LeftDown, "LeftDown" },
+		{ Neural::PaddingMethod::RightUp, "RightUp" },
+		{ Neural::PaddingMethod::RightDown, "RightDown" },
+		{ Neural::PaddingMethod::Surround, "Surround" }
+	};
+
+	// Row copy padding against the element by element reference.
+	for (const auto & method : methods)
+	{
+		const double zero = MaxError(Neural::Pad::Padding(input, method.first, Neural::PaddingNum::ZeroPadding, 2, 1), ReferencePadding(input, method.first, 0, 2, 1));
+		const double one = MaxError(Neural::Pad::Padding(input, method.first, Neural::PaddingNum::OnePadding, 2, 1), ReferencePadding(input, method.first, 1, 2, 1));
+		cout << "Padding " << method.second << " error : " << zero << " " << one << endl;
+	}
+
+	// Max pooling with virtual padding against pooling the materialized padded input.
+	for (const auto & method : methods)
+	{
+		Neural::PoolLayerInitor initor;
+		initor.Stride = 2;
+		initor.InputSize = MathLib::Size(7, 9);
+		initor.PoolSize = MathLib::Size(3, 3);
+		initor.PaddingMethod = method.first;
+		initor.PaddingNum = Neural::PaddingNum::OnePadding;
+		initor.PoolingMethod = Neural::PoolingMethod::MaxPooling;
+		Neural::PoolingLayer pool(initor);
+		pool.SetInput({ input });
+		pool.ForwardPropagation();
+
+		const MathLib::Matrix<double> padded = ReferencePadding(input, method.first, 1, pool._paddingM, pool._paddingN);
+		MathLib::Matrix<double> reference(pool._outputSize.m, pool._outputSize.n);
+		for (size_t a = 0; a < pool._outputSize.m; a++)
+			for (size_t b = 0; b < pool._outputSize.n; b++)
+			{
+				double max = -INFINITY;
+				for (size_t i = a * 2; i < a * 2 + 3; i++)
+					for (size_t j = b * 2; j < b * 2 + 3; j++)
+						if (i < padded.ColumeSize() && j < padded.RowSize() && max < padded(i, j))
+							max = padded(i, j);
+				reference(a, b) = max;
+			}
+		cout << "Max pooling " << method.second << " error : " << MaxError(pool.GetFeature(0), reference) << endl;
+	}
+
+	// Convolution with virtual padding against a sliding window on the padded copy.
+	const size_t size = 64, kernelSize = 5;
+	const MathLib::Matrix<double> image(size, size, MathLib::MatrixType::Random);
+	const MathLib::Matrix<double> kernel(kernelSize, kernelSize, MathLib::MatrixType::Random);
+	const Neural::ConvGeometry geometry(MathLib::Size(size, size), MathLib::Size(kernelSize, kernelSize),
+		MathLib::Size(kernelSize / 2, kernelSize / 2), 1, MathLib::Size(size, size));
+	MathLib::Matrix<double> virtualOutput(size, size), paddedOutput(size, size);
+	const size_t repeat = 100;
+
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+		Neural::Convolution::Correlate(image.Data(), geometry, kernel.Data(), 0, virtualOutput.Data());
+	auto middle = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; r++)
+	{
+		const MathLib::Matrix<double> padded = Neural::Pad::Padding(image, Neural::PaddingMethod::Surround, Neural::PaddingNum::ZeroPadding, kernelSize / 2, kernelSize / 2);
+		for (size_t i = 0; i < size; i++)
+			for (size_t j = 0; j < size; j++)
+			{
+				double sum = 0;
+				for (size_t u = 0; u < kernelSize; u++)
+					for (size_t v = 0; v < kernelSize; v++)
+						sum += padded(i + u, j + v) * kernel(u, v);
+				paddedOutput(i, j) = sum;
+			}
+	}
+	auto end = chrono::steady_clock::now();
+	cout << "Correlate error : " << MaxError(virtualOutput, paddedOutput) << endl;
+	cout << "Virtual padding : " << chrono::duration<double, milli>(middle - start).count() / repeat << "ms  Padded copy : "
+		<< chrono::duration<double, milli>(end - middle).count() / repeat << "ms" << endl;
+
+	system("pause");
+	return 0;
+}
+#endif // VirtualPaddingDebug
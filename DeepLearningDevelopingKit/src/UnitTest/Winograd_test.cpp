@@ -0,0 +1,119 @@
+﻿/***************************************************************************************************/
+/*                                               Deep Learning Developing Kit                                                   */
+/*								        		 	     Winograd Convolution Test                                               */
+/*                                                   www.tianshicangxie.com                                                        */
+/*                                      Copyright © 2015-2018 Celestial Tech Inc.                                          */
+/***************************************************************************************************/
+
+// #define WinogradDebug
+
+#ifdef WinogradDebug
+
+// Header files
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "..\Algorithm\NeuralNetwork\ConvolutionalNeuralNetwork\CNN_ConvolutionalLayer.h"
+
+using namespace std;
+
+// Largest error of Winograd against a long double cross-correlation, relative to the largest output.
+template<class T>
+double RelativeError(const Neural::WinogradTile _tile, const size_t _m, const size_t _n, const size_t _padding)
+{
+	const size_t kernelNum = 4;
+	const MathLib::Size output(_m + 2 * _padding - 2, _n + 2 * _padding - 2);
+	const Neural::ConvGeometry geometry(MathLib::Size(_m, _n), MathLib::Size(3, 3), MathLib::Size(_padding, _padding), 1, output);
+	mt19937 engine(11);
+	uniform_real_distribution<double> distribution(-1, 1);
+	vector<T> input(_m * _n), kernels(kernelNum * 9), result(kernelNum * geometry.OutputPixels());
+	for (T & x : input) x = T(distribution(engine));
+	for (T & x : kernels) x = T(distribution(engine));
+
+	Neural::Winograd<T> winograd(_tile);
+	vector<T> transformed;
+	winograd.TransformKernels(kernels.data(), kernelNum, transformed);
+	winograd.Forward(input.data(), geometry, transformed.data(), kernelNum, result.data());
+
+	double error = 0, scale = 0;
+	for (size_t k = 0; k < kernelNum; k++)
+		for (size_t i = 0; i < output.m; i++)
+			for (size_t j = 0; j < output.n; j++)
+			{
+				long double sum = 0;
+				for (size_t u = 0; u < 3; u++)
+					for (size_t v = 0; v < 3; v++)
+					{
+						const long long row = (long long)(i + u) - (long long)_padding, column = (long long)(j + v) - (long long)_padding;
+						if (row >= 0 && row < (long long)_m && column >= 0 && column < (long long)_n)
+							sum += (long double)input[row * _n + column] * kernels[k * 9 + u * 3 + v];
+					}
+				error = max(error, (double)fabsl(sum - result[k * geometry.OutputPixels() + i * output.n + j]));
+				scale = max(scale, (double)fabsl(sum));
+			}
+	return error / scale;
+}
+
+template<class T>
+void ErrorTable(const char * _type)
+{
+	for (Neural::WinogradTile tile : { Neural::WinogradTile::F2x2, Neural::WinogradTile::F4x4 })
+	{
+		cout << _type << (tile == Neural::WinogradTile::F2x2 ? " F(2x2,3x3)" : " F(4x4,3x3)")
+			<< "  32x32 same : " << RelativeError<T>(tile, 32, 32, 1)
+			<< "  7x9 same : " << RelativeError<T>(tile, 7, 9, 1)
+			<< "  13x10 valid : " << RelativeError<T>(tile, 13, 10, 0) << endl;
+	}
+}
+
+int main()
+{
+	// Numerical error against the exact cross-correlation.
+	ErrorTable<float>("float ");
+	ErrorTable<double>("double");
+
+	// The layer paths agree with the direct path and are timed against im2col.
+	for (size_t size : { 8, 64 })
+	{
+		Neural::ConvLayerInitor initor;
+		initor.InputSize = MathLib::Size(size, size);
+		initor.KernelSize = MathLib::Size(3, 3);
+		initor.Stride = 1;
+		initor.KernelNum = 10;
+		initor.ActivationFunction = ActivationFunction::Linear;
+		initor.PaddingMethod = Neural::PaddingMethod::Surround;
+		initor.PaddingNum = Neural::PaddingNum::ZeroPadding;
+		Neural::ConvolutionalLayer layer(initor);
+		vector<MathLib::Matrix<double>> input;
+		for (size_t c = 0; c < 5; c++)
+			input.push_back(MathLib::Matrix<double>(size, size, MathLib::MatrixType::Random));
+		layer.SetInput(input);
+		layer.SetAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+		layer.ForwardPropagation();
+		const vector<Neural::ConvFeature> reference = layer.GetFeatureAll();
+
+		cout << size << "x" << size << ", 10 kernels :";
+		for (Neural::ConvolutionAlgorithm algorithm : { Neural::ConvolutionAlgorithm::Im2col, Neural::ConvolutionAlgorithm::Winograd2x2, Neural::ConvolutionAlgorithm::Winograd4x4 })
+		{
+			layer.SetAlgorithm(algorithm);
+			auto start = chrono::steady_clock::now();
+			for (size_t r = 0; r < 200; r++)
+				layer.ForwardPropagation();
+			const double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / 200;
+			double error = 0;
+			for (size_t k = 0; k < reference.size(); k++)
+				for (size_t i = 0; i < size; i++)
+					for (size_t j = 0; j < size; j++)
+						error = max(error, abs(reference[k](i, j) - layer.GetFeature(k)(i, j)));
+			cout << (algorithm == Neural::ConvolutionAlgorithm::Im2col ? "  Im2col " : algorithm == Neural::ConvolutionAlgorithm::Winograd2x2 ? "  F2x2 " : "  F4x4 ")
+				<< elapsed << "ms (error " << error << ")";
+		}
+		cout << endl;
+	}
+
+	system("pause");
+	return 0;
+}
+#endif // WinogradDebug